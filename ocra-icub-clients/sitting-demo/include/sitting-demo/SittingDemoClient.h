@@ -2,7 +2,8 @@
 #define SITTINGDEMOCLIENT_H
 
 #include <ocra-icub/IcubClient.h>
-#include <ocra-recipes/TrajectoryThread.h>
+#include <ocra-icub/GainProfile.h>
+#include <ocra-icub/OnlineTrajectoryThread.h>
 #include <ocra-recipes/ControllerClient.h>
 
 
@@ -24,12 +25,17 @@ protected:
 private:
 
     void moveCom();
+    void changeGains(const Eigen::MatrixXd& stiffness, const Eigen::MatrixXd& damping);
     std::string taskName;
     ocra_recipes::TaskConnection::Ptr comTask;
-    ocra_recipes::TrajectoryThread::Ptr comTrajThread;
+    ocra_icub::OnlineTrajectoryThread::shared_ptr comTrajThread;
+    double maxVel;
+    double maxAcc;
     double xDisp, yDisp, zDisp;
     Eigen::Vector3d currentDesiredPosition;
     Eigen::MatrixXd Kp, Kd;
+    ocra_icub::GainProfileSender::shared_ptr gainSender;
+    double gainTransitionTime;
 };
 
 
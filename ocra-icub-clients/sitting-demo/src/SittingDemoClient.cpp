@@ -5,6 +5,9 @@ SittingDemoClient::SittingDemoClient(std::shared_ptr<ocra::Model> modelPtr, cons
     xDisp = 0.0;
     yDisp = 0.0;
     zDisp = 0.0;
+    gainTransitionTime = 1.0;
+    maxVel = 0.01;
+    maxAcc = 0.02;
 }
 
 SittingDemoClient::~SittingDemoClient()
@@ -28,6 +31,15 @@ bool SittingDemoClient::configure(yarp::os::ResourceFinder &rf)
     if (rf.check("z")) {
         zDisp = rf.find("z").asDouble();
     }
+    if (rf.check("gainTransitionTime")) {
+        gainTransitionTime = rf.find("gainTransitionTime").asDouble();
+    }
+    if (rf.check("maxVel")) {
+        maxVel = rf.find("maxVel").asDouble();
+    }
+    if (rf.check("maxAcc")) {
+        maxAcc = rf.find("maxAcc").asDouble();
+    }
 }
 
 bool SittingDemoClient::initialize()
@@ -35,23 +47,26 @@ bool SittingDemoClient::initialize()
     yarp::os::Time::delay(2.0);
     comTask = std::make_shared<ocra_recipes::TaskConnection>(taskName);
 
-    ocra_recipes::TRAJECTORY_TYPE trajType = ocra_recipes::MIN_JERK;
-
     currentDesiredPosition = comTask->getDesiredTaskState().getPosition().getTranslation();
 
-    ocra_recipes::TERMINATION_STRATEGY termStrategy = ocra_recipes::NONE;
-
-    comTrajThread = std::make_shared<ocra_recipes::TrajectoryThread>(10, taskName, currentDesiredPosition, trajType, termStrategy);
-
-    comTrajThread->setMaxVelocity(0.01);
+    // New goals are taken on the fly, from the current position and velocity of the trajectory.
+    comTrajThread = std::make_shared<ocra_icub::OnlineTrajectoryThread>(10, taskName, maxVel, maxAcc);
     comTrajThread->start();
 
+    // Gain changes are interpolated by the server, so each one is a single message.
+    gainSender = std::make_shared<ocra_icub::GainProfileSender>("sitting-demo");
+    if (!gainSender->open()) {
+        return false;
+    }
+
     return true;
 }
 
 void SittingDemoClient::release()
 {
-    // add your code here...
+    if (gainSender) {
+        gainSender->close();
+    }
 }
 
 void SittingDemoClient::loop()
@@ -112,17 +127,17 @@ void SittingDemoClient::loop()
             zDisp = value / 100.0; // cm to m
             moveCom();
         } else if ( key == "kp") {
-            comTask->setStiffness(value);
+            changeGains(Eigen::MatrixXd::Constant(1, 1, value), Eigen::MatrixXd());
         } else if ( key == "kd") {
-            comTask->setDamping(value);
+            changeGains(Eigen::MatrixXd(), Eigen::MatrixXd::Constant(1, 1, value));
         } else if ( key == "kpz") {
-            Eigen::MatrixXd kpMat = comTask->getStiffnessMatrix();
+            Eigen::MatrixXd kpMat = Kp;
             kpMat(2,2) = value;
-            comTask->setStiffness(kpMat);
+            changeGains(kpMat, Eigen::MatrixXd());
         } else if ( key == "kdz") {
-            Eigen::MatrixXd kdMat = comTask->getDampingMatrix();
+            Eigen::MatrixXd kdMat = Kd;
             kdMat(2,2) = value;
-            comTask->setDamping(kdMat);
+            changeGains(Eigen::MatrixXd(), kdMat);
         } else {
             std::cout << "Error BAD KEY" << std::endl;
         }
@@ -132,11 +147,23 @@ void SittingDemoClient::loop()
 
 void SittingDemoClient::moveCom()
 {
-    currentDesiredPosition = comTask->getDesiredTaskState().getPosition().getTranslation();
+    // Displacements add up to the goal of the running motion, even if it has not been reached yet.
+    currentDesiredPosition = comTrajThread->getGoal();
 
     currentDesiredPosition(0) += xDisp;
     currentDesiredPosition(1) += yDisp;
     currentDesiredPosition(2) += zDisp;
 
-    comTrajThread->setTrajectoryWaypoints(currentDesiredPosition);
+    comTrajThread->setGoal(currentDesiredPosition);
+}
+
+void SittingDemoClient::changeGains(const Eigen::MatrixXd& stiffness, const Eigen::MatrixXd& damping)
+{
+    ocra_icub::GainProfile profile;
+    profile.taskName = taskName;
+    profile.stiffness = stiffness;
+    profile.damping = damping;
+    profile.duration = gainTransitionTime;
+    profile.interpolation = ocra_icub::GAIN_MIN_JERK;
+    gainSender->send(profile);
 }
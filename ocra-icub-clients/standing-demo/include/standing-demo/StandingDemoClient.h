@@ -2,6 +2,8 @@
 #define SITTINGDEMOCLIENT_H
 
 #include <ocra-icub/IcubClient.h>
+#include <ocra-icub/ContactTransition.h>
+#include <ocra-icub/OnlineTrajectoryThread.h>
 #include <ocra-recipes/TrajectoryThread.h>
 #include <ocra-recipes/ControllerClient.h>
 
@@ -26,17 +28,21 @@ private:
     double maxAcc;
     bool useMinJerk;
     ocra_recipes::TrajectoryThread::Ptr comTrajThread;
+    ocra_icub::OnlineTrajectoryThread::shared_ptr onlineComTrajThread;
+    Eigen::MatrixXd comWaypoints;
+    int currentWaypoint;
+    double waypointTolerance;
     ocra_recipes::TrajectoryThread::Ptr rootTrajThread;
     // ocra_recipes::TaskConnection::Ptr comTask;
     // ocra_recipes::TaskConnection::Ptr rootTask;
-    ocra_recipes::TaskConnection::Ptr leftLegContactTask;
-    ocra_recipes::TaskConnection::Ptr rightLegContactTask;
 
-    double startTime;
-    double contactReleaseDelay;
-    bool contactsReleased;
+    ocra_icub::ContactTransitionSender::shared_ptr contactTransitions;
+    double releaseLoad;
+    double acquireLoad;
+    std::string leftThighWrenchPort;
+    std::string rightThighWrenchPort;
 
-    void deactivateLegContacts();
+    void armLegContactRelease(const std::string& taskName, const std::string& wrenchPort);
 
 };
 
@@ -34,11 +34,12 @@ bool StandingDemoClient::configure(yarp::os::ResourceFinder &rf)
         maxAcc = maxVel;
     }
 
-    if (rf.check("delay")) {
-        contactReleaseDelay = rf.find("delay").asDouble();
-    } else {
-        contactReleaseDelay = 2.0;
-    }
+    waypointTolerance = rf.check("waypointTolerance", yarp::os::Value(0.02)).asDouble();
+
+    releaseLoad = rf.check("releaseLoad", yarp::os::Value(10.0)).asDouble();
+    acquireLoad = rf.check("acquireLoad", yarp::os::Value(2.0*releaseLoad)).asDouble();
+    leftThighWrenchPort = rf.check("leftThighWrench", yarp::os::Value(ocra_icub::ContactTransitionRule::MODEL_WRENCH_SOURCE)).asString();
+    rightThighWrenchPort = rf.check("rightThighWrench", yarp::os::Value(ocra_icub::ContactTransitionRule::MODEL_WRENCH_SOURCE)).asString();
 
     return true;
 }
@@ -50,10 +51,14 @@ void StandingDemoClient::printHelp()
     std::cout << "=======================================" << std::endl;
     std::cout << "Valid args" << std::endl;
     std::cout << "--help --> Shows this message :)." << std::endl;
-    std::cout << "--minJerk --> Uses a MinimumJerkTrajectory instead of a TimeOptimalTrajectory." << std::endl;
+    std::cout << "--minJerk --> Uses a MinimumJerkTrajectory instead of the velocity and acceleration limited online trajectory." << std::endl;
     std::cout << "--maxVel [double value] --> Sets the maximum velocity of the movement." << std::endl;
     std::cout << "--maxAcc [double value] --> Sets the maximum acceleration of the movement." << std::endl;
-    std::cout << "--delay [double value] --> Sets the time to wait before deactivating the leg contacts (seconds)." << std::endl;
+    std::cout << "--waypointTolerance [double value] --> Distance to an intermediate CoM waypoint at which the next one is given, so the CoM does not stop on it (m). Default 0.02." << std::endl;
+    std::cout << "--releaseLoad [double value] --> Load of a thigh contact below which it is released (N). Default 10." << std::endl;
+    std::cout << "--acquireLoad [double value] --> Load above which a released thigh contact counts as loaded again (N). Default 2*releaseLoad." << std::endl;
+    std::cout << "--leftThighWrench [port name] --> Port streaming the estimated left thigh wrench, in the world frame. Default: the contact force computed by the controller." << std::endl;
+    std::cout << "--rightThighWrench [port name] --> Same for the right thigh." << std::endl;
     std::cout << "=======================================" << std::endl;
     std::cout << "-------       END OF HELP       -------" << std::endl;
     std::cout << "=======================================" << std::endl;
@@ -67,14 +72,19 @@ bool StandingDemoClient::initialize()
     if (useMinJerk) {
         std::cout << "type: MinimumJerkTrajectory" << std::endl;
     } else {
-        std::cout << "type: TimeOptimalTrajectory" << std::endl;
+        std::cout << "type: OnlineTrajectoryGenerator" << std::endl;
     }
     std::cout << "maxVel: " << maxVel << std::endl;
     std::cout << "maxAcc: " << maxAcc << std::endl;
     std::cout << "====================================================================" << std::endl;
 
-    leftLegContactTask = std::make_shared<ocra_recipes::TaskConnection>("LeftUpperLegContact");
-    rightLegContactTask = std::make_shared<ocra_recipes::TaskConnection>("RightUpperLegContact");
+    // The server releases each thigh contact on the tick where its load vanishes.
+    contactTransitions = std::make_shared<ocra_icub::ContactTransitionSender>("standing-demo");
+    if (!contactTransitions->open()) {
+        return false;
+    }
+    armLegContactRelease("LeftUpperLegContact", leftThighWrenchPort);
+    armLegContactRelease("RightUpperLegContact", rightThighWrenchPort);
 
     Eigen::Vector3d comStartingPos = model->getCoMPosition();
     double zDisp = 0.15;
@@ -91,59 +101,65 @@ bool StandingDemoClient::initialize()
 
     std::cout << "com_waypoints\n" << com_waypoints << std::endl;
 
-    std::list<Eigen::VectorXd> com_waypointList;
-    for(int i=0; i<com_waypoints.cols(); ++i) {
-        com_waypointList.push_back(com_waypoints.col(i));
-    }
-
     ocra_recipes::TERMINATION_STRATEGY termStrategy = ocra_recipes::STOP_THREAD;
 
     if (useMinJerk) {
         ocra_recipes::TRAJECTORY_TYPE trajType = ocra_recipes::MIN_JERK;
         comTrajThread = std::make_shared<ocra_recipes::TrajectoryThread>(10, "ComTask", com_waypoints, trajType, termStrategy);
         comTrajThread->setMaxVelocity(maxVel);
+        comTrajThread->start();
     } else {
-        ocra_recipes::TRAJECTORY_TYPE trajType = ocra_recipes::TIME_OPTIMAL;
-        comTrajThread = std::make_shared<ocra_recipes::TrajectoryThread>(10, "ComTask", com_waypointList, trajType, termStrategy);
-        comTrajThread->setMaxVelocityAndAcceleration(maxVel, maxAcc);
+        // The waypoints are given one at a time as goals, see loop(). The next one is given as soon as the CoM is within waypointTolerance of the current one.
+        comWaypoints = com_waypoints;
+        currentWaypoint = 0;
+        onlineComTrajThread = std::make_shared<ocra_icub::OnlineTrajectoryThread>(10, "ComTask", maxVel, maxAcc);
+        onlineComTrajThread->setGoal(comWaypoints.col(currentWaypoint));
+        onlineComTrajThread->start();
     }
 
-    comTrajThread->start();
-
 
     // rootTrajThread = std::make_shared<ocra_recipes::TrajectoryThread>(10, "RootCartesian", root_waypoints, trajType, termStrategy);
     // rootTrajThread->start();
 
 
 
-    contactsReleased = false;
-
-    startTime = yarp::os::Time::now();
-
-
     return true;
 }
 
 void StandingDemoClient::release()
 {
-    // add your code here...
+    if (contactTransitions) {
+        contactTransitions->disarm("LeftUpperLegContact");
+        contactTransitions->disarm("RightUpperLegContact");
+        contactTransitions->close();
+    }
 }
 
 void StandingDemoClient::loop()
 {
-    if (!contactsReleased && ((yarp::os::Time::now() - startTime) >= contactReleaseDelay) ){
-        deactivateLegContacts();
-        contactsReleased = true;
-    }
-
-    if(!comTrajThread->isRunning()) {
+    if (useMinJerk) {
+        if(!comTrajThread->isRunning()) {
+            stop();
+        }
+    } else if (currentWaypoint < comWaypoints.cols()-1) {
+        // isGoalReached() waits for the velocity to vanish, so the intermediate waypoints are only approached.
+        if (onlineComTrajThread->isGoalReached() || onlineComTrajThread->getDistanceToGoal() < waypointTolerance) {
+            onlineComTrajThread->setGoal(comWaypoints.col(++currentWaypoint));
+        }
+    } else if (onlineComTrajThread->isGoalReached()) {
+        onlineComTrajThread->stop();
         stop();
     }
 }
 
-void StandingDemoClient::deactivateLegContacts()
+void StandingDemoClient::armLegContactRelease(const std::string& taskName, const std::string& wrenchPort)
 {
-    std::cout << "Deactivating back leg contacts." << std::endl;
-    leftLegContactTask->deactivate();
-    rightLegContactTask->deactivate();
+    ocra_icub::ContactTransitionRule rule;
+    rule.taskName = taskName;
+    rule.mode = ocra_icub::CONTACT_RELEASE;
+    rule.releaseLoad = releaseLoad;
+    rule.acquireLoad = acquireLoad;
+    rule.wrenchSource = wrenchPort;
+    std::cout << "Releasing " << taskName << " when its load falls below " << releaseLoad << " N (" << wrenchPort << ")." << std::endl;
+    contactTransitions->send(rule);
 }
@@ -2,6 +2,7 @@
 #define STEPPING_DEMO_CLIENT_H
 
 #include <ocra-icub/IcubClient.h>
+#include <ocra-icub/ClientHeartbeat.h>
 #include <ocra-recipes/TrajectoryThread.h>
 #include <ocra-recipes/ControllerClient.h>
 // #include <ocra/control/Model.h>
@@ -208,6 +209,8 @@ private:
     std::shared_ptr<ocra_recipes::TrajectoryThread> rightFoot_TrajThread;
     std::shared_ptr<ocra_recipes::TrajectoryThread> com_TrajThread;
 
+    ocra_icub::ClientHeartbeat::shared_ptr heartbeat;
+
 
     Eigen::Vector3d leftFootHome;
     Eigen::Vector3d rightFootHome;
@@ -73,7 +73,11 @@ bool SteppingDemoClient::initialize()
         walkingParams.firstStepDone = true;
         walkingParams.stepHeight = 0.02;
     }
-    
+
+    // Lets the server hold the feet and the CoM if this client stops sending references.
+    heartbeat = std::make_shared<ocra_icub::ClientHeartbeat>("steppingDemoClient", std::vector<std::string>{"ComTask", "LeftFootCartesian", "RightFootCartesian"});
+    heartbeat->open();
+
     return true;
 }
 
@@ -82,6 +86,7 @@ void SteppingDemoClient::release()
     com_TrajThread->stop();
     rightFoot_TrajThread->stop();
     leftFoot_TrajThread->stop();
+    heartbeat->close();
 }
 
 void SteppingDemoClient::loop()
@@ -94,6 +99,7 @@ void SteppingDemoClient::loop()
     } else if (motionType == STATIC_WALKING) {
         staticWalkingLoop();
     }
+    heartbeat->beat();
 }
 
 void SteppingDemoClient::staticWalkingLoop(){
@@ -13,6 +13,10 @@ currentZMP = np.loadtxt(home + "currentZMP.txt");
 referenceZMP = np.loadtxt(home + "referenceZMP.txt");
 previewedZMP = np.loadtxt(home + "previewedZMP.txt");
 optimalInput = np.loadtxt(home + "optimalInput.txt");
+# Only logged when the ZMP disturbance observer is enabled
+hasDisturbance = os.path.isfile(home + "zmpDisturbance.txt")
+if hasDisturbance:
+    zmpDisturbance = np.loadtxt(home + "zmpDisturbance.txt");
 
 time = currentComPos[:,0]
 
@@ -31,6 +35,8 @@ ax2.plot(time, referenceZMP[:,2], '--', linewidth = 3, label='Raw ZMP reference'
 ax2.plot(time, previewedZMP[:,2], '--', linewidth = 3, label='Previewed ZMP reference')
 ax2.plot(time, currentZMP[:,2], linewidth = 3, label='Actual ZMP')
 ax2.plot(time, currentComPos[:,2], linewidth = 3, label='Actual CoM')
+if hasDisturbance:
+    ax2.plot(zmpDisturbance[:,0], zmpDisturbance[:,2], ':', linewidth = 3, label='Estimated ZMP offset')
 ax2.set_ylabel('Position [m]')
 ax2.autoscale(enable=True, axis='x', tight=True)
 ax2.legend()
@@ -61,4 +67,6 @@ os.remove(home + "currentZMP.txt");
 os.remove(home + "referenceZMP.txt");
 os.remove(home + "previewedZMP.txt");
 os.remove(home + "optimalInput.txt");
+if hasDisturbance:
+    os.remove(home + "zmpDisturbance.txt");
 # os.remove(home + "currentRightFootPosition.txt");
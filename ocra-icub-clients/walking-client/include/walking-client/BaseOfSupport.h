@@ -315,17 +315,18 @@ public:
     /**
      * To be called at every update cycle of the hosting client. 
      *
-     * - Retrieves the feet corners.
+     * - Retrieves the feet corners and expresses them in the heading frame of the state.
      * - Computes the bounding box.
      * - Updates the state-dependent right hand side of the constraints.
      * Calls computeBoundingBox() and StepController::getContact2DCoordinates(), then
      * updates #_B
      *
      * @param[in] xi_k Current system state.
+     * @param[in] heading Heading of the frame in which xi_k is expressed.
      * 
-     * @see #_B
+     * @see #_B, MIQPState::getHeading()
      */
-    bool update(const Eigen::VectorXd& xi_k);
+    bool update(const Eigen::VectorXd& xi_k, double heading);
     
     /**
      * Computes the bounding box points (minimum and maximum points of the box of the current support 
@@ -0,0 +1,169 @@
+/**
+ *  \class ContactDetector
+ *
+ *  \brief Estimates the contact state of each foot from its F/T sensor at the full sensor rate.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details Each foot sensor port is read through a callback, so every sample is processed as soon as it arrives and independently of the rate of the client. For each foot the normal force is low-pass filtered and compared against two thresholds (hysteresis): the foot touches down when the filtered force goes above touchdownForce and lifts off when it falls below liftoffForce. A change is only accepted once it has held for debounceTime, and the resulting event is stamped with the instant at which the threshold was first crossed.
+ *
+ *  The contact confidence is the filtered normal force mapped linearly from 0 at liftoffForce to 1 at touchdownForce.
+ *
+ *  Published ports, with prefix e.g. /walkingClient/contactDetector:
+ *  - <prefix>/events:o   one bottle per event: (touchdown|liftoff left|right timestamp confidence)
+ *  - <prefix>/state:o    every sample: (leftInContact leftConfidence leftFz rightInContact rightConfidence rightFz)
+ */
+
+#ifndef _CONTACTDETECTOR_H_
+#define _CONTACTDETECTOR_H_
+
+#include <Eigen/Dense>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/sig/Vector.h>
+#include "walking-client/utils.h"
+
+struct ContactDetectorParams {
+    /* Filtered normal force above which a foot touches down (N) */
+    double touchdownForce;
+    /* Filtered normal force below which a foot lifts off (N). Must be smaller than touchdownForce */
+    double liftoffForce;
+    /* Cutoff frequency of the first order low-pass filter on the normal force (Hz) */
+    double cutoffFrequency;
+    /* Time a threshold crossing must hold before the contact state switches (s) */
+    double debounceTime;
+    /* Sign of the raw Fz measurement when the foot pushes on the ground */
+    double forceSign;
+
+    ContactDetectorParams():
+    touchdownForce(20.0),
+    liftoffForce(8.0),
+    cutoffFrequency(30.0),
+    debounceTime(0.01),
+    forceSign(-1.0){}
+};
+
+enum CONTACT_EVENT_TYPE {
+    TOUCHDOWN,
+    LIFTOFF
+};
+
+struct ContactEvent {
+    FOOT foot;
+    CONTACT_EVENT_TYPE type;
+    /* Time at which the threshold was crossed */
+    double timestamp;
+    /* Confidence when the event was accepted */
+    double confidence;
+};
+
+class ContactDetector {
+public:
+    ContactDetector(const ContactDetectorParams &params);
+    virtual ~ContactDetector();
+
+    /**
+     *  Opens the sensor and output ports and connects them to the feet analog sensors of the robot.
+     *
+     *  @param prefix Prefix of the ports, e.g. /walkingClient/contactDetector
+     *  @param robot  Robot name, used to find /<robot>/left_foot/analog:o and /<robot>/right_foot/analog:o
+     *  @return True if all ports could be opened and connected.
+     */
+    bool open(const std::string &prefix, const std::string &robot);
+
+    /**
+     *  Closes all ports.
+     */
+    void close();
+
+    /**
+     *  Processes one sensor sample. Called by the port callbacks, but can also be fed directly.
+     *
+     *  @param foot      Foot of the sensor.
+     *  @param rawWrench Raw 6D wrench, Fz at index 2.
+     *  @param timestamp Time of the sample in seconds.
+     */
+    void update(FOOT foot, const Eigen::VectorXd &rawWrench, double timestamp);
+
+    bool isInContact(FOOT foot);
+
+    /**
+     *  @return Contact confidence in [0, 1].
+     */
+    double getConfidence(FOOT foot);
+
+    /**
+     *  @return Filtered normal force, positive when pushing on the ground.
+     */
+    double getNormalForce(FOOT foot);
+
+    /**
+     *  @return Time of the last touchdown of the foot, or a negative value if there was none.
+     */
+    double getLastTouchdownTime(FOOT foot);
+
+    /**
+     *  @return Time of the last liftoff of the foot, or a negative value if there was none.
+     */
+    double getLastLiftoffTime(FOOT foot);
+
+    /**
+     *  Pops the oldest event not yet consumed.
+     *
+     *  @param[out] event Oldest event.
+     *  @return False if there are no pending events.
+     */
+    bool popEvent(ContactEvent &event);
+
+private:
+    class WrenchPort : public yarp::os::BufferedPort<yarp::sig::Vector> {
+    public:
+        WrenchPort(ContactDetector &detector, FOOT foot);
+        using yarp::os::BufferedPort<yarp::sig::Vector>::onRead;
+        virtual void onRead(yarp::sig::Vector &wrench);
+    private:
+        ContactDetector &_detector;
+        FOOT _foot;
+    };
+
+    struct FootContactState {
+        bool initialized;
+        bool inContact;
+        double normalForce;
+        double confidence;
+        double lastSampleTime;
+        /* Time at which the opposite state was first requested, negative if not pending */
+        double pendingSince;
+        double lastTouchdownTime;
+        double lastLiftoffTime;
+
+        FootContactState():
+        initialized(false),
+        inContact(false),
+        normalForce(0.0),
+        confidence(0.0),
+        lastSampleTime(0.0),
+        pendingSince(-1.0),
+        lastTouchdownTime(-1.0),
+        lastLiftoffTime(-1.0){}
+    };
+
+    void publishEvent(const ContactEvent &event);
+    void publishState();
+
+    ContactDetectorParams _params;
+    FootContactState _feet[2];
+    std::deque<ContactEvent> _events;
+    std::mutex _stateMutex;
+    std::mutex _portMutex;
+    WrenchPort _leftWrenchPort;
+    WrenchPort _rightWrenchPort;
+    yarp::os::BufferedPort<yarp::os::Bottle> _eventsPort;
+    yarp::os::BufferedPort<yarp::os::Bottle> _statePort;
+    bool _isOpen;
+};
+
+#endif
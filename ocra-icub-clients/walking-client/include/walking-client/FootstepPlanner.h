@@ -0,0 +1,178 @@
+/**
+ *  \class FootstepPlanner
+ *
+ *  \brief Converts a commanded planar velocity into a sequence of feasible footholds.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details The robot is abstracted as a unicycle whose pose \f$(x, y, \theta)\f$ is the middle point between the feet and their mean heading. For every step the commanded velocity \f$(v_x, v_y, \omega)\f$ is integrated over one step duration to move the unicycle, and the swing foot is placed at half the nominal step width from it, on its own side. The foothold is then clamped in the frame of the stance foot so that:
+ *  - the forward displacement is at most \f$\pm\f$ maxStepLength,
+ *  - the lateral distance between the feet stays within [minStepWidth, maxStepWidth],
+ *  - the relative rotation between the feet is at most maxStepRotation, and smaller when the swing foot turns towards the stance foot,
+ *  - the inner edge of the swing foot never crosses the inner edge of the stance foot.
+ *
+ *  Only the last committed step is used, so every new step is computed in constant time when the previous one is committed.
+ *  The velocity can be set directly or read from a port, e.g. /walkingClient/footstepPlanner/velocity:i, as a bottle (vx vy wz) in m/s and rad/s expressed in the unicycle frame. If no command arrives for commandTimeout seconds the velocity goes back to zero.
+ */
+
+#ifndef _FOOTSTEPPLANNER_H_
+#define _FOOTSTEPPLANNER_H_
+
+#include <Eigen/Dense>
+#include <Eigen/Lgsm>
+#include <string>
+#include <vector>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+#include "walking-client/utils.h"
+
+struct FootstepPlannerParams {
+    /* Duration of one step in seconds */
+    double stepDuration;
+    /* Lateral distance between the feet when walking straight */
+    double nominalStepWidth;
+    /* Minimum lateral distance between the feet */
+    double minStepWidth;
+    /* Maximum lateral distance between the feet */
+    double maxStepWidth;
+    /* Maximum forward/backward displacement of the swing foot w.r.t. the stance foot */
+    double maxStepLength;
+    /* Maximum relative yaw between the feet (rad) */
+    double maxStepRotation;
+    /* Maximum relative yaw between the feet when the swing foot turns towards the stance foot (rad) */
+    double maxInwardStepRotation;
+    /* Foot sole length, used to prevent overlap */
+    double footLength;
+    /* Foot sole width, used to prevent overlap */
+    double footWidth;
+    /* Seconds without a velocity command after which the velocity is set to zero */
+    double commandTimeout;
+
+    FootstepPlannerParams():
+    stepDuration(1.0),
+    nominalStepWidth(0.14),
+    minStepWidth(0.10),
+    maxStepWidth(0.20),
+    maxStepLength(0.05),
+    maxStepRotation(0.3),
+    maxInwardStepRotation(0.1),
+    footLength(0.12),
+    footWidth(0.06),
+    commandTimeout(0.5){}
+};
+
+struct Footstep {
+    /* Foot which performs the step */
+    FOOT foot;
+    /* Target position of the sole */
+    Eigen::Vector3d position;
+    /* Target heading of the sole (rad) */
+    double yaw;
+    /* Duration of the step (s) */
+    double duration;
+};
+
+class FootstepPlanner {
+public:
+    FootstepPlanner(const FootstepPlannerParams &params);
+    virtual ~FootstepPlanner();
+
+    /**
+     *  Opens the port from which the velocity command is read.
+     *
+     *  @param portName Full name of the port, e.g. /walkingClient/footstepPlanner/velocity:i
+     *  @return True if the port could be opened.
+     */
+    bool openVelocityPort(const std::string &portName);
+
+    /**
+     *  Closes the velocity port if it was opened.
+     */
+    void close();
+
+    /**
+     *  Reads the velocity port without blocking. Call it once per loop.
+     *
+     *  @param now Current time in seconds, used for the command timeout.
+     *  @return True if a new command was read.
+     */
+    bool readVelocityCommand(double now);
+
+    /**
+     *  Sets the commanded velocity directly (vx, vy, wz). It is limited by what a single step can achieve.
+     */
+    void setVelocityCommand(const Eigen::Vector3d &velocity);
+
+    Eigen::Vector3d getVelocityCommand() const;
+
+    /**
+     *  Initializes the planner with the current feet poses.
+     *
+     *  @param leftFoot     Position of the left sole.
+     *  @param leftYaw      Heading of the left sole.
+     *  @param rightFoot    Position of the right sole.
+     *  @param rightYaw     Heading of the right sole.
+     *  @param firstSwingFoot Foot which performs the first step.
+     */
+    void reset(const Eigen::Vector3d &leftFoot, double leftYaw, const Eigen::Vector3d &rightFoot, double rightYaw, FOOT firstSwingFoot);
+
+    /**
+     *  Computes the next step from the last committed step and the current velocity command. It does not modify the planner state, so it can be called every tick to preview the next foothold.
+     *
+     *  @return The next footstep.
+     */
+    Footstep computeNextStep() const;
+
+    /**
+     *  Commits a step. The step becomes the new stance foot and the other foot swings next.
+     *
+     *  @param step Footstep returned by computeNextStep().
+     */
+    void commitStep(const Footstep &step);
+
+    /**
+     *  Convenience method which computes and commits the next step.
+     */
+    Footstep planNextStep();
+
+    /**
+     *  Plans nSteps steps at the current velocity command, followed by a last step which brings the feet side by side.
+     *
+     *  @param nSteps Number of steps before the closing step.
+     *  @return The planned steps.
+     */
+    std::vector<Footstep> planSteps(int nSteps);
+
+    /**
+     *  Extracts the heading of a sole from its orientation.
+     */
+    static double yawFromRotation(const Eigen::Rotation3d &rotation);
+
+private:
+    /**
+     *  Position of a point expressed in a frame of given position and heading.
+     */
+    Eigen::Vector2d toLocalFrame(const Eigen::Vector2d &point, const Eigen::Vector2d &origin, double yaw) const;
+    Eigen::Vector2d toWorldFrame(const Eigen::Vector2d &point, const Eigen::Vector2d &origin, double yaw) const;
+    double wrapAngle(double angle) const;
+    Footstep computeStep(const Eigen::Vector3d &velocity) const;
+    Eigen::Vector2d lateralOffset(FOOT foot) const;
+
+    FootstepPlannerParams _params;
+    Eigen::Vector3d _velocity;
+    double _lastCommandTime;
+
+    /* Last committed poses of the feet */
+    Eigen::Vector3d _leftFoot;
+    Eigen::Vector3d _rightFoot;
+    double _leftYaw;
+    double _rightYaw;
+    FOOT _swingFoot;
+    /* Unicycle pose (x, y, theta) consistent with the last committed step */
+    Eigen::Vector3d _unicycle;
+
+    yarp::os::BufferedPort<yarp::os::Bottle> _velocityPort;
+    bool _portIsOpen;
+};
+
+#endif
@@ -32,11 +32,15 @@
 #include <ocra/util/FileOperations.h>
 #include <yarp/os/RateThread.h>
 #include <yarp/os/Semaphore.h>
+#include <yarp/os/Time.h>
 #include <Eigen/Dense>
 #include <Eigen/Lgsm>
+#include <vector>
 #include "unsupported/Eigen/MatrixFunctions"
 #include <walking-client/constraints/MIQPLinearConstraints.h>
 #include <walking-client/MIQPState.h>
+#include <walking-client/ContactDetector.h>
+#include <walking-client/WalkingPlan.h>
 #include "Gurobi.h" // eigen-gurobi
 
 namespace MIQP{
@@ -64,10 +68,11 @@ public:
      * @param params        MIQP parameters
      * @params robotModel   Pointer to the robot model instantiated by the containing client
      *                      (walking-client)
+     * @param contactDetector Feet contact state estimator started by the containing client
      * @param comStateRef   Reference to a matrix of CoM state references. The k-th row contains the
      *                      desired CoM state at time k
      */
-    MIQPController(MIQPParameters params, ocra::Model::Ptr robotModel, std::shared_ptr<StepController> stepController, const Eigen::MatrixXd &comStateRef);
+    MIQPController(MIQPParameters params, ocra::Model::Ptr robotModel, std::shared_ptr<StepController> stepController, std::shared_ptr<ContactDetector> contactDetector, const Eigen::MatrixXd &comStateRef);
 
     /**
      * Destructor
@@ -117,6 +122,22 @@ public:
     
     void getSolution(Eigen::VectorXd &X_kn);
 
+    /**
+     * Retrieves the latest plan if it is newer than the one the caller already has. Never blocks: if the solution is being written, it returns false and the plan can be fetched at the next call.
+     *
+     * @param[out] plan         Latest plan.
+     * @param lastSequence      Sequence number of the plan of the caller.
+     * @return True if plan was updated.
+     */
+    bool getPlan(MIQPPlan &plan, unsigned int lastSequence);
+
+    /**
+     * Sets the horizontal CoM velocity tracked in the preview window, e.g. from the velocity command of the footstep planner. It replaces the velocity of the CoM state references from the next solve on and is expressed along the planned heading of each sample. The yaw rate stays MIQPParameters::yawRate, since the headings of the preview window are planned at construction.
+     *
+     * @param velocity Forward and lateral CoM velocity.
+     */
+    void setVelocityCommand(const Eigen::Vector2d &velocity);
+
 protected:
     // MARK: - PROTECTED METHODS
     /**
@@ -274,6 +295,18 @@ protected:
      * @see #_Q, #_T
      */
     void buildPreviewInputMatrix(const Eigen::MatrixXd &C, Eigen::MatrixXd &R);
+
+    /**
+     * Builds #_plannedRotations.
+     */
+    void buildPlannedRotations();
+
+    /**
+     * Rotates the rows of a preview matrix of 2D outputs, whose \f$i\f$-th pair of rows is expressed in the heading frame of sample \f$i+1\f$, into the heading frame of the state.
+     *
+     * @param[in,out] M Preview matrix with \f$2N\f$ rows, e.g. #_P_B or #_R_B.
+     */
+    void rotateIntoStateFrame(Eigen::MatrixXd &M);
     
     /** Builds the equality constraints matrices #_Aeq, #_Beq. For the time being, the equality constraints are composed of only the so-called Simultaneity
      * constraints of the problem, which guarantee that allowing a discontinuity of one of the bounds (\f$\mathbf{a},\mathbf{b}\f$) in one direction simultaneously 
@@ -344,6 +377,15 @@ protected:
      * @param home Root directory where to write the file.
      */
     void writeToFile(const double& time, const Eigen::VectorXd& X_kn, std::string& home);
+
+    /**
+     * Builds the plan of a solution: previewed CoP, CoM and BoS from the state #_xi_k.
+     *
+     * @param stateTime Time at which #_xi_k was sampled.
+     * @param X_kn Solution.
+     * @param[out] plan Plan, without its sequence number.
+     */
+    void buildPlan(double stateTime, const Eigen::VectorXd &X_kn, MIQPPlan &plan);
     
 private:
     // MARK: - PRIVATE VARIABLES
@@ -359,6 +401,11 @@ private:
      */
     std::shared_ptr<StepController> _stepController;
 
+    /*
+     * Pointer to the feet contact detector started by the walking-client, used by MIQPState to find the support phase.
+     */
+    std::shared_ptr<ContactDetector> _contactDetector;
+
     /**
      * Object containing basic MIQP parameters.
      */
@@ -423,12 +470,34 @@ private:
      * are the falling edges of \f$\mathbf{b}\f$, \f$\delta\f$ indicates the potential change from double support
      * to single support, while \f$\gamma\f$ indicates whether the robot is in single support (SS) or double support (DS). 
      * \f$\mathbf{h}, \dot{\mathbf{h}}, \ddot{\mathbf{h}}\f$
+     *
+     * The state is expressed in the heading frame #_heading, see MIQPState.
      */
     Eigen::VectorXd _xi_k;
 
+    /** Heading of the frame in which #_xi_k is expressed
+     */
+    double _heading;
+
+    /**
+     * Rotations \f$\mathbf{R}(i \omega \delta t)\f$, \f$i = 0 \dots N\f$, from the heading frame of preview sample \f$i\f$ to the heading frame of the state, where \f$\omega\f$ is MIQPParameters::yawRate.
+     *
+     * The headings of the preview window are planned beforehand, \f$\theta_{k+i} = \theta_k + i \omega \delta t\f$, and the bounds \f$\mathbf{a}_{k+i}, \mathbf{b}_{k+i}\f$ are expressed in the frame of \f$\theta_{k+i}\f$, so that the box follows the rotated feet. The constraints on the bounds are linearised around this heading sequence: the small rotation \f$\omega \delta t\f$ between consecutive samples is neglected in the shape constraints, while the center of the BoS tracked by the CoP and the CoM references are rotated back into the frame of the state. As the rotations only depend on the parameters they are applied to #_P_B and #_R_B once, and the cost and constraint matrices stay constant.
+     */
+    std::vector<Eigen::Matrix2d> _plannedRotations;
+
     /** Solution \f$\mathcal{X}_{k,N}\f$ of the MIQP problem
      */
     Eigen::VectorXd _X_kn;
+    /** Latest plan, protected by #semaphore
+     */
+    MIQPPlan _plan;
+
+    /** Protects #_velocityCommand and #_hasVelocityCommand, which are written by the client thread
+     */
+    yarp::os::Semaphore _commandSemaphore;
+    Eigen::Vector2d _velocityCommand;
+    bool _hasVelocityCommand;
 
     /**
      *  State matrix \f$A_h\f$ from the CoM jerk integration scheme.
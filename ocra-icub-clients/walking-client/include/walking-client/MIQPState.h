@@ -4,7 +4,7 @@
  *  \author Jorhabib Eljaik
  *  \cite ibanezThesis2015
  *  \warning Work in progress! This is still a barebone class in the process of being tested.
- *  \details
+ *  \details The BoS descriptors and the CoM state are expressed in the heading frame of the support, i.e. the world frame rotated about the vertical axis by #_heading, so that the box \f$[\mathbf{b}, \mathbf{a}]\f$ of the MIQP is aligned with the feet of a robot that has turned.
  **/
 
 #ifndef _MIQP_STATE_H_
@@ -14,6 +14,8 @@
 #include <ocra-icub/OcraWbiModel.h>
 #include <ocra/util/ErrorsHelper.h>
 #include "walking-client/utils.h"
+#include "walking-client/ContactDetector.h"
+#include "walking-client/FootstepPlanner.h"
 #include <ocra-icub/Utilities.h>
 
 namespace MIQP{
@@ -107,33 +109,29 @@ namespace MIQP{
         Eigen::Vector3d _l_foot_coord;
 
         /*
-         * Port that connects to the left foot F/T sensor.
+         * Heading of the left and right soles
          */
-        yarp::os::BufferedPort<yarp::sig::Vector> _portWrenchLeftFoot;
+        double _l_foot_yaw;
+        double _r_foot_yaw;
 
-        /*
-         * Port that connect to the right F/T sensor.
-         */
-        yarp::os::BufferedPort<yarp::sig::Vector> _portWrenchRightFoot;
-
-        /*
-         * Normal force threshold
+        /**
+         * Heading of the support: yaw of the stance foot in SS, mid-angle between the feet in DS. The state is expressed in the frame rotated by this heading.
          */
-        double _FzThreshold; // N
+        double _heading;
 
         /*
-         * Normal distance threshold
+         * Feet contact state estimated from the F/T sensors at their own rate.
          */
-        double _PzThreshold; // m
+        std::shared_ptr<ContactDetector> _contactDetector;
 
     public:
 
-        MIQPState (ocra::Model::Ptr robotModel, std::string robot);
+        MIQPState (ocra::Model::Ptr robotModel, std::string robot, std::shared_ptr<ContactDetector> contactDetector);
 
         virtual ~MIQPState ();
 
         /**
-         * Open and connects ports to F/T sensors in the feet of the robot and sets some thresholds.
+         * Sets the initial base of support descriptors, assuming the robot starts in double support.
          *
          * @return True if everything ends successfully.
          */
@@ -165,14 +163,21 @@ namespace MIQP{
                                             double thresholdChange);
 
         /**
-         * Updates the horizontal CoM state (horizonal position, velocity and acceleration).
+         * Updates #_heading from the heading of the feet in contact.
+         *
+         * @return Previous heading.
+         */
+        double updateHeading();
+
+        /**
+         * Updates the horizontal CoM state (horizonal position, velocity and acceleration), expressed in the heading frame.
 
          @param[out] hk 6-dimensional CoM state vector.
          */
         void updateHorizontalCoMState(Eigen::VectorXd &hk);
 
         /**
-         * This method uses the normal measurements of the F/T sensors in the feet of the robot along with the \f$z\f$ coordinates of both feet to identify whether the robot is in DS or not.
+         * This method uses the contact state of both feet to identify whether the robot is in DS or not.
          *
          * @param[out] If the robot is in SS, this variable contains the foot in SS.
          * @return True if robot is found in SS, false if it is in DS.
@@ -180,24 +185,12 @@ namespace MIQP{
         bool isRobotInSS(FOOT &footInSS);
 
         /**
-         * Determins if #whichFoot is in contact with the ground by checking the normal F/T measurement of the corresponding foot
-         * in combination with the \f$z\f$ coordinate.
+         * Determins if #whichFoot is in contact with the ground. The filtered, debounced state of the contact detector is used.
 
          @param whichFoot Foot for which you want to know whether it's in contact or not.
-         @param FzThreshold Z Force threshold to consider whether the foot is in contact or not.
-         @param PzThreshold Z position threshold to consider whether the foot is in contact or not.
          @return True if #whichFoot is in contact. False otherwise.
          */
-        bool isFootInContact(FOOT whichFoot, double FzThreshold, double PzThreshold);
-
-        /**
-         Reads the raw wrench published for the corresponding analog force/torque sensors in iCub's feet.
-
-         @param whichFoot For which foot is the measurement read.
-         @param rawWrench Result of the reading.
-         @return True if reading is successful, false otherwise.
-         */
-        bool readFootWrench(FOOT whichFoot, Eigen::VectorXd &rawWrench);
+        bool isFootInContact(FOOT whichFoot);
 
         /**
          * Copies in #xi the full state #_xi_k.
@@ -222,6 +215,11 @@ namespace MIQP{
          */
         Eigen::Vector3d getRightFootPosition();
         
+        /**
+         * @return Heading of the frame in which the state is expressed.
+         */
+        double getHeading() const {return _heading;}
+
         /**
          * Operator to write the current state contents in a "pretty" way.
          */
@@ -233,6 +231,7 @@ namespace MIQP{
             out << "\tbeta : [" << state._beta.transpose()            << "]\n";
             out << "\tdelta:  " << state._delta                       << "]\n";
             out << "\tgamma:  " << state._gamma                       << " \n";
+            out << "\theading: " << state._heading                   << " \n";
             out << "\th    : [" << state._hk.head(2).transpose()       << " \n";
             out << "\tdh   : [" << state._hk.segment<2>(2).transpose()<< "]\n";
             out << "\tddh  : [" << state._hk.tail(2).transpose()      << "]\n";
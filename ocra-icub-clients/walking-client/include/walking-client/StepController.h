@@ -1,9 +1,9 @@
 /**
  *  \class StepController
  *
- *  \brief
+ *  \brief Drives the feet tasks during a step and switches their contacts.
  *
- *  \note
+ *  \note The swing trajectories are evaluated in the client loop by calling update() every tick. The position is sent to the tasks "LeftFootCartesian"/"RightFootCartesian" and the heading to "LeftFootOrientation"/"RightFootOrientation".
  *
  *  \author Jorhabib Eljaik
  *
@@ -14,8 +14,12 @@
 #ifndef _STEPCONTROLLER_H_
 #define _STEPCONTROLLER_H_
 
-#include <ocra-recipes/TrajectoryThread.h>
+#include <ocra-recipes/TaskConnection.h>
+#include <ocra-icub/TaskConvergence.h>
+#include <ocra/control/Model.h>
 #include "walking-client/utils.h"
+#include "walking-client/SwingFootTrajectory.h"
+#include "walking-client/FootstepPlanner.h"
 
 class StepController {
 public:
@@ -24,7 +28,7 @@ public:
     virtual ~StepController();
 
     /**
-     * @todo This max velocity must be compatible with the one specified in the linar constraints
+     * @todo The max velocity used by doStepWithMaxVelocity must be compatible with the one specified in the linar constraints
      */
     bool initialize();
 
@@ -45,11 +49,14 @@ public:
      */
     void activateFeetContacts(FOOT foot);
 
-    
+
+    /**
+     *  Makes a step whose duration is given by the distance to travel and the maximum foot velocity.
+     */
     bool doStepWithMaxVelocity(FOOT foot, Eigen::Vector3d target, double stepHeight);
 
     /**
-     *  Make a step with foot with a specific duration with a specific height.
+     *  Make a step with foot with a specific duration with a specific height. The heading of the foot is kept.
      *
      *  @param foot LEFT_FOOT or RIGHT_FOOT.
      *  @param target x,y,z location of where the foot should land.
@@ -59,13 +66,74 @@ public:
     void step(FOOT foot, Eigen::Vector3d target, double stepDuration, double stepHeight);
 
     /**
-     *  Checks if the step has reached it's target locations and if this is true then re-activates the foot contacts.
+     *  Make a step with foot with a specific duration with a specific height, turning the foot to targetYaw.
+     *
+     *  @param foot LEFT_FOOT or RIGHT_FOOT.
+     *  @param target x,y,z location of where the foot should land.
+     *  @param targetYaw Heading of the foot at touchdown.
+     *  @param duration How long the step should take.
+     *  @param stepHeight How high the foot should lift.
+     */
+    void step(FOOT foot, Eigen::Vector3d target, double targetYaw, double stepDuration, double stepHeight);
+
+    /**
+     *  Moves the landing pose of the step in progress. Position, velocity and acceleration of the foot remain continuous.
+     *
+     *  @param foot LEFT_FOOT or RIGHT_FOOT (whichever is stepping currently)
+     *  @param target New landing position.
+     *  @param targetYaw New landing heading.
+     *  @return False if the foot is not swinging or is already searching for the ground.
+     */
+    bool retarget(FOOT foot, Eigen::Vector3d target, double targetYaw);
+
+    /**
+     *  Moves the landing pose and changes the remaining duration of the step in progress.
+     *
+     *  @param foot LEFT_FOOT or RIGHT_FOOT (whichever is stepping currently)
+     *  @param target New landing position.
+     *  @param targetYaw New landing heading.
+     *  @param remainingDuration Time from now to the new touchdown.
+     *  @return False if the foot is not swinging or is already searching for the ground.
+     */
+    bool retarget(FOOT foot, Eigen::Vector3d target, double targetYaw, double remainingDuration);
+
+    /**
+     *  @return Time elapsed since the beginning of the step of foot, or a negative value if it is not swinging.
+     */
+    double getStepElapsedTime(FOOT foot);
+
+    /**
+     *  Evaluates the swing trajectories at the current time and sends them to the feet tasks. To be called every tick of the owner thread.
+     */
+    void update();
+
+    /**
+     *  Checks if the swinging foot has touched down and if this is true then re-activates the foot contacts. A contact measured before the apex is ignored. When no contact is measured, the foot searches for the ground below the target and the step is considered finished when the search is over.
+     *
+     *  @param foot LEFT_FOOT or RIGHT_FOOT (whichever is stepping currently)
+     *  @param footInContact Whether the sensors measure a contact for this foot.
+     */
+    bool isStepFinished(FOOT foot, bool footInContact);
+
+    /**
+     *  Checks if the step has reached the end of its nominal duration and if this is true then re-activates the foot contacts. Used when no contact sensing is available.
      *
      *  @param foot LEFT_FOOT or RIGHT_FOOT (whichever is stepping currently)
      */
     bool isStepFinished(FOOT foot);
-    
+
+    /**
+     *  Distance between the desired and the current position of the foot task, as published by the server on its last tick (see ocra_icub::TaskConvergenceListener). Falls back to the distance between the last desired position and the model when the server publishes nothing for the task.
+     */
     double getFootTrajError(FOOT foot, double &error);
+
+    /**
+     *  Sets how the swinging foot looks for the ground when no touchdown was measured at the end of the step.
+     *
+     *  @param velocity Downwards velocity of the foot at touchdown (m/s).
+     *  @param depth Maximum distance below the target (m).
+     */
+    void setTouchdownSearch(double velocity, double depth);
     
     /**
      *  Retrieves the 3D position of the "l_sole" frame from the iCub model.
@@ -81,6 +149,11 @@ public:
      */
     Eigen::Vector3d getRightFootPosition();
 
+    /**
+     *  Retrieves the heading of the "l_sole" or "r_sole" frame from the iCub model.
+     */
+    double getFootYaw(FOOT foot);
+
     void computeMidPoint(FOOT foot, Eigen::Vector3d target, double stepHeight, Eigen::Vector3d & midPoint);
 
 
@@ -89,7 +162,7 @@ public:
     bool isTrajectoryFinished(FOOT foot);
 
     /**
-     *  Stops the feet trajectory threads. To be called during the release of the
+     *  Ends any step in progress. To be called during the release of the
      *  owner thread.
      */
     void stop();
@@ -113,9 +186,24 @@ private:
     ocra_recipes::TaskConnection::Ptr _RightFootContact_FrontLeft;
     ocra_recipes::TaskConnection::Ptr _RightFootContact_BackRight;
     ocra_recipes::TaskConnection::Ptr _RightFootContact_FrontRight;
-    std::shared_ptr<ocra_recipes::TrajectoryThread> _leftFoot_TrajThread;
-    std::shared_ptr<ocra_recipes::TrajectoryThread> _rightFoot_TrajThread;
-    Eigen::Vector3d target;
+    ocra_recipes::TaskConnection::Ptr _leftFootTask;
+    ocra_recipes::TaskConnection::Ptr _rightFootTask;
+    ocra_recipes::TaskConnection::Ptr _leftFootOrientationTask;
+    ocra_recipes::TaskConnection::Ptr _rightFootOrientationTask;
+    ocra_icub::TaskConvergenceListener::shared_ptr _convergenceListener;
+    SwingFootTrajectory _leftFootSwing;
+    SwingFootTrajectory _rightFootSwing;
+    Eigen::Vector3d _leftFootDesiredPosition;
+    Eigen::Vector3d _rightFootDesiredPosition;
+    double _leftFootStepStartTime;
+    double _rightFootStepStartTime;
+    double _maxFootVelocity;
+    /**
+     *  Ends the swing, holds the foot where it is and re-activates its contacts.
+     */
+    void finishStep(FOOT foot);
+    void sendFootState(FOOT foot, const Eigen::Vector3d &position, const Eigen::Vector3d &velocity, const Eigen::Vector3d &acceleration, double yaw, double yawRate, double yawAcceleration);
+    SwingFootTrajectory& getSwing(FOOT foot);
     Eigen::Vector3d _leftFootPosition;
     Eigen::Vector3d _rightFootPosition;
     ocra::Model::Ptr _model;
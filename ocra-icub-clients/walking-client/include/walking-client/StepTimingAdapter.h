@@ -0,0 +1,116 @@
+/**
+ *  \class StepTimingAdapter
+ *
+ *  \brief Re-optimizes the remaining duration of the current step and the location of the next one from the measured CoM state.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details Under the table-cart model with constant height \f$c_z\f$, the Divergent Component of Motion (DCM) \f$\xi = h + \dot{h}/\omega\f$, with \f$\omega = \sqrt{g/c_z}\f$, evolves during single support as \f$\xi(t) = p + (\xi_0 - p)e^{\omega t}\f$, where \f$p\f$ is the CoP at the center of the support polygon. Using \f$\tau = e^{\omega T_r}\f$ for the remaining duration \f$T_r\f$ makes the DCM at touchdown linear in \f$\tau\f$, and the adaptation becomes the small QP
+ *
+ *  \f[
+ *  \min_{u, \tau} \; \alpha_u \|u - u_{nom}\|^2 + \alpha_\tau (\tau - \tau_{nom})^2 + \alpha_b \|p + (\xi - p)\tau - u - b_{nom}\|^2
+ *  \f]
+ *
+ *  subject to the box \f$\tau \in [e^{\omega T_{r,min}}, e^{\omega T_{r,max}}]\f$ and to the reachable region of the swing foot \f$u\f$, expressed in the stance foot frame with the limits of FootstepPlannerParams. \f$b_{nom}\f$ is the DCM offset at touchdown of a periodic gait with the nominal step.
+ *
+ *  For a fixed \f$\tau\f$ the optimal \f$u\f$ is the clamped unconstrained optimum, which is piecewise linear in \f$\tau\f$ with at most four breakpoints. The reduced cost is thus a convex piecewise quadratic in \f$\tau\f$, minimized exactly on each piece. The solution is computed in constant time and can be called every tick.
+ */
+
+#ifndef _STEPTIMINGADAPTER_H_
+#define _STEPTIMINGADAPTER_H_
+
+#include <Eigen/Dense>
+#include <vector>
+#include "walking-client/utils.h"
+#include "walking-client/FootstepPlanner.h"
+
+struct StepTimingAdaptationParams {
+    /* Whether the stepping test adapts its steps */
+    bool enabled;
+    /* Shortest step duration (s) */
+    double minStepDuration;
+    /* Longest step duration (s) */
+    double maxStepDuration;
+    /* Remaining time below which the step is no longer adapted (s) */
+    double freezeTime;
+    /* Weight on the deviation from the nominal step location */
+    double stepLocationWeight;
+    /* Weight on the deviation from the nominal step timing */
+    double stepTimingWeight;
+    /* Weight on the deviation from the nominal DCM offset at touchdown */
+    double dcmOffsetWeight;
+    /* Gravity acceleration (m/s^2) */
+    double gravity;
+
+    StepTimingAdaptationParams():
+    enabled(false),
+    minStepDuration(0.4),
+    maxStepDuration(3.0),
+    freezeTime(0.1),
+    stepLocationWeight(1.0),
+    stepTimingWeight(10.0),
+    dcmOffsetWeight(1000.0),
+    gravity(9.81){}
+};
+
+class StepTimingAdapter {
+public:
+    /**
+     *  Constructor.
+     *
+     *  @param params     Adaptation parameters.
+     *  @param limits     Step geometry limits, shared with the footstep planner.
+     *  @param comHeight  Constant CoM height of the table-cart model.
+     */
+    StepTimingAdapter(const StepTimingAdaptationParams &params, const FootstepPlannerParams &limits, double comHeight);
+    virtual ~StepTimingAdapter();
+
+    /**
+     *  Adapts the current step.
+     *
+     *  @param hk               Horizontal CoM state (position, velocity, acceleration).
+     *  @param supportPolygon   Active contact points of the stance foot, one per row, in the world frame.
+     *  @param stanceYaw        Heading of the stance foot.
+     *  @param swingFoot        Foot currently swinging.
+     *  @param nominalStep      Nominal touchdown position of the swing foot.
+     *  @param nominalDuration  Nominal duration of the step.
+     *  @param elapsed          Time since the beginning of the step.
+     *  @param[out] adaptedStep       Adapted touchdown position.
+     *  @param[out] adaptedRemaining  Adapted remaining duration of the step.
+     *  @return False if the step is too close to its end to be adapted or the support polygon is empty. The outputs are then the nominal ones.
+     */
+    bool adapt(const Eigen::VectorXd &hk,
+               const Eigen::MatrixXd &supportPolygon,
+               double stanceYaw,
+               FOOT swingFoot,
+               const Eigen::Vector2d &nominalStep,
+               double nominalDuration,
+               double elapsed,
+               Eigen::Vector2d &adaptedStep,
+               double &adaptedRemaining);
+
+    /**
+     *  @return Natural frequency of the table-cart model.
+     */
+    double getOmega() const {return _omega;}
+
+private:
+    /**
+     *  Optimal swing foot location in the stance frame for a given tau, and the corresponding cost.
+     */
+    double reducedCost(double tau, Eigen::Vector2d &u) const;
+
+    StepTimingAdaptationParams _params;
+    FootstepPlannerParams _limits;
+    double _omega;
+
+    // Problem data of the current call, in the stance foot frame centered at the CoP
+    Eigen::Vector2d _dcmOffset;
+    Eigen::Vector2d _uNominal;
+    Eigen::Vector2d _bNominal;
+    Eigen::Vector2d _uLower;
+    Eigen::Vector2d _uUpper;
+    double _tauNominal;
+};
+
+#endif
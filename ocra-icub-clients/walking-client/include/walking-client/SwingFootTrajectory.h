@@ -0,0 +1,155 @@
+/**
+ *  \class SwingFootTrajectory
+ *
+ *  \brief Closed-form swing foot trajectory made of quintic polynomials, evaluated inside the client loop.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details The horizontal position and the heading of the foot each follow a single quintic from lift-off to touchdown. The height follows two quintics joined at the apex, reached at half the step duration with zero vertical velocity. Every polynomial is built from the full state (position, velocity and acceleration) at its start, so re-targeting mid-swing rebuilds them from the current state and the trajectory stays \f$C^2\f$.
+ *
+ *  Touchdown is expected at the end of the step with a small downwards velocity. If no contact has been measured by then, the foot keeps descending at that velocity for at most touchdownSearchDepth, after which it holds its position.
+ */
+
+#ifndef _SWINGFOOTTRAJECTORY_H_
+#define _SWINGFOOTTRAJECTORY_H_
+
+#include <Eigen/Dense>
+
+/**
+ *  Quintic polynomial joining two states (position, velocity, acceleration) in a given duration.
+ */
+class QuinticPolynomial {
+public:
+    QuinticPolynomial();
+
+    /**
+     *  Computes the coefficients of the polynomial.
+     *
+     *  @param startTime Time at which the polynomial starts.
+     *  @param duration  Duration of the polynomial. Must be positive.
+     *  @param p0, v0, a0 Initial position, velocity and acceleration.
+     *  @param pf, vf, af Final position, velocity and acceleration.
+     */
+    void set(double startTime, double duration, double p0, double v0, double a0, double pf, double vf, double af);
+
+    /**
+     *  Evaluates the polynomial. Before its start it returns the initial state and after its end the final state.
+     */
+    void evaluate(double time, double &p, double &v, double &a) const;
+
+    double getStartTime() const {return _startTime;}
+    double getEndTime() const {return _startTime + _duration;}
+
+private:
+    Eigen::Matrix<double, 6, 1> _coeffs;
+    double _startTime;
+    double _duration;
+};
+
+class SwingFootTrajectory {
+public:
+    SwingFootTrajectory();
+    virtual ~SwingFootTrajectory();
+
+    /**
+     *  Starts a new swing from a foot at rest.
+     *
+     *  @param initialPosition Current position of the sole.
+     *  @param initialYaw      Current heading of the sole.
+     *  @param target          Touchdown position of the sole.
+     *  @param targetYaw       Touchdown heading of the sole.
+     *  @param duration        Duration of the swing in seconds.
+     *  @param stepHeight      Height of the apex above the highest of the initial and target positions.
+     *  @param startTime       Current time in seconds.
+     */
+    void start(const Eigen::Vector3d &initialPosition, double initialYaw, const Eigen::Vector3d &target, double targetYaw, double duration, double stepHeight, double startTime);
+
+    /**
+     *  Changes the touchdown pose of the current swing, keeping the touchdown time. When less than minRetargetTime is left, the touchdown is delayed so that the new target can be reached smoothly.
+     *
+     *  @param target    New touchdown position.
+     *  @param targetYaw New touchdown heading.
+     *  @param now       Current time in seconds.
+     *  @return False if there is no active swing or if the foot is already searching for the ground.
+     */
+    bool retarget(const Eigen::Vector3d &target, double targetYaw, double now);
+
+    /**
+     *  Changes the touchdown pose and time of the current swing. The apex is moved proportionally when it has not been reached yet.
+     *
+     *  @param target        New touchdown position.
+     *  @param targetYaw     New touchdown heading.
+     *  @param touchdownTime New touchdown time, at least minRetargetTime from now.
+     *  @param now           Current time in seconds.
+     *  @return False if there is no active swing or if the foot is already searching for the ground.
+     */
+    bool retarget(const Eigen::Vector3d &target, double targetYaw, double touchdownTime, double now);
+
+    /**
+     *  Evaluates the trajectory.
+     *
+     *  @param now Current time in seconds.
+     *  @param[out] position, velocity, acceleration Desired linear state of the sole.
+     *  @param[out] yaw, yawRate, yawAcceleration Desired heading of the sole and its derivatives.
+     */
+    void evaluate(double now, Eigen::Vector3d &position, Eigen::Vector3d &velocity, Eigen::Vector3d &acceleration, double &yaw, double &yawRate, double &yawAcceleration) const;
+
+    /**
+     *  Ends the swing, e.g. on touchdown.
+     */
+    void stop();
+
+    bool isActive() const {return _active;}
+
+    /**
+     *  @return True once the apex has been passed. Contacts measured before are not touchdowns.
+     */
+    bool isDescending(double now) const;
+
+    /**
+     *  @return True once the nominal touchdown time has been reached.
+     */
+    bool isNominalDurationOver(double now) const;
+
+    /**
+     *  @return True when the foot has descended touchdownSearchDepth below the target without touching the ground.
+     */
+    bool isTouchdownSearchOver(double now) const;
+
+    /**
+     *  Velocity at which the foot reaches the target and keeps descending while searching for the ground, and maximum depth of that search.
+     */
+    void setTouchdownSearch(double velocity, double depth);
+
+    /**
+     *  Minimum time given to the foot to reach a new target.
+     */
+    void setMinRetargetTime(double minRetargetTime);
+
+    Eigen::Vector3d getTarget() const {return _target;}
+    double getTargetYaw() const {return _targetYaw;}
+    double getTouchdownTime() const {return _touchdownTime;}
+
+private:
+    void evaluateNominal(double now, Eigen::Vector3d &position, Eigen::Vector3d &velocity, Eigen::Vector3d &acceleration, double &yaw, double &yawRate, double &yawAcceleration) const;
+    void setVerticalProfile(double now, double z, double dz, double ddz, bool throughApex);
+
+    QuinticPolynomial _x;
+    QuinticPolynomial _y;
+    QuinticPolynomial _yaw;
+    QuinticPolynomial _zRise;
+    QuinticPolynomial _zFall;
+    Eigen::Vector3d _target;
+    double _targetYaw;
+    double _initialHeight;
+    double _stepHeight;
+    double _apexHeight;
+    double _apexTime;
+    double _touchdownTime;
+    double _touchdownVelocity;
+    double _touchdownSearchDepth;
+    double _minRetargetTime;
+    bool _active;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ *  \class VariableHeightZmpPreviewController
+ *
+ *  \brief ZMP preview controller along a planned CoM height profile, for stepping onto platforms and stairs.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details When the CoM moves vertically, the table-cart output of ZmpPreviewController becomes time-varying. At preview step \f$j\f$ the ZMP on the support surface is
+ *
+ *  \f[
+ *  \mathbf{p}_j = \mathbf{h}_j - \frac{c_j}{g}\ddot{\mathbf{h}}_j, \qquad c_j = \frac{g\,(z_j - s_j)}{g + \ddot{z}_j}
+ *  \f]
+ *
+ *  where \f$z_j\f$ is the planned CoM height, \f$s_j\f$ the height of the support surface under the ZMP and \f$c_j\f$ the effective height, i.e. the row \f$\mathbf{C}_{p,j}\f$ of the output matrix uses \f$c_j\f$ instead of the constant \f$c_z\f$. Solving the resulting QP exactly would require rebuilding \f$\mathbf{H}_p\f$ and factorizing \f$\mathbf{A}_{\text{opt}}\f$ every tick.
+ *
+ *  Instead, the gains of the constant-height problem \f$\mathbf{U} = \mathbf{K}_p\mathbf{P}_r + \mathbf{K}_h\tilde{\mathbf{H}}_r - \mathbf{K}_x\hat{\mathbf{h}}_k\f$ are computed once for a grid of heights around \f$c_z\f$ and cached. Every tick, the reference height \f$\bar{c}\f$ is the effective height at the beginning of the window and the optimal inputs are interpolated linearly between the two neighbouring cached heights. The remaining variation along the window is moved to the ZMP reference:
+ *
+ *  \f[
+ *  \mathbf{r}'_j = \mathbf{r}_j + \frac{c_j - \bar{c}}{g}\ddot{\mathbf{h}}_j
+ *  \f]
+ *
+ *  using the CoM accelerations predicted at the previous call, shifted by the samples elapsed since. This is one fixed-point iteration per tick, which converges while the plan is followed. The per-tick cost is a few matrix-vector products of the size of \f$\mathbf{H}_p^T\f$, with no factorization.
+ *
+ *  On flat ground with a constant height the controller reduces to ZmpPreviewController.
+ */
+
+#ifndef _VARIABLEHEIGHTZMPPREVIEWCONTROLLER_H_
+#define _VARIABLEHEIGHTZMPPREVIEWCONTROLLER_H_
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <vector>
+#include "walking-client/ZmpPreviewController.h"
+
+struct VariableHeightZmpPreviewParams {
+    /* Whether the stepping test previews the ZMP along a CoM height profile */
+    bool enabled;
+    /* Half width of the range of effective heights covered by the gain cache, around cz (m) */
+    double heightRange;
+    /* Number of cached heights */
+    int nHeights;
+
+    VariableHeightZmpPreviewParams():
+    enabled(false),
+    heightRange(0.1),
+    nHeights(9){}
+};
+
+class VariableHeightZmpPreviewController : public ZmpPreviewController {
+public:
+    /**
+     *  Constructor. Builds and caches the gains of every height of the grid.
+     *
+     *  @param period        Period (in ms) of the thread in which the controller runs.
+     *  @param parameters    Preview parameters. cz is the nominal CoM height above the support surface.
+     *  @param heightParams  Range and resolution of the gain cache.
+     */
+    VariableHeightZmpPreviewController(const double period,
+                                       std::shared_ptr<ZmpPreviewParams> parameters,
+                                       const VariableHeightZmpPreviewParams &heightParams);
+    virtual ~VariableHeightZmpPreviewController();
+
+    using ZmpPreviewController::computeOptimalInput;
+    using ZmpPreviewController::tableCartModel;
+
+    /**
+     *  Computes a horizon of optimal CoM jerks along a planned CoM height profile.
+     *
+     *  @param zmpRef         \f$\mathbf{P}_r\f$ Horizon of \f$N_p\f$ ZMP references.
+     *  @param comVelRef      \f$\tilde{\mathbf{H}}_r\f$ Horizon of \f$N_p\f$ CoM velocities. Only used when \f$\eta_w > 0\f$.
+     *  @param hk             Current CoM state \f$\hat{\mathbf{h}}_k\f$.
+     *  @param comHeights     Planned CoM heights \f$z_j\f$ over the preview window, \f$N_p\f$ samples.
+     *  @param supportHeights Heights \f$s_j\f$ of the support surface under the ZMP, \f$N_p\f$ samples.
+     *  @param[out] optimalU  Horizon of optimal inputs \f$\mathcal{U}_{k+N_c|k}\f$.
+     */
+    void computeOptimalInput(const Eigen::VectorXd &zmpRef,
+                             const Eigen::VectorXd &comVelRef,
+                             const Eigen::VectorXd &hk,
+                             const Eigen::VectorXd &comHeights,
+                             const Eigen::VectorXd &supportHeights,
+                             Eigen::VectorXd &optimalU);
+
+    /**
+     *  Table-cart model with a given effective height.
+     *
+     *  @param      hkk             Horizontal CoM state.
+     *  @param      effectiveHeight Effective height \f$c\f$.
+     *  @param[out] p               Computed ZMP.
+     */
+    void tableCartModel(const Eigen::VectorXd &hkk, double effectiveHeight, Eigen::Vector2d &p);
+
+    /**
+     *  @return Effective height at the beginning of the window of the last call to computeOptimalInput().
+     */
+    double getEffectiveHeight() const {return _effectiveHeight;}
+
+    /**
+     *  Forgets the predicted accelerations, e.g. when the plan is replaced.
+     */
+    void reset();
+
+    /**
+     *  Number of samples between two calls to computeOptimalInput(), by which the predicted accelerations are shifted. 1 unless the controller runs slower than its sampling period, see ZmpPreviewPlanner.
+     */
+    void setSamplesBetweenCalls(int samples) {_samplesBetweenCalls = std::max(1, samples);}
+
+private:
+    struct HeightGains {
+        double height;
+        /* ZMP reference gain A^{-1} Hp^T Nb */
+        Eigen::MatrixXd Kp;
+        /* CoM velocity reference gain A^{-1} Hh^T Nw. Empty if nw is zero */
+        Eigen::MatrixXd Kh;
+        /* State gain Kp Gp + Kh Gh */
+        Eigen::MatrixXd Kx;
+    };
+
+    /**
+     *  Optimal inputs of the constant-height problem of the i-th cached height.
+     */
+    void solveAtHeight(int i, const Eigen::VectorXd &zmpRef, const Eigen::VectorXd &comVelRef, const Eigen::VectorXd &hk, Eigen::VectorXd &U) const;
+
+    const double _g;
+    const double _dt;
+    const int _Np;
+    const int _Nc;
+    std::vector<HeightGains> _gains;
+    /* Preview of the CoM accelerations, used to predict them along the window */
+    Eigen::MatrixXd _Ga;
+    Eigen::MatrixXd _Ha;
+    Eigen::VectorXd _effectiveHeights;
+    Eigen::VectorXd _correctedZmpRef;
+    Eigen::VectorXd _predictedAcceleration;
+    Eigen::VectorXd _U0;
+    Eigen::VectorXd _U1;
+    double _effectiveHeight;
+    int _samplesBetweenCalls;
+    bool _hasPrediction;
+};
+
+#endif
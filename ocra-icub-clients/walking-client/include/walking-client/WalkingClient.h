@@ -2,11 +2,21 @@
 #define WALKINGCLIENT_H
 
 #include <ocra-icub/IcubClient.h>
+#include <ocra-icub/ClientHeartbeat.h>
+#include <ocra-icub/ArbitratedReference.h>
 #include <ocra-recipes/TrajectoryThread.h>
 #include <ocra-recipes/ControllerClient.h>
 #include <ocra/util/EigenUtilities.h>
 #include "walking-client/ZmpPreviewController.h"
+#include "walking-client/VariableHeightZmpPreviewController.h"
+#include "walking-client/ZmpDisturbanceObserver.h"
+#include "walking-client/ZmpPreviewPlanner.h"
+#include "walking-client/WalkingPlanPublisher.h"
 #include "walking-client/StepController.h"
+#include "walking-client/FootstepPlanner.h"
+#include "walking-client/ContactDetector.h"
+#include "walking-client/StepTimingAdapter.h"
+#include "walking-client/WalkingPlan.h"
 #include "walking-client/utils.h"
 #include "walking-client/MIQPController.h"
 #include "walking-client/Interpolator.h"
@@ -76,6 +86,14 @@ public:
      */
     bool readFootWrench(FOOT whichFoot, Eigen::VectorXd &rawWrench);
 
+    /**
+     Contact state of a foot as estimated by the contact detector.
+
+     @param whichFoot Foot to check.
+     @return True if the foot is in contact with the ground.
+     */
+    bool isFootInContact(FOOT whichFoot);
+
     yarp::os::BufferedPort<yarp::sig::Vector> portWrenchLeftFoot;
 
     yarp::os::BufferedPort<yarp::sig::Vector> portWrenchRightFoot;
@@ -145,6 +163,19 @@ public:
     
     void performMIQPTest();
 
+    /**
+     Walks by tracking the plans of the MIQPController. Every new plan is handed over at the beginning of a tick and converted into the CoP and CoM velocity references of the ZMP preview controller and into step targets and timings for the StepController, see WalkingPlan. The latency of every plan is published on /<name>/walking/latency:o as (sequence solveLatency handoverLatency totalLatency), where totalLatency is the time from the state sample of the plan to the tick at which its first references are applied.
+     */
+    void performWalking();
+
+    /**
+     Starts, follows and finishes the steps of the current walking plan.
+
+     @param t Current time relative to the state of the plan.
+     @param newPlan True if the plan was handed over at this tick, in which case the step in progress is retargeted.
+     */
+    void updateWalkingStep(double t, bool newPlan);
+
     void performSingleStepTest();
 
     /**
@@ -169,6 +200,56 @@ public:
     void findMIQPParams(yarp::os::ResourceFinder &rf);
     void findSteppingTestParams(yarp::os::ResourceFinder &rf);
 
+    /**
+     *  Parses the group [FOOTSTEP_PLANNER]. Step geometry limits are optional, see FootstepPlannerParams for the defaults. The velocity (vx, vy, wz) used when nothing is published on /<clientName>/footstepPlanner/velocity:i defaults to a straight walk of stepLength per stride from [STEPPING_TEST].
+     *
+     *  The port is read at every loop. In the STEPPING_TEST a new command is applied to the remaining steps at each touchdown. In the walking mode the commanded (vx, vy) replaces the CoM velocity reference of the MIQP, whose yaw rate stays MIQPParameters::yawRate.
+     */
+    void findFootstepPlannerParams(yarp::os::ResourceFinder &rf);
+    void findContactDetectorParams(yarp::os::ResourceFinder &rf);
+    void findStepTimingAdaptationParams(yarp::os::ResourceFinder &rf);
+
+    /**
+     *  Parses the group [ZMP_DISTURBANCE_OBSERVER] and creates the observer when enabled. Must be called after findZMPPreviewControllerParams(), which sets cz.
+     */
+    void findZmpDisturbanceObserverParams(yarp::os::ResourceFinder &rf);
+
+    /**
+     *  Shifts the ZMP references of the current preview window by the offset estimated by the disturbance observer, if enabled.
+     */
+    void compensateZmpDisturbance();
+
+    /**
+     *  Updates the disturbance observer with the measurements of the current tick and logs its estimate to zmpDisturbance.txt (time, offset x y, force x y). Must be called after _globalZMP has been computed.
+     *
+     *  @param hk           Measured horizontal CoM state.
+     *  @param appliedJerk  CoM jerk applied in this tick.
+     *  @param homeDir      Directory of the log files of the test.
+     *  @param tnow         Time of the test.
+     */
+    void updateZmpDisturbanceObserver(const Eigen::VectorXd &hk, const Eigen::Vector2d &appliedJerk, const std::string &homeDir, double tnow);
+
+    /**
+     *  Previewed CoM state reference of the current tick from the reference windows zmpRefInPreviewWindow and comVelRefInPreviewWindow (and the CoM heights windows in the stepping test). Solves the preview problem in this tick, or hands it over to the planning thread and tracks its latest solution when planningRatio is larger than 1. Sets _appliedComJerk.
+     *
+     *  @param hk       Measured horizontal CoM state.
+     *  @param[out] hkk Horizontal CoM state reference.
+     *  @param[out] pk  ZMP of hkk according to the table-cart model.
+     */
+    void previewCoM(const Eigen::VectorXd &hk, Eigen::VectorXd &hkk, Eigen::Vector2d &pk);
+
+    /**
+     *  Parses the group [PLAN_PUBLISHER].
+     */
+    void findPlanPublisherParams(yarp::os::ResourceFinder &rf);
+
+    /**
+     *  Publishes the plan and measured state of the stepping and walking modes once per planning cycle, if enabled. Must be called after previewCoM() and after _globalZMP has been computed.
+     *
+     *  @param hk Measured horizontal CoM state.
+     */
+    void publishWalkingPlan(const Eigen::VectorXd &hk);
+
     /**
      Takes an std::Vector of ZMP trajectories at time \f$k\f$ and outputs the ZMP samples from time \f$k\f$ until \f$k + N_c\f$s, i.e. the ZMP preview window.
 
@@ -195,7 +276,7 @@ public:
     std::vector<Eigen::Vector2d> generateZMPSingleStepTrajectory(double period, double feetSeparation);
 
     /**
-     Generates a straight line step pattern with step targets, step order, and step durations. Used for testing.
+     Generates a step pattern with step targets, step order, and step durations from the velocity command of the footstep planner. With the default velocity this is a straight line. Used for testing.
     */
     void generateStepPattern();
 
@@ -204,11 +285,32 @@ public:
     */
     std::vector<Eigen::Vector2d> generateZMPSteppingTrajectory();
 
+    /**
+     Replans the steps after the one that just touched down from the measured feet and the current velocity command of the footstep planner, then regenerates the ZMP trajectory of the STEPPING_TEST. Step heights and durations are kept.
+    */
+    void replanRemainingSteps();
+
+    /**
+     Generates the CoM height profile of the STEPPING_TEST and the height of the support surface under the ZMP, sampled like the ZMP trajectory. The support height is interpolated linearly between ZMP waypoints while the CoM follows it with minimum-jerk transitions, so that it rises smoothly onto platforms and stairs.
+
+     @param waypointHeights   Support height at every ZMP waypoint, relative to the initial one.
+     @param waypointDurations Duration of every segment between ZMP waypoints.
+     @param nSamples          Number of samples, i.e. size of the ZMP trajectory.
+     */
+    void generateCoMHeightSteppingTrajectory(const Eigen::VectorXd &waypointHeights, const Eigen::VectorXd &waypointDurations, int nSamples);
+
     /**
      Manages the step switching for the STEPPING_TEST.
     */
     void startSteppinMotherFucker(int &stepTrigger, double &error);
 
+    /**
+     Re-optimizes the remaining duration and the landing position of the step in progress from the measured CoM state. See StepTimingAdapter.
+
+     @param hk Horizontal CoM state (position, velocity, acceleration).
+     */
+    void adaptCurrentStep(const Eigen::VectorXd &hk);
+
     /**
      Prepares an object of type ocra::TaskState with the com state passed to this method and when doSet is true, applies the control to the robot.
 
@@ -232,21 +334,62 @@ private:
     // Variables for STEPPING_TEST.
     std::vector<FOOT> _stepOrder;
     Eigen::MatrixXd _stepTargets;
+    Eigen::VectorXd _stepTargetYaws;
     Eigen::VectorXd _stepTargetDurations;
     bool _currentlyStepping;
     bool _waitBeforeNextStep;
     double _waitTimeStart;
     int _currentStepIndex;
     std::vector<Eigen::Vector2d> _steppingTrajectory;
+    std::vector<double> _steppingComHeights;
+    std::vector<double> _steppingSupportHeights;
     steppingTestParams _steppingTestParams;
+    FootstepPlannerParams _footstepPlannerParams;
+    Eigen::Vector3d _footstepVelocity;
+    std::shared_ptr<FootstepPlanner> _footstepPlanner;
+    Eigen::Vector3d _steppingStartLeftFoot;
+    Eigen::Vector3d _steppingStartRightFoot;
+    StepTimingAdaptationParams _stepTimingAdaptationParams;
+    std::shared_ptr<StepTimingAdapter> _stepTimingAdapter;
+
+    // Variables for the walking mode.
+    WalkingPlan _walkingPlan;
+    MIQPPlan _incomingPlan;
+    bool _walkingStepInProgress;
+    FOOT _walkingSwingFoot;
+    /* Time at which the last step finished. Only plans computed after it can start a new step */
+    double _walkingLastTouchdownTime;
+    /* True once a velocity command has been received. Until then the MIQP tracks its own CoM reference */
+    bool _walkingSteered;
+    yarp::os::BufferedPort<yarp::os::Bottle> _walkingLatencyPort;
 
 
     // General Variables
     std::shared_ptr<ZmpPreviewParams> _zmpPreviewParams;
     std::shared_ptr<ZmpPreviewController> _zmpPreviewController;
+    VariableHeightZmpPreviewParams _variableHeightPreviewParams;
+    std::shared_ptr<VariableHeightZmpPreviewController> _variableHeightPreviewController;
+    ZmpDisturbanceObserverParams _zmpDisturbanceObserverParams;
+    std::shared_ptr<ZmpDisturbanceObserver> _zmpDisturbanceObserver;
+    /* Client periods per period of the preview planning thread. 1 solves the preview in the client */
+    int _previewPlanningRatio;
+    std::shared_ptr<ZmpPreviewPlanner> _zmpPreviewPlanner;
+    long _previewTick;
+    /* CoM jerk of the current CoM reference */
+    Eigen::Vector2d _appliedComJerk;
+    WalkingPlanPublisherParams _planPublisherParams;
+    std::shared_ptr<WalkingPlanPublisher> _planPublisher;
+    long _planPublisherTick;
+    /* Desired CoM height, vertical velocity and vertical acceleration */
+    Eigen::Vector3d _comHeightState;
     std::shared_ptr<ocra_recipes::TaskConnection> _comTask;
+    std::string _comTaskName;
     std::shared_ptr<MIQPController> _miqpController;
     std::shared_ptr<StepController> _stepController;
+    std::shared_ptr<ContactDetector> _contactDetector;
+    ContactDetectorParams _contactDetectorParams;
+    ocra_icub::ClientHeartbeat::shared_ptr _heartbeat;
+    ocra_icub::ArbitratedReferenceSender::shared_ptr _comReferenceSender;
     std::vector<Eigen::Vector2d> _zmpTrajectory;
     std::vector<Eigen::Vector2d> _singleStepTrajectory;
     ocra::TaskState _desiredComState;
@@ -290,6 +433,8 @@ private:
     bool _firstLoop;
     Eigen::VectorXd zmpRefInPreviewWindow;
     Eigen::VectorXd comVelRefInPreviewWindow;
+    Eigen::VectorXd comHeightsInPreviewWindow;
+    Eigen::VectorXd supportHeightsInPreviewWindow;
     Eigen::VectorXd optimalU;
 
     // MIQP-related variables
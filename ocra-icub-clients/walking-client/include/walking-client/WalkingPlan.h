@@ -0,0 +1,119 @@
+/**
+ *  \class WalkingPlan
+ *
+ *  \brief Converts the solution of the walking MIQP into references for the ZMP preview controller and the swing feet.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details An MIQPPlan holds the previewed CoP, CoM state and base of support (BoS) of one MIQP solution, sampled every \f$\delta t\f$ of the MIQP from the state it was computed from (sample 0). This class samples it at the rate of the client:
+ *
+ *  - The CoP and CoM velocity references of the preview window of ZmpPreviewController are interpolated linearly between MIQP samples and held after the end of the MIQP horizon.
+ *  - Steps are read from the support phases of the plan. The first single support (SS) phase, \f$\gamma = 0\f$, gives the liftoff time and the stance foot, which is the foot at the bounds \f$\mathbf{a} = \mathbf{b}\f$. The next double support (DS) phase gives the touchdown time, and its bounds the landing position: the swing foot lands at the corner of the box \f$[\mathbf{b}, \mathbf{a}]\f$ opposite to the stance foot, with the planned heading of the touchdown sample.
+ *
+ *  The bounds of each sample are expressed in the world frame rotated by the planned heading of the sample, so the corners are chosen in that frame and rotated back into the world frame.
+ *
+ *  Times are expressed relative to MIQPPlan::stateTime.
+ */
+
+#ifndef _WALKINGPLAN_H_
+#define _WALKINGPLAN_H_
+
+#include <Eigen/Dense>
+#include "walking-client/utils.h"
+
+struct MIQPPlan {
+    /* Number of the solution, starting at 1 */
+    unsigned int sequence;
+    /* Time at which the state the plan starts from was sampled (s) */
+    double stateTime;
+    /* Time at which the solution became available (s) */
+    double solvedTime;
+    /* Time between samples (s) */
+    double dt;
+    /* CoP, one row per sample. Row 0 is the state, rows 1 to N the preview window */
+    Eigen::MatrixXd cop;
+    /* CoM state (position, velocity, acceleration), one row per sample */
+    Eigen::MatrixXd com;
+    /* Upper bounds of the BoS in the heading frame of the sample, one row per sample */
+    Eigen::MatrixXd a;
+    /* Lower bounds of the BoS in the heading frame of the sample, one row per sample */
+    Eigen::MatrixXd b;
+    /* Planned heading, one per sample */
+    Eigen::VectorXd heading;
+    /* Double support indicator, one per sample */
+    Eigen::VectorXd gamma;
+
+    MIQPPlan():
+    sequence(0),
+    stateTime(0.0),
+    solvedTime(0.0),
+    dt(0.0){}
+};
+
+struct PlannedStep {
+    FOOT foot;
+    /* Landing position of the swing foot */
+    Eigen::Vector2d target;
+    /* Landing heading of the swing foot */
+    double yaw;
+    /* Beginning of the SS phase. Not positive if the foot is already swinging when the plan starts */
+    double liftoffTime;
+    /* Beginning of the following DS phase */
+    double touchdownTime;
+};
+
+class WalkingPlan {
+public:
+    WalkingPlan();
+    virtual ~WalkingPlan();
+
+    /**
+     *  Replaces the current plan.
+     */
+    void setPlan(const MIQPPlan &plan);
+
+    bool isValid() const {return _valid;}
+
+    /**
+     *  @return Sequence number of the current plan, 0 if there is none.
+     */
+    unsigned int getSequence() const {return _plan.sequence;}
+
+    const MIQPPlan &getPlan() const {return _plan;}
+
+    /**
+     *  CoP references of a preview window.
+     *
+     *  @param t            Current time relative to the state of the plan.
+     *  @param dt           Period of the preview window.
+     *  @param Np           Size of the preview window.
+     *  @param[out] zmpRef  Stacked references at t + dt, ..., t + Np*dt. Must be of size 2*Np.
+     */
+    void getCoPReference(double t, double dt, int Np, Eigen::VectorXd &zmpRef) const;
+
+    /**
+     *  Horizontal CoM velocity references of a preview window. Same arguments as getCoPReference().
+     */
+    void getCoMVelocityReference(double t, double dt, int Np, Eigen::VectorXd &comVelRef) const;
+
+    /**
+     *  First step of the plan whose landing is inside the MIQP horizon.
+     *
+     *  @param leftFoot   Current horizontal position of the left foot.
+     *  @param rightFoot  Current horizontal position of the right foot.
+     *  @param[out] step  Planned step.
+     *  @return False if the plan has no SS phase followed by a DS phase.
+     */
+    bool getNextStep(const Eigen::Vector2d &leftFoot, const Eigen::Vector2d &rightFoot, PlannedStep &step) const;
+
+private:
+    /**
+     *  Linear interpolation of two consecutive columns of the samples at time t.
+     */
+    Eigen::Vector2d interpolate(const Eigen::MatrixXd &samples, int col, double t) const;
+
+    MIQPPlan _plan;
+    bool _valid;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ *  \class WalkingPlanMessage
+ *
+ *  \brief Plan and measured state of the walking client in one compact, versioned binary message, for live monitoring.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details This file only depends on Eigen and is also built as the library walking-plan-message, so that monitoring tools can decode the messages published on /<clientName>/plan:o without linking against the client. Encoding and decoding reuse the storage of their arguments, so neither allocates once the sizes have settled.
+ *
+ *  Layout of version 2, which added the headings of the footsteps and of the contact sequence to version 1. Integers are unsigned, everything is little-endian and matrices are stored row by row:
+ *
+ *  | Bytes       | Content |
+ *  |-------------|---------|
+ *  | 4           | Magic "WKPL" |
+ *  | 2           | Version |
+ *  | 2           | Flags: bit 0 left foot in contact, bit 1 right foot in contact |
+ *  | 4           | Sequence number |
+ *  | 4           | Reserved |
+ *  | 8           | Time (s) |
+ *  | 8           | Sampling period of the ZMP reference and predicted CoM windows (s) |
+ *  | 8 x 6       | Measured horizontal CoM state (position, velocity, acceleration) |
+ *  | 8 x 2       | Measured global ZMP |
+ *  | 8 x 3       | Left foot position |
+ *  | 8 x 3       | Right foot position |
+ *  | 4 x 4       | Rows of zmpReference, predictedCom, footsteps and contactSequence |
+ *  | 8 x 2 x n   | zmpReference |
+ *  | 8 x 2 x n   | predictedCom |
+ *  | 8 x 6 x n   | footsteps |
+ *  | 8 x 7 x n   | contactSequence |
+ */
+
+#ifndef _WALKINGPLANMESSAGE_H_
+#define _WALKINGPLANMESSAGE_H_
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+struct WalkingPlanMessage {
+    /* Sequence number of the message */
+    uint32_t sequence;
+    /* Time of the client when the message was built (s) */
+    double time;
+    /* Time between two rows of zmpReference and predictedCom (s) */
+    double windowPeriod;
+
+    // Measured state
+    /* Horizontal CoM position, velocity and acceleration */
+    Eigen::Matrix<double, 6, 1> comState;
+    Eigen::Vector2d zmp;
+    Eigen::Vector3d leftFootPosition;
+    Eigen::Vector3d rightFootPosition;
+    bool leftFootInContact;
+    bool rightFootInContact;
+
+    // Plan
+    /* ZMP references of the preview window, one row per sample */
+    Eigen::MatrixXd zmpReference;
+    /* Horizontal CoM positions previewed by the ZMP preview controller, one row per sample */
+    Eigen::MatrixXd predictedCom;
+    /* Upcoming steps: foot (0 left, 1 right), target x y z, touchdown time relative to time (NaN if unknown), target yaw */
+    Eigen::MatrixXd footsteps;
+    /* Support phases of the MIQP plan: time relative to time, gamma (1 DS, 0 SS), upper bounds ax ay, lower bounds bx by, planned heading. The bounds are expressed in the world frame rotated by the heading */
+    Eigen::MatrixXd contactSequence;
+
+    WalkingPlanMessage();
+};
+
+namespace WalkingPlanCodec {
+    const uint16_t VERSION = 2;
+
+    /**
+     *  Serializes a message.
+     *
+     *  @param message      Message to encode.
+     *  @param[out] buffer  Encoded bytes. Only grows, so a reused buffer is not reallocated.
+     *  @return Number of bytes of the message at the beginning of buffer.
+     */
+    std::size_t encode(const WalkingPlanMessage &message, std::vector<unsigned char> &buffer);
+
+    /**
+     *  Deserializes a message.
+     *
+     *  @param data          Encoded bytes.
+     *  @param size          Number of bytes.
+     *  @param[out] message  Decoded message.
+     *  @return False if the bytes are not a complete message of a known version.
+     */
+    bool decode(const unsigned char *data, std::size_t size, WalkingPlanMessage &message);
+}
+
+#endif
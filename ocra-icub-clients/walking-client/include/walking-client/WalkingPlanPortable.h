@@ -0,0 +1,54 @@
+/**
+ *  \class WalkingPlanPortable
+ *
+ *  \brief Raw bytes of an encoded WalkingPlanMessage, as sent on /<clientName>/plan:o.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details Header only, so that a monitor only needs YARP and the walking-plan-message library:
+ *
+ *  \code
+ *  yarp::os::BufferedPort<WalkingPlanPortable> port;
+ *  port.open("/monitor/plan:i");
+ *  yarp::os::Network::connect("/walkingClient/plan:o", "/monitor/plan:i");
+ *  WalkingPlanMessage message;
+ *  WalkingPlanPortable *bytes = port.read();
+ *  if (bytes && WalkingPlanCodec::decode(bytes->buffer.data(), bytes->size, message)) { ... }
+ *  \endcode
+ */
+
+#ifndef _WALKINGPLANPORTABLE_H_
+#define _WALKINGPLANPORTABLE_H_
+
+#include <cstddef>
+#include <vector>
+#include <yarp/os/Portable.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/ConnectionWriter.h>
+
+class WalkingPlanPortable : public yarp::os::Portable {
+public:
+    /* Encoded message. Only grows, size is the number of valid bytes */
+    std::vector<unsigned char> buffer;
+    std::size_t size;
+
+    WalkingPlanPortable(): size(0) {}
+
+    virtual bool write(yarp::os::ConnectionWriter &connection) {
+        connection.appendInt(size);
+        connection.appendExternalBlock(reinterpret_cast<const char *>(buffer.data()), size);
+        return true;
+    }
+
+    virtual bool read(yarp::os::ConnectionReader &connection) {
+        int n = connection.expectInt();
+        if (n < 0)
+            return false;
+        if (buffer.size() < (std::size_t) n)
+            buffer.resize(n);
+        size = n;
+        return connection.expectBlock(reinterpret_cast<char *>(buffer.data()), n);
+    }
+};
+
+#endif
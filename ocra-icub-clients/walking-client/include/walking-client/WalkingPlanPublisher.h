@@ -0,0 +1,81 @@
+/**
+ *  \class WalkingPlanPublisher
+ *
+ *  \brief Publishes the plan and measured state of the walking client as one WalkingPlanMessage per planning cycle.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details The message is encoded into the buffer of a WalkingPlanPortable taken from a yarp::os::BufferedPort, whose pool of objects is reused from one message to the next, and written without waiting for the readers. A slow or absent reader only makes messages drop, it never blocks the loop of the client.
+ *
+ *  To keep the message compact the ZMP reference and predicted CoM windows are decimated: one sample every windowDecimation samples of the preview window.
+ */
+
+#ifndef _WALKINGPLANPUBLISHER_H_
+#define _WALKINGPLANPUBLISHER_H_
+
+#include <Eigen/Dense>
+#include <memory>
+#include <string>
+#include <yarp/os/BufferedPort.h>
+#include "walking-client/WalkingPlanMessage.h"
+#include "walking-client/WalkingPlanPortable.h"
+#include "walking-client/ZmpPreviewController.h"
+
+struct WalkingPlanPublisherParams {
+    /* Whether the plan is published on /<clientName>/plan:o */
+    bool enabled;
+    /* One sample of the preview windows every windowDecimation samples */
+    int windowDecimation;
+
+    WalkingPlanPublisherParams():
+    enabled(false),
+    windowDecimation(10){}
+};
+
+class WalkingPlanPublisher {
+public:
+    /**
+     *  Constructor.
+     *
+     *  @param period      Period (in ms) of the preview window samples, i.e. of the client.
+     *  @param controller  Preview controller, whose integration matrices give the predicted CoM.
+     *  @param params      Decimation of the windows.
+     */
+    WalkingPlanPublisher(const double period, std::shared_ptr<ZmpPreviewController> controller, const WalkingPlanPublisherParams &params);
+    virtual ~WalkingPlanPublisher();
+
+    bool open(const std::string &portName);
+    void close();
+
+    /**
+     *  @return Message to be filled with the measured state, the footsteps and the contact sequence before publish().
+     */
+    WalkingPlanMessage &message() {return _message;}
+
+    /**
+     *  Sets the ZMP reference and predicted CoM windows of the message.
+     *
+     *  @param zmpRef  Stacked ZMP references of the preview window.
+     *  @param h0      CoM state the preview was computed from.
+     *  @param U       Stacked optimal CoM jerks of the preview, integrated from h0.
+     */
+    void setPreviewWindow(const Eigen::VectorXd &zmpRef, const Eigen::VectorXd &h0, const Eigen::VectorXd &U);
+
+    /**
+     *  Encodes and writes the message with the next sequence number.
+     *
+     *  @param time Time of the message.
+     */
+    void publish(double time);
+
+private:
+    const int _decimation;
+    Eigen::MatrixXd _Ah;
+    Eigen::MatrixXd _Bh;
+    Eigen::VectorXd _h;
+    Eigen::VectorXd _hNext;
+    WalkingPlanMessage _message;
+    yarp::os::BufferedPort<WalkingPlanPortable> _port;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ *  \class ZmpDisturbanceObserver
+ *
+ *  \brief Estimates the ZMP offset caused by unmodelled dynamics and external pushes, to be fed forward into ZmpPreviewController.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details The table-cart model of ZmpPreviewController is augmented on each horizontal axis with a disturbance \f$w\f$, modelled as a random walk:
+ *
+ *  \f{align*}
+ *  \mathbf{x}_{k+1} &= \left[\begin{array}{cc} \mathbf{A}_h & 0 \\ 0 & 1 \end{array}\right] \mathbf{x}_k + \left[\begin{array}{c} \mathbf{B}_h \\ 0 \end{array}\right] u_k, \qquad \mathbf{x} = (h, \dot{h}, \ddot{h}, w)\\
+ *  \mathbf{y}_k &= \left[\begin{array}{cccc} 1 & 0 & 0 & 0 \\ 0 & 0 & 1 & 0 \\ 1 & 0 & -c_z/g & 1 \end{array}\right] \mathbf{x}_k
+ *  \f}
+ *
+ *  where \f$\mathbf{y}\f$ stacks the measured CoM position, CoM acceleration and global ZMP. \f$w\f$ is therefore the offset between the measured ZMP and the one of the table-cart model. It is equivalent to a horizontal force \f$\mathbf{f} = m g \mathbf{w} / c_z\f$ acting on the CoM, which captures a wrong CoM height, the motion of the arms or a push.
+ *
+ *  The gain of the observer is the steady-state Kalman gain of this model, computed once by the constructor. Every tick then costs a prediction and a correction with fixed-size 4x4 matrices, both axes at once. Feeding the offset forward amounts to shifting the ZMP references of the preview window by \f$-\mathbf{w}\f$, so the horizon does not have to grow to reject a constant disturbance.
+ */
+
+#ifndef _ZMPDISTURBANCEOBSERVER_H_
+#define _ZMPDISTURBANCEOBSERVER_H_
+
+#include <Eigen/Dense>
+
+struct ZmpDisturbanceObserverParams {
+    /* Whether the estimated ZMP offset is fed forward into the preview controller */
+    bool enabled;
+    /* Standard deviation of the measured CoM position (m) */
+    double comPositionNoise;
+    /* Standard deviation of the measured CoM acceleration (m/s^2) */
+    double comAccelerationNoise;
+    /* Standard deviation of the measured global ZMP (m) */
+    double zmpNoise;
+    /* Standard deviation of the CoM jerk not explained by the applied input (m/s^3) */
+    double jerkNoise;
+    /* Rate at which the disturbance can drift (m/sqrt(s)). Larger values track pushes faster */
+    double disturbanceRate;
+    /* Saturation of the compensated ZMP offset on each axis (m) */
+    double maxOffset;
+
+    ZmpDisturbanceObserverParams():
+    enabled(false),
+    comPositionNoise(0.001),
+    comAccelerationNoise(0.1),
+    zmpNoise(0.005),
+    jerkNoise(1.0),
+    disturbanceRate(0.05),
+    maxOffset(0.03){}
+};
+
+class ZmpDisturbanceObserver {
+public:
+    /**
+     *  Constructor. Computes the steady-state gain of the observer.
+     *
+     *  @param period  Period (in ms) of the thread in which the observer is updated.
+     *  @param cz      Constant CoM height of the table-cart model.
+     *  @param params  Noise model of the observer.
+     */
+    ZmpDisturbanceObserver(const double period, const double cz, const ZmpDisturbanceObserverParams &params);
+    virtual ~ZmpDisturbanceObserver();
+
+    /**
+     *  Prediction and correction with the measurements of the current tick. The first call initializes the state with zero disturbance.
+     *
+     *  @param hk           Measured horizontal CoM state (position, velocity, acceleration).
+     *  @param measuredZmp  Global ZMP measured by the feet F/T sensors.
+     *  @param appliedJerk  CoM jerk applied at the previous tick.
+     */
+    void update(const Eigen::VectorXd &hk, const Eigen::Vector2d &measuredZmp, const Eigen::Vector2d &appliedJerk);
+
+    /**
+     *  Shifts every ZMP reference of a preview window by the saturated estimated offset.
+     *
+     *  @param[in,out] zmpRef Stacked ZMP references, as passed to ZmpPreviewController::computeOptimalInput().
+     */
+    void compensate(Eigen::VectorXd &zmpRef) const;
+
+    /**
+     *  @return Estimated ZMP offset \f$\mathbf{w}\f$.
+     */
+    Eigen::Vector2d getZmpOffset() const {return _X.row(3).transpose();}
+
+    /**
+     *  @param mass Mass of the robot (kg).
+     *  @return Equivalent horizontal force on the CoM (N).
+     */
+    Eigen::Vector2d getDisturbanceForce(const double mass) const;
+
+    /**
+     *  Forgets the estimate. The next call to update() initializes it again.
+     */
+    void reset();
+
+private:
+    const double _g;
+    const double _cz;
+    const double _maxOffset;
+    Eigen::Matrix4d _A;
+    Eigen::Vector4d _B;
+    Eigen::Matrix<double, 3, 4> _C;
+    /* Steady-state Kalman gain */
+    Eigen::Matrix<double, 4, 3> _L;
+    /* Augmented state, one column per axis */
+    Eigen::Matrix<double, 4, 2> _X;
+    Eigen::Matrix<double, 3, 2> _Y;
+    bool _initialized;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ *  \class ZmpPreviewPlanner
+ *
+ *  \brief Runs ZmpPreviewController in a slower planning thread, while the client tracks its latest output at its own rate.
+ *
+ *  \author Jorhabib Eljaik
+ *
+ *  \details The preview matrices are built with the period of the client, so one solution \f$\mathcal{U}_{k+N_c|k}\f$ holds a jerk for every client tick after the tick \f$k\f$ at which the CoM state was measured. The planning thread runs every `ratio` client periods:
+ *
+ *  - Fast loop (client): post() hands over the measured CoM state and the reference windows of the current tick. track() picks up the latest solution, if any, and integrates its jerks from the state it was computed from up to the current tick. The CoM position, velocity and acceleration sent to the task are therefore those of the previewed trajectory, consistent with each other by construction.
+ *  - Slow loop (this thread): solves the preview problem for the latest posted request and publishes the solution.
+ *
+ *  Requests and solutions go through triple buffers, so neither loop ever waits for the other and neither allocates memory after the constructor.
+ */
+
+#ifndef _ZMPPREVIEWPLANNER_H_
+#define _ZMPPREVIEWPLANNER_H_
+
+#include <Eigen/Dense>
+#include <atomic>
+#include <memory>
+#include <yarp/os/RateThread.h>
+#include "walking-client/ZmpPreviewController.h"
+#include "walking-client/VariableHeightZmpPreviewController.h"
+
+/**
+ *  Single-producer, single-consumer triple buffer. publish() and read() are wait-free: the writer fills its own buffer and swaps it with the shared one, the reader swaps the shared one with its own buffer only when it is newer.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    explicit TripleBuffer(const T &initial):
+    _writeIndex(0),
+    _readIndex(2),
+    _shared(1)
+    {
+        for (int i = 0; i < 3; ++i)
+            _buffers[i] = initial;
+    }
+
+    /**
+     *  @return Buffer owned by the writer, to be filled before calling publish().
+     */
+    T &writeBuffer() {return _buffers[_writeIndex];}
+
+    /**
+     *  Makes the write buffer the newest value.
+     */
+    void publish() {
+        _writeIndex = _shared.exchange(_writeIndex | FRESH) & INDEX;
+    }
+
+    /**
+     *  Takes the newest value, if it was published after the last call.
+     *
+     *  @return True if readBuffer() changed.
+     */
+    bool read() {
+        if (!(_shared.load() & FRESH))
+            return false;
+        _readIndex = _shared.exchange(_readIndex) & INDEX;
+        return true;
+    }
+
+    /**
+     *  @return Buffer owned by the reader.
+     */
+    const T &readBuffer() const {return _buffers[_readIndex];}
+
+private:
+    enum {INDEX = 3, FRESH = 4};
+    T _buffers[3];
+    int _writeIndex;
+    int _readIndex;
+    std::atomic<int> _shared;
+};
+
+struct PreviewRequest {
+    /* Client tick at which hk was measured */
+    long tick;
+    Eigen::VectorXd hk;
+    Eigen::VectorXd zmpRef;
+    Eigen::VectorXd comVelRef;
+    /* Only used by the variable height controller */
+    Eigen::VectorXd comHeights;
+    Eigen::VectorXd supportHeights;
+};
+
+struct PreviewSolution {
+    /* Tick of the request the solution was computed from */
+    long tick;
+    Eigen::VectorXd hk;
+    Eigen::VectorXd U;
+    /* Effective CoM height used by the solution */
+    double effectiveHeight;
+};
+
+class ZmpPreviewPlanner : public yarp::os::RateThread {
+public:
+    /**
+     *  Constructor.
+     *
+     *  @param clientPeriod          Period (in ms) of the client, also the sampling period of the preview controller.
+     *  @param ratio                 Number of client periods per planning period.
+     *  @param parameters            Preview parameters of the controller.
+     *  @param controller            Preview controller. Only this thread calls its computeOptimalInput() once started.
+     *  @param variableHeightController Same controller when it previews along a CoM height profile, null otherwise.
+     */
+    ZmpPreviewPlanner(const int clientPeriod,
+                      const int ratio,
+                      std::shared_ptr<ZmpPreviewParams> parameters,
+                      std::shared_ptr<ZmpPreviewController> controller,
+                      std::shared_ptr<VariableHeightZmpPreviewController> variableHeightController);
+    virtual ~ZmpPreviewPlanner();
+
+    /**
+     *  Solves the preview problem of the latest request, if it has not been solved yet.
+     */
+    virtual void run();
+
+    /**
+     *  Hands over the measurements and references of the current tick to the planning thread. Called by the client.
+     *
+     *  @param tick           Current client tick.
+     *  @param hk             Measured horizontal CoM state.
+     *  @param zmpRef         ZMP references of the preview window.
+     *  @param comVelRef      CoM velocity references of the preview window.
+     *  @param comHeights     Planned CoM heights of the preview window. Ignored by the constant height controller.
+     *  @param supportHeights Heights of the support surface of the preview window. Ignored by the constant height controller.
+     */
+    void post(long tick,
+              const Eigen::VectorXd &hk,
+              const Eigen::VectorXd &zmpRef,
+              const Eigen::VectorXd &comVelRef,
+              const Eigen::VectorXd &comHeights,
+              const Eigen::VectorXd &supportHeights);
+
+    /**
+     *  CoM state reference of the current tick from the latest solution. Called by the client.
+     *
+     *  @param tick             Current client tick.
+     *  @param[out] hkk         Previewed CoM state at the next tick.
+     *  @param[out] jerk        Previewed jerk applied between the current and next tick.
+     *  @param[out] effectiveHeight Effective CoM height of the solution.
+     *  @return False until the first solution is available.
+     */
+    bool track(long tick, Eigen::VectorXd &hkk, Eigen::Vector2d &jerk, double &effectiveHeight);
+
+    /**
+     *  @return Solution currently tracked by track(). Called by the client.
+     */
+    const PreviewSolution &getTrackedSolution() const {return _solutions.readBuffer();}
+
+private:
+    const int _Nc;
+    const double _cz;
+    /* Integration matrices at the period of the client */
+    Eigen::MatrixXd _Ah;
+    Eigen::MatrixXd _Bh;
+    std::shared_ptr<ZmpPreviewController> _controller;
+    std::shared_ptr<VariableHeightZmpPreviewController> _variableHeightController;
+    TripleBuffer<PreviewRequest> _requests;
+    TripleBuffer<PreviewSolution> _solutions;
+    /* Last request solved by this thread */
+    long _solvedTick;
+
+    // Owned by the client
+    /* Previewed CoM state at _trackedTick */
+    Eigen::VectorXd _trackedState;
+    Eigen::VectorXd _nextState;
+    long _trackedTick;
+    bool _tracking;
+};
+
+#endif
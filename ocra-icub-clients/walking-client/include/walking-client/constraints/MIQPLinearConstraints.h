@@ -178,8 +178,9 @@ public:
      * Updates the state-dependent RHS of the inequality constraints 
      * 
      * @param[in] xi_k Current state.
+     * @param[in] heading Heading of the frame in which xi_k is expressed.
      */
-    void updateRHS(const Eigen::VectorXd& xi_k);
+    void updateRHS(const Eigen::VectorXd& xi_k, double heading);
     
     /**
      * Retrieves the constraints matrix \f$\mathbf{A}\f$. Before passing a matrix to copy #_A allocate the space 
@@ -32,6 +32,8 @@ struct steppingTestParams {
     double stepDuration;
     double stepLength;
     double stepHeight;
+    /* Height gained by every step, e.g. the riser of a staircase (m) */
+    double stepRise;
 };
 
 struct MIQPParameters {
@@ -93,6 +95,10 @@ struct MIQPParameters {
     std::string robot;
     /* Distance from actual CoP boundaries */
     double marginCoPBounds;
+    /* Keep solving from the measured state instead of stopping after the first solution */
+    bool closedLoop;
+    /* Heading rate of the planned heading sequence (rad/s). The BoS bounds of each preview sample are expressed in the frame of its planned heading */
+    double yawRate;
 };
 
 #define STATE_VECTOR_SIZE 16
@@ -90,10 +90,13 @@ void BaseOfSupport::buildA(const Eigen::MatrixXd& Ci, const Eigen::MatrixXd& Q,
     OCRA_INFO("Built A");
 }
 
-bool BaseOfSupport::update(const Eigen::VectorXd& xi_k) {
+bool BaseOfSupport::update(const Eigen::VectorXd& xi_k, double heading) {
     // Get feet corners
     Eigen::MatrixXd feetCorners;
     feetCorners = _stepController->getContact2DCoordinates();
+    // Express them in the heading frame, where the box is aligned with the feet
+    Eigen::Matrix2d toHeadingFrame = Eigen::Rotation2Dd(-heading).toRotationMatrix();
+    feetCorners = feetCorners*toHeadingFrame.transpose();
     // Compute the bounding box of the current support configuration
     Eigen::Matrix2d minMaxBoundingBox;
     computeBoundingBox(feetCorners, minMaxBoundingBox);
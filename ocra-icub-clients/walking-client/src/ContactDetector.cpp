@@ -0,0 +1,210 @@
+#include "walking-client/ContactDetector.h"
+#include <ocra/util/Macros.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/os/Time.h>
+#include <algorithm>
+#include <cmath>
+
+// Events kept when nobody consumes them
+#define MAX_PENDING_CONTACT_EVENTS 100
+
+ContactDetector::WrenchPort::WrenchPort(ContactDetector &detector, FOOT foot):
+_detector(detector),
+_foot(foot)
+{
+}
+
+void ContactDetector::WrenchPort::onRead(yarp::sig::Vector &wrench)
+{
+    if (wrench.size() < 3)
+        return;
+    // Prefer the acquisition time of the sample when the sensor stamps it
+    yarp::os::Stamp stamp;
+    double timestamp = (getEnvelope(stamp) && stamp.isValid()) ? stamp.getTime() : yarp::os::Time::now();
+    _detector.update(_foot, Eigen::VectorXd::Map(wrench.data(), wrench.size()), timestamp);
+}
+
+ContactDetector::ContactDetector(const ContactDetectorParams &params):
+_params(params),
+_leftWrenchPort(*this, LEFT_FOOT),
+_rightWrenchPort(*this, RIGHT_FOOT),
+_isOpen(false)
+{
+    if (_params.liftoffForce >= _params.touchdownForce) {
+        OCRA_WARNING("liftoffForce must be smaller than touchdownForce. Using " << 0.5*_params.touchdownForce << " instead.")
+        _params.liftoffForce = 0.5*_params.touchdownForce;
+    }
+}
+
+ContactDetector::~ContactDetector()
+{
+    close();
+}
+
+bool ContactDetector::open(const std::string &prefix, const std::string &robot)
+{
+    bool ok = _eventsPort.open((prefix + "/events:o").c_str());
+    ok &= _statePort.open((prefix + "/state:o").c_str());
+
+    WrenchPort *ports[2] = {&_leftWrenchPort, &_rightWrenchPort};
+    const std::string names[2] = {"left_foot", "right_foot"};
+    for (int i = 0; i < 2; ++i) {
+        std::string portName = prefix + "/" + names[i] + "/wrench:i";
+        if (!ports[i]->open(portName.c_str())) {
+            OCRA_ERROR("Impossible to open " << portName)
+            ok = false;
+            continue;
+        }
+        ports[i]->useCallback();
+        std::string src = std::string("/" + robot + "/" + names[i] + "/analog:o");
+        if (!yarp::os::Network::connect(src, portName)) {
+            OCRA_ERROR("Impossible to connect to " << src)
+            ok = false;
+        }
+    }
+    _isOpen = true;
+    return ok;
+}
+
+void ContactDetector::close()
+{
+    if (!_isOpen)
+        return;
+    _leftWrenchPort.disableCallback();
+    _rightWrenchPort.disableCallback();
+    _leftWrenchPort.close();
+    _rightWrenchPort.close();
+    _eventsPort.close();
+    _statePort.close();
+    _isOpen = false;
+}
+
+void ContactDetector::update(FOOT foot, const Eigen::VectorXd &rawWrench, double timestamp)
+{
+    bool hasEvent = false;
+    ContactEvent event;
+    {
+        std::lock_guard<std::mutex> lock(_stateMutex);
+        FootContactState &s = _feet[foot];
+        double measuredForce = _params.forceSign*rawWrench(2);
+
+        if (!s.initialized) {
+            s.normalForce = measuredForce;
+            s.inContact = measuredForce > _params.touchdownForce;
+            s.initialized = true;
+        } else {
+            // First order low-pass filter, discretized with the actual time between samples
+            double dt = std::max(0.0, timestamp - s.lastSampleTime);
+            double tau = 1.0/(2.0*M_PI*_params.cutoffFrequency);
+            s.normalForce += (dt/(dt + tau))*(measuredForce - s.normalForce);
+        }
+        s.lastSampleTime = timestamp;
+        s.confidence = std::max(0.0, std::min(1.0, (s.normalForce - _params.liftoffForce)/(_params.touchdownForce - _params.liftoffForce)));
+
+        // Hysteresis
+        bool contactRequested = s.inContact ? (s.normalForce > _params.liftoffForce) : (s.normalForce > _params.touchdownForce);
+
+        // Debouncing
+        if (contactRequested == s.inContact) {
+            s.pendingSince = -1.0;
+        } else {
+            if (s.pendingSince < 0.0)
+                s.pendingSince = timestamp;
+            if ((timestamp - s.pendingSince) >= _params.debounceTime) {
+                s.inContact = contactRequested;
+                event.foot = foot;
+                event.type = s.inContact ? TOUCHDOWN : LIFTOFF;
+                event.timestamp = s.pendingSince;
+                event.confidence = s.confidence;
+                if (s.inContact)
+                    s.lastTouchdownTime = s.pendingSince;
+                else
+                    s.lastLiftoffTime = s.pendingSince;
+                s.pendingSince = -1.0;
+                _events.push_back(event);
+                if (_events.size() > MAX_PENDING_CONTACT_EVENTS)
+                    _events.pop_front();
+                hasEvent = true;
+            }
+        }
+    }
+
+    if (_isOpen) {
+        if (hasEvent)
+            publishEvent(event);
+        publishState();
+    }
+}
+
+bool ContactDetector::isInContact(FOOT foot)
+{
+    std::lock_guard<std::mutex> lock(_stateMutex);
+    return _feet[foot].inContact;
+}
+
+double ContactDetector::getConfidence(FOOT foot)
+{
+    std::lock_guard<std::mutex> lock(_stateMutex);
+    return _feet[foot].confidence;
+}
+
+double ContactDetector::getNormalForce(FOOT foot)
+{
+    std::lock_guard<std::mutex> lock(_stateMutex);
+    return _feet[foot].normalForce;
+}
+
+double ContactDetector::getLastTouchdownTime(FOOT foot)
+{
+    std::lock_guard<std::mutex> lock(_stateMutex);
+    return _feet[foot].lastTouchdownTime;
+}
+
+double ContactDetector::getLastLiftoffTime(FOOT foot)
+{
+    std::lock_guard<std::mutex> lock(_stateMutex);
+    return _feet[foot].lastLiftoffTime;
+}
+
+bool ContactDetector::popEvent(ContactEvent &event)
+{
+    std::lock_guard<std::mutex> lock(_stateMutex);
+    if (_events.empty())
+        return false;
+    event = _events.front();
+    _events.pop_front();
+    return true;
+}
+
+void ContactDetector::publishEvent(const ContactEvent &event)
+{
+    std::lock_guard<std::mutex> lock(_portMutex);
+    yarp::os::Bottle &b = _eventsPort.prepare();
+    b.clear();
+    b.addString(event.type == TOUCHDOWN ? "touchdown" : "liftoff");
+    b.addString(event.foot == LEFT_FOOT ? "left" : "right");
+    b.addDouble(event.timestamp);
+    b.addDouble(event.confidence);
+    _eventsPort.writeStrict();
+}
+
+void ContactDetector::publishState()
+{
+    FootContactState left, right;
+    {
+        std::lock_guard<std::mutex> lock(_stateMutex);
+        left = _feet[LEFT_FOOT];
+        right = _feet[RIGHT_FOOT];
+    }
+    std::lock_guard<std::mutex> lock(_portMutex);
+    yarp::os::Bottle &b = _statePort.prepare();
+    b.clear();
+    b.addInt(left.inContact);
+    b.addDouble(left.confidence);
+    b.addDouble(left.normalForce);
+    b.addInt(right.inContact);
+    b.addDouble(right.confidence);
+    b.addDouble(right.normalForce);
+    _statePort.write();
+}
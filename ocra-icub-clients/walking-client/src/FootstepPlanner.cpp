@@ -0,0 +1,207 @@
+#include "walking-client/FootstepPlanner.h"
+#include <ocra/util/Macros.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+FootstepPlanner::FootstepPlanner(const FootstepPlannerParams &params):
+_params(params),
+_velocity(Eigen::Vector3d::Zero()),
+_lastCommandTime(-1.0),
+_leftFoot(Eigen::Vector3d::Zero()),
+_rightFoot(Eigen::Vector3d::Zero()),
+_leftYaw(0.0),
+_rightYaw(0.0),
+_swingFoot(RIGHT_FOOT),
+_unicycle(Eigen::Vector3d::Zero()),
+_portIsOpen(false)
+{
+    // With parallel feet the soles only overlap when they are closer than one foot width.
+    if (_params.minStepWidth < _params.footWidth) {
+        OCRA_WARNING("minStepWidth (" << _params.minStepWidth << ") is smaller than footWidth. Using " << _params.footWidth << " instead.")
+        _params.minStepWidth = _params.footWidth;
+    }
+    if (_params.maxStepWidth < _params.minStepWidth) {
+        OCRA_WARNING("maxStepWidth is smaller than minStepWidth. Using " << _params.minStepWidth << " instead.")
+        _params.maxStepWidth = _params.minStepWidth;
+    }
+    _params.nominalStepWidth = std::max(_params.minStepWidth, std::min(_params.maxStepWidth, _params.nominalStepWidth));
+}
+
+FootstepPlanner::~FootstepPlanner()
+{
+    close();
+}
+
+bool FootstepPlanner::openVelocityPort(const std::string &portName)
+{
+    _portIsOpen = _velocityPort.open(portName.c_str());
+    if (!_portIsOpen) {
+        OCRA_ERROR("Impossible to open " << portName)
+    }
+    return _portIsOpen;
+}
+
+void FootstepPlanner::close()
+{
+    if (_portIsOpen) {
+        _velocityPort.close();
+        _portIsOpen = false;
+    }
+}
+
+bool FootstepPlanner::readVelocityCommand(double now)
+{
+    if (!_portIsOpen)
+        return false;
+
+    yarp::os::Bottle *command = _velocityPort.read(false);
+    if (command != NULL && command->size() >= 3) {
+        setVelocityCommand(Eigen::Vector3d(command->get(0).asDouble(), command->get(1).asDouble(), command->get(2).asDouble()));
+        _lastCommandTime = now;
+        return true;
+    }
+
+    // Stop walking when the commanding module goes silent. The timeout only applies once a command has been received.
+    if (_lastCommandTime >= 0.0 && (now - _lastCommandTime) > _params.commandTimeout && !_velocity.isZero()) {
+        OCRA_WARNING("No velocity command received in the last " << _params.commandTimeout << "s. Setting velocity to zero.")
+        _velocity.setZero();
+    }
+    return false;
+}
+
+void FootstepPlanner::setVelocityCommand(const Eigen::Vector3d &velocity)
+{
+    _velocity = velocity;
+}
+
+Eigen::Vector3d FootstepPlanner::getVelocityCommand() const
+{
+    return _velocity;
+}
+
+void FootstepPlanner::reset(const Eigen::Vector3d &leftFoot, double leftYaw, const Eigen::Vector3d &rightFoot, double rightYaw, FOOT firstSwingFoot)
+{
+    _leftFoot = leftFoot;
+    _rightFoot = rightFoot;
+    _leftYaw = wrapAngle(leftYaw);
+    _rightYaw = wrapAngle(rightYaw);
+    _swingFoot = firstSwingFoot;
+    _unicycle.head(2) = (leftFoot.head(2) + rightFoot.head(2))/2.0;
+    _unicycle(2) = wrapAngle(_leftYaw + wrapAngle(_rightYaw - _leftYaw)/2.0);
+}
+
+Footstep FootstepPlanner::computeNextStep() const
+{
+    return computeStep(_velocity);
+}
+
+void FootstepPlanner::commitStep(const Footstep &step)
+{
+    if (step.foot == LEFT_FOOT) {
+        _leftFoot = step.position;
+        _leftYaw = step.yaw;
+    } else {
+        _rightFoot = step.position;
+        _rightYaw = step.yaw;
+    }
+    // Re-anchor the unicycle on the committed foot, so that clamped steps do not accumulate an offset.
+    _unicycle.head(2) = step.position.head(2) - Eigen::Rotation2Dd(step.yaw)*lateralOffset(step.foot);
+    _unicycle(2) = step.yaw;
+    _swingFoot = (step.foot == LEFT_FOOT) ? RIGHT_FOOT : LEFT_FOOT;
+}
+
+Footstep FootstepPlanner::planNextStep()
+{
+    Footstep step = computeNextStep();
+    commitStep(step);
+    return step;
+}
+
+std::vector<Footstep> FootstepPlanner::planSteps(int nSteps)
+{
+    std::vector<Footstep> steps;
+    steps.reserve(nSteps + 1);
+    for (int i = 0; i < nSteps; ++i)
+        steps.push_back(planNextStep());
+
+    // Closing step with zero velocity brings the swing foot next to the last one.
+    Footstep closingStep = computeStep(Eigen::Vector3d::Zero());
+    commitStep(closingStep);
+    steps.push_back(closingStep);
+    return steps;
+}
+
+double FootstepPlanner::yawFromRotation(const Eigen::Rotation3d &rotation)
+{
+    return std::atan2(2.0*(rotation.w()*rotation.z() + rotation.x()*rotation.y()),
+                      1.0 - 2.0*(rotation.y()*rotation.y() + rotation.z()*rotation.z()));
+}
+
+Eigen::Vector2d FootstepPlanner::toLocalFrame(const Eigen::Vector2d &point, const Eigen::Vector2d &origin, double yaw) const
+{
+    return Eigen::Rotation2Dd(-yaw)*(point - origin);
+}
+
+Eigen::Vector2d FootstepPlanner::toWorldFrame(const Eigen::Vector2d &point, const Eigen::Vector2d &origin, double yaw) const
+{
+    return origin + Eigen::Rotation2Dd(yaw)*point;
+}
+
+double FootstepPlanner::wrapAngle(double angle) const
+{
+    return std::atan2(std::sin(angle), std::cos(angle));
+}
+
+Eigen::Vector2d FootstepPlanner::lateralOffset(FOOT foot) const
+{
+    double side = (foot == LEFT_FOOT) ? 1.0 : -1.0;
+    return Eigen::Vector2d(0.0, side*_params.nominalStepWidth/2.0);
+}
+
+Footstep FootstepPlanner::computeStep(const Eigen::Vector3d &velocity) const
+{
+    const double T = _params.stepDuration;
+    // Left foot is on the positive y side of the stance foot, right foot on the negative one.
+    const double side = (_swingFoot == LEFT_FOOT) ? 1.0 : -1.0;
+    const Eigen::Vector3d &stance = (_swingFoot == LEFT_FOOT) ? _rightFoot : _leftFoot;
+    const double stanceYaw = (_swingFoot == LEFT_FOOT) ? _rightYaw : _leftYaw;
+
+    // Integrate the unicycle over one step, using the heading at mid-step for the translation.
+    double theta = _unicycle(2) + velocity(2)*T;
+    double midTheta = _unicycle(2) + velocity(2)*T/2.0;
+    Eigen::Vector2d body = _unicycle.head(2) + Eigen::Rotation2Dd(midTheta)*Eigen::Vector2d(velocity.head(2))*T;
+    Eigen::Vector2d desired = toWorldFrame(lateralOffset(_swingFoot), body, theta);
+
+    // Clamp the foothold in the stance foot frame
+    Eigen::Vector2d local = toLocalFrame(desired, stance.head(2), stanceYaw);
+    double relativeYaw = wrapAngle(theta - stanceYaw);
+
+    // Turning the toe towards the stance foot is more limited than turning it away.
+    relativeYaw = side*std::max(-_params.maxInwardStepRotation, std::min(_params.maxStepRotation, side*relativeYaw));
+    local(0) = std::max(-_params.maxStepLength, std::min(_params.maxStepLength, local(0)));
+    local(1) = side*std::max(_params.minStepWidth, std::min(_params.maxStepWidth, side*local(1)));
+
+    // The inner corners of the swing sole must stay beyond the inner edge of the stance sole.
+    double innerMargin = std::numeric_limits<double>::max();
+    for (double corner : {-0.5, 0.5}) {
+        Eigen::Vector2d c = local + Eigen::Rotation2Dd(relativeYaw)*Eigen::Vector2d(corner*_params.footLength, -side*_params.footWidth/2.0);
+        innerMargin = std::min(innerMargin, side*c(1) - _params.footWidth/2.0);
+    }
+    if (innerMargin < 0.0) {
+        local(1) -= side*innerMargin;
+        // Pushing the foot outwards is not enough, so the rotation is dropped. Parallel feet never overlap since minStepWidth >= footWidth.
+        if (side*local(1) > _params.maxStepWidth) {
+            relativeYaw = 0.0;
+            local(1) = side*_params.maxStepWidth;
+        }
+    }
+
+    Footstep step;
+    step.foot = _swingFoot;
+    step.position.head(2) = toWorldFrame(local, stance.head(2), stanceYaw);
+    step.position(2) = stance(2);
+    step.yaw = wrapAngle(stanceYaw + relativeYaw);
+    step.duration = T;
+    return step;
+}
@@ -1,10 +1,12 @@
 #include "walking-client/MIQPController.h"
+#include <algorithm>
 
 using namespace MIQP;
 
-MIQPController::MIQPController(MIQPParameters params, ocra::Model::Ptr robotModel, std::shared_ptr<StepController> stepController, const Eigen::MatrixXd &comStateRef) : RateThread(params.dtThread),
+MIQPController::MIQPController(MIQPParameters params, ocra::Model::Ptr robotModel, std::shared_ptr<StepController> stepController, std::shared_ptr<ContactDetector> contactDetector, const Eigen::MatrixXd &comStateRef) : RateThread(params.dtThread),
 _robotModel(robotModel),
 _stepController(stepController),
+_contactDetector(contactDetector),
 _miqpParams(params),
 _comStateRef(comStateRef),
 _period(params.dt),
@@ -27,7 +29,10 @@ _R_H(_C_H.rows()*_miqpParams.N, _T.cols()*_miqpParams.N),
 _R_P(_C_P.rows()*_miqpParams.N, _T.cols()*_miqpParams.N),
 _R_B(_C_B.rows()*_miqpParams.N, _T.cols()*_miqpParams.N),
 _Sw(_R_H.rows(), _R_H.rows()),
-_H_N_r(6*_miqpParams.N)
+_H_N_r(6*_miqpParams.N),
+_heading(0.0),
+_velocityCommand(Eigen::Vector2d::Zero()),
+_hasVelocityCommand(false)
 
 {
     buildAh(_period, _Ah);
@@ -43,6 +48,9 @@ _H_N_r(6*_miqpParams.N)
     buildPreviewInputMatrix(_C_H, _R_H);
     buildPreviewInputMatrix(_C_P, _R_P);
     buildPreviewInputMatrix(_C_B, _R_B);
+    buildPlannedRotations();
+    rotateIntoStateFrame(_P_B);
+    rotateIntoStateFrame(_R_B);
     buildSw(_Sw, _miqpParams );
     buildNb(_Nb, _miqpParams.wb);
     if (_addRegularization)
@@ -111,7 +119,7 @@ MIQPController::~MIQPController() {
 bool MIQPController::threadInit() {
 
     // Instantiate MIQP state object
-    _state = std::make_shared<MIQPState>(_robotModel, _miqpParams.robot);
+    _state = std::make_shared<MIQPState>(_robotModel, _miqpParams.robot, _contactDetector);
     updateStateVector();
 
     // Set lower and upper bounds
@@ -156,11 +164,12 @@ void MIQPController::threadRelease() {
 void MIQPController::run() {
     // Update state vector
     updateStateVector();
+    double stateTime = yarp::os::Time::now();
 
     // Update constraints.
     // NOTE: _Aineq is time-invariant and thus built only once, while _Bineq is state dependant
     // (also depends on a history of states when walking constraints are included).
-    _constraints->updateRHS(_xi_k);
+    _constraints->updateRHS(_xi_k, _heading);
     _constraints->getRHS(_Bineq);
 
     // Updates RHS of equality constraints. For now, contains only Simultaneity
@@ -174,9 +183,14 @@ void MIQPController::run() {
     _eigGurobi.solve(2*_H_N, _linearTermTransObjFunc, _Aeq, _Beq, _Aineq, _Bineq, _lb, _ub);
 
     // Get the solution
+    Eigen::VectorXd X_kn = _eigGurobi.result();
+    MIQPPlan plan;
+    buildPlan(stateTime, X_kn, plan);
     this->semaphore.wait();
     OCRA_WARNING("Updated _X_kn");
-    _X_kn = _eigGurobi.result();
+    _X_kn = X_kn;
+    plan.sequence = _plan.sequence + 1;
+    _plan = plan;
     this->semaphore.post();
     std::cout << _X_kn.topRows(INPUT_VECTOR_SIZE).transpose() << std::endl;
     } catch(GRBException e) {
@@ -215,7 +229,8 @@ void MIQPController::run() {
         }
     }
     //FIXME: This is temporary. Remove when allowing state feedback
-    this->askToStop();
+    if (!_miqpParams.closedLoop)
+        this->askToStop();
  }
 
 void MIQPController::writeToFile(const double& time, const Eigen::VectorXd& X_kn, std::string& home) {
@@ -239,12 +254,32 @@ void MIQPController::setBinaryVariables()
 void MIQPController::setCOMStateRefInPreviewWindow(unsigned int k, Eigen::VectorXd &H_N_r) {
     unsigned int j = 0;
     // FIXME: Pass an actual reference of CoM states
+    // References are given along the planned heading of each sample, e.g. a forward velocity
+    // In closed loop k grows with every solve; past the end of the reference its last row is held
+    unsigned int lastRow = _comStateRef.rows() - 1;
+    _commandSemaphore.wait();
+    bool hasVelocityCommand = _hasVelocityCommand;
+    Eigen::Vector2d velocityCommand = _velocityCommand;
+    _commandSemaphore.post();
     for (unsigned int i = k + 1; i <= k + _miqpParams.N; i++) {
-        H_N_r.segment(j, 6) = _comStateRef.row(i);
+        const Eigen::Matrix2d &R = _plannedRotations[j/6 + 1];
+        unsigned int row = std::min(i, lastRow);
+        for (unsigned int d = 0; d < 3; d++)
+            H_N_r.segment<2>(j + 2*d) = R*_comStateRef.row(row).segment<2>(2*d).transpose();
+        // A velocity command steers the CoM, and with it the footsteps, at runtime
+        if (hasVelocityCommand)
+            H_N_r.segment<2>(j + 2) = R*velocityCommand;
         j += 6;
     }
 }
 
+void MIQPController::setVelocityCommand(const Eigen::Vector2d &velocity) {
+    _commandSemaphore.wait();
+    _velocityCommand = velocity;
+    _hasVelocityCommand = true;
+    _commandSemaphore.post();
+}
+
 void MIQPController::setLowerAndUpperBounds() {
     // N blocks of [a_0 a_1 b_0 b_1 alpha_0 alpha_1 beta_0 beta_1 delta gamma u_x u_y]
     _lb.setZero();
@@ -272,7 +307,10 @@ void MIQPController::setLowerAndUpperBounds() {
 void MIQPController::updateStateVector() {
     _state->updateStateVector();
     _state->getFullState(_xi_k);
-    _xi_k << 0, 0, 0, -0.13, 0, 0,0,0, 1, 1, 0.0, -0.065, 0, 0, 0, 0;
+    _heading = _state->getHeading();
+    // The open loop test solves once from a fixed initial stance. The walking mode replans from the measured state.
+    if (!_miqpParams.closedLoop)
+        _xi_k << 0, 0, 0, -0.13, 0, 0,0,0, 1, 1, 0.0, -0.065, 0, 0, 0, 0;
     OCRA_INFO("State in MIQPController is: _xi_k)" << _xi_k.transpose());
     OCRA_INFO("State: \n" << *_state);
 }
@@ -448,6 +486,18 @@ void MIQPController::buildPreviewInputMatrix(const Eigen::MatrixXd &C, Eigen::Ma
 //    OCRA_WARNING("Built R");
 }
 
+void MIQPController::buildPlannedRotations() {
+    _plannedRotations.resize(_miqpParams.N + 1);
+    double dt = _miqpParams.dt/1000.0;
+    for (unsigned int i = 0; i <= _miqpParams.N; i++)
+        _plannedRotations[i] = Eigen::Rotation2Dd(i*_miqpParams.yawRate*dt).toRotationMatrix();
+}
+
+void MIQPController::rotateIntoStateFrame(Eigen::MatrixXd &M) {
+    for (unsigned int i = 0; i < _miqpParams.N; i++)
+        M.middleRows(2*i, 2) = (_plannedRotations[i+1]*M.middleRows(2*i, 2)).eval();
+}
+
 void MIQPController::buildEqualityConstraintsMatrices(const Eigen::VectorXd &x_k, Eigen::MatrixXd &Aeq, Eigen::VectorXd &Beq) {
     _Ci_eq.resize(1,STATE_VECTOR_SIZE);
     _Ci_eq << 0,0,0,0,1,-1,1,-1, Eigen::VectorXd::Zero(8);
@@ -549,3 +599,48 @@ void MIQPController::buildMinimizeSteppingReg(MIQPParameters &miqpParams) {
 void MIQPController::getSolution(Eigen::VectorXd &X_kn) {
     X_kn = _X_kn;
 }
+
+bool MIQPController::getPlan(MIQPPlan &plan, unsigned int lastSequence) {
+    if (!this->semaphore.check())
+        return false;
+    bool isNew = _plan.sequence > lastSequence;
+    if (isNew)
+        plan = _plan;
+    this->semaphore.post();
+    return isNew;
+}
+
+void MIQPController::buildPlan(double stateTime, const Eigen::VectorXd &X_kn, MIQPPlan &plan) {
+    const int N = _miqpParams.N;
+    Eigen::VectorXd P_kN = _P_P*_xi_k + _R_P*X_kn;
+    Eigen::VectorXd H_kN = _P_H*_xi_k + _R_H*X_kn;
+    plan.cop.resize(N+1, 2);
+    plan.com.resize(N+1, 6);
+    plan.a.resize(N+1, 2);
+    plan.b.resize(N+1, 2);
+    plan.gamma.resize(N+1);
+    plan.heading.resize(N+1);
+    // CoP and CoM go back to the world frame, the bounds stay in the heading frame of their sample
+    const Eigen::Matrix2d toWorld = Eigen::Rotation2Dd(_heading).toRotationMatrix();
+    Eigen::VectorXd h0 = _C_H*_xi_k;
+    // Sample 0 is the state the plan starts from
+    plan.cop.row(0) = (toWorld*_C_P*_xi_k).transpose();
+    for (int d = 0; d < 3; d++)
+        plan.com.block<1,2>(0, 2*d) = (toWorld*h0.segment<2>(2*d)).transpose();
+    plan.a.row(0) = _xi_k.segment<2>(MIQP::A_X_IN).transpose();
+    plan.b.row(0) = _xi_k.segment<2>(MIQP::B_X_IN).transpose();
+    plan.gamma(0) = _xi_k(MIQP::GAMMA_IN);
+    plan.heading(0) = _heading;
+    for (int i = 0; i < N; i++) {
+        plan.cop.row(i+1) = (toWorld*P_kN.segment<2>(2*i)).transpose();
+        for (int d = 0; d < 3; d++)
+            plan.com.block<1,2>(i+1, 2*d) = (toWorld*H_kN.segment<2>(6*i + 2*d)).transpose();
+        plan.a.row(i+1) = X_kn.segment<2>(i*INPUT_VECTOR_SIZE + MIQP::A_X_IN).transpose();
+        plan.b.row(i+1) = X_kn.segment<2>(i*INPUT_VECTOR_SIZE + MIQP::B_X_IN).transpose();
+        plan.gamma(i+1) = X_kn(i*INPUT_VECTOR_SIZE + MIQP::GAMMA_IN);
+        plan.heading(i+1) = _heading + (i+1)*_miqpParams.yawRate*_miqpParams.dt/1000.0;
+    }
+    plan.stateTime = stateTime;
+    plan.solvedTime = yarp::os::Time::now();
+    plan.dt = _miqpParams.dt/1000.0;
+}
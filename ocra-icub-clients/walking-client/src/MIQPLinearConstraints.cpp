@@ -106,11 +106,11 @@ void MIQPLinearConstraints::setMatrixAcl() {
     }
 }
 
-void MIQPLinearConstraints::updateRHS(const Eigen::VectorXd& xi_k){
+void MIQPLinearConstraints::updateRHS(const Eigen::VectorXd& xi_k, double heading){
     _rhs.segment(0,_fcbarShapeAdmiss.size()) = _fcbarShapeAdmiss - _BShapeAdmiss * xi_k;
     /** FIXME: TEMPORARY!!  Maybe it's best to have a more generic update method*/
     if (_addCoPConstraints) {
-        _baseOfSupport->update(xi_k);
+        _baseOfSupport->update(xi_k, heading);
         // TODO: Add to _rhs the base of support terms
         Eigen::VectorXd tmprhs(_rhs.size() - _fcbarShapeAdmiss.size());
         _baseOfSupport->getrhs(tmprhs);
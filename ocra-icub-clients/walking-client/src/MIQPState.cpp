@@ -2,12 +2,16 @@
 
 using namespace MIQP;
 
-MIQPState::MIQPState(ocra::Model::Ptr robotModel, std::string robot):
+MIQPState::MIQPState(ocra::Model::Ptr robotModel, std::string robot, std::shared_ptr<ContactDetector> contactDetector):
 _xi_k(Eigen::VectorXd(STATE_VECTOR_SIZE)),
 _hk(Eigen::VectorXd(6)),
 _robotModel(robotModel),
 _robot(robot),
-_delta(1)
+_contactDetector(contactDetector),
+_delta(1),
+_l_foot_yaw(0.0),
+_r_foot_yaw(0.0),
+_heading(0.0)
 {
     OCRA_ERROR("FROM MIQPSTATE ROBOT NAME IS: " << _robot);
     initialize();
@@ -17,39 +21,10 @@ MIQPState::~MIQPState(){}
 
 bool MIQPState::initialize() {
 
-    // Connect to feet wrench ports
-    bool ok = _portWrenchLeftFoot.open("/walkingClient/MIQPState/left_foot/wrench:i");
-    if (!ok) {
-        OCRA_ERROR("Impossible to open /walkingClient/MIQPState/left_foot/wrench:i");
-        return false;
-    } else {
-        // Autoconnect
-        std::string src = std::string("/"+_robot+"/left_foot/analog:o");
-        if (!yarp::os::Network::connect(src, _portWrenchLeftFoot.getName().c_str())) {
-            OCRA_ERROR("Impossible to connect to " << src);
-            return false;
-        }
-    }
-    ok = _portWrenchRightFoot.open("/walkingClient/MIQPState/right_foot/wrench:i");
-    if (!ok) {
-        OCRA_ERROR("Impossible to open /walkingClient/MIQPState/right_foot/wrench:i");
-        return false;
-    } else {
-        // Autoconnect
-        std::string src = std::string("/"+_robot+"/right_foot/analog:o");
-        if (!yarp::os::Network::connect(src, _portWrenchRightFoot.getName().c_str()) ) {
-            OCRA_ERROR("Impossible to connect to " << src);
-            return false;
-        }
-    }
-
-    // Set thresholds
-    // FIXME: This should come from configuration file
-    _FzThreshold = 5; // N
-    _PzThreshold = 0.05; // m => 5cm
-
     // Set initial values for some of the BoS descriptors, assuming the robot always starts in double
     // support and no initial com velocity
+    _a.setZero();
+    _b.setZero();
     _alpha.setZero();
     _beta.setZero();
     _delta = 1;
@@ -61,6 +36,11 @@ bool MIQPState::initialize() {
 void MIQPState::updateStateVector() {
     /* TODO: This threshold should not be hardcoded but from config file*/
     double thresholdChange = 0.015; //1.5cm
+    // The previous bounds are compared with the new ones in the new heading frame
+    double previousHeading = updateHeading();
+    Eigen::Rotation2Dd toNewFrame(previousHeading - _heading);
+    _a = toNewFrame*_a;
+    _b = toNewFrame*_b;
     updateBaseOfSupportDescriptors(_a, _b, _alpha, _beta, _delta, _gamma, thresholdChange);
     updateHorizontalCoMState(_hk);
     _xi_k << _a, _b, _alpha, _beta, _delta, _gamma, _hk;
@@ -68,9 +48,9 @@ void MIQPState::updateStateVector() {
 
 bool MIQPState::isRobotInSS(FOOT &footInSS) {
     // is left foot in contact?
-    bool lFootInContact = isFootInContact(LEFT_FOOT, _FzThreshold, _PzThreshold);
+    bool lFootInContact = isFootInContact(LEFT_FOOT);
     // is right foot in contact?
-    bool rFootInContact = isFootInContact(RIGHT_FOOT, _FzThreshold, _PzThreshold);
+    bool rFootInContact = isFootInContact(RIGHT_FOOT);
     // if both are in contact, then return false
     if (lFootInContact && rFootInContact)
         return false;
@@ -88,27 +68,8 @@ bool MIQPState::isRobotInSS(FOOT &footInSS) {
 
 }
 
-bool MIQPState::isFootInContact(FOOT whichFoot, double FzThreshold, double PzThreshold) {
-    // Read normal F/T sensor measurement and compare to a threshold. Do the same for the z coordinate of the corresponding foot.
-    Eigen::VectorXd rawWrench(6);
-    double coordZ;
-    switch (whichFoot) {
-        case LEFT_FOOT:
-            readFootWrench(LEFT_FOOT, rawWrench);
-            coordZ = _l_foot_coord(2);
-            break;
-        case RIGHT_FOOT:
-            readFootWrench(RIGHT_FOOT, rawWrench);
-            coordZ = _r_foot_coord(2);
-            break;
-        default:
-            break;
-    }
-
-    if (rawWrench(2) < -_FzThreshold && coordZ < _PzThreshold)
-        return true;
-    else
-        return false;
+bool MIQPState::isFootInContact(FOOT whichFoot) {
+    return _contactDetector->isInContact(whichFoot);
 }
 
 void MIQPState::updateBaseOfSupportDescriptors(Eigen::Vector2d &aa,
@@ -124,6 +85,10 @@ void MIQPState::updateBaseOfSupportDescriptors(Eigen::Vector2d &aa,
     _l_foot_coord = getLeftFootPosition();
     // Retrieve coordinates of right sole
     _r_foot_coord = getRightFootPosition();
+    // Feet coordinates in the heading frame
+    Eigen::Rotation2Dd toHeadingFrame(-_heading);
+    _l_foot_coord.head<2>() = toHeadingFrame*_l_foot_coord.head<2>();
+    _r_foot_coord.head<2>() = toHeadingFrame*_r_foot_coord.head<2>();
     // If the robot is in SS, identify which foot is on the ground and set lower and upper bounds accordingly
     Eigen::Vector2d a;
     Eigen::Vector2d b;
@@ -190,30 +155,26 @@ void MIQPState::updateBaseOfSupportDescriptors(Eigen::Vector2d &aa,
     firstUpdate = false;
 }
 
-void MIQPState::updateHorizontalCoMState(Eigen::VectorXd &hk) {
-    hk.head<2>() = _robotModel->getCoMPosition().topRows(2);
-    hk.segment<2>(2) = _robotModel->getCoMVelocity().topRows(2);
-    hk.tail<2>() = _robotModel->getCoMAcceleration().topRows(2);
-}
-
-bool MIQPState::readFootWrench(FOOT whichFoot, Eigen::VectorXd &rawWrench) {
-    yarp::sig::Vector * yRawFootWrench;
-    switch (whichFoot) {
-        case LEFT_FOOT:
-            yRawFootWrench = _portWrenchLeftFoot.read();
-            break;
-        case RIGHT_FOOT:
-            yRawFootWrench = _portWrenchRightFoot.read();
-            break;
-        default:
-            break;
+double MIQPState::updateHeading() {
+    double previousHeading = _heading;
+    _l_foot_yaw = FootstepPlanner::yawFromRotation(_robotModel->getSegmentPosition(_robotModel->getSegmentIndex("l_sole")).getRotation());
+    _r_foot_yaw = FootstepPlanner::yawFromRotation(_robotModel->getSegmentPosition(_robotModel->getSegmentIndex("r_sole")).getRotation());
+    FOOT footInSS;
+    if (isRobotInSS(footInSS)) {
+        _heading = (footInSS == LEFT_FOOT) ? _l_foot_yaw : _r_foot_yaw;
+    } else {
+        double difference = std::atan2(std::sin(_r_foot_yaw - _l_foot_yaw), std::cos(_r_foot_yaw - _l_foot_yaw));
+        _heading = _l_foot_yaw + difference/2.0;
     }
+    _heading = std::atan2(std::sin(_heading), std::cos(_heading));
+    return previousHeading;
+}
 
-    if (yRawFootWrench == NULL)
-        return false;
-
-    rawWrench = Eigen::VectorXd::Map(yRawFootWrench->data(), 6);
-    return true;
+void MIQPState::updateHorizontalCoMState(Eigen::VectorXd &hk) {
+    Eigen::Rotation2Dd toHeadingFrame(-_heading);
+    hk.head<2>() = toHeadingFrame*_robotModel->getCoMPosition().topRows(2);
+    hk.segment<2>(2) = toHeadingFrame*_robotModel->getCoMVelocity().topRows(2);
+    hk.tail<2>() = toHeadingFrame*_robotModel->getCoMAcceleration().topRows(2);
 }
 
 void MIQPState::getFullState(Eigen::VectorXd &xi) {
@@ -1,7 +1,13 @@
 #include "walking-client/StepController.h"
+#include <yarp/os/Time.h>
 
 
 StepController::StepController(int periodms, ocra::Model::Ptr model):
+_leftFootDesiredPosition(Eigen::Vector3d::Zero()),
+_rightFootDesiredPosition(Eigen::Vector3d::Zero()),
+_leftFootStepStartTime(0.0),
+_rightFootStepStartTime(0.0),
+_maxFootVelocity(0.05),
 _model(model),
 _period(periodms) {}
 
@@ -10,22 +16,27 @@ StepController::~StepController() {
 }
 
 bool StepController::initialize() {
-    // Specify type of feet trajectory
-    ocra_recipes::TRAJECTORY_TYPE trajType = ocra_recipes::LIN_INTERP;
-    ocra_recipes::TERMINATION_STRATEGY termStrategy = ocra_recipes::WAIT;
-
-    // Create trajectory objects
-    _leftFoot_TrajThread = std::make_shared<ocra_recipes::TrajectoryThread>(_period, "LeftFootCartesian", trajType, termStrategy);
-    _rightFoot_TrajThread = std::make_shared<ocra_recipes::TrajectoryThread>(_period, "RightFootCartesian", trajType, termStrategy);
-
-    //TODO: We don't really want this! The speed should be given based on the time in which the step should be performed.
-    _leftFoot_TrajThread->setMaxVelocity(0.05);
-    _rightFoot_TrajThread->setMaxVelocity(0.05);
+    // Feet tasks, driven by the swing trajectories evaluated in update()
+    _leftFootTask = std::make_shared<ocra_recipes::TaskConnection>("LeftFootCartesian");
+    _rightFootTask = std::make_shared<ocra_recipes::TaskConnection>("RightFootCartesian");
+    _leftFootOrientationTask = std::make_shared<ocra_recipes::TaskConnection>("LeftFootOrientation");
+    _rightFootOrientationTask = std::make_shared<ocra_recipes::TaskConnection>("RightFootOrientation");
+    _leftFootTask->openControlPorts();
+    _rightFootTask->openControlPorts();
+    _leftFootOrientationTask->openControlPorts();
+    _rightFootOrientationTask->openControlPorts();
+    _leftFootDesiredPosition = getLeftFootPosition();
+    _rightFootDesiredPosition = getRightFootPosition();
+
+    // Errors of the feet tasks computed by the server on each tick
+    _convergenceListener = std::make_shared<ocra_icub::TaskConvergenceListener>("walking-client/stepController");
+    if (!_convergenceListener->open()) {
+        OCRA_WARNING("The feet task errors are not published by the server. They will be computed from the model.");
+    }
 
-    // Start trajectory threads
-    if (!_leftFoot_TrajThread->start()) return false;
-    if (!_rightFoot_TrajThread->start()) return false;
-    OCRA_INFO("Feet trajectory threads started.");
+    // Never re-target a step in less than two control periods
+    _leftFootSwing.setMinRetargetTime(2.0*_period/1000.0);
+    _rightFootSwing.setMinRetargetTime(2.0*_period/1000.0);
 
     // Create task connection objects
     _LeftFootContact_BackLeft = std::make_shared<ocra_recipes::TaskConnection>("LeftFootContact_BackLeft");
@@ -46,8 +57,6 @@ bool StepController::initialize() {
     _RightFootContact_FrontRight = std::make_shared<ocra_recipes::TaskConnection>("RightFootContact_FrontRight");
     _contactsCollection.push_back(_RightFootContact_FrontRight);
 
-    _leftFoot_TrajThread->setGoalErrorThreshold(0.005);
-    _rightFoot_TrajThread->setGoalErrorThreshold(0.005);
     OCRA_INFO("StepController finished initialization");
     return true;
 }
@@ -119,64 +128,124 @@ void StepController::activateFeetContacts(FOOT foot) {
 }
 
 bool StepController::doStepWithMaxVelocity(FOOT foot, Eigen::Vector3d target, double stepHeight) {
+    Eigen::Vector3d currentFootPosition = (foot == LEFT_FOOT) ? getLeftFootPosition() : getRightFootPosition();
+    // Length of the path through the midpoint
     Eigen::Vector3d midPoint; midPoint.setZero();
-    Eigen::MatrixXd wayPoints(3,2);
-
-    // Pass only the midpoint and the target point. The current position should be included by default.
-    this->computeMidPoint(foot, target, stepHeight, midPoint);
-    OCRA_INFO("Midpoint: " << midPoint);
-    OCRA_INFO("Target: " << target);
-    wayPoints.col(0) = midPoint;
-    wayPoints.col(1) = target;
-    switch ( foot ) {
-        case LEFT_FOOT:
-            _leftFoot_TrajThread->setTrajectoryWaypoints(wayPoints);
-            break;
-        case RIGHT_FOOT:
-            _rightFoot_TrajThread->setTrajectoryWaypoints(wayPoints);
-            break;
-        default:
-            break;
-    }
-
+    this->doComputeMidPoint(currentFootPosition, target, stepHeight, midPoint);
+    double pathLength = (midPoint - currentFootPosition).norm() + (target - midPoint).norm();
+    // A quintic peaks at 1.875 times its mean velocity
+    double stepDuration = 1.875*pathLength/_maxFootVelocity;
+    OCRA_INFO("Target: " << target.transpose() << " reached in " << stepDuration << "s");
+    step(foot, target, getFootYaw(foot), stepDuration, stepHeight);
     return true;
 }
 
 void StepController::step(FOOT foot, Eigen::Vector3d target, double stepDuration, double stepHeight)
 {
-    Eigen::Vector3d midPoint;
-    midPoint.setZero();
-    Eigen::Vector2d durations((stepDuration / 2.0), stepDuration);
-
-    Eigen::MatrixXd wayPoints(3,2);
+    step(foot, target, getFootYaw(foot), stepDuration, stepHeight);
+}
 
-    // Pass only the midpoint and the target point. The current position should be included by default.
-    this->computeMidPoint(foot, target, stepHeight, midPoint);
-//     OCRA_INFO("Midpoint: " << midPoint.transpose());
+void StepController::step(FOOT foot, Eigen::Vector3d target, double targetYaw, double stepDuration, double stepHeight)
+{
+    Eigen::Vector3d currentFootPosition = (foot == LEFT_FOOT) ? getLeftFootPosition() : getRightFootPosition();
     OCRA_INFO("Target: " << target.transpose());
-    wayPoints.col(0) = midPoint;
-    wayPoints.col(1) = target;
-    switch ( foot ) {
+    double now = yarp::os::Time::now();
+    getSwing(foot).start(currentFootPosition, getFootYaw(foot), target, targetYaw, stepDuration, stepHeight, now);
+    if (foot == LEFT_FOOT)
+        _leftFootStepStartTime = now;
+    else
+        _rightFootStepStartTime = now;
+    deactivateFeetContacts(foot);
+    update();
+}
+
+bool StepController::retarget(FOOT foot, Eigen::Vector3d target, double targetYaw)
+{
+    return getSwing(foot).retarget(target, targetYaw, yarp::os::Time::now());
+}
+
+bool StepController::retarget(FOOT foot, Eigen::Vector3d target, double targetYaw, double remainingDuration)
+{
+    double now = yarp::os::Time::now();
+    return getSwing(foot).retarget(target, targetYaw, now + remainingDuration, now);
+}
+
+double StepController::getStepElapsedTime(FOOT foot)
+{
+    if (!getSwing(foot).isActive())
+        return -1.0;
+    double start = (foot == LEFT_FOOT) ? _leftFootStepStartTime : _rightFootStepStartTime;
+    return yarp::os::Time::now() - start;
+}
+
+void StepController::update()
+{
+    double now = yarp::os::Time::now();
+    Eigen::Vector3d position, velocity, acceleration;
+    double yaw, yawRate, yawAcceleration;
+    if (_leftFootSwing.isActive()) {
+        _leftFootSwing.evaluate(now, position, velocity, acceleration, yaw, yawRate, yawAcceleration);
+        sendFootState(LEFT_FOOT, position, velocity, acceleration, yaw, yawRate, yawAcceleration);
+    }
+    if (_rightFootSwing.isActive()) {
+        _rightFootSwing.evaluate(now, position, velocity, acceleration, yaw, yawRate, yawAcceleration);
+        sendFootState(RIGHT_FOOT, position, velocity, acceleration, yaw, yawRate, yawAcceleration);
+    }
+}
+
+void StepController::sendFootState(FOOT foot, const Eigen::Vector3d &position, const Eigen::Vector3d &velocity, const Eigen::Vector3d &acceleration, double yaw, double yawRate, double yawAcceleration)
+{
+    // Only the heading is planned, roll and pitch are kept flat.
+    Eigen::Rotation3d orientation(std::cos(yaw/2.0), 0.0, 0.0, std::sin(yaw/2.0));
+
+    ocra::TaskState desiredPosition;
+    desiredPosition.setPosition(Eigen::Displacementd(position, orientation));
+    desiredPosition.setVelocity(Eigen::Twistd(0.0, 0.0, yawRate, velocity(0), velocity(1), velocity(2)));
+    desiredPosition.setAcceleration(Eigen::Twistd(0.0, 0.0, yawAcceleration, acceleration(0), acceleration(1), acceleration(2)));
+
+    ocra::TaskState desiredOrientation;
+    desiredOrientation.setPosition(Eigen::Displacementd(Eigen::Vector3d::Zero(), orientation));
+    desiredOrientation.setVelocity(Eigen::Twistd(0.0, 0.0, yawRate, 0.0, 0.0, 0.0));
+    desiredOrientation.setAcceleration(Eigen::Twistd(0.0, 0.0, yawAcceleration, 0.0, 0.0, 0.0));
+
+    switch (foot) {
         case LEFT_FOOT:
-            _leftFoot_TrajThread->pause();
-            _leftFoot_TrajThread->setTrajectoryWaypoints(wayPoints);
-            _leftFoot_TrajThread->getTrajectory()->setDuration(durations);
-            _leftFoot_TrajThread->unpause();
-            deactivateFeetContacts(foot);
+            _leftFootTask->setDesiredTaskStateDirect(desiredPosition);
+            _leftFootOrientationTask->setDesiredTaskStateDirect(desiredOrientation);
+            _leftFootDesiredPosition = position;
             break;
         case RIGHT_FOOT:
-            _rightFoot_TrajThread->pause();
-            _rightFoot_TrajThread->setTrajectoryWaypoints(wayPoints);
-            _rightFoot_TrajThread->getTrajectory()->setDuration(durations);
-            _rightFoot_TrajThread->unpause();
-            deactivateFeetContacts(foot);
+            _rightFootTask->setDesiredTaskStateDirect(desiredPosition);
+            _rightFootOrientationTask->setDesiredTaskStateDirect(desiredOrientation);
+            _rightFootDesiredPosition = position;
             break;
         default:
             break;
     }
-    
-    _leftFoot_TrajThread->getTrajectory();
+}
 
+SwingFootTrajectory& StepController::getSwing(FOOT foot)
+{
+    return (foot == LEFT_FOOT) ? _leftFootSwing : _rightFootSwing;
+}
+
+void StepController::finishStep(FOOT foot)
+{
+    SwingFootTrajectory &swing = getSwing(foot);
+    if (!swing.isActive())
+        return;
+    swing.stop();
+    // Hold the foot where it touched down rather than where it was planned to land.
+    Eigen::Vector3d measuredPosition = (foot == LEFT_FOOT) ? getLeftFootPosition() : getRightFootPosition();
+    Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+    sendFootState(foot, measuredPosition, zero, zero, getFootYaw(foot), 0.0, 0.0);
+    activateFeetContacts(foot);
+}
+
+void StepController::setTouchdownSearch(double velocity, double depth)
+{
+    _leftFootSwing.setTouchdownSearch(velocity, depth);
+    _rightFootSwing.setTouchdownSearch(velocity, depth);
 }
 
 void StepController::computeMidPoint(FOOT foot, Eigen::Vector3d target, double stepHeight, Eigen::Vector3d & midPoint) {
@@ -201,50 +270,52 @@ void StepController::doComputeMidPoint(Eigen::Vector3d currentFootPosition, Eige
 }
 
 bool StepController::isTrajectoryFinished(FOOT foot) {
-    switch (foot) {
-        case LEFT_FOOT:
-            return this->_leftFoot_TrajThread->goalAttained();
-            break;
-        case RIGHT_FOOT:
-            return this->_rightFoot_TrajThread->goalAttained();
-            break;
-        default:
-            break;
-    }
-
-    return true;
+    SwingFootTrajectory &swing = getSwing(foot);
+    return !swing.isActive() || swing.isNominalDurationOver(yarp::os::Time::now());
 }
 
-bool StepController::isStepFinished(FOOT foot) {
-    bool stepFinished = false;
-    switch (foot) {
-        case LEFT_FOOT:
-        {
-            stepFinished = this->_leftFoot_TrajThread->goalAttained();
-        }break;
-        case RIGHT_FOOT:
-        {
-            stepFinished = this->_rightFoot_TrajThread->goalAttained();
-        }break;
-        default:
-            break;
+bool StepController::isStepFinished(FOOT foot, bool footInContact) {
+    SwingFootTrajectory &swing = getSwing(foot);
+    if (!swing.isActive())
+        return true;
+
+    double now = yarp::os::Time::now();
+    if (footInContact && swing.isDescending(now)) {
+        OCRA_INFO("Touchdown measured " << now - swing.getTouchdownTime() << "s after the planned touchdown.");
+        finishStep(foot);
+        return true;
     }
-    if (stepFinished) {
-        activateFeetContacts(foot);
+    if (swing.isTouchdownSearchOver(now)) {
+        OCRA_WARNING("No touchdown was measured. Finishing the step anyway.");
+        finishStep(foot);
+        return true;
     }
+    return false;
+}
 
-    return stepFinished;
+bool StepController::isStepFinished(FOOT foot) {
+    if (isTrajectoryFinished(foot)) {
+        finishStep(foot);
+        return true;
+    }
+    return false;
 }
 
 double StepController::getFootTrajError(FOOT foot, double &error) {
+    ocra_icub::TaskConvergence convergence;
+    std::string taskName = (foot == LEFT_FOOT) ? "LeftFootCartesian" : "RightFootCartesian";
+    if (_convergenceListener && _convergenceListener->getConvergence(taskName, convergence)) {
+        error = convergence.positionError;
+        return error;
+    }
     switch (foot) {
         case LEFT_FOOT:
         {
-            error = this->_leftFoot_TrajThread->getDiffError();
+            error = (_leftFootDesiredPosition - getLeftFootPosition()).norm();
         }break;
         case RIGHT_FOOT:
         {
-            error = this->_rightFoot_TrajThread->getDiffError();
+            error = (_rightFootDesiredPosition - getRightFootPosition()).norm();
         }break;
         default:
             break;
@@ -263,6 +334,12 @@ Eigen::Vector3d StepController::getRightFootPosition()
     return _model->getSegmentPosition(_model->getSegmentIndex("r_sole")).getTranslation();
 }
 
+double StepController::getFootYaw(FOOT foot)
+{
+    std::string segment = (foot == LEFT_FOOT) ? "l_sole" : "r_sole";
+    return FootstepPlanner::yawFromRotation(_model->getSegmentPosition(_model->getSegmentIndex(segment)).getRotation());
+}
+
 Eigen::MatrixXd StepController::getContact2DCoordinates() {
     Eigen::MatrixXd contactsCoordinates;
     int activeContacts = 0;
@@ -282,6 +359,9 @@ Eigen::MatrixXd StepController::getContact2DCoordinates() {
 }
 
 void StepController::stop() {
-    _rightFoot_TrajThread->stop();
-    _leftFoot_TrajThread->stop();
+    finishStep(LEFT_FOOT);
+    finishStep(RIGHT_FOOT);
+    if (_convergenceListener) {
+        _convergenceListener->close();
+    }
 }
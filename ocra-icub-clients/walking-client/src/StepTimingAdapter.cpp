@@ -0,0 +1,120 @@
+#include "walking-client/StepTimingAdapter.h"
+#include <algorithm>
+#include <cmath>
+
+StepTimingAdapter::StepTimingAdapter(const StepTimingAdaptationParams &params, const FootstepPlannerParams &limits, double comHeight):
+_params(params),
+_limits(limits),
+_omega(std::sqrt(params.gravity/comHeight)),
+_dcmOffset(Eigen::Vector2d::Zero()),
+_uNominal(Eigen::Vector2d::Zero()),
+_bNominal(Eigen::Vector2d::Zero()),
+_uLower(Eigen::Vector2d::Zero()),
+_uUpper(Eigen::Vector2d::Zero()),
+_tauNominal(1.0)
+{
+}
+
+StepTimingAdapter::~StepTimingAdapter()
+{
+}
+
+bool StepTimingAdapter::adapt(const Eigen::VectorXd &hk,
+                              const Eigen::MatrixXd &supportPolygon,
+                              double stanceYaw,
+                              FOOT swingFoot,
+                              const Eigen::Vector2d &nominalStep,
+                              double nominalDuration,
+                              double elapsed,
+                              Eigen::Vector2d &adaptedStep,
+                              double &adaptedRemaining)
+{
+    adaptedStep = nominalStep;
+    adaptedRemaining = nominalDuration - elapsed;
+
+    double minRemaining = std::max(_params.minStepDuration - elapsed, _params.freezeTime);
+    double maxRemaining = _params.maxStepDuration - elapsed;
+    if (supportPolygon.rows() == 0 || adaptedRemaining < _params.freezeTime || maxRemaining < minRemaining)
+        return false;
+
+    // Everything is expressed in the stance frame, centered at the middle of the support polygon
+    Eigen::Vector2d cop = supportPolygon.colwise().mean().transpose();
+    Eigen::Rotation2Dd toStance(-stanceYaw);
+    Eigen::Vector2d dcm = hk.head(2) + hk.segment(2,2)/_omega;
+    _dcmOffset = toStance*(dcm - cop);
+    _uNominal = toStance*(nominalStep - cop);
+    _tauNominal = std::exp(_omega*std::max(minRemaining, std::min(maxRemaining, adaptedRemaining)));
+
+    // DCM offset at touchdown of a periodic gait made of nominal steps. Forward offsets repeat, lateral ones alternate.
+    double tauStep = std::exp(_omega*nominalDuration);
+    _bNominal(0) = _uNominal(0)/(tauStep - 1.0);
+    _bNominal(1) = -_uNominal(1)/(tauStep + 1.0);
+
+    // Reachable region of the swing foot
+    double side = (swingFoot == LEFT_FOOT) ? 1.0 : -1.0;
+    _uLower(0) = -_limits.maxStepLength;
+    _uUpper(0) = _limits.maxStepLength;
+    _uLower(1) = (side > 0) ? _limits.minStepWidth : -_limits.maxStepWidth;
+    _uUpper(1) = (side > 0) ? _limits.maxStepWidth : -_limits.minStepWidth;
+
+    // Breakpoints of the clamped optimal u as a function of tau
+    const double tauMin = std::exp(_omega*minRemaining);
+    const double tauMax = std::exp(_omega*maxRemaining);
+    const double wu = _params.stepLocationWeight;
+    const double wb = _params.dcmOffsetWeight;
+    std::vector<double> knots = {tauMin, tauMax};
+    for (int i = 0; i < 2; ++i) {
+        if (std::abs(_dcmOffset(i)) < 1e-9)
+            continue;
+        for (double bound : {_uLower(i), _uUpper(i)}) {
+            double knot = (bound*(wu + wb) - wu*_uNominal(i) + wb*_bNominal(i))/(wb*_dcmOffset(i));
+            if (knot > tauMin && knot < tauMax)
+                knots.push_back(knot);
+        }
+    }
+    std::sort(knots.begin(), knots.end());
+
+    // The reduced cost is quadratic between knots: fit it with three samples and take its minimum
+    double bestTau = _tauNominal;
+    Eigen::Vector2d bestU;
+    double bestCost = reducedCost(bestTau, bestU);
+    for (size_t k = 0; k + 1 < knots.size(); ++k) {
+        double a = knots[k];
+        double b = knots[k+1];
+        double h = (b - a)/2.0;
+        if (h <= 0.0)
+            continue;
+        double m = a + h;
+        Eigen::Vector2d u;
+        double fa = reducedCost(a, u);
+        double fm = reducedCost(m, u);
+        double fb = reducedCost(b, u);
+        double curvature = (fa - 2.0*fm + fb)/(h*h);
+        double slope = (fb - fa)/(2.0*h);
+        double tau = (curvature > 0.0) ? m - slope/curvature : (fa < fb ? a : b);
+        tau = std::max(a, std::min(b, tau));
+        double cost = reducedCost(tau, u);
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestTau = tau;
+            bestU = u;
+        }
+    }
+
+    adaptedStep = cop + Eigen::Rotation2Dd(stanceYaw)*bestU;
+    adaptedRemaining = std::log(bestTau)/_omega;
+    return true;
+}
+
+double StepTimingAdapter::reducedCost(double tau, Eigen::Vector2d &u) const
+{
+    const double wu = _params.stepLocationWeight;
+    const double wb = _params.dcmOffsetWeight;
+    const double wt = _params.stepTimingWeight;
+    Eigen::Vector2d dcmAtTouchdown = _dcmOffset*tau;
+    u = (wu*_uNominal + wb*(dcmAtTouchdown - _bNominal))/(wu + wb);
+    u = u.cwiseMax(_uLower).cwiseMin(_uUpper);
+    return wu*(u - _uNominal).squaredNorm()
+         + wt*(tau - _tauNominal)*(tau - _tauNominal)
+         + wb*(dcmAtTouchdown - u - _bNominal).squaredNorm();
+}
@@ -0,0 +1,178 @@
+#include "walking-client/SwingFootTrajectory.h"
+#include <algorithm>
+#include <cmath>
+
+QuinticPolynomial::QuinticPolynomial():
+_coeffs(Eigen::Matrix<double, 6, 1>::Zero()),
+_startTime(0.0),
+_duration(1.0)
+{
+}
+
+void QuinticPolynomial::set(double startTime, double duration, double p0, double v0, double a0, double pf, double vf, double af)
+{
+    const double T = std::max(duration, 1e-6);
+    const double T2 = T*T;
+    const double T3 = T2*T;
+    _startTime = startTime;
+    _duration = T;
+    _coeffs(0) = p0;
+    _coeffs(1) = v0;
+    _coeffs(2) = a0/2.0;
+    _coeffs(3) = (20.0*(pf - p0) - (8.0*vf + 12.0*v0)*T - (3.0*a0 - af)*T2) / (2.0*T3);
+    _coeffs(4) = (30.0*(p0 - pf) + (14.0*vf + 16.0*v0)*T + (3.0*a0 - 2.0*af)*T2) / (2.0*T3*T);
+    _coeffs(5) = (12.0*(pf - p0) - 6.0*(vf + v0)*T - (a0 - af)*T2) / (2.0*T3*T2);
+}
+
+void QuinticPolynomial::evaluate(double time, double &p, double &v, double &a) const
+{
+    const double t = std::max(0.0, std::min(_duration, time - _startTime));
+    const Eigen::Matrix<double, 6, 1> &c = _coeffs;
+    // Horner's scheme
+    p = c(0) + t*(c(1) + t*(c(2) + t*(c(3) + t*(c(4) + t*c(5)))));
+    v = c(1) + t*(2.0*c(2) + t*(3.0*c(3) + t*(4.0*c(4) + t*5.0*c(5))));
+    a = 2.0*c(2) + t*(6.0*c(3) + t*(12.0*c(4) + t*20.0*c(5)));
+}
+
+SwingFootTrajectory::SwingFootTrajectory():
+_target(Eigen::Vector3d::Zero()),
+_targetYaw(0.0),
+_initialHeight(0.0),
+_stepHeight(0.0),
+_apexHeight(0.0),
+_apexTime(0.0),
+_touchdownTime(0.0),
+_touchdownVelocity(0.02),
+_touchdownSearchDepth(0.02),
+_minRetargetTime(0.1),
+_active(false)
+{
+}
+
+SwingFootTrajectory::~SwingFootTrajectory()
+{
+}
+
+void SwingFootTrajectory::start(const Eigen::Vector3d &initialPosition, double initialYaw, const Eigen::Vector3d &target, double targetYaw, double duration, double stepHeight, double startTime)
+{
+    duration = std::max(duration, 2.0*_minRetargetTime);
+    _target = target;
+    // Turn the shortest way
+    _targetYaw = initialYaw + std::atan2(std::sin(targetYaw - initialYaw), std::cos(targetYaw - initialYaw));
+    _initialHeight = initialPosition(2);
+    _stepHeight = stepHeight;
+    _apexHeight = std::max(_initialHeight, target(2)) + stepHeight;
+    _apexTime = startTime + duration/2.0;
+    _touchdownTime = startTime + duration;
+
+    _x.set(startTime, duration, initialPosition(0), 0.0, 0.0, target(0), 0.0, 0.0);
+    _y.set(startTime, duration, initialPosition(1), 0.0, 0.0, target(1), 0.0, 0.0);
+    _yaw.set(startTime, duration, initialYaw, 0.0, 0.0, _targetYaw, 0.0, 0.0);
+    setVerticalProfile(startTime, initialPosition(2), 0.0, 0.0, true);
+    _active = true;
+}
+
+bool SwingFootTrajectory::retarget(const Eigen::Vector3d &target, double targetYaw, double now)
+{
+    return retarget(target, targetYaw, _touchdownTime, now);
+}
+
+bool SwingFootTrajectory::retarget(const Eigen::Vector3d &target, double targetYaw, double touchdownTime, double now)
+{
+    if (!_active || now >= _touchdownTime)
+        return false;
+
+    Eigen::Vector3d p, v, a;
+    double yaw, yawRate, yawAcceleration;
+    evaluateNominal(now, p, v, a, yaw, yawRate, yawAcceleration);
+
+    _target = target;
+    _targetYaw = yaw + std::atan2(std::sin(targetYaw - yaw), std::cos(targetYaw - yaw));
+    _apexHeight = std::max(_initialHeight, target(2)) + _stepHeight;
+    touchdownTime = std::max(touchdownTime, now + _minRetargetTime);
+    if (now < _apexTime)
+        _apexTime = now + (_apexTime - now)*(touchdownTime - now)/(_touchdownTime - now);
+    _touchdownTime = touchdownTime;
+    const double remaining = _touchdownTime - now;
+
+    _x.set(now, remaining, p(0), v(0), a(0), target(0), 0.0, 0.0);
+    _y.set(now, remaining, p(1), v(1), a(1), target(1), 0.0, 0.0);
+    _yaw.set(now, remaining, yaw, yawRate, yawAcceleration, _targetYaw, 0.0, 0.0);
+    // Too close to the apex to rise smoothly, so the foot starts descending from where it is.
+    setVerticalProfile(now, p(2), v(2), a(2), (now + _minRetargetTime) < _apexTime && !isDescending(now));
+    return true;
+}
+
+void SwingFootTrajectory::evaluate(double now, Eigen::Vector3d &position, Eigen::Vector3d &velocity, Eigen::Vector3d &acceleration, double &yaw, double &yawRate, double &yawAcceleration) const
+{
+    if (now <= _touchdownTime) {
+        evaluateNominal(now, position, velocity, acceleration, yaw, yawRate, yawAcceleration);
+        return;
+    }
+
+    // Late touchdown: keep descending at the touchdown velocity until the search depth is reached, then hold.
+    double depth = _touchdownVelocity*(now - _touchdownTime);
+    bool searching = depth < _touchdownSearchDepth;
+    position = _target;
+    position(2) -= std::min(depth, _touchdownSearchDepth);
+    velocity.setZero();
+    velocity(2) = searching ? -_touchdownVelocity : 0.0;
+    acceleration.setZero();
+    yaw = _targetYaw;
+    yawRate = 0.0;
+    yawAcceleration = 0.0;
+}
+
+void SwingFootTrajectory::stop()
+{
+    _active = false;
+}
+
+bool SwingFootTrajectory::isDescending(double now) const
+{
+    return now >= _zFall.getStartTime();
+}
+
+bool SwingFootTrajectory::isNominalDurationOver(double now) const
+{
+    return now >= _touchdownTime;
+}
+
+bool SwingFootTrajectory::isTouchdownSearchOver(double now) const
+{
+    if (_touchdownVelocity <= 0.0)
+        return isNominalDurationOver(now);
+    return now >= (_touchdownTime + _touchdownSearchDepth/_touchdownVelocity);
+}
+
+void SwingFootTrajectory::setTouchdownSearch(double velocity, double depth)
+{
+    _touchdownVelocity = std::max(0.0, velocity);
+    _touchdownSearchDepth = std::max(0.0, depth);
+}
+
+void SwingFootTrajectory::setMinRetargetTime(double minRetargetTime)
+{
+    _minRetargetTime = std::max(1e-3, minRetargetTime);
+}
+
+void SwingFootTrajectory::evaluateNominal(double now, Eigen::Vector3d &position, Eigen::Vector3d &velocity, Eigen::Vector3d &acceleration, double &yaw, double &yawRate, double &yawAcceleration) const
+{
+    _x.evaluate(now, position(0), velocity(0), acceleration(0));
+    _y.evaluate(now, position(1), velocity(1), acceleration(1));
+    if (now < _zFall.getStartTime())
+        _zRise.evaluate(now, position(2), velocity(2), acceleration(2));
+    else
+        _zFall.evaluate(now, position(2), velocity(2), acceleration(2));
+    _yaw.evaluate(now, yaw, yawRate, yawAcceleration);
+}
+
+void SwingFootTrajectory::setVerticalProfile(double now, double z, double dz, double ddz, bool throughApex)
+{
+    if (throughApex) {
+        _zRise.set(now, _apexTime - now, z, dz, ddz, _apexHeight, 0.0, 0.0);
+        _zFall.set(_apexTime, _touchdownTime - _apexTime, _apexHeight, 0.0, 0.0, _target(2), -_touchdownVelocity, 0.0);
+    } else {
+        _zFall.set(now, _touchdownTime - now, z, dz, ddz, _target(2), -_touchdownVelocity, 0.0);
+    }
+}
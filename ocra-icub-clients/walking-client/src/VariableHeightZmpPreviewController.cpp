@@ -0,0 +1,127 @@
+#include "walking-client/VariableHeightZmpPreviewController.h"
+#include <algorithm>
+#include <cmath>
+
+VariableHeightZmpPreviewController::VariableHeightZmpPreviewController(const double period,
+                                                                       std::shared_ptr<ZmpPreviewParams> parameters,
+                                                                       const VariableHeightZmpPreviewParams &heightParams):
+ZmpPreviewController(period, parameters),
+_g(9.8),
+_dt(period/1000),
+_Np(parameters->Np),
+_Nc(parameters->Nc),
+_effectiveHeights(Eigen::VectorXd::Constant(parameters->Np, parameters->cz)),
+_correctedZmpRef(Eigen::VectorXd::Zero(2*parameters->Np)),
+_predictedAcceleration(Eigen::VectorXd::Zero(2*parameters->Np)),
+_U0(Eigen::VectorXd::Zero(2*parameters->Nc)),
+_U1(Eigen::VectorXd::Zero(2*parameters->Nc)),
+_effectiveHeight(parameters->cz),
+_samplesBetweenCalls(1),
+_hasPrediction(false)
+{
+    Eigen::MatrixXd Ah = buildAh(_dt);
+    Eigen::MatrixXd Bh = buildBh(_dt);
+    Eigen::MatrixXd Ca(2,6);
+    Ca << Eigen::Matrix2d::Zero(), Eigen::Matrix2d::Zero(), Eigen::Matrix2d::Identity();
+    _Ga = buildGp(Ca, Ah, _Np);
+    _Ha = buildHp(Ca, Bh, Ah, _Nc, _Np);
+
+    Eigen::MatrixXd Nu = buildNu(parameters->nu, _Nc);
+    Eigen::MatrixXd Nb = buildNb(parameters->nb, _Np);
+    Eigen::MatrixXd Ch = buildCh();
+    Eigen::MatrixXd Gh = buildGh(Ch, Ah, _Np);
+    Eigen::MatrixXd Hh = buildHh(Ch, Bh, Ah, _Nc, _Np);
+
+    int nHeights = std::max(1, heightParams.nHeights);
+    double minHeight = (nHeights > 1) ? parameters->cz - heightParams.heightRange : parameters->cz;
+    double heightStep = (nHeights > 1) ? 2.0*heightParams.heightRange/(nHeights - 1) : 0.0;
+    _gains.resize(nHeights);
+    for (int i = 0; i < nHeights; ++i) {
+        HeightGains &gains = _gains[i];
+        gains.height = minHeight + i*heightStep;
+        Eigen::MatrixXd Cp = buildCp(gains.height, _g);
+        Eigen::MatrixXd Gp = buildGp(Cp, Ah, _Np);
+        Eigen::MatrixXd Hp = buildHp(Cp, Bh, Ah, _Nc, _Np);
+        Eigen::LLT<Eigen::MatrixXd> AOptimalLLT(Hp.transpose()*Nb*Hp + Nu + parameters->nw*Hh.transpose()*Hh);
+        gains.Kp = AOptimalLLT.solve(Hp.transpose()*Nb);
+        gains.Kx = gains.Kp*Gp;
+        if (parameters->nw > 0.0) {
+            gains.Kh = AOptimalLLT.solve(parameters->nw*Hh.transpose());
+            gains.Kx += gains.Kh*Gh;
+        }
+    }
+    OCRA_INFO("Cached preview gains for " << nHeights << " CoM heights between " << _gains.front().height << " and " << _gains.back().height)
+}
+
+VariableHeightZmpPreviewController::~VariableHeightZmpPreviewController()
+{
+}
+
+void VariableHeightZmpPreviewController::computeOptimalInput(const Eigen::VectorXd &zmpRef,
+                                                             const Eigen::VectorXd &comVelRef,
+                                                             const Eigen::VectorXd &hk,
+                                                             const Eigen::VectorXd &comHeights,
+                                                             const Eigen::VectorXd &supportHeights,
+                                                             Eigen::VectorXd &optimalU)
+{
+    // Effective heights along the window, with the vertical CoM acceleration from the planned profile
+    for (int j = 0; j < _Np; ++j) {
+        int prev = std::max(0, j - 1);
+        int next = std::min(_Np - 1, j + 1);
+        double ddz = (next - prev == 2) ? (comHeights(next) - 2.0*comHeights(j) + comHeights(prev))/(_dt*_dt) : 0.0;
+        // A CoM falling faster than 0.9g cannot be supported by the feet
+        _effectiveHeights(j) = _g*(comHeights(j) - supportHeights(j))/std::max(0.1*_g, _g + ddz);
+    }
+    _effectiveHeight = _effectiveHeights(0);
+
+    // Neighbouring cached heights
+    int nHeights = _gains.size();
+    double cbar = std::max(_gains.front().height, std::min(_gains.back().height, _effectiveHeight));
+    int i = 0;
+    double alpha = 0.0;
+    if (nHeights > 1) {
+        double step = _gains[1].height - _gains[0].height;
+        double position = (cbar - _gains.front().height)/step;
+        i = std::min(nHeights - 2, (int)std::floor(position));
+        alpha = position - i;
+    }
+
+    // Height variation along the window moved to the ZMP reference
+    _correctedZmpRef = zmpRef;
+    if (_hasPrediction) {
+        for (int j = 0; j < _Np; ++j) {
+            int shifted = std::min(_Np - 1, j + _samplesBetweenCalls);
+            _correctedZmpRef.segment<2>(2*j) += ((_effectiveHeights(j) - cbar)/_g)*_predictedAcceleration.segment<2>(2*shifted);
+        }
+    }
+
+    solveAtHeight(i, _correctedZmpRef, comVelRef, hk, _U0);
+    if (alpha > 1e-9) {
+        solveAtHeight(i + 1, _correctedZmpRef, comVelRef, hk, _U1);
+        optimalU = (1.0 - alpha)*_U0 + alpha*_U1;
+    } else {
+        optimalU = _U0;
+    }
+
+    _predictedAcceleration.noalias() = _Ga*hk + _Ha*optimalU;
+    _hasPrediction = true;
+}
+
+void VariableHeightZmpPreviewController::tableCartModel(const Eigen::VectorXd &hkk, double effectiveHeight, Eigen::Vector2d &p)
+{
+    p = hkk.head<2>() - (effectiveHeight/_g)*hkk.tail<2>();
+}
+
+void VariableHeightZmpPreviewController::reset()
+{
+    _hasPrediction = false;
+}
+
+void VariableHeightZmpPreviewController::solveAtHeight(int i, const Eigen::VectorXd &zmpRef, const Eigen::VectorXd &comVelRef, const Eigen::VectorXd &hk, Eigen::VectorXd &U) const
+{
+    const HeightGains &gains = _gains[i];
+    U.noalias() = gains.Kp*zmpRef;
+    U.noalias() -= gains.Kx*hk;
+    if (gains.Kh.size() > 0)
+        U.noalias() += gains.Kh*comVelRef;
+}
@@ -1,4 +1,5 @@
 #include "walking-client/WalkingClient.h"
+#include <limits>
 
 
 using namespace Eigen;
@@ -17,7 +18,15 @@ _globalZMP(Eigen::Vector2d::Zero()),
 _isTestRun(false),
 _currentlyStepping(false),
 _waitBeforeNextStep(false),
-_currentStepIndex(0)
+_currentStepIndex(0),
+_walkingStepInProgress(false),
+_walkingSwingFoot(RIGHT_FOOT),
+_walkingLastTouchdownTime(-1.0),
+_walkingSteered(false),
+_previewPlanningRatio(1),
+_previewTick(0),
+_appliedComJerk(Eigen::Vector2d::Zero()),
+_planPublisherTick(0)
 {
 
 }
@@ -71,6 +80,8 @@ bool WalkingClient::configure(yarp::os::ResourceFinder &rf) {
 
     // Find ZMP Preview Controller parameters
     findZMPPreviewControllerParams(rf);
+    // Find ZMP disturbance observer parameters
+    findZmpDisturbanceObserverParams(rf);
     // Find TESTS_GENERAL_PARAMETERS
     findGeneralTestsParams(rf);
     // Find COM_LIN_VEL_CONSTANT_REFERENCE
@@ -81,6 +92,14 @@ bool WalkingClient::configure(yarp::os::ResourceFinder &rf) {
     findSingleStepTestParams(rf);
     // Find stepping test parameters
     findSteppingTestParams(rf);
+    // Find footstep planner parameters
+    findFootstepPlannerParams(rf);
+    // Find contact detector parameters
+    findContactDetectorParams(rf);
+    // Find step timing adaptation parameters
+    findStepTimingAdaptationParams(rf);
+    // Find plan publisher parameters
+    findPlanPublisherParams(rf);
     // Find ZMP_VARYING_REFERENCE
     findZMPVaryingReferenceParams(rf);
     // Find MIQP Parameters
@@ -119,6 +138,13 @@ bool WalkingClient::initialize()
 
     _period = this->getExpectedPeriod();
 
+    // Feet contact state, estimated at the F/T sensors rate
+    _contactDetector = std::make_shared<ContactDetector>(_contactDetectorParams);
+    if (!_contactDetector->open(composePortName("contactDetector"), _robot)) {
+        OCRA_ERROR("Impossible to start the contact detector");
+        return false;
+    }
+
 
      // Prepare feet cartesian tasks
     _stepController = std::make_shared<StepController>(_period, this->model);
@@ -128,8 +154,24 @@ bool WalkingClient::initialize()
     // CoM TaskConnection object. This is the task object through which the CoM acceleration will be set by this controller.
     std::string comTaskName("ComTask");
     _comTask = std::make_shared<ocra_recipes::TaskConnection>(comTaskName);
+    _comTaskName = comTaskName;
+
+    // Heartbeat to the server watchdog, which holds the CoM and feet tasks if this client stalls.
+    _heartbeat = std::make_shared<ocra_icub::ClientHeartbeat>(_clientName, std::vector<std::string>{comTaskName, "LeftFootCartesian", "RightFootCartesian", "LeftFootOrientation", "RightFootOrientation"});
+    _heartbeat->open();
     _comTask->openControlPorts();
 
+    // The CoM references go through the arbitration of the server, which may share the CoM task with other clients. Without it they are written to the task directly.
+    _comReferenceSender = std::make_shared<ocra_icub::ArbitratedReferenceSender>(_clientName, 1);
+    if (!_comReferenceSender->open()) {
+        OCRA_WARNING("The CoM references will be written directly to " << comTaskName << " without arbitration.");
+        _comReferenceSender->close();
+        _comReferenceSender.reset();
+    }
+
+
+    // Constant CoM height unless the stepping test plans a height profile
+    _comHeightState << _zmpPreviewParams->cz, 0.0, 0.0;
 
     // For testing and tuning purposes, generate ZMP trajectory that moves from one foot to the other.
     Eigen::Vector3d sep; sep.setZero();
@@ -146,6 +188,13 @@ bool WalkingClient::initialize()
     }
     if (!_testType.compare("steppingTest")) {
         OCRA_WARNING("Generating trajectory for stepping test with feet separation: " << sep);
+        if (_footstepPlannerParams.nominalStepWidth <= 0.0)
+            _footstepPlannerParams.nominalStepWidth = std::abs(feetSeparation);
+        _footstepPlanner = std::make_shared<FootstepPlanner>(_footstepPlannerParams);
+        _footstepPlanner->openVelocityPort(composePortName("footstepPlanner/velocity:i"));
+        _footstepPlanner->setVelocityCommand(_footstepVelocity);
+        _footstepPlanner->readVelocityCommand(yarp::os::Time::now());
+        _stepTimingAdapter = std::make_shared<StepTimingAdapter>(_stepTimingAdaptationParams, _footstepPlannerParams, _zmpPreviewParams->cz);
         generateStepPattern();
         _steppingTrajectory = generateZMPSteppingTrajectory();
 //         for (auto v : _steppingTrajectory)
@@ -173,6 +222,9 @@ bool WalkingClient::initialize()
     // For the test the reference com velocity is set to zero. Only zmp references are considered.
     comVelRefInPreviewWindow = Eigen::VectorXd(2*_zmpPreviewParams->Np);
     comVelRefInPreviewWindow.setZero();
+    // CoM and support heights in the preview window, only used by the variable height preview controller
+    comHeightsInPreviewWindow = Eigen::VectorXd::Constant(_zmpPreviewParams->Np, _zmpPreviewParams->cz);
+    supportHeightsInPreviewWindow = Eigen::VectorXd::Zero(_zmpPreviewParams->Np);
     // Allocation of optimal input vector
     optimalU = Eigen::VectorXd(2*_zmpPreviewParams->Nc);
 
@@ -223,14 +275,35 @@ bool WalkingClient::initialize()
     OCRA_ERROR("Space allocated for preview window of the walking-client: " << Nw);
     this->_X_kn.resize(Nw*INPUT_VECTOR_SIZE);
     this->_t_kn.resize(Nw);
-    if (!_testType.compare("miqp")) {
-        _miqpController = std::make_shared<MIQPController>(_miqpParams, this->model, this->_stepController, comStateRef);
+    _miqpParams.closedLoop = !_testType.compare("walking");
+    if (!_testType.compare("walking")) {
+        _walkingLatencyPort.open(composePortName("walking/latency:o"));
+        // The MIQP places the footsteps; the planner only holds the velocity command that steers it
+        _footstepPlanner = std::make_shared<FootstepPlanner>(_footstepPlannerParams);
+        _footstepPlanner->openVelocityPort(composePortName("footstepPlanner/velocity:i"));
+        _footstepPlanner->setVelocityCommand(Eigen::Vector3d(dCoMxRef, dCoMyRef, 0.0));
+    }
+    if (!_testType.compare("miqp") || !_testType.compare("walking")) {
+        _miqpController = std::make_shared<MIQPController>(_miqpParams, this->model, this->_stepController, this->_contactDetector, comStateRef);
         _miqpController->start();
         // Don't run this thread before the MIQPController class has finished initializing
         while (!_miqpController->isRunning()) {
             OCRA_WARNING("Waiting for MIQPController thread to start");
         }
     }
+    // The preview controller of the stepping and walking modes can run slower than the client
+    if (_previewPlanningRatio > 1 && (!_testType.compare("steppingTest") || !_testType.compare("walking"))) {
+        std::shared_ptr<VariableHeightZmpPreviewController> variableHeightController;
+        if (!_testType.compare("steppingTest"))
+            variableHeightController = _variableHeightPreviewController;
+        _zmpPreviewPlanner = std::make_shared<ZmpPreviewPlanner>(_period, _previewPlanningRatio, _zmpPreviewParams, _zmpPreviewController, variableHeightController);
+        _zmpPreviewPlanner->start();
+    }
+    if (_planPublisherParams.enabled && (!_testType.compare("steppingTest") || !_testType.compare("walking"))) {
+        _planPublisher = std::make_shared<WalkingPlanPublisher>((double) _period, _zmpPreviewController, _planPublisherParams);
+        if (!_planPublisher->open(composePortName("plan:o")))
+            return false;
+    }
     OCRA_INFO("Initialization is over");
     return true;
 }
@@ -240,9 +313,23 @@ void WalkingClient::release()
      // Set task's Kp and Kd to initial values before starting the client
 //     _comTask->setStiffness(30);
 //     _comTask->setDamping(5);
-    if (!_testType.compare("miqp"))
+    if (!_testType.compare("miqp") || !_testType.compare("walking"))
         _miqpController->stop();
+    if (!_testType.compare("walking"))
+        _walkingLatencyPort.close();
+    if (_zmpPreviewPlanner)
+        _zmpPreviewPlanner->stop();
+    if (_planPublisher)
+        _planPublisher->close();
     _stepController->stop();
+    if (_footstepPlanner)
+        _footstepPlanner->close();
+    _contactDetector->close();
+    if (_comReferenceSender) {
+        _comReferenceSender->release(_comTaskName);
+        _comReferenceSender->close();
+    }
+    _heartbeat->close();
 }
 
 void WalkingClient::loop()
@@ -265,12 +352,20 @@ void WalkingClient::loop()
        if (!_testType.compare("miqp")) {
            performMIQPTest();
        }
+
+       if (!_testType.compare("walking")) {
+           performWalking();
+       }
+
+       // Feet swing trajectories are evaluated in this loop
+       _stepController->update();
        
        if (!_testType.compare("")) {
             OCRA_ERROR("You want to perform a zmp test, but zmpPreview was not found as value for the option 'test'. Please try again... ");
             this->askToStop();
        } 
     }
+    _heartbeat->beat();
 }
 
 void WalkingClient::performMIQPTest() {
@@ -311,6 +406,195 @@ void WalkingClient::performMIQPTest() {
         this->askToStop();
 }
 
+void WalkingClient::performWalking() {
+    static double walkingStartTime = yarp::os::Time::now();
+    double now = yarp::os::Time::now();
+
+    // Plans are only handed over here, at the beginning of a tick, so that all the references of a tick come from the same plan.
+    bool newPlan = _miqpController->getPlan(_incomingPlan, _walkingPlan.getSequence());
+    if (newPlan) {
+        _walkingPlan.setPlan(_incomingPlan);
+        const MIQPPlan &plan = _walkingPlan.getPlan();
+        Eigen::VectorXd latency(4);
+        latency << plan.sequence, plan.solvedTime - plan.stateTime, now - plan.solvedTime, now - plan.stateTime;
+        yarp::os::Bottle &b = _walkingLatencyPort.prepare();
+        b.clear();
+        b.addInt(plan.sequence);
+        for (int i = 1; i < latency.size(); i++)
+            b.addDouble(latency(i));
+        _walkingLatencyPort.write();
+        ocra::utils::writeInFile((Eigen::VectorXd(5) << now - walkingStartTime, latency).finished(), std::string(_homeDataDir + "/walking/latency.txt"), true);
+    }
+    // The commanded velocity replaces the CoM velocity reference of the MIQP once a command has been received
+    if (_footstepPlanner->readVelocityCommand(now))
+        _walkingSteered = true;
+    if (_walkingSteered)
+        _miqpController->setVelocityCommand(_footstepPlanner->getVelocityCommand().head<2>());
+
+    if (!_walkingPlan.isValid())
+        return;
+
+    // References of the preview window from the current plan
+    double t = now - _walkingPlan.getPlan().stateTime;
+    double periodDouble = (double) this->_period/1000;
+    _walkingPlan.getCoPReference(t, periodDouble, _zmpPreviewParams->Np, zmpRefInPreviewWindow);
+    _walkingPlan.getCoMVelocityReference(t, periodDouble, _zmpPreviewParams->Np, comVelRefInPreviewWindow);
+    compensateZmpDisturbance();
+
+    // Retrieve current COM state
+    Eigen::VectorXd hk(6);
+    hk.head<2>() = this->model->getCoMPosition().topRows(2);
+    hk.segment<2>(2) = this->model->getCoMVelocity().topRows(2);
+    hk.tail<2>() = this->model->getCoMAcceleration().topRows(2);
+    Eigen::VectorXd hkk(6); hkk.setZero();
+    Eigen::Vector2d pk; pk.setZero();
+
+    previewCoM(hk, hkk, pk);
+    prepareAndsetDesiredCoMTaskState(hkk, true);
+
+    updateWalkingStep(t, newPlan);
+
+    // Read Force/Torque measurements and compute ZMP
+    readFootWrench(LEFT_FOOT, _rawLeftFootWrench);
+    readFootWrench(RIGHT_FOOT, _rawRightFootWrench);
+    _zmpPreviewController->computeGlobalZMPFromSensors(_rawLeftFootWrench, _rawRightFootWrench, this->model, _globalZMP);
+
+    std::string homeDir = std::string(_homeDataDir + "/walking/");
+    double tnow = now - walkingStartTime;
+    updateZmpDisturbanceObserver(hk, _appliedComJerk, homeDir, tnow);
+    publishWalkingPlan(hk);
+    ocra::utils::writeInFile((Eigen::VectorXd(3) << tnow, zmpRefInPreviewWindow.head<2>()).finished(), std::string(homeDir + "referenceZMP.txt"), true);
+    ocra::utils::writeInFile((Eigen::VectorXd(3) << tnow, pk).finished(), std::string(homeDir + "previewedZMP.txt"), true);
+    ocra::utils::writeInFile((Eigen::VectorXd(3) << tnow, _globalZMP).finished(), std::string(homeDir + "currentZMP.txt"), true);
+    ocra::utils::writeInFile((Eigen::VectorXd(3) << tnow, hkk.head<2>()).finished(), std::string(homeDir + "intComPositionRef.txt"), true);
+}
+
+void WalkingClient::updateWalkingStep(double t, bool newPlan) {
+    Eigen::Vector3d leftFootPosition = _stepController->getLeftFootPosition();
+    Eigen::Vector3d rightFootPosition = _stepController->getRightFootPosition();
+    PlannedStep step;
+    bool planned = _walkingPlan.getNextStep(leftFootPosition.head<2>(), rightFootPosition.head<2>(), step);
+
+    if (_walkingStepInProgress) {
+        FOOT swingFoot = _walkingSwingFoot;
+        FOOT stanceFoot = (swingFoot == LEFT_FOOT) ? RIGHT_FOOT : LEFT_FOOT;
+        if (_stepController->isStepFinished(swingFoot, isFootInContact(swingFoot))) {
+            if (swingFoot == RIGHT_FOOT) {
+                this->changeFixedLink("r_sole", false, true);
+            } else {
+                this->changeFixedLink("l_sole", true, false);
+            }
+            _walkingStepInProgress = false;
+            _walkingLastTouchdownTime = yarp::os::Time::now();
+        } else if (newPlan && planned && step.foot == swingFoot && step.touchdownTime > t) {
+            // The swing foot follows the landing position and time of the latest plan
+            double stanceHeight = (stanceFoot == LEFT_FOOT) ? leftFootPosition(2) : rightFootPosition(2);
+            Eigen::Vector3d target(step.target(0), step.target(1), stanceHeight);
+            _stepController->retarget(swingFoot, target, step.yaw, step.touchdownTime - t);
+        }
+        return;
+    }
+
+    // Plans computed before the last touchdown still contain the step that just finished
+    if (_walkingPlan.getPlan().stateTime <= _walkingLastTouchdownTime)
+        return;
+
+    if (planned && t >= step.liftoffTime && step.touchdownTime > t) {
+        FOOT stanceFoot = (step.foot == LEFT_FOOT) ? RIGHT_FOOT : LEFT_FOOT;
+        double stanceHeight = (stanceFoot == LEFT_FOOT) ? leftFootPosition(2) : rightFootPosition(2);
+        Eigen::Vector3d target(step.target(0), step.target(1), stanceHeight);
+        OCRA_INFO("Plan " << _walkingPlan.getSequence() << " starts a step of the " << (step.foot == LEFT_FOOT ? "left" : "right") << " foot");
+        _stepController->step(step.foot, target, step.yaw, step.touchdownTime - t, _steppingTestParams.stepHeight);
+        _walkingSwingFoot = step.foot;
+        _walkingStepInProgress = true;
+    }
+}
+
+void WalkingClient::previewCoM(const Eigen::VectorXd &hk, Eigen::VectorXd &hkk, Eigen::Vector2d &pk) {
+    bool variableHeight = _variableHeightPreviewController && !_testType.compare("steppingTest");
+    if (_zmpPreviewPlanner) {
+        double effectiveHeight = _zmpPreviewParams->cz;
+        _zmpPreviewPlanner->post(_previewTick, hk, zmpRefInPreviewWindow, comVelRefInPreviewWindow, comHeightsInPreviewWindow, supportHeightsInPreviewWindow);
+        if (!_zmpPreviewPlanner->track(_previewTick, hkk, _appliedComJerk, effectiveHeight)) {
+            // Hold the measured CoM until the first solution is available
+            hkk.setZero();
+            hkk.head<2>() = hk.head<2>();
+            _appliedComJerk.setZero();
+        }
+        _previewTick++;
+        if (variableHeight)
+            _variableHeightPreviewController->tableCartModel(hkk, effectiveHeight, pk);
+        else
+            _zmpPreviewController->tableCartModel(hkk, pk);
+        return;
+    }
+
+    if (variableHeight)
+        _variableHeightPreviewController->computeOptimalInput(zmpRefInPreviewWindow, comVelRefInPreviewWindow, hk, comHeightsInPreviewWindow, supportHeightsInPreviewWindow, optimalU);
+    else
+        _zmpPreviewController->computeOptimalInput(zmpRefInPreviewWindow, comVelRefInPreviewWindow, hk, optimalU);
+    _appliedComJerk = optimalU.topRows(2);
+
+    // Only using the first input computed by the preview controller;
+    // This input must now be integrated (since it's just the optimal com jerk).
+    // Ah and Bh already integrate the jerk into the acceleration, as in ZmpPreviewPlanner::track().
+    _zmpPreviewController->integrateCom(_appliedComJerk, hk, hkk);
+    if (variableHeight)
+        _variableHeightPreviewController->tableCartModel(hkk, _variableHeightPreviewController->getEffectiveHeight(), pk);
+    else
+        _zmpPreviewController->tableCartModel(hkk, pk);
+}
+
+void WalkingClient::publishWalkingPlan(const Eigen::VectorXd &hk) {
+    // One message per planning cycle
+    if (!_planPublisher || (_planPublisherTick++ % _previewPlanningRatio) != 0)
+        return;
+
+    WalkingPlanMessage &message = _planPublisher->message();
+    message.comState = hk;
+    message.zmp = _globalZMP;
+    message.leftFootPosition = _stepController->getLeftFootPosition();
+    message.rightFootPosition = _stepController->getRightFootPosition();
+    message.leftFootInContact = isFootInContact(LEFT_FOOT);
+    message.rightFootInContact = isFootInContact(RIGHT_FOOT);
+
+    if (_zmpPreviewPlanner) {
+        const PreviewSolution &solution = _zmpPreviewPlanner->getTrackedSolution();
+        _planPublisher->setPreviewWindow(zmpRefInPreviewWindow, solution.hk, solution.U);
+    } else {
+        _planPublisher->setPreviewWindow(zmpRefInPreviewWindow, hk, optimalU);
+    }
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    if (!_testType.compare("walking") && _walkingPlan.isValid()) {
+        const MIQPPlan &plan = _walkingPlan.getPlan();
+        double t = yarp::os::Time::now() - plan.stateTime;
+        PlannedStep step;
+        bool planned = _walkingPlan.getNextStep(message.leftFootPosition.head<2>(), message.rightFootPosition.head<2>(), step);
+        if (message.footsteps.rows() != (planned ? 1 : 0))
+            message.footsteps.resize(planned ? 1 : 0, 6);
+        if (planned) {
+            double stanceHeight = (step.foot == LEFT_FOOT) ? message.rightFootPosition(2) : message.leftFootPosition(2);
+            message.footsteps.row(0) << step.foot, step.target.transpose(), stanceHeight, step.touchdownTime - t, step.yaw;
+        }
+        int n = plan.gamma.size();
+        if (message.contactSequence.rows() != n)
+            message.contactSequence.resize(n, 7);
+        for (int i = 0; i < n; ++i)
+            message.contactSequence.row(i) << i*plan.dt - t, plan.gamma(i), plan.a.row(i), plan.b.row(i), plan.heading(i);
+    } else {
+        int n = std::max(0, (int) _stepTargets.cols() - _currentStepIndex);
+        if (message.footsteps.rows() != n)
+            message.footsteps.resize(n, 6);
+        for (int i = 0; i < n; ++i)
+            message.footsteps.row(i) << _stepOrder[_currentStepIndex + i], _stepTargets.col(_currentStepIndex + i).transpose(), nan, _stepTargetYaws(_currentStepIndex + i);
+        if (message.contactSequence.rows() != 0)
+            message.contactSequence.resize(0, 7);
+    }
+
+    _planPublisher->publish(yarp::os::Time::now());
+}
+
 bool WalkingClient::queryMIQPSolution(const int miqpPeriod, const int miqpPreviewPeriod, const int clientPeriod, Eigen::VectorXd &preview, Eigen::VectorXd &timeVector) {
     // If current iteration _k is a multiple of miqpPeriod/clientPeriod, then a new solution from the MIQP should be ready.
     preview.setZero();
@@ -362,6 +646,10 @@ bool WalkingClient::readFootWrench(FOOT whichFoot, Eigen::VectorXd &rawWrench) {
     return true;
 }
 
+bool WalkingClient::isFootInContact(FOOT whichFoot) {
+    return _contactDetector->isInContact(whichFoot);
+}
+
 std::vector< Eigen::Vector2d > WalkingClient::generateZMPStepTrajectoryTEST(double feetSeparation, double period, double duration, double riseTime, double constantReferenceY)
 {
     std::vector<Eigen::Vector2d> zmpTrajectory;
@@ -413,60 +701,90 @@ void WalkingClient::generateStepPattern()
 {
     Eigen::Vector3d leftFootPosition = _stepController->getLeftFootPosition();
     Eigen::Vector3d rightFootPosition = _stepController->getRightFootPosition();
-    _stepTargets.resize(3, _steppingTestParams.nSteps+1);
-    // even steps are the left foot and odd steps are the right foot
+    _steppingStartLeftFoot = leftFootPosition;
+    _steppingStartRightFoot = rightFootPosition;
+    double leftFootYaw = _stepController->getFootYaw(LEFT_FOOT);
+    double rightFootYaw = _stepController->getFootYaw(RIGHT_FOOT);
+
+    // The right foot steps first and the feet alternate until a closing step brings them side by side.
+    _footstepPlanner->reset(leftFootPosition, leftFootYaw, rightFootPosition, rightFootYaw, FOOT::RIGHT_FOOT);
+    std::vector<Footstep> steps = _footstepPlanner->planSteps(_steppingTestParams.nSteps);
+
+    _stepOrder.clear();
+    _stepTargets.resize(3, steps.size());
+    _stepTargetYaws.resize(steps.size());
+    _stepTargetDurations.resize(steps.size());
     for (auto i=0; i<_stepTargets.cols(); ++i) {
-        if (i % 2 == 0) {
-            _stepTargets.col(i) = rightFootPosition;
-            _stepOrder.push_back(FOOT::RIGHT_FOOT);
-        } else {
-            _stepTargets.col(i) = leftFootPosition;
-            _stepOrder.push_back(FOOT::LEFT_FOOT);
-        }
+        _stepTargets.col(i) = steps[i].position;
+        _stepTargetYaws(i) = steps[i].yaw;
+        _stepTargetDurations(i) = steps[i].duration;
+        _stepOrder.push_back(steps[i].foot);
     }
 
-    // only the x-axis is changing for the step
-    double stepDisplacement = _steppingTestParams.stepLength/2.0;
-
-    // the first step only moves forward by 1/2 the step length
-    _stepTargets(0,0) += stepDisplacement;
-
-    // the intermediate steps all move the full length
-    for (auto i=1; i<_stepTargets.cols()-1; ++i) {
-        _stepTargets(0,i) = _stepTargets(0,i-1) + stepDisplacement;
+    // Every step climbs one riser. The closing step lands next to the last one.
+    for (auto i=0; i<_stepTargets.cols(); ++i) {
+        _stepTargets(2,i) += _steppingTestParams.stepRise*std::min(i+1, (int)_stepTargets.cols()-1);
     }
 
-    // the final step needs to come up to the last foot which was set down
-    _stepTargets(0,_steppingTestParams.nSteps) = _stepTargets(0,_steppingTestParams.nSteps-1);
-    _stepTargetDurations = Eigen::VectorXd::Constant(_stepTargets.cols(), _steppingTestParams.stepDuration);
     _stepTargetDurations.head(1)(0) = _steppingTestParams.stepDuration / 2.0;
     _stepTargetDurations.tail(1)(0) = _steppingTestParams.stepDuration / 2.0;
     std::cout << "Step Targets:\n" << _stepTargets << std::endl;
+    std::cout << "Step Yaws:\n" << _stepTargetYaws.transpose() << std::endl;
     std::cout << "Step Durations:\n" << _stepTargetDurations << std::endl;
 }
 
+void WalkingClient::replanRemainingSteps()
+{
+    int next = _currentStepIndex + 1;
+    if (next >= (int)_stepOrder.size())
+        return;
+
+    // Plan the remaining steps from where the feet actually are. The closing step stays the last one.
+    Eigen::Vector3d leftFootPosition = _stepController->getLeftFootPosition();
+    Eigen::Vector3d rightFootPosition = _stepController->getRightFootPosition();
+    double leftFootYaw = _stepController->getFootYaw(LEFT_FOOT);
+    double rightFootYaw = _stepController->getFootYaw(RIGHT_FOOT);
+    _footstepPlanner->reset(leftFootPosition, leftFootYaw, rightFootPosition, rightFootYaw, _stepOrder[next]);
+    std::vector<Footstep> steps = _footstepPlanner->planSteps(_stepOrder.size() - 1 - next);
+
+    // Only the horizontal placement changes: the step heights and durations, and thus the timing of the ZMP and CoM height trajectories, are kept
+    for (int i=0; i<(int)steps.size(); ++i) {
+        _stepTargets.col(next + i).head<2>() = steps[i].position.head<2>();
+        _stepTargetYaws(next + i) = steps[i].yaw;
+    }
+    _steppingTrajectory = generateZMPSteppingTrajectory();
+    OCRA_INFO("Replanned the last " << steps.size() << " steps with velocity " << _footstepPlanner->getVelocityCommand().transpose());
+}
+
 std::vector<Eigen::Vector2d> WalkingClient::generateZMPSteppingTrajectory()
 {
     std::vector<Eigen::Vector2d> zmpTrajectory;
     Eigen::Vector2d reference = Eigen::Vector2d::Zero();
-    Eigen::Vector3d leftFootPosition = _stepController->getLeftFootPosition();
-    Eigen::Vector3d rightFootPosition = _stepController->getRightFootPosition();
+    // Feet positions at the start of the test, so that the trajectory is unchanged up to the replanned steps
+    Eigen::Vector3d leftFootPosition = _steppingStartLeftFoot;
+    Eigen::Vector3d rightFootPosition = _steppingStartRightFoot;
     Eigen::Vector3d zmpStartPosition = (leftFootPosition + rightFootPosition)/2.0;
     Eigen::MatrixXd zmpWaypoints;
     int nSteps = _stepTargets.cols();
     zmpWaypoints.resize(2, 4+2*nSteps-1);
+    // Height of the support surface under every waypoint, relative to the initial one
+    Eigen::VectorXd zmpWaypointHeights(zmpWaypoints.cols());
     zmpWaypoints.col(0) = zmpStartPosition.head(2);
     zmpWaypoints.col(1) = zmpStartPosition.head(2);
     zmpWaypoints.col(2) = leftFootPosition.head(2);
     zmpWaypoints.col(3) = leftFootPosition.head(2);
+    zmpWaypointHeights.head(2).setZero();
+    zmpWaypointHeights.segment(2,2).setConstant(leftFootPosition(2) - zmpStartPosition(2));
     int j=4;
     for(int i=0; i<(_stepTargets.cols()-1); ++i )
     {
         zmpWaypoints.col(j) = _stepTargets.col(i).head(2);
         zmpWaypoints.col(j+1) = _stepTargets.col(i).head(2);
+        zmpWaypointHeights.segment(j,2).setConstant(_stepTargets(2,i) - zmpStartPosition(2));
         j+=2;
     }
     zmpWaypoints.rightCols(1) = ((_stepTargets.col(nSteps-2) + _stepTargets.col(nSteps-1))/2.0).head(2);
+    zmpWaypointHeights.tail(1).setConstant((_stepTargets(2,nSteps-2) + _stepTargets(2,nSteps-1))/2.0 - zmpStartPosition(2));
 
     Eigen::VectorXd zmpWaypointDurations = Eigen::VectorXd::Zero(zmpWaypoints.cols()-1);
     double singleSupportDuration = _steppingTestParams.stepDuration;
@@ -495,10 +813,38 @@ std::vector<Eigen::Vector2d> WalkingClient::generateZMPSteppingTrajectory()
         zmpTrajectory.push_back(zmpTrajectoryMatrix.col(i));
     }
 
+    generateCoMHeightSteppingTrajectory(zmpWaypointHeights, zmpWaypointDurations, zmpTrajectory.size());
+
     return zmpTrajectory;
 
 }
 
+void WalkingClient::generateCoMHeightSteppingTrajectory(const Eigen::VectorXd &waypointHeights, const Eigen::VectorXd &waypointDurations, int nSamples)
+{
+    _steppingComHeights.clear();
+    _steppingSupportHeights.clear();
+    double dt = this->getExpectedPeriod()/1000.;
+    int segment = 0;
+    double segmentStart = 0.0;
+    for (int k=0; k<nSamples; ++k) {
+        double t = k*dt;
+        while (segment < waypointDurations.size() && t >= segmentStart + waypointDurations(segment)) {
+            segmentStart += waypointDurations(segment);
+            ++segment;
+        }
+        double from = waypointHeights(waypointHeights.size()-1);
+        double to = from;
+        double s = 1.0;
+        if (segment < waypointDurations.size()) {
+            from = waypointHeights(segment);
+            to = waypointHeights(segment+1);
+            s = (t - segmentStart)/waypointDurations(segment);
+        }
+        _steppingSupportHeights.push_back(from + s*(to - from));
+        _steppingComHeights.push_back(_zmpPreviewParams->cz + from + s*s*s*(10.0 - 15.0*s + 6.0*s*s)*(to - from));
+    }
+}
+
 std::vector<Eigen::Vector2d> WalkingClient::generateZMPTrajectoryTEST(double tTrans,
                                                                       double feetSeparation,
                                                                       double timeStep,
@@ -576,6 +922,7 @@ void WalkingClient::performZMPPreviewTest(ZmpTestType type)
     transformStdVectorToEigenVector(_zmpTrajectory, el, _zmpPreviewParams->Np, zmpRefInPreviewWindow);
 
     // Compute optimal input in preview window for the next Np zmp references
+    compensateZmpDisturbance();
     _zmpPreviewController->computeOptimalInput(zmpRefInPreviewWindow, comVelRefInPreviewWindow, hk, optimalU);
 
     // Only using the first input computed by the preview controller;
@@ -613,6 +960,7 @@ void WalkingClient::performZMPPreviewTest(ZmpTestType type)
     //TODO: Watch out! if the thread doesn't respect the desired period, then your plots will look horizontally scaled!
     tnow = tnow + this->getEstPeriod()/1000;
     std::string homeDir = std::string(_homeDataDir + "/zmpPreviewController/");
+    updateZmpDisturbanceObserver(hk, optimalU.topRows(2), homeDir, tnow);
     ocra::utils::writeInFile((Eigen::VectorXd(4) << tnow, intddhkk).finished(), std::string(homeDir + "refComLinAcc.txt") ,true);
     ocra::utils::writeInFile((Eigen::VectorXd(4) << tnow, currentAcceleration).finished(), std::string(homeDir + "currentComLinAcc.txt"),true);
     ocra::utils::writeInFile((Eigen::VectorXd(3) << tnow, inthkk).finished(), std::string(homeDir + "intComPositionRef.txt"), true);
@@ -648,8 +996,10 @@ void WalkingClient::performZMPPreviewTestIntCoM(ZmpTestType type)
     Eigen::Vector2d zmpReference;
     // Retrieve current COM state
     Eigen::VectorXd hk(6);
-    // Get only current CoM position
+    // The integrated CoM drives the preview, the measured state only feeds the disturbance observer
     hk.head<2>() = this->model->getCoMPosition().topRows(2);
+    hk.segment<2>(2) = this->model->getCoMVelocity().topRows(2);
+    hk.tail<2>() = this->model->getCoMAcceleration().topRows(2);
     Eigen::VectorXd hkk(6); hkk.setZero();
     Eigen::Vector2d pk; pk.setZero();
     Eigen::Vector2d intddhkk; intddhkk.setZero();
@@ -660,6 +1010,7 @@ void WalkingClient::performZMPPreviewTestIntCoM(ZmpTestType type)
 
     // Transform the following Np zmp references from the current time step in the std::vector container to a single Eigen::VectorXd
     transformStdVectorToEigenVector(_zmpTrajectory, el, _zmpPreviewParams->Np, zmpRefInPreviewWindow);
+    compensateZmpDisturbance();
 
     // Compute optimal input in preview window for the next Np zmp references
     _zmpPreviewController->computeOptimalInput(zmpRefInPreviewWindow, comVelRefInPreviewWindow, _hkkPrevious, optimalU);
@@ -702,6 +1053,7 @@ void WalkingClient::performZMPPreviewTestIntCoM(ZmpTestType type)
     //TODO: Watch out! if the thread doesn't respect the desired period, then your plots will look horizontally scaled!
     tnow = tnow + this->getEstPeriod()/1000;
     std::string homeDir = std::string(_homeDataDir + "/zmpPreviewController/");
+    updateZmpDisturbanceObserver(hk, optimalU.topRows(2), homeDir, tnow);
     ocra::utils::writeInFile((Eigen::VectorXd(4) << tnow, intddhkk).finished(), std::string(homeDir + "refComLinAcc.txt") ,true);
     ocra::utils::writeInFile((Eigen::VectorXd(4) << tnow, currentAcceleration).finished(), std::string(homeDir + "currentComLinAcc.txt"),true);
     ocra::utils::writeInFile((Eigen::VectorXd(3) << tnow, inthkk).finished(), std::string(homeDir + "intComPositionRef.txt"), true);
@@ -730,6 +1082,7 @@ void WalkingClient::performSingleStepTest() {
     static double tnow = yarp::os::Time::now() - timeInit;
     static int el = 0;
     static bool stepStarted = false;
+    static bool stepFinished = false;
 
     Eigen::Vector2d zmpReference;
     // Retrieve current COM state
@@ -751,6 +1104,7 @@ void WalkingClient::performSingleStepTest() {
     transformStdVectorToEigenVector(_singleStepTrajectory, el, _zmpPreviewParams->Np, zmpRefInPreviewWindow);
 
     // Compute optimal input in preview window for the next Np zmp references
+    compensateZmpDisturbance();
     _zmpPreviewController->computeOptimalInput(zmpRefInPreviewWindow, comVelRefInPreviewWindow, hk, optimalU);
 
     // Only using the first input computed by the preview controller;
@@ -780,8 +1134,8 @@ void WalkingClient::performSingleStepTest() {
         stepStarted = true;
     }
 
-    if (stepStarted && _stepController->isTrajectoryFinished(RIGHT_FOOT)) {
-        _stepController->activateFeetContacts(RIGHT_FOOT);
+    if (stepStarted && !stepFinished) {
+        stepFinished = _stepController->isStepFinished(RIGHT_FOOT, isFootInContact(RIGHT_FOOT));
     }
 
     Eigen::Vector3d currentAcceleration;
@@ -798,6 +1152,7 @@ void WalkingClient::performSingleStepTest() {
     //TODO: Watch out! if the thread doesn't respect the desired period, then your plots will look horizontally scaled!
     tnow = tnow + this->getEstPeriod()/1000;
     std::string homeDir = std::string(_homeDataDir + "/zmpPreviewController/");
+    updateZmpDisturbanceObserver(hk, optimalU.topRows(2), homeDir, tnow);
     ocra::utils::writeInFile((Eigen::VectorXd(4) << tnow, intddhkk).finished(), std::string(homeDir + "refComLinAcc.txt") ,true);
     ocra::utils::writeInFile((Eigen::VectorXd(4) << tnow, currentAcceleration).finished(), std::string(homeDir + "currentComLinAcc.txt"),true);
     ocra::utils::writeInFile((Eigen::VectorXd(3) << tnow, inthkk).finished(), std::string(homeDir + "intComPositionRef.txt"), true);
@@ -822,6 +1177,8 @@ void WalkingClient::steppingTest() {
 
     static int el = 0;
 
+    // The command is applied to the remaining steps at the next touchdown, see replanRemainingSteps()
+    _footstepPlanner->readVelocityCommand(yarp::os::Time::now());
 
     Eigen::Vector2d zmpReference;
     // Retrieve current COM state
@@ -843,20 +1200,30 @@ void WalkingClient::steppingTest() {
     transformStdVectorToEigenVector(_steppingTrajectory, el, _zmpPreviewParams->Np, zmpRefInPreviewWindow);
 
     // Compute optimal input in preview window for the next Np zmp references
-    _zmpPreviewController->computeOptimalInput(zmpRefInPreviewWindow, comVelRefInPreviewWindow, hk, optimalU);
-
-    // Only using the first input computed by the preview controller;
-    // This input must now be integrated (since it's just the optimal com jerk)
-    _zmpPreviewController->integrateCom(optimalU.topRows(2), hk, hkk);
+    compensateZmpDisturbance();
+    int lastHeightSample = _steppingComHeights.size() - 1;
+    if (_variableHeightPreviewController) {
+        for (int j=0; j<_zmpPreviewParams->Np; ++j) {
+            int sample = std::min(el + j, lastHeightSample);
+            comHeightsInPreviewWindow(j) = _steppingComHeights[sample];
+            supportHeightsInPreviewWindow(j) = _steppingSupportHeights[sample];
+        }
+    }
+    previewCoM(hk, hkk, pk);
 
-    // Using the zmp cart model, the instantaneous zmp trajectory can now be
-    // computed. For this we'll pass the current full com state hk.
     inthkk = hkk.head<2>();
     intdhkk = hkk.segment<2>(2);
+    intddhkk = hkk.tail<2>();
     double periodDouble = (double) this->_period/1000;
-    intddhkk = hkk.tail<2>() + periodDouble*optimalU.topRows(2);
-    hkk.tail<2>() = intddhkk;
-    _zmpPreviewController->tableCartModel(hkk, pk);
+    if (_variableHeightPreviewController) {
+        // Vertical CoM reference from the planned height profile
+        int sample = std::min(el, lastHeightSample);
+        int next = std::min(sample + 1, lastHeightSample);
+        int prev = std::max(sample - 1, 0);
+        _comHeightState << _steppingComHeights[sample],
+                           (_steppingComHeights[next] - _steppingComHeights[prev])/((next - prev)*periodDouble),
+                           (next - prev == 2) ? (_steppingComHeights[next] - 2.0*_steppingComHeights[sample] + _steppingComHeights[prev])/(periodDouble*periodDouble) : 0.0;
+    }
 
     // Apply control
     // Prepare the desired com state and apply control!
@@ -869,6 +1236,8 @@ void WalkingClient::steppingTest() {
     static double error = 0;
     if ((yarp::os::Time::now()-steppingTestStartTime)>=initialZmpMoveTime) {
         startSteppinMotherFucker(stepTrigger, error);
+        if (_stepTimingAdaptationParams.enabled)
+            adaptCurrentStep(hk);
 //         OCRA_WARNING("Foot Traj Error called with: " << _stepOrder[_currentStepIndex]);
 //         _stepController->getFootTrajError(_stepOrder[_currentStepIndex], error);    
     }
@@ -888,6 +1257,8 @@ void WalkingClient::steppingTest() {
     //TODO: Watch out! if the thread doesn't respect the desired period, then your plots will look horizontally scaled!
     tnow = tnow + this->getEstPeriod()/1000;
     std::string homeDir = std::string(_homeDataDir + "/steppingTests/");
+    updateZmpDisturbanceObserver(hk, _appliedComJerk, homeDir, tnow);
+    publishWalkingPlan(hk);
 //     ocra::utils::writeInFile((Eigen::VectorXd(4) << tnow, intddhkk).finished(), std::string(homeDir + "refComLinAcc.txt") ,true);
     ocra::utils::writeInFile((Eigen::VectorXd(2) << tnow, error).finished(), std::string(homeDir + "feetError.txt"), true);
     ocra::utils::writeInFile((Eigen::VectorXd(2) << tnow, stepTrigger).finished(), std::string(homeDir + "stepTrigger.txt"),true);
@@ -914,7 +1285,7 @@ void WalkingClient::startSteppinMotherFucker(int &stepTrigger, double &error)
             auto foot = _stepOrder[_currentStepIndex];
             auto target = _stepTargets.col(_currentStepIndex);
             double stepDuration = _stepTargetDurations(_currentStepIndex);
-            _stepController->step(foot, target, stepDuration, _steppingTestParams.stepHeight);
+            _stepController->step(foot, target, _stepTargetYaws(_currentStepIndex), stepDuration, _steppingTestParams.stepHeight);
             stepTrigger = 1;
             _currentlyStepping = true;
             _stepController->getFootTrajError(_stepOrder[_currentStepIndex], error);
@@ -933,8 +1304,9 @@ void WalkingClient::startSteppinMotherFucker(int &stepTrigger, double &error)
                 ++_currentStepIndex;
             }
         } else {
-            if (_stepController->isStepFinished(_stepOrder[_currentStepIndex]) ) {
+            if (_stepController->isStepFinished(_stepOrder[_currentStepIndex], isFootInContact(_stepOrder[_currentStepIndex])) ) {
                 std::cout << "Step finished. Waiting for ZMP." << std::endl;
+                replanRemainingSteps();
                 _waitBeforeNextStep = true;
                 _waitTimeStart = yarp::os::Time::now();
                 stepTrigger = -1;
@@ -944,6 +1316,35 @@ void WalkingClient::startSteppinMotherFucker(int &stepTrigger, double &error)
     }
 }
 
+void WalkingClient::adaptCurrentStep(const Eigen::VectorXd &hk)
+{
+    if (!_currentlyStepping || _waitBeforeNextStep || _currentStepIndex >= (int)_stepOrder.size())
+        return;
+
+    FOOT swingFoot = _stepOrder[_currentStepIndex];
+    FOOT stanceFoot = (swingFoot == LEFT_FOOT) ? RIGHT_FOOT : LEFT_FOOT;
+    double elapsed = _stepController->getStepElapsedTime(swingFoot);
+    if (elapsed < 0.0)
+        return;
+
+    // The nominal step of the plan is the reference at every tick, so adaptations do not accumulate.
+    Eigen::Vector3d nominalTarget = _stepTargets.col(_currentStepIndex);
+    Eigen::Vector2d adaptedStep;
+    double adaptedRemaining;
+    if (_stepTimingAdapter->adapt(hk,
+                                  _stepController->getContact2DCoordinates(),
+                                  _stepController->getFootYaw(stanceFoot),
+                                  swingFoot,
+                                  nominalTarget.head(2),
+                                  _stepTargetDurations(_currentStepIndex),
+                                  elapsed,
+                                  adaptedStep,
+                                  adaptedRemaining)) {
+        Eigen::Vector3d target(adaptedStep(0), adaptedStep(1), nominalTarget(2));
+        _stepController->retarget(swingFoot, target, _stepTargetYaws(_currentStepIndex), adaptedRemaining);
+    }
+}
+
 void WalkingClient::prepareAndsetDesiredCoMTaskState(VectorXd comState, bool doSet)
 {
     ocra::TaskState desiredComState;
@@ -951,19 +1352,22 @@ void WalkingClient::prepareAndsetDesiredCoMTaskState(VectorXd comState, bool doS
     Eigen::Vector3d comRefVelocity;
     Eigen::Vector3d comRefAcceleration;
 
-    if (!_testType.compare("steppingTest") || !_testType.compare("zmpPreview")) {
-        comRefPosition << comState.head<2>(), _zmpPreviewParams->cz;
-        comRefVelocity << comState.segment<2>(2), 0;
+    if (!_testType.compare("steppingTest") || !_testType.compare("zmpPreview") || !_testType.compare("walking")) {
+        comRefPosition << comState.head<2>(), _comHeightState(0);
+        comRefVelocity << comState.segment<2>(2), _comHeightState(1);
     }
-    comRefAcceleration << comState.tail<2>(), 0;
+    comRefAcceleration << comState.tail<2>(), _comHeightState(2);
 
     if (doSet) {
-        if (!_testType.compare("steppingTest") || !_testType.compare("zmpPreview")) {
+        if (!_testType.compare("steppingTest") || !_testType.compare("zmpPreview") || !_testType.compare("walking")) {
             desiredComState.setPosition(ocra::util::eigenVectorToDisplacementd(comRefPosition));
             desiredComState.setVelocity(ocra::util::eigenVectorToTwistd(comRefVelocity));
         }
         desiredComState.setAcceleration(ocra::util::eigenVectorToTwistd(comRefAcceleration));
-        _comTask->setDesiredTaskStateDirect(desiredComState);
+        if (_comReferenceSender)
+            _comReferenceSender->send(_comTaskName, desiredComState);
+        else
+            _comTask->setDesiredTaskStateDirect(desiredComState);
 //         _comTask->setDesiredTaskState(desiredComState);
     }
 
@@ -987,11 +1391,20 @@ void WalkingClient::findZMPPreviewControllerParams(yarp::os::ResourceFinder &rf)
         _zmpPreviewParams->nw = zmpPreviewControllerParamsGroup.find("nw").asDouble();
         _zmpPreviewParams->nb = zmpPreviewControllerParamsGroup.find("nb").asDouble();
         _zmpPreviewParams->nu = zmpPreviewControllerParamsGroup.find("nu").asDouble();
+        _variableHeightPreviewParams.enabled = zmpPreviewControllerParamsGroup.check("variableHeight", yarp::os::Value(_variableHeightPreviewParams.enabled)).asBool();
+        _variableHeightPreviewParams.heightRange = zmpPreviewControllerParamsGroup.check("heightRange", yarp::os::Value(_variableHeightPreviewParams.heightRange)).asDouble();
+        _variableHeightPreviewParams.nHeights = zmpPreviewControllerParamsGroup.check("nHeights", yarp::os::Value(_variableHeightPreviewParams.nHeights)).asInt();
+        _previewPlanningRatio = std::max(1, zmpPreviewControllerParamsGroup.check("planningRatio", yarp::os::Value(_previewPlanningRatio)).asInt());
         OCRA_INFO(">> [ZMP_PREVIEW_CONTROLLER_PARAMS]: \n " << zmpPreviewControllerParamsGroup.toString().c_str() << " cz: " << _zmpPreviewParams->cz);
     }
 
     // Create zmpPreviewController object
-   _zmpPreviewController = std::make_shared<ZmpPreviewController>((double) this->getExpectedPeriod(), _zmpPreviewParams);
+    if (_variableHeightPreviewParams.enabled) {
+        _variableHeightPreviewController = std::make_shared<VariableHeightZmpPreviewController>((double) this->getExpectedPeriod(), _zmpPreviewParams, _variableHeightPreviewParams);
+        _zmpPreviewController = _variableHeightPreviewController;
+    } else {
+        _zmpPreviewController = std::make_shared<ZmpPreviewController>((double) this->getExpectedPeriod(), _zmpPreviewParams);
+    }
 }
 
 void WalkingClient::findGeneralTestsParams(yarp::os::ResourceFinder &rf) {
@@ -1109,6 +1522,7 @@ void WalkingClient::findMIQPParams(yarp::os::ResourceFinder &rf) {
         _miqpParams.addRegularization = miqpParamsGroup.find("addRegularization").asBool();
         _miqpParams.robot = miqpParamsGroup.find("robot").asString();
         _miqpParams.marginCoPBounds = miqpParamsGroup.find("marginCoPBounds").asDouble();
+        _miqpParams.yawRate = miqpParamsGroup.check("yawRate", yarp::os::Value(0.0)).asDouble();
          OCRA_INFO(">> [MIQP_CONTROLLER_PARAMS in config file]: \n " << miqpParamsGroup.toString().c_str());
     }
 }
@@ -1123,6 +1537,117 @@ void WalkingClient::findSteppingTestParams(yarp::os::ResourceFinder &rf) {
         _steppingTestParams.stepDuration = steppingTestGroup.find("stepDuration").asDouble();
         _steppingTestParams.stepLength = steppingTestGroup.find("stepLength").asDouble();
         _steppingTestParams.stepHeight = steppingTestGroup.find("stepHeight").asDouble();
+        _steppingTestParams.stepRise = steppingTestGroup.check("stepRise", yarp::os::Value(0.0)).asDouble();
         OCRA_INFO(">> [STEPPING_TEST]: \n " << steppingTestGroup.toString().c_str());
     }
 }
+
+void WalkingClient::findFootstepPlannerParams(yarp::os::ResourceFinder &rf) {
+    // Defaults reproduce the straight stepping test: the unicycle advances half a stride per step.
+    _footstepPlannerParams.stepDuration = _steppingTestParams.stepDuration;
+    // A non-positive nominal width means the measured feet separation is used.
+    _footstepPlannerParams.nominalStepWidth = 0.0;
+    _footstepVelocity << _steppingTestParams.stepLength/(2.0*_steppingTestParams.stepDuration), 0.0, 0.0;
+    if (!rf.check("FOOTSTEP_PLANNER")) {
+        OCRA_WARNING("Group FOOTSTEP_PLANNER was not found, walking straight with default step limits");
+    } else {
+        yarp::os::Property footstepPlannerGroup;
+        footstepPlannerGroup.fromString(rf.findGroup("FOOTSTEP_PLANNER").tail().toString());
+        _footstepVelocity(0) = footstepPlannerGroup.check("vx", yarp::os::Value(_footstepVelocity(0))).asDouble();
+        _footstepVelocity(1) = footstepPlannerGroup.check("vy", yarp::os::Value(_footstepVelocity(1))).asDouble();
+        _footstepVelocity(2) = footstepPlannerGroup.check("wz", yarp::os::Value(_footstepVelocity(2))).asDouble();
+        FootstepPlannerParams &p = _footstepPlannerParams;
+        p.nominalStepWidth = footstepPlannerGroup.check("nominalStepWidth", yarp::os::Value(p.nominalStepWidth)).asDouble();
+        p.minStepWidth = footstepPlannerGroup.check("minStepWidth", yarp::os::Value(p.minStepWidth)).asDouble();
+        p.maxStepWidth = footstepPlannerGroup.check("maxStepWidth", yarp::os::Value(p.maxStepWidth)).asDouble();
+        p.maxStepLength = footstepPlannerGroup.check("maxStepLength", yarp::os::Value(p.maxStepLength)).asDouble();
+        p.maxStepRotation = footstepPlannerGroup.check("maxStepRotation", yarp::os::Value(p.maxStepRotation)).asDouble();
+        p.maxInwardStepRotation = footstepPlannerGroup.check("maxInwardStepRotation", yarp::os::Value(p.maxInwardStepRotation)).asDouble();
+        p.footLength = footstepPlannerGroup.check("footLength", yarp::os::Value(p.footLength)).asDouble();
+        p.footWidth = footstepPlannerGroup.check("footWidth", yarp::os::Value(p.footWidth)).asDouble();
+        p.commandTimeout = footstepPlannerGroup.check("commandTimeout", yarp::os::Value(p.commandTimeout)).asDouble();
+        OCRA_INFO(">> [FOOTSTEP_PLANNER]: \n " << footstepPlannerGroup.toString().c_str());
+    }
+}
+
+void WalkingClient::findContactDetectorParams(yarp::os::ResourceFinder &rf) {
+    if (!rf.check("CONTACT_DETECTOR")) {
+        OCRA_WARNING("Group CONTACT_DETECTOR was not found, using default parameters");
+    } else {
+        yarp::os::Property contactDetectorGroup;
+        contactDetectorGroup.fromString(rf.findGroup("CONTACT_DETECTOR").tail().toString());
+        ContactDetectorParams &p = _contactDetectorParams;
+        p.touchdownForce = contactDetectorGroup.check("touchdownForce", yarp::os::Value(p.touchdownForce)).asDouble();
+        p.liftoffForce = contactDetectorGroup.check("liftoffForce", yarp::os::Value(p.liftoffForce)).asDouble();
+        p.cutoffFrequency = contactDetectorGroup.check("cutoffFrequency", yarp::os::Value(p.cutoffFrequency)).asDouble();
+        p.debounceTime = contactDetectorGroup.check("debounceTime", yarp::os::Value(p.debounceTime)).asDouble();
+        p.forceSign = contactDetectorGroup.check("forceSign", yarp::os::Value(p.forceSign)).asDouble();
+        OCRA_INFO(">> [CONTACT_DETECTOR]: \n " << contactDetectorGroup.toString().c_str());
+    }
+}
+
+void WalkingClient::findZmpDisturbanceObserverParams(yarp::os::ResourceFinder &rf) {
+    if (!rf.check("ZMP_DISTURBANCE_OBSERVER")) {
+        OCRA_WARNING("Group ZMP_DISTURBANCE_OBSERVER was not found, ZMP disturbances will not be compensated");
+    } else {
+        yarp::os::Property observerGroup;
+        observerGroup.fromString(rf.findGroup("ZMP_DISTURBANCE_OBSERVER").tail().toString());
+        ZmpDisturbanceObserverParams &p = _zmpDisturbanceObserverParams;
+        p.enabled = observerGroup.check("enabled", yarp::os::Value(p.enabled)).asBool();
+        p.comPositionNoise = observerGroup.check("comPositionNoise", yarp::os::Value(p.comPositionNoise)).asDouble();
+        p.comAccelerationNoise = observerGroup.check("comAccelerationNoise", yarp::os::Value(p.comAccelerationNoise)).asDouble();
+        p.zmpNoise = observerGroup.check("zmpNoise", yarp::os::Value(p.zmpNoise)).asDouble();
+        p.jerkNoise = observerGroup.check("jerkNoise", yarp::os::Value(p.jerkNoise)).asDouble();
+        p.disturbanceRate = observerGroup.check("disturbanceRate", yarp::os::Value(p.disturbanceRate)).asDouble();
+        p.maxOffset = observerGroup.check("maxOffset", yarp::os::Value(p.maxOffset)).asDouble();
+        OCRA_INFO(">> [ZMP_DISTURBANCE_OBSERVER]: \n " << observerGroup.toString().c_str());
+    }
+
+    if (_zmpDisturbanceObserverParams.enabled)
+        _zmpDisturbanceObserver = std::make_shared<ZmpDisturbanceObserver>((double) this->getExpectedPeriod(), _zmpPreviewParams->cz, _zmpDisturbanceObserverParams);
+}
+
+void WalkingClient::compensateZmpDisturbance() {
+    if (_zmpDisturbanceObserver)
+        _zmpDisturbanceObserver->compensate(zmpRefInPreviewWindow);
+}
+
+void WalkingClient::updateZmpDisturbanceObserver(const Eigen::VectorXd &hk, const Eigen::Vector2d &appliedJerk, const std::string &homeDir, double tnow) {
+    if (!_zmpDisturbanceObserver)
+        return;
+    _zmpDisturbanceObserver->update(hk, _globalZMP, appliedJerk);
+    Eigen::Vector2d offset = _zmpDisturbanceObserver->getZmpOffset();
+    Eigen::Vector2d force = _zmpDisturbanceObserver->getDisturbanceForce(this->model->getMass());
+    ocra::utils::writeInFile((Eigen::VectorXd(5) << tnow, offset, force).finished(), std::string(homeDir + "zmpDisturbance.txt"), true);
+}
+
+void WalkingClient::findPlanPublisherParams(yarp::os::ResourceFinder &rf) {
+    if (!rf.check("PLAN_PUBLISHER")) {
+        OCRA_WARNING("Group PLAN_PUBLISHER was not found, the plan will not be published");
+    } else {
+        yarp::os::Property planPublisherGroup;
+        planPublisherGroup.fromString(rf.findGroup("PLAN_PUBLISHER").tail().toString());
+        WalkingPlanPublisherParams &p = _planPublisherParams;
+        p.enabled = planPublisherGroup.check("enabled", yarp::os::Value(p.enabled)).asBool();
+        p.windowDecimation = planPublisherGroup.check("windowDecimation", yarp::os::Value(p.windowDecimation)).asInt();
+        OCRA_INFO(">> [PLAN_PUBLISHER]: \n " << planPublisherGroup.toString().c_str());
+    }
+}
+
+void WalkingClient::findStepTimingAdaptationParams(yarp::os::ResourceFinder &rf) {
+    if (!rf.check("STEP_TIMING_ADAPTATION")) {
+        OCRA_WARNING("Group STEP_TIMING_ADAPTATION was not found, steps will not be adapted");
+    } else {
+        yarp::os::Property adaptationGroup;
+        adaptationGroup.fromString(rf.findGroup("STEP_TIMING_ADAPTATION").tail().toString());
+        StepTimingAdaptationParams &p = _stepTimingAdaptationParams;
+        p.enabled = adaptationGroup.check("enabled", yarp::os::Value(p.enabled)).asBool();
+        p.minStepDuration = adaptationGroup.check("minStepDuration", yarp::os::Value(p.minStepDuration)).asDouble();
+        p.maxStepDuration = adaptationGroup.check("maxStepDuration", yarp::os::Value(p.maxStepDuration)).asDouble();
+        p.freezeTime = adaptationGroup.check("freezeTime", yarp::os::Value(p.freezeTime)).asDouble();
+        p.stepLocationWeight = adaptationGroup.check("stepLocationWeight", yarp::os::Value(p.stepLocationWeight)).asDouble();
+        p.stepTimingWeight = adaptationGroup.check("stepTimingWeight", yarp::os::Value(p.stepTimingWeight)).asDouble();
+        p.dcmOffsetWeight = adaptationGroup.check("dcmOffsetWeight", yarp::os::Value(p.dcmOffsetWeight)).asDouble();
+        OCRA_INFO(">> [STEP_TIMING_ADAPTATION]: \n " << adaptationGroup.toString().c_str());
+    }
+}
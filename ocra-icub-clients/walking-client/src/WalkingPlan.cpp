@@ -0,0 +1,76 @@
+#include "walking-client/WalkingPlan.h"
+#include <algorithm>
+#include <cmath>
+
+WalkingPlan::WalkingPlan():
+_valid(false)
+{
+}
+
+WalkingPlan::~WalkingPlan()
+{
+}
+
+void WalkingPlan::setPlan(const MIQPPlan &plan)
+{
+    _plan = plan;
+    _valid = _plan.dt > 0.0 && _plan.cop.rows() > 0 && _plan.cop.rows() == _plan.gamma.size() && _plan.heading.size() == _plan.gamma.size();
+}
+
+void WalkingPlan::getCoPReference(double t, double dt, int Np, Eigen::VectorXd &zmpRef) const
+{
+    for (int j = 0; j < Np; ++j)
+        zmpRef.segment<2>(2*j) = interpolate(_plan.cop, 0, t + (j+1)*dt);
+}
+
+void WalkingPlan::getCoMVelocityReference(double t, double dt, int Np, Eigen::VectorXd &comVelRef) const
+{
+    for (int j = 0; j < Np; ++j)
+        comVelRef.segment<2>(2*j) = interpolate(_plan.com, 2, t + (j+1)*dt);
+}
+
+bool WalkingPlan::getNextStep(const Eigen::Vector2d &leftFoot, const Eigen::Vector2d &rightFoot, PlannedStep &step) const
+{
+    if (!_valid)
+        return false;
+
+    const int n = _plan.gamma.size();
+    int liftoff = 0;
+    while (liftoff < n && _plan.gamma(liftoff) > 0.5)
+        ++liftoff;
+    int touchdown = liftoff;
+    while (touchdown < n && _plan.gamma(touchdown) < 0.5)
+        ++touchdown;
+    if (touchdown >= n)
+        return false;
+
+    // In SS the bounds collapse on the stance foot
+    Eigen::Vector2d stanceBounds = Eigen::Rotation2Dd(_plan.heading(liftoff))*_plan.a.row(liftoff).transpose();
+    bool leftIsStance = (leftFoot - stanceBounds).squaredNorm() < (rightFoot - stanceBounds).squaredNorm();
+
+    // Corners are chosen in the heading frame of the touchdown sample
+    Eigen::Rotation2Dd toWorld(_plan.heading(touchdown));
+    Eigen::Vector2d stance = toWorld.inverse()*(leftIsStance ? leftFoot : rightFoot);
+    Eigen::Vector2d a = _plan.a.row(touchdown).transpose();
+    Eigen::Vector2d b = _plan.b.row(touchdown).transpose();
+    Eigen::Vector2d target;
+    step.foot = leftIsStance ? RIGHT_FOOT : LEFT_FOOT;
+    for (int i = 0; i < 2; ++i)
+        target(i) = (std::abs(stance(i) - a(i)) < std::abs(stance(i) - b(i))) ? b(i) : a(i);
+    step.target = toWorld*target;
+    step.yaw = _plan.heading(touchdown);
+    step.liftoffTime = liftoff*_plan.dt;
+    step.touchdownTime = touchdown*_plan.dt;
+    return true;
+}
+
+Eigen::Vector2d WalkingPlan::interpolate(const Eigen::MatrixXd &samples, int col, double t) const
+{
+    const int last = samples.rows() - 1;
+    double position = std::max(0.0, t/_plan.dt);
+    int i = std::min(last, (int)std::floor(position));
+    if (i == last)
+        return samples.block<1,2>(last, col).transpose();
+    double alpha = position - i;
+    return ((1.0 - alpha)*samples.block<1,2>(i, col) + alpha*samples.block<1,2>(i+1, col)).transpose();
+}
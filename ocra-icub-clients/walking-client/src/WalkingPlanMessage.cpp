@@ -0,0 +1,147 @@
+#include "walking-client/WalkingPlanMessage.h"
+#include <cstring>
+
+namespace {
+    const unsigned char MAGIC[4] = {'W', 'K', 'P', 'L'};
+    const std::size_t FIXED_SIZE = 4 + 2 + 2 + 4 + 4 + 8 + 8 + 8*(6 + 2 + 3 + 3) + 4*4;
+    const int FOOTSTEP_COLUMNS = 6;
+    const int CONTACT_COLUMNS = 7;
+
+    class Writer {
+    public:
+        Writer(unsigned char *data): _data(data), _offset(0) {}
+        template <typename T> void put(const T &value) {
+            std::memcpy(_data + _offset, &value, sizeof(T));
+            _offset += sizeof(T);
+        }
+        template <typename Derived> void putMatrix(const Eigen::MatrixBase<Derived> &m) {
+            for (int i = 0; i < m.rows(); ++i)
+                for (int j = 0; j < m.cols(); ++j)
+                    put<double>(m(i,j));
+        }
+        std::size_t offset() const {return _offset;}
+    private:
+        unsigned char *_data;
+        std::size_t _offset;
+    };
+
+    class Reader {
+    public:
+        Reader(const unsigned char *data): _data(data), _offset(0) {}
+        template <typename T> T get() {
+            T value;
+            std::memcpy(&value, _data + _offset, sizeof(T));
+            _offset += sizeof(T);
+            return value;
+        }
+        template <typename Derived> void getMatrix(Eigen::MatrixBase<Derived> &m) {
+            for (int i = 0; i < m.rows(); ++i)
+                for (int j = 0; j < m.cols(); ++j)
+                    m(i,j) = get<double>();
+        }
+        void skip(std::size_t bytes) {_offset += bytes;}
+    private:
+        const unsigned char *_data;
+        std::size_t _offset;
+    };
+
+    bool isLittleEndian() {
+        const uint16_t one = 1;
+        return *reinterpret_cast<const unsigned char *>(&one) == 1;
+    }
+}
+
+WalkingPlanMessage::WalkingPlanMessage():
+sequence(0),
+time(0.0),
+windowPeriod(0.0),
+comState(Eigen::Matrix<double, 6, 1>::Zero()),
+zmp(Eigen::Vector2d::Zero()),
+leftFootPosition(Eigen::Vector3d::Zero()),
+rightFootPosition(Eigen::Vector3d::Zero()),
+leftFootInContact(false),
+rightFootInContact(false),
+zmpReference(0, 2),
+predictedCom(0, 2),
+footsteps(0, FOOTSTEP_COLUMNS),
+contactSequence(0, CONTACT_COLUMNS)
+{
+}
+
+std::size_t WalkingPlanCodec::encode(const WalkingPlanMessage &message, std::vector<unsigned char> &buffer)
+{
+    std::size_t size = FIXED_SIZE + sizeof(double)*(2*message.zmpReference.rows()
+                                                    + 2*message.predictedCom.rows()
+                                                    + FOOTSTEP_COLUMNS*message.footsteps.rows()
+                                                    + CONTACT_COLUMNS*message.contactSequence.rows());
+    if (buffer.size() < size)
+        buffer.resize(size);
+
+    Writer w(buffer.data());
+    for (int i = 0; i < 4; ++i)
+        w.put<unsigned char>(MAGIC[i]);
+    w.put<uint16_t>(VERSION);
+    w.put<uint16_t>((message.leftFootInContact ? 1 : 0) | (message.rightFootInContact ? 2 : 0));
+    w.put<uint32_t>(message.sequence);
+    w.put<uint32_t>(0);
+    w.put<double>(message.time);
+    w.put<double>(message.windowPeriod);
+    w.putMatrix(message.comState);
+    w.putMatrix(message.zmp);
+    w.putMatrix(message.leftFootPosition);
+    w.putMatrix(message.rightFootPosition);
+    w.put<uint32_t>(message.zmpReference.rows());
+    w.put<uint32_t>(message.predictedCom.rows());
+    w.put<uint32_t>(message.footsteps.rows());
+    w.put<uint32_t>(message.contactSequence.rows());
+    w.putMatrix(message.zmpReference.leftCols<2>());
+    w.putMatrix(message.predictedCom.leftCols<2>());
+    w.putMatrix(message.footsteps.leftCols<FOOTSTEP_COLUMNS>());
+    w.putMatrix(message.contactSequence.leftCols<CONTACT_COLUMNS>());
+    return w.offset();
+}
+
+bool WalkingPlanCodec::decode(const unsigned char *data, std::size_t size, WalkingPlanMessage &message)
+{
+    // Messages are written in the byte order of the client, which is little-endian on every supported platform
+    if (!isLittleEndian() || size < FIXED_SIZE || std::memcmp(data, MAGIC, 4) != 0)
+        return false;
+
+    Reader r(data);
+    r.skip(4);
+    if (r.get<uint16_t>() != VERSION)
+        return false;
+    uint16_t flags = r.get<uint16_t>();
+    message.leftFootInContact = flags & 1;
+    message.rightFootInContact = flags & 2;
+    message.sequence = r.get<uint32_t>();
+    r.skip(4);
+    message.time = r.get<double>();
+    message.windowPeriod = r.get<double>();
+    r.getMatrix(message.comState);
+    r.getMatrix(message.zmp);
+    r.getMatrix(message.leftFootPosition);
+    r.getMatrix(message.rightFootPosition);
+    uint32_t nZmp = r.get<uint32_t>();
+    uint32_t nCom = r.get<uint32_t>();
+    uint32_t nSteps = r.get<uint32_t>();
+    uint32_t nContacts = r.get<uint32_t>();
+
+    // Sizes are checked before anything is allocated
+    const std::size_t maxRows = size/sizeof(double);
+    if (nZmp > maxRows || nCom > maxRows || nSteps > maxRows || nContacts > maxRows)
+        return false;
+    std::size_t expected = FIXED_SIZE + sizeof(double)*(2*nZmp + 2*nCom + FOOTSTEP_COLUMNS*nSteps + CONTACT_COLUMNS*nContacts);
+    if (size < expected)
+        return false;
+
+    message.zmpReference.resize(nZmp, 2);
+    message.predictedCom.resize(nCom, 2);
+    message.footsteps.resize(nSteps, FOOTSTEP_COLUMNS);
+    message.contactSequence.resize(nContacts, CONTACT_COLUMNS);
+    r.getMatrix(message.zmpReference);
+    r.getMatrix(message.predictedCom);
+    r.getMatrix(message.footsteps);
+    r.getMatrix(message.contactSequence);
+    return true;
+}
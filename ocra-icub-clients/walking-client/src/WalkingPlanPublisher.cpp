@@ -0,0 +1,61 @@
+#include "walking-client/WalkingPlanPublisher.h"
+#include <algorithm>
+
+WalkingPlanPublisher::WalkingPlanPublisher(const double period, std::shared_ptr<ZmpPreviewController> controller, const WalkingPlanPublisherParams &params):
+_decimation(std::max(1, params.windowDecimation)),
+_h(Eigen::VectorXd::Zero(6)),
+_hNext(Eigen::VectorXd::Zero(6))
+{
+    _Ah = controller->buildAh(period/1000);
+    _Bh = controller->buildBh(period/1000);
+    _message.windowPeriod = _decimation*period/1000;
+}
+
+WalkingPlanPublisher::~WalkingPlanPublisher()
+{
+}
+
+bool WalkingPlanPublisher::open(const std::string &portName)
+{
+    if (!_port.open(portName)) {
+        OCRA_ERROR("Impossible to open " << portName);
+        return false;
+    }
+    return true;
+}
+
+void WalkingPlanPublisher::close()
+{
+    _port.close();
+}
+
+void WalkingPlanPublisher::setPreviewWindow(const Eigen::VectorXd &zmpRef, const Eigen::VectorXd &h0, const Eigen::VectorXd &U)
+{
+    int nZmp = zmpRef.size()/2/_decimation;
+    if (_message.zmpReference.rows() != nZmp)
+        _message.zmpReference.resize(nZmp, 2);
+    for (int i = 0; i < nZmp; ++i)
+        _message.zmpReference.row(i) = zmpRef.segment<2>(2*((i+1)*_decimation - 1)).transpose();
+
+    // Sample j of the window is the state after j+1 jerks, as for the ZMP references
+    int nCom = U.size()/2/_decimation;
+    if (_message.predictedCom.rows() != nCom)
+        _message.predictedCom.resize(nCom, 2);
+    _h = h0;
+    for (int j = 0; j < nCom*_decimation; ++j) {
+        _hNext.noalias() = _Ah*_h;
+        _hNext.noalias() += _Bh*U.segment<2>(2*j);
+        _h.swap(_hNext);
+        if ((j + 1) % _decimation == 0)
+            _message.predictedCom.row((j + 1)/_decimation - 1) = _h.head<2>().transpose();
+    }
+}
+
+void WalkingPlanPublisher::publish(double time)
+{
+    _message.sequence++;
+    _message.time = time;
+    WalkingPlanPortable &bytes = _port.prepare();
+    bytes.size = WalkingPlanCodec::encode(_message, bytes.buffer);
+    _port.write();
+}
@@ -0,0 +1,80 @@
+#include "walking-client/ZmpDisturbanceObserver.h"
+#include <algorithm>
+
+ZmpDisturbanceObserver::ZmpDisturbanceObserver(const double period, const double cz, const ZmpDisturbanceObserverParams &params):
+_g(9.8),
+_cz(cz),
+_maxOffset(params.maxOffset),
+_X(Eigen::Matrix<double, 4, 2>::Zero()),
+_Y(Eigen::Matrix<double, 3, 2>::Zero()),
+_initialized(false)
+{
+    const double dt = period/1000;
+    _A << 1, dt, dt*dt/2, 0,
+          0, 1,  dt,      0,
+          0, 0,  1,       0,
+          0, 0,  0,       1;
+    _B << dt*dt*dt/6, dt*dt/2, dt, 0;
+    _C << 1, 0, 0,        0,
+          0, 0, 1,        0,
+          1, 0, -_cz/_g,  1;
+
+    Eigen::Matrix4d Q = params.jerkNoise*params.jerkNoise*_B*_B.transpose();
+    Q(3,3) = params.disturbanceRate*params.disturbanceRate*dt;
+    Eigen::Matrix3d R = Eigen::Vector3d(params.comPositionNoise*params.comPositionNoise,
+                                        params.comAccelerationNoise*params.comAccelerationNoise,
+                                        params.zmpNoise*params.zmpNoise).asDiagonal();
+
+    // Riccati recursion until the gain settles
+    Eigen::Matrix4d P = Eigen::Matrix4d::Identity();
+    _L.setZero();
+    for (int i = 0; i < 100000; ++i) {
+        P = _A*P*_A.transpose() + Q;
+        Eigen::Matrix3d S = _C*P*_C.transpose() + R;
+        Eigen::Matrix<double, 4, 3> L = P*_C.transpose()*S.inverse();
+        P = (Eigen::Matrix4d::Identity() - L*_C)*P;
+        bool settled = (L - _L).cwiseAbs().maxCoeff() < 1e-12;
+        _L = L;
+        if (settled)
+            break;
+    }
+}
+
+ZmpDisturbanceObserver::~ZmpDisturbanceObserver()
+{
+}
+
+void ZmpDisturbanceObserver::update(const Eigen::VectorXd &hk, const Eigen::Vector2d &measuredZmp, const Eigen::Vector2d &appliedJerk)
+{
+    _Y.row(0) = hk.head<2>().transpose();
+    _Y.row(1) = hk.tail<2>().transpose();
+    _Y.row(2) = measuredZmp.transpose();
+
+    if (!_initialized) {
+        _X.topRows<3>() = Eigen::Map<const Eigen::Matrix<double, 2, 3> >(hk.data()).transpose();
+        _X.row(3).setZero();
+        _initialized = true;
+        return;
+    }
+
+    _X = _A*_X + _B*appliedJerk.transpose();
+    _X += _L*(_Y - _C*_X);
+}
+
+void ZmpDisturbanceObserver::compensate(Eigen::VectorXd &zmpRef) const
+{
+    Eigen::Vector2d offset = getZmpOffset().cwiseMax(-_maxOffset).cwiseMin(_maxOffset);
+    for (int j = 0; j < zmpRef.size()/2; ++j)
+        zmpRef.segment<2>(2*j) -= offset;
+}
+
+Eigen::Vector2d ZmpDisturbanceObserver::getDisturbanceForce(const double mass) const
+{
+    return (mass*_g/_cz)*getZmpOffset();
+}
+
+void ZmpDisturbanceObserver::reset()
+{
+    _X.setZero();
+    _initialized = false;
+}
@@ -0,0 +1,125 @@
+#include "walking-client/ZmpPreviewPlanner.h"
+#include <algorithm>
+
+namespace {
+    PreviewRequest emptyRequest(int Np) {
+        PreviewRequest request;
+        request.tick = -1;
+        request.hk = Eigen::VectorXd::Zero(6);
+        request.zmpRef = Eigen::VectorXd::Zero(2*Np);
+        request.comVelRef = Eigen::VectorXd::Zero(2*Np);
+        request.comHeights = Eigen::VectorXd::Zero(Np);
+        request.supportHeights = Eigen::VectorXd::Zero(Np);
+        return request;
+    }
+
+    PreviewSolution emptySolution(int Nc, double cz) {
+        PreviewSolution solution;
+        solution.tick = -1;
+        solution.hk = Eigen::VectorXd::Zero(6);
+        solution.U = Eigen::VectorXd::Zero(2*Nc);
+        solution.effectiveHeight = cz;
+        return solution;
+    }
+}
+
+ZmpPreviewPlanner::ZmpPreviewPlanner(const int clientPeriod,
+                                     const int ratio,
+                                     std::shared_ptr<ZmpPreviewParams> parameters,
+                                     std::shared_ptr<ZmpPreviewController> controller,
+                                     std::shared_ptr<VariableHeightZmpPreviewController> variableHeightController):
+RateThread(clientPeriod*ratio),
+_Nc(parameters->Nc),
+_cz(parameters->cz),
+_controller(controller),
+_variableHeightController(variableHeightController),
+_requests(emptyRequest(parameters->Np)),
+_solutions(emptySolution(parameters->Nc, parameters->cz)),
+_solvedTick(-1),
+_trackedState(Eigen::VectorXd::Zero(6)),
+_nextState(Eigen::VectorXd::Zero(6)),
+_trackedTick(-1),
+_tracking(false)
+{
+    _Ah = _controller->buildAh(clientPeriod/1000.0);
+    _Bh = _controller->buildBh(clientPeriod/1000.0);
+    if (_variableHeightController)
+        _variableHeightController->setSamplesBetweenCalls(ratio);
+    OCRA_INFO("ZMP preview planned every " << clientPeriod*ratio << " ms and tracked every " << clientPeriod << " ms");
+}
+
+ZmpPreviewPlanner::~ZmpPreviewPlanner()
+{
+}
+
+void ZmpPreviewPlanner::run()
+{
+    if (!_requests.read())
+        return;
+    const PreviewRequest &request = _requests.readBuffer();
+    if (request.tick <= _solvedTick)
+        return;
+
+    PreviewSolution &solution = _solutions.writeBuffer();
+    if (_variableHeightController) {
+        _variableHeightController->computeOptimalInput(request.zmpRef, request.comVelRef, request.hk, request.comHeights, request.supportHeights, solution.U);
+        solution.effectiveHeight = _variableHeightController->getEffectiveHeight();
+    } else {
+        _controller->computeOptimalInput(request.zmpRef, request.comVelRef, request.hk, solution.U);
+        solution.effectiveHeight = _cz;
+    }
+    solution.tick = request.tick;
+    solution.hk = request.hk;
+    _solutions.publish();
+    _solvedTick = request.tick;
+}
+
+void ZmpPreviewPlanner::post(long tick,
+                             const Eigen::VectorXd &hk,
+                             const Eigen::VectorXd &zmpRef,
+                             const Eigen::VectorXd &comVelRef,
+                             const Eigen::VectorXd &comHeights,
+                             const Eigen::VectorXd &supportHeights)
+{
+    PreviewRequest &request = _requests.writeBuffer();
+    request.tick = tick;
+    request.hk = hk;
+    request.zmpRef = zmpRef;
+    request.comVelRef = comVelRef;
+    if (_variableHeightController) {
+        request.comHeights = comHeights;
+        request.supportHeights = supportHeights;
+    }
+    _requests.publish();
+}
+
+bool ZmpPreviewPlanner::track(long tick, Eigen::VectorXd &hkk, Eigen::Vector2d &jerk, double &effectiveHeight)
+{
+    // A new solution restarts the integration from the state it was computed from
+    if (_solutions.read()) {
+        _trackedState = _solutions.readBuffer().hk;
+        _trackedTick = _solutions.readBuffer().tick;
+        _tracking = true;
+    }
+    if (!_tracking)
+        return false;
+
+    const PreviewSolution &solution = _solutions.readBuffer();
+    while (_trackedTick <= tick) {
+        long j = _trackedTick - solution.tick;
+        // Beyond the control window the acceleration is held
+        if (j < _Nc)
+            jerk = solution.U.segment<2>(2*j);
+        else
+            jerk.setZero();
+        _nextState.noalias() = _Ah*_trackedState;
+        _nextState.noalias() += _Bh*jerk;
+        if (_trackedTick == tick)
+            break;
+        _trackedState.swap(_nextState);
+        ++_trackedTick;
+    }
+    hkk = _nextState;
+    effectiveHeight = solution.effectiveHeight;
+    return true;
+}
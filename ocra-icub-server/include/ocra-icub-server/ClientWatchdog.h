@@ -0,0 +1,125 @@
+/*! \file       ClientWatchdog.h
+ *  \brief      Detects stalled clients from their heartbeats and takes over their tasks.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_CLIENT_WATCHDOG_H
+#define OCRA_CONTROLLER_SERVER_CLIENT_WATCHDOG_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include <ocra/control/Task.h>
+#include <ocra/control/TaskState.h>
+#include <ocra-icub/Utilities.h>
+#include <ocra-icub-server/IcubControllerServer.h>
+
+enum WATCHDOG_ACTION
+{
+    WATCHDOG_FREEZE,        /*!< Hold every task of the client at its measured state. */
+    WATCHDOG_BLEND_TO_HOME  /*!< Like WATCHDOG_FREEZE but full posture tasks are blended to the home posture. */
+};
+
+/*! \class ClientWatchdog
+ *  \brief Watches the heartbeats published by the clients (see ocra_icub::ClientHeartbeat) and takes over the tasks of a client which stops beating.
+ *
+ *  update() is called once per control tick, before the torques are computed. A client is only watched once its first heartbeat has been received, so clients which do not publish heartbeats are left alone. When a client misses more than `timeoutTicks` ticks, its tasks are frozen at their measured state (zero velocity and acceleration) or, for full posture tasks in WATCHDOG_BLEND_TO_HOME mode, brought to the home posture along a minimum jerk profile. The control ports of the held tasks are closed and their desired states are written at every tick, so neither the trajectories nor the queued messages of the stalled client move them. A `timeout` event is written on /ocra-icub-server/watchdog/events:o, and a `recovered` event when the client beats again, at which point the control ports are opened again and it drives its tasks again.
+ */
+class ClientWatchdog
+{
+CLASS_POINTER_TYPEDEFS(ClientWatchdog)
+
+public:
+    /*! Constructor
+     *  \param server The controller server whose tasks are taken over.
+     *  \param threadPeriod The control period in ms.
+     *  \param timeoutTicks Number of ticks without heartbeat after which a client is considered stalled.
+     *  \param action What to do with the tasks of a stalled client.
+     *  \param blendTime Duration in seconds of the blend to the home posture.
+     *  \param homePosture The posture used by WATCHDOG_BLEND_TO_HOME.
+     */
+    ClientWatchdog(std::shared_ptr<IcubControllerServer> server, int threadPeriod, int timeoutTicks, WATCHDOG_ACTION action, double blendTime, const Eigen::VectorXd& homePosture);
+    virtual ~ClientWatchdog();
+
+    bool open();
+    void close();
+
+    /*! Reads the pending heartbeats, detects timeouts and updates the tasks held by the watchdog. Call once per tick.
+     */
+    void update();
+
+    /*! \return The number of clients currently held by the watchdog.
+     */
+    int getNumberOfStalledClients() const;
+
+    /*! \return The names of the clients currently held by the watchdog.
+     */
+    std::vector<std::string> getStalledClients() const;
+
+private:
+    struct HeldTask
+    {
+        std::shared_ptr<ocra::Task> task;
+        Eigen::VectorXd startPosture;
+        ocra::TaskState target;
+        bool blendPosture = false;
+        bool portsClosed = false;
+    };
+
+    struct ClientRecord
+    {
+        std::vector<std::string> taskNames;
+        int lastSequence = 0;
+        int ticksSinceBeat = 0;
+        bool hasTimedOut = false;
+        int ticksSinceTimeout = 0;
+        std::vector<HeldTask> heldTasks;
+    };
+
+    void readHeartbeats();
+    void takeOverClient(const std::string& clientName, ClientRecord& client);
+    void updateHeldTasks(ClientRecord& client);
+    void releaseHeldTasks(ClientRecord& client);
+    void emitEvent(const std::string& eventType, const std::string& clientName, const ClientRecord& client);
+
+private:
+    std::shared_ptr<IcubControllerServer> ctrlServer;
+    int period;
+    int timeout;
+    WATCHDOG_ACTION watchdogAction;
+    int blendTicks;
+    Eigen::VectorXd home;
+
+    std::map<std::string, ClientRecord> clients;
+    yarp::os::BufferedPort<yarp::os::Bottle> heartbeatPort;
+    yarp::os::BufferedPort<yarp::os::Bottle> eventPort;
+    bool portsAreOpen;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_CLIENT_WATCHDOG_H
@@ -0,0 +1,129 @@
+/*! \file       ContactTransitionManager.h
+ *  \brief      Releases and acquires contact tasks when their load crosses the thresholds set by the clients.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_CONTACT_TRANSITION_MANAGER_H
+#define OCRA_CONTROLLER_SERVER_CONTACT_TRANSITION_MANAGER_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/sig/Vector.h>
+
+#include <ocra/control/Task.h>
+#include <ocra-icub/Utilities.h>
+#include <ocra-icub/ContactTransition.h>
+#include <ocra-icub-server/IcubControllerServer.h>
+
+/*! \class ContactTransitionManager
+ *  \brief Evaluates the contact transition rules (see ocra_icub::ContactTransitionRule) sent by the clients on /ocra-icub-server/contacts:i.
+ *
+ *  update() is called once per control tick, before the torques are computed. It measures the load of every armed contact task and deactivates or activates the task on the tick where the load crosses the release or acquisition threshold. Measured wrenches are received by port callbacks, so update() always uses the latest sample without waiting for it. Rules are received in a callback as well, which opens and connects their wrench ports outside of the control loop.
+ *
+ *  `armed`, `released`, `acquired`, `disarmed` and `rejected` events are written on /ocra-icub-server/contacts/events:o.
+ */
+class ContactTransitionManager
+{
+CLASS_POINTER_TYPEDEFS(ContactTransitionManager)
+
+public:
+    /*! Constructor
+     *  \param server The controller server whose contact tasks are switched.
+     */
+    ContactTransitionManager(std::shared_ptr<IcubControllerServer> server);
+    virtual ~ContactTransitionManager();
+
+    bool open();
+    void close();
+
+    /*! Measures the loads and switches the contact tasks. Call once per tick.
+     */
+    void update();
+
+    /*! \return The number of armed rules.
+     */
+    int getNumberOfArmedRules() const;
+
+private:
+    class WrenchPort : public yarp::os::BufferedPort<yarp::sig::Vector>
+    {
+    public:
+        WrenchPort();
+        using yarp::os::BufferedPort<yarp::sig::Vector>::onRead;
+        virtual void onRead(yarp::sig::Vector& wrench);
+        bool getForce(Eigen::Vector3d& force);
+    private:
+        std::mutex forceMutex;
+        Eigen::Vector3d latestForce;
+        bool hasSample;
+    };
+
+    class RulePort : public yarp::os::BufferedPort<yarp::os::Bottle>
+    {
+    public:
+        RulePort(ContactTransitionManager& manager);
+        using yarp::os::BufferedPort<yarp::os::Bottle>::onRead;
+        virtual void onRead(yarp::os::Bottle& bottle);
+    private:
+        ContactTransitionManager& manager;
+    };
+
+    struct ArmedRule
+    {
+        ocra_icub::ContactTransitionRule rule;
+        std::shared_ptr<ocra::Task> task;
+        std::shared_ptr<WrenchPort> wrenchPort; /*!< Null when the load comes from the model. */
+        bool loaded = true;
+        bool wasConstraint = false; /*!< How the task was active before it was released. */
+        int pendingTicks = 0;
+    };
+
+    void receiveRule(const yarp::os::Bottle& bottle);
+    bool armRule(const ocra_icub::ContactTransitionRule& rule, ArmedRule& armed, std::string& reason);
+    bool measureLoad(ArmedRule& armed, double& load);
+    void retireWrenchPort(std::shared_ptr<WrenchPort> wrenchPort);
+    void emitEvent(const std::string& eventType, const std::string& taskName, double load, const std::string& message);
+
+private:
+    std::shared_ptr<IcubControllerServer> ctrlServer;
+
+    std::map<std::string, ArmedRule> rules; /*!< Only used by the control thread. */
+    std::vector<ArmedRule> pendingRules; /*!< Rules received since the last tick. */
+    std::vector<std::shared_ptr<WrenchPort> > retiredWrenchPorts; /*!< Closed by the rule callback, never by the control thread. */
+    std::mutex pendingMutex;
+    std::mutex eventMutex;
+    int wrenchPortCount;
+
+    RulePort rulePort;
+    yarp::os::BufferedPort<yarp::os::Bottle> eventPort;
+    bool portsAreOpen;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_CONTACT_TRANSITION_MANAGER_H
@@ -0,0 +1,95 @@
+/*! \file       GainScheduler.h
+ *  \brief      Interpolates the gain profiles sent by the clients inside the control loop.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_GAIN_SCHEDULER_H
+#define OCRA_CONTROLLER_SERVER_GAIN_SCHEDULER_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <Eigen/Dense>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include <ocra/control/Task.h>
+#include <ocra-icub/Utilities.h>
+#include <ocra-icub/GainProfile.h>
+#include <ocra-icub-server/IcubControllerServer.h>
+
+/*! \class GainScheduler
+ *  \brief Applies the gain profiles (see ocra_icub::GainProfile) sent by the clients on /ocra-icub-server/gains:i.
+ *
+ *  update() is called once per control tick, before the torques are computed. It reads the pending profiles without blocking and sets the interpolated stiffness and damping of every task with a running profile, so a client sends one message per transition instead of one per tick. Profiles whose matrices do not match the size of the task gains are rejected. `rejected` and `finished` events are written on /ocra-icub-server/gains/events:o.
+ */
+class GainScheduler
+{
+CLASS_POINTER_TYPEDEFS(GainScheduler)
+
+public:
+    /*! Constructor
+     *  \param server The controller server whose tasks receive the gains.
+     *  \param threadPeriod The control period in ms.
+     */
+    GainScheduler(std::shared_ptr<IcubControllerServer> server, int threadPeriod);
+    virtual ~GainScheduler();
+
+    bool open();
+    void close();
+
+    /*! Reads the pending profiles and updates the gains of the tasks. Call once per tick.
+     */
+    void update();
+
+    /*! \return The number of profiles being interpolated.
+     */
+    int getNumberOfRunningProfiles() const;
+
+private:
+    struct RunningProfile
+    {
+        std::shared_ptr<ocra::Task> task;
+        ocra_icub::GainProfile profile;
+        Eigen::MatrixXd startStiffness;
+        Eigen::MatrixXd startDamping;
+        int ticks = 0;
+    };
+
+    void readProfiles();
+    bool startProfile(const ocra_icub::GainProfile& profile, std::string& reason);
+    bool expandTarget(const Eigen::MatrixXd& target, const Eigen::MatrixXd& current, Eigen::MatrixXd& expanded) const;
+    void emitEvent(const std::string& eventType, const std::string& taskName, const std::string& message);
+
+private:
+    std::shared_ptr<IcubControllerServer> ctrlServer;
+    double period;
+
+    std::map<std::string, RunningProfile> profiles;
+    yarp::os::BufferedPort<yarp::os::Bottle> profilePort;
+    yarp::os::BufferedPort<yarp::os::Bottle> eventPort;
+    bool portsAreOpen;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_GAIN_SCHEDULER_H
@@ -25,9 +25,39 @@ public:
     virtual ocra::Model::Ptr loadRobotModel();
 
     virtual void getRobotState(Eigen::VectorXd& q, Eigen::VectorXd& qd, Eigen::Displacementd& H_root, Eigen::Twistd& T_root);
+
+    /*! Direct access to a task of the controller for the server side components which act on the tasks inside the control tick.
+     *  \return The task or an empty pointer if no task has this name.
+     */
+    std::shared_ptr<ocra::Task> getTask(const std::string& taskName);
+    std::vector<std::string> getTaskNames();
+
+    /*! Adds a constraint to the controller, for the server side components which are not tasks, e.g. the self collision avoidance. The constraint must outlive its registration.
+     */
+    void addConstraint(ocra::LinearConstraint& constraint);
+    void removeConstraint(ocra::LinearConstraint& constraint);
     
+    /*! Makes getRobotState() return the state last read by another server instead of reading the robot, e.g. when this server only keeps the client connections after a controller swap. An empty pointer makes it read the robot again.
+     */
+    void followRobotState(std::shared_ptr<IcubControllerServer> source);
+
+    /*! \return False if no state was read yet.
+     */
+    bool getLastRobotState(Eigen::VectorXd& q, Eigen::VectorXd& qd, Eigen::Displacementd& H_root, Eigen::Twistd& T_root);
+
     // Odometry related methods
+    /*! Loads the URDF model used by the odometry. Does not use the WBI, so it can run outside of the control thread. initializeOdometry() loads the model itself if this was not called.
+     */
+    bool loadOdometryModel(const std::string& model_file);
     bool initializeOdometry(std::string model_file, std::string initialFixedFrame);
+
+    /*! Pose of the frame the odometry is fixed to, so that the odometry of another server goes on from it.
+     *  \return False if the odometry is not used.
+     */
+    bool getOdometryState(std::string& fixedFrame, iDynTree::Transform& world_H_fixedFrame);
+    bool setOdometryState(const std::string& fixedFrame, const iDynTree::Transform& world_H_fixedFrame);
+    std::string getFixedLinkForOdometry();
+    void setFixedLinkForOdometry(const std::string& fixedLink);
     std::vector<std::string> getCanonical_iCubJoints();
     // Not in the virtual class
     void rootFrameVelocity(Eigen::VectorXd& q,
@@ -66,7 +96,14 @@ private:
     wbi::Frame wbi_H_root;
     
     iDynTree::SimpleLeggedOdometry odometry;
-    
+    bool odometryModelIsLoaded;
+
+    std::shared_ptr<IcubControllerServer> robotStateSource; /*!< See followRobotState(). */
+    bool hasLastRobotState;
+    Eigen::VectorXd lastQ;
+    Eigen::VectorXd lastQd;
+    Eigen::Displacementd lastHRoot;
+    Eigen::Twistd lastTRoot;
 };
 
 #endif
@@ -0,0 +1,132 @@
+/*! \file       ReferenceArbiter.h
+ *  \brief      Decides which client drives each task when several clients send references to the same tasks.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_REFERENCE_ARBITER_H
+#define OCRA_CONTROLLER_SERVER_REFERENCE_ARBITER_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include <ocra/control/Task.h>
+#include <ocra/control/TaskState.h>
+#include <ocra-icub/Utilities.h>
+#include <ocra-icub/ArbitratedReference.h>
+#include <ocra-icub-server/IcubControllerServer.h>
+
+enum ARBITRATION_POLICY
+{
+    ARBITRATION_QUEUE,  /*!< References of lower priority clients are kept and the best one takes the task over when the owner releases it. */
+    ARBITRATION_REJECT  /*!< References of lower priority clients are dropped. */
+};
+
+/*! \class ReferenceArbiter
+ *  \brief Arbitrates the references sent by the clients on /ocra-icub-server/references:i (see ocra_icub::ArbitratedReference).
+ *
+ *  Every task has at most one owner. The first client which sends a reference for a free task owns it, and a client with a strictly higher priority preempts the owner. The references of the other clients are queued or rejected depending on the policy. When a task changes owner, its desired state is blended from the previous desired state to the reference of the new owner along a minimum jerk profile of the blend time of the new owner, so switching clients does not step the reference. An owner keeps its task until it releases it or, with an ownership timeout, until it stops sending references for that many ticks.
+ *
+ *  update() is called once per control tick, before the torques are computed. The pending references are read without blocking and the tasks are updated in one pass. The desired state of the owner is written at every tick, so the references other clients write directly to the task ports do not override it. The clients held by the ClientWatchdog lose their tasks through releaseClient(), so the hold of the watchdog is not overridden either. `acquired`, `preempted`, `queued`, `rejected`, `released` and `expired` events are written on /ocra-icub-server/arbitration/events:o.
+ */
+class ReferenceArbiter
+{
+CLASS_POINTER_TYPEDEFS(ReferenceArbiter)
+
+public:
+    /*! Constructor
+     *  \param server The controller server whose tasks are driven.
+     *  \param threadPeriod The control period in ms.
+     *  \param policy What to do with the references of the clients which do not own the task.
+     *  \param ownershipTimeout Number of ticks without reference after which an owner loses its task. 0 disables it.
+     */
+    ReferenceArbiter(std::shared_ptr<IcubControllerServer> server, int threadPeriod, ARBITRATION_POLICY policy, int ownershipTimeout);
+    virtual ~ReferenceArbiter();
+
+    bool open();
+    void close();
+
+    /*! Reads the pending references and updates the desired states of the arbitrated tasks. Call once per tick.
+     */
+    void update();
+
+    /*! \return The name of the client which owns the task, or an empty string.
+     */
+    std::string getOwner(const std::string& taskName) const;
+
+    /*! Drops the tasks owned and the references queued by a client, e.g. when the watchdog holds its tasks. The client takes its tasks back from its next reference.
+     */
+    void releaseClient(const std::string& clientName);
+
+private:
+    struct Claim
+    {
+        std::string clientName;
+        int priority = 0;
+        double blendTime = 0.0;
+        ocra::TaskState state;
+        int lastTick = 0;
+    };
+
+    struct TaskArbitration
+    {
+        std::shared_ptr<ocra::Task> task;
+        bool hasOwner = false;
+        Claim owner;
+        std::map<std::string, Claim> queued;
+        std::set<std::string> rejected;
+        ocra::TaskState blendStart;
+        int blendTicks = 0;
+        int blendTick = 0;
+    };
+
+    void readReferences();
+    void handleReference(const ocra_icub::ArbitratedReference& reference);
+    void handleRelease(TaskArbitration& arbitration, const ocra_icub::ArbitratedReference& reference);
+    void takeOver(TaskArbitration& arbitration, const Claim& claim);
+    void promoteQueued(const std::string& taskName, TaskArbitration& arbitration);
+    void updateTask(const std::string& taskName, TaskArbitration& arbitration);
+    void emitEvent(const std::string& eventType, const std::string& taskName, const std::string& clientName, const std::string& message);
+
+    /*! Blends the fields the two states have in common, the other fields are those of the target.
+     */
+    static ocra::TaskState blendStates(const ocra::TaskState& start, const ocra::TaskState& target, double s);
+
+private:
+    std::shared_ptr<IcubControllerServer> ctrlServer;
+    double period;
+    ARBITRATION_POLICY arbitrationPolicy;
+    int timeout;
+    int tick;
+
+    std::map<std::string, TaskArbitration> tasks;
+    yarp::os::BufferedPort<yarp::os::Bottle> referencePort;
+    yarp::os::BufferedPort<yarp::os::Bottle> eventPort;
+    bool portsAreOpen;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_REFERENCE_ARBITER_H
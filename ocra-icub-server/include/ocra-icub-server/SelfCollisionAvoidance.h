@@ -0,0 +1,158 @@
+/*! \file       SelfCollisionAvoidance.h
+ *  \brief      Keeps pairs of segments apart with capsule distance constraints inside the control loop.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_SELF_COLLISION_AVOIDANCE_H
+#define OCRA_CONTROLLER_SERVER_SELF_COLLISION_AVOIDANCE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <ocra/control/Model.h>
+#include <ocra/optim/LinearFunction.h>
+#include <ocra/optim/Constraint.h>
+#include <ocra-icub/Utilities.h>
+#include <ocra-icub-server/IcubControllerServer.h>
+
+/*! \class SelfCollisionAvoidance
+ *  \brief Attaches capsules to segments of the model and adds one inequality constraint per pair of capsules to the controller.
+ *
+ *  The capsules and the pairs to check are read from a configuration file (see selfCollision.ini in the robot directories):
+ *
+ *      activationDistance  0.05
+ *      safetyDistance      0.01
+ *      stiffness           200.0
+ *      damping             30.0
+ *      capsules ((name segment p0x p0y p0z p1x p1y p1z radius) ...)
+ *      pairs ((capsuleA capsuleB) ...)
+ *
+ *  The end points of a capsule are expressed in the frame of its segment. Pairs of adjacent segments, which always touch, should not be listed.
+ *
+ *  update() is called once per control tick, before the torques are computed. The model is only updated inside computeTorques(), so the distances are those of the state measured on the previous tick. A bounding sphere test discards the pairs which are further apart than the activation distance, so only the close pairs pay for the segment to segment distance and the Jacobians of their segments. For a close pair with distance d between the capsule surfaces, closest points pA and pB and normal n = (pA - pB)/|pA - pB|, the joint accelerations are constrained by
+ *
+ *      n^T (J_pA - J_pB) ddq >= -stiffness (d - safetyDistance) - damping dd/dt
+ *
+ *  which lets d decrease towards the safety distance but no further. The J_dot dq term is neglected and dd/dt is differentiated from the distance of the previous tick. The rows of the pairs which are far apart are disabled. All the matrices have a fixed size, so nothing is allocated once the constraint is added.
+ */
+class SelfCollisionAvoidance
+{
+CLASS_POINTER_TYPEDEFS(SelfCollisionAvoidance)
+
+public:
+    /*! Constructor
+     *  \param server The controller server whose controller receives the constraint.
+     *  \param threadPeriod The control period in ms.
+     */
+    SelfCollisionAvoidance(std::shared_ptr<IcubControllerServer> server, int threadPeriod);
+    virtual ~SelfCollisionAvoidance();
+
+    /*! Reads the capsules and pairs, checks the segment names against the model and adds the constraint to the controller.
+     *  \param configFilePath Path to the configuration file.
+     *  \return False if the file is invalid or a segment is unknown.
+     */
+    bool open(const std::string& configFilePath);
+    void close();
+
+    /*! Moves the constraint to the controller of another server, e.g. after a controller swap. The capsules are kept.
+     */
+    bool attach(std::shared_ptr<IcubControllerServer> server);
+
+    /*! Computes the distances of the pairs and updates the constraint. Call once per tick.
+     */
+    void update();
+
+    /*! \return The smallest distance between the surfaces of the capsules of a pair at the last update, or the activation distance if no pair was close.
+     */
+    double getMinimumDistance() const;
+
+    /*! \return The number of pairs closer than the activation distance at the last update.
+     */
+    int getNumberOfActivePairs() const;
+
+private:
+    struct Capsule
+    {
+        std::string name;
+        std::string segmentName;
+        int segmentIndex = -1;
+        Eigen::Vector3d localStart;
+        Eigen::Vector3d localEnd;
+        double radius = 0.0;
+
+        // World positions, updated once per tick.
+        Eigen::Vector3d start;
+        Eigen::Vector3d end;
+        Eigen::Vector3d center;
+        double boundingRadius = 0.0;
+    };
+
+    struct CapsulePair
+    {
+        int first = -1;
+        int second = -1;
+        bool wasActive = false;
+        double previousDistance = 0.0;
+    };
+
+    bool parseConfigFile(const std::string& configFilePath);
+    bool addConstraint();
+    void removeConstraint();
+    void updateCapsule(Capsule& capsule);
+    void pointJacobian(const Capsule& capsule, const Eigen::Vector3d& point, Eigen::MatrixXd& jacobian) const;
+
+    /*! Closest points between the segments [p0 p1] and [q0 q1].
+     */
+    static void closestPoints(const Eigen::Vector3d& p0, const Eigen::Vector3d& p1, const Eigen::Vector3d& q0, const Eigen::Vector3d& q1, Eigen::Vector3d& closestP, Eigen::Vector3d& closestQ);
+
+private:
+    std::shared_ptr<IcubControllerServer> ctrlServer;
+    std::shared_ptr<ocra::Model> model;
+    double period;
+
+    double activationDistance;
+    double safetyDistance;
+    double stiffness;
+    double damping;
+
+    std::vector<Capsule> capsules;
+    std::vector<CapsulePair> pairs;
+    std::vector<int> usedCapsules;
+
+    std::shared_ptr<ocra::LinearFunction> distanceFunction;
+    std::shared_ptr<ocra::LinearConstraint> distanceConstraint;
+    bool constraintIsAdded;
+
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
+    Eigen::MatrixXd jacobianA;
+    Eigen::MatrixXd jacobianB;
+
+    double minimumDistance;
+    int nActivePairs;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_SELF_COLLISION_AVOIDANCE_H
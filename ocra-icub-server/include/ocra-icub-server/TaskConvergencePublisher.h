@@ -0,0 +1,91 @@
+/*! \file       TaskConvergencePublisher.h
+ *  \brief      Publishes the errors and convergence flags of the active tasks on every control tick.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_TASK_CONVERGENCE_PUBLISHER_H
+#define OCRA_CONTROLLER_SERVER_TASK_CONVERGENCE_PUBLISHER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include <ocra/control/Task.h>
+#include <ocra-icub/Utilities.h>
+#include <ocra-icub/TaskConvergence.h>
+#include <ocra-icub-server/IcubControllerServer.h>
+
+/*! \class TaskConvergencePublisher
+ *  \brief Writes the errors of every active task (see ocra_icub::TaskConvergence) on /ocra-icub-server/convergence:o.
+ *
+ *  update() is called once per control tick, after the torques are computed, so the task states come from the model of this tick and nothing is fetched over the network. A joint space task is converged when its joint error is below the joint threshold, a Cartesian task when its translation and rotation errors are below the position and orientation thresholds, and both need their velocity error below the velocity threshold; clients which need another tolerance compare the errors themselves. Nothing is computed while no client is connected. The list of tasks is refreshed once per second, so tasks added by a client appear with at most that delay.
+ */
+class TaskConvergencePublisher
+{
+CLASS_POINTER_TYPEDEFS(TaskConvergencePublisher)
+
+public:
+    /*! Constructor
+     *  \param server The controller server whose tasks are monitored.
+     *  \param threadPeriod The control period in ms.
+     *  \param positionThreshold Translation error (m) below which a Cartesian task is converged.
+     *  \param orientationThreshold Rotation angle (rad) below which an orientation task is converged.
+     *  \param jointThreshold Joint error norm (rad) below which a joint space task is converged.
+     *  \param velocityThreshold Velocity error below which a task is converged.
+     */
+    TaskConvergencePublisher(std::shared_ptr<IcubControllerServer> server, int threadPeriod, double positionThreshold, double orientationThreshold, double jointThreshold, double velocityThreshold);
+    virtual ~TaskConvergencePublisher();
+
+    bool open();
+    void close();
+
+    /*! Computes the errors of the active tasks and publishes them. Call once per tick.
+     */
+    void update();
+
+    /*! Computes the errors of one task.
+     */
+    void computeConvergence(ocra::Task& task, ocra_icub::TaskConvergence& convergence) const;
+
+private:
+    void refreshTasks();
+
+private:
+    std::shared_ptr<IcubControllerServer> ctrlServer;
+    double positionTolerance;
+    double orientationTolerance;
+    double jointTolerance;
+    double velocityTolerance;
+    int refreshTicks;
+    int tick;
+
+    std::vector<std::pair<std::string, std::shared_ptr<ocra::Task> > > tasks;
+    ocra_icub::TaskConvergence convergence;
+    yarp::os::BufferedPort<yarp::os::Bottle> convergencePort;
+    bool portIsOpen;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_TASK_CONVERGENCE_PUBLISHER_H
@@ -0,0 +1,86 @@
+/*! \file       TaskSetValidator.h
+ *  \brief      Checks a task set xml file against the robot before the controller server creates the tasks.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_TASK_SET_VALIDATOR_H
+#define OCRA_CONTROLLER_SERVER_TASK_SET_VALIDATOR_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <wbi/wbi.h>
+#include <ocra-icub/Utilities.h>
+
+class TiXmlElement;
+
+/*! \class TaskSetValidator
+ *  \brief Validates a task set file against the schema used by ocra-recipes and against the joints and frames of the robot.
+ *
+ *  All the errors found in the file are collected and reported at once so that a broken task set is caught before the robot is put into torque control.
+ */
+class TaskSetValidator
+{
+CLASS_POINTER_TYPEDEFS(TaskSetValidator)
+
+public:
+    /*! \struct TaskSummary
+     *  \brief The name, type and segment of a validated task.
+     */
+    struct TaskSummary
+    {
+        std::string name;
+        std::string type;
+        std::string segment;
+    };
+
+    /*! Constructor
+     *  \param wbi The WBI whose joint and frame lists are used to check the task set. If it is null only the schema is checked.
+     */
+    TaskSetValidator(std::shared_ptr<wbi::wholeBodyInterface> wbi);
+    virtual ~TaskSetValidator();
+
+    /*! Validates the task set file.
+     *  \param taskSetPath Absolute path to the task set xml file.
+     *
+     *  \return True if the file can be used to create the tasks.
+     */
+    bool validate(const std::string& taskSetPath);
+
+    const std::vector<std::string>& getErrors() const;
+    const std::vector<std::string>& getWarnings() const;
+    const std::vector<TaskSummary>& getTasks() const;
+
+private:
+    void checkTask(TiXmlElement* taskElement, int taskNumber);
+    void checkNumericAttributes(TiXmlElement* element, const std::string& taskName);
+
+private:
+    std::shared_ptr<wbi::wholeBodyInterface> robot;
+    std::vector<std::string> errors;
+    std::vector<std::string> warnings;
+    std::vector<TaskSummary> tasks;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_TASK_SET_VALIDATOR_H
@@ -31,8 +31,17 @@
 #include <wbi/wbi.h>
 
 #include <ocra-icub-server/IcubControllerServer.h>
+#include <ocra-icub-server/TaskSetValidator.h>
+#include <ocra-icub-server/ClientWatchdog.h>
+#include <ocra-icub-server/GainScheduler.h>
+#include <ocra-icub-server/ContactTransitionManager.h>
+#include <ocra-icub-server/ReferenceArbiter.h>
+#include <ocra-icub-server/TaskConvergencePublisher.h>
+#include <ocra-icub-server/SelfCollisionAvoidance.h>
+#include <ocra-icub-server/ViableJointLimits.h>
 
 #include <ocra-icub/Utilities.h>
+#include <ocra-icub/PostureGenerator.h>
 #include <ocra/util/ErrorsHelper.h>
 
 #include <yarp/os/Bottle.h>
@@ -40,8 +49,13 @@
 #include <yarp/os/ConnectionReader.h>
 #include <yarp/os/Time.h>
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include <iDynTree/Estimation/SimpleLeggedOdometry.h>
 
@@ -81,6 +95,46 @@ public: // Variables
     double wDdq;
     double wTau;
     double wFc;
+
+    int                     modelUpdatePeriod; /*!< Number of ticks between two refreshes of the mass matrix of the model and its inverse. 1 refreshes them on every tick. */
+    double                  modelUpdateThreshold; /*!< Configuration drift which forces a refresh of the model before the period is over. <= 0 disables it. */
+
+    int                     watchdogTimeout; /*!< Number of ticks a client may miss its heartbeat before its tasks are taken over. 0 disables the watchdog. */
+    WATCHDOG_ACTION         watchdogAction; /*!< What the watchdog does with the tasks of a stalled client. */
+    double                  watchdogBlendTime; /*!< Duration in seconds of the blend to the home posture. */
+
+    ARBITRATION_POLICY      arbitrationPolicy; /*!< What the reference arbiter does with the references of the clients which do not own a task. */
+    int                     ownershipTimeout; /*!< Number of ticks without reference after which a client loses the tasks it owns. 0 disables it. */
+
+    double                  convergencePositionThreshold; /*!< Translation error (m) below which a Cartesian task is reported as converged. */
+    double                  convergenceOrientationThreshold; /*!< Rotation angle (rad) below which an orientation task is reported as converged. */
+    double                  convergenceJointThreshold; /*!< Joint error norm (rad) below which a joint space task is reported as converged. */
+    double                  convergenceVelocityThreshold; /*!< Velocity error below which a task is reported as converged. */
+
+    std::vector<std::vector<int> > coupledJointGroups; /*!< Joints which are mechanically coupled and can only be debugged together, e.g. the torso. */
+
+    double                  controllerSwapTolerance; /*!< Largest relative torque difference between the current and the new controller on the shadow tick for a swap to be accepted. */
+
+    std::string             selfCollisionConfigPath; /*!< Capsules and pairs of segments kept apart by the controller (see SelfCollisionAvoidance). Empty disables the self collision avoidance. */
+
+    bool                    useViableJointLimits; /*!< Bounds the joint accelerations so the joints can stop before their position limits (see ViableJointLimits). */
+    double                  jointVelocityLimit; /*!< Velocity limit of the joints (rad/s). */
+    double                  jointAccelerationLimit; /*!< Acceleration limit of the joints (rad/s^2). */
+    double                  jointLimitMargin; /*!< Distance to the position limits the joints keep free (rad). */
+};
+
+/*! \enum CONTROLLER_SWAP_STATUS
+ *  \brief Progress of a runtime change of controller type or solver.
+ */
+enum CONTROLLER_SWAP_STATUS
+{
+    SWAP_IDLE = 0,
+    SWAP_BUILDING,
+    SWAP_VERIFYING,
+    SWAP_SUCCEEDED,
+    SWAP_FAILED,
+    SWAP_REQUESTED, /*!< Waiting for the control thread to start the build. */
+    SWAP_INITIALIZING /*!< Built. Waiting for the control thread to initialize it and create its tasks. */
 };
 
 
@@ -165,8 +219,36 @@ private:
     void parseDebugMessage(yarp::os::Bottle& input, yarp::os::Bottle& reply);
     void writeDebugData();
     void putAnklesIntoIdle(double idleTime);
-    void sendTorqueReferenceToDebugJoint(int idx);
-    bool setDebugJointToTorqueMode(int idx);
+    std::vector<int> expandCoupledJoints(const std::vector<int>& joints);
+    bool setDebugJointsToTorqueMode(const std::vector<int>& joints);
+    void setDebugJointsToPositionMode(const std::vector<int>& joints);
+    void sendTorqueReferenceToDebugJoints();
+    std::string debugJointsToString(const std::vector<int>& joints);
+
+    std::shared_ptr<IcubControllerServer> createControllerServer(ocra_recipes::CONTROLLER_TYPE ctrlType, ocra_recipes::SOLVER_TYPE solver, bool usingInterprocessCommunication);
+    bool initializeControllerServer(std::shared_ptr<IcubControllerServer> server);
+
+    /*! Requests a controller of another type or with another solver. run() starts building it in the background, initializes it and creates its tasks on the next tick, then swaps it in once it has been verified on a shadow tick.
+     *  \param ctrlTypeString WOCRA or HOCRA.
+     *  \param solverString QUADPROG or QPOASES.
+     *  \param message Filled with a description of what was done.
+     *
+     *  \return True if the build was started.
+     */
+    bool startControllerSwap(const std::string& ctrlTypeString, const std::string& solverString, std::string& message);
+    void startShadowBuild();
+    void buildShadowController();
+    void initializeShadowController();
+    void runShadowTick();
+    /*! Pairs the tasks of ctrlServer with their copies in server.
+     *  \param missingTasks Filled with the tasks server has no copy of.
+     */
+    void pairTasks(std::shared_ptr<IcubControllerServer> server, const std::vector<std::string>& taskNames, std::vector<std::pair<std::shared_ptr<ocra::Task>, std::shared_ptr<ocra::Task> > >& taskPairs, std::vector<std::string>& missingTasks);
+    /*! Pairs the tasks again when the clients have added or removed tasks of ctrlServer after a swap.
+     */
+    void refreshActiveTaskPairs();
+    void mirrorTaskStates(const std::vector<std::pair<std::shared_ptr<ocra::Task>, std::shared_ptr<ocra::Task> > >& taskPairs);
+    void setControllerSwapStatus(CONTROLLER_SWAP_STATUS status, const std::string& message);
 
 private:
     ocra::Model::Ptr model;
@@ -191,7 +273,8 @@ private:
     yarp::os::RpcServer rpcServerPort; /*!< Rpc server port. */
 
     // Debugging related
-    int debugJointIndex;
+    std::vector<int> debugJoints; /*!< The joints in torque control, coupled joints included. */
+    Eigen::VectorXd debugReference; /*!< Torques of the debugged joints and the position held by the others, sent in a single write. */
     yarp::os::RpcServer debugRpcPort;
     yarp::os::Port debugRefOutPort;
     yarp::os::Port debugRealOutPort;
@@ -204,6 +287,30 @@ private:
     Eigen::Displacementd l_foot_disp_inverse; /*!< For gazebo visualization. You can't get the l_sole pose directly in gazebo, but you can get the l_foot, so since all poses from ocra::Model are calculated in the l_sole then we need to go from l_sole to l_foot.*/
 
     iDynTree::SimpleLeggedOdometry odometry; /*!< Odometry object */
+
+    ClientWatchdog::shared_ptr watchdog; /*!< Takes over the tasks of the clients which stop sending heartbeats. */
+    GainScheduler::shared_ptr gainScheduler; /*!< Interpolates the gain profiles sent by the clients. */
+    ContactTransitionManager::shared_ptr contactTransitions; /*!< Releases and acquires the contact tasks armed by the clients. */
+    ReferenceArbiter::shared_ptr referenceArbiter; /*!< Decides which client drives the tasks shared by several clients. */
+    TaskConvergencePublisher::shared_ptr convergencePublisher; /*!< Publishes the errors of the active tasks on every tick. */
+    SelfCollisionAvoidance::shared_ptr selfCollision; /*!< Constrains the distances between pairs of segments. Follows activeServer. */
+    ViableJointLimits::shared_ptr jointLimits; /*!< Bounds the joint accelerations from the joint limits. Follows activeServer. */
+
+    // Controller swap related
+    std::shared_ptr<IcubControllerServer> activeServer; /*!< The server whose controller computes the torques. It is ctrlServer until the first swap. ctrlServer always keeps the ports and the tasks the clients talk to, but after a swap it only publishes the state read by activeServer. */
+    std::shared_ptr<IcubControllerServer> shadowServer; /*!< The new controller while it is initialized and verified. */
+    std::shared_ptr<IcubControllerServer> retiredServer; /*!< The replaced or rejected controller. It is destroyed on the control thread when the next build starts, not in the middle of a swap. */
+    std::vector<std::pair<std::shared_ptr<ocra::Task>, std::shared_ptr<ocra::Task> > > activeTaskPairs; /*!< Tasks of ctrlServer and their copies in activeServer. */
+    std::vector<std::string> activeTaskNames; /*!< Tasks of ctrlServer when activeTaskPairs was made. */
+    std::vector<std::pair<std::shared_ptr<ocra::Task>, std::shared_ptr<ocra::Task> > > shadowTaskPairs; /*!< Tasks of ctrlServer and their copies in shadowServer. */
+    std::vector<std::string> shadowTaskNames; /*!< Tasks of ctrlServer when shadowTaskPairs was made. */
+    std::thread swapBuilder;
+    std::mutex swapMutex;
+    std::atomic<int> swapStatus;
+    std::string swapMessage;
+    ocra_recipes::CONTROLLER_TYPE swapControllerType;
+    ocra_recipes::SOLVER_TYPE swapSolver;
+    Eigen::VectorXd shadowTorques;
 };
 
 
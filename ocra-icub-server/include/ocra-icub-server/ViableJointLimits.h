@@ -0,0 +1,116 @@
+/*! \file       ViableJointLimits.h
+ *  \brief      Joint acceleration bounds which respect the position and velocity limits of the joints.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_CONTROLLER_SERVER_VIABLE_JOINT_LIMITS_H
+#define OCRA_CONTROLLER_SERVER_VIABLE_JOINT_LIMITS_H
+
+#include <memory>
+
+#include <Eigen/Dense>
+
+#include <ocra/control/Model.h>
+#include <ocra/optim/LinearFunction.h>
+#include <ocra/optim/Constraint.h>
+#include <ocra-icub/Utilities.h>
+#include <ocra-icub-server/IcubControllerServer.h>
+
+/*! \class ViableJointLimits
+ *  \brief Bounds the joint accelerations of the controller so that every joint can still stop before its position limits.
+ *
+ *  On every tick the bounds of each joint are the tightest of:
+ *
+ *  - the acceleration limit,
+ *  - the velocity limit reached in one period,
+ *  - the position limit (minus a margin) reached in one period,
+ *  - viability: after the period the joint must still be able to stop before the position limit when braking at the acceleration limit, i.e. dq^2 <= 2 ddq_max (q_max - q). This is the bound which slows fast motions down early enough.
+ *
+ *  When the state is already outside the viable set the bounds can cross. The joint then brakes as hard as allowed, which is the only way back into it.
+ *
+ *  The bounds are computed in one vectorised pass over preallocated arrays and written into a linear inequality constraint on the joint part of the acceleration variable. update() is called once per control tick, before the torques are computed, so it sees the state measured on the previous tick, which the margin accounts for.
+ */
+class ViableJointLimits
+{
+CLASS_POINTER_TYPEDEFS(ViableJointLimits)
+
+public:
+    /*! Constructor
+     *  \param server The controller server whose controller receives the constraint.
+     *  \param threadPeriod The control period in ms.
+     *  \param maxVelocity The velocity limit of the joints (rad/s).
+     *  \param maxAcceleration The acceleration limit of the joints (rad/s^2).
+     *  \param margin Distance to the position limits which is kept free (rad).
+     */
+    ViableJointLimits(std::shared_ptr<IcubControllerServer> server, int threadPeriod, double maxVelocity, double maxAcceleration, double margin);
+    virtual ~ViableJointLimits();
+
+    /*! Reads the joint limits of the model and adds the constraint to the controller.
+     */
+    bool open();
+    void close();
+
+    /*! Moves the constraint to the controller of another server, e.g. after a controller swap.
+     */
+    bool attach(std::shared_ptr<IcubControllerServer> server);
+
+    /*! Computes the bounds from the current joint state and updates the constraint. Call once per tick.
+     */
+    void update();
+
+    const Eigen::ArrayXd& getLowerAccelerationBounds() const;
+    const Eigen::ArrayXd& getUpperAccelerationBounds() const;
+
+    /*! Computes the acceleration bounds of a set of joints.
+     *  \param q, dq The joint positions and velocities.
+     *  \param qMin, qMax The position limits, margin included.
+     *  \param vMax, aMax The velocity and acceleration limits.
+     *  \param dt The control period (s).
+     *  \param[out] lower, upper The bounds. They must already have the size of q.
+     */
+    static void computeBounds(const Eigen::ArrayXd& q, const Eigen::ArrayXd& dq, const Eigen::ArrayXd& qMin, const Eigen::ArrayXd& qMax, double vMax, double aMax, double dt, Eigen::ArrayXd& lower, Eigen::ArrayXd& upper);
+
+private:
+    bool addConstraint();
+    void removeConstraint();
+
+private:
+    std::shared_ptr<IcubControllerServer> ctrlServer;
+    std::shared_ptr<ocra::Model> model;
+    double period;
+    double vMax;
+    double aMax;
+    double positionMargin;
+
+    Eigen::ArrayXd qMin;
+    Eigen::ArrayXd qMax;
+    Eigen::ArrayXd lower;
+    Eigen::ArrayXd upper;
+
+    std::shared_ptr<ocra::LinearFunction> boundFunction;
+    std::shared_ptr<ocra::LinearConstraint> boundConstraint;
+    bool constraintIsAdded;
+    Eigen::VectorXd b;
+};
+
+#endif // OCRA_CONTROLLER_SERVER_VIABLE_JOINT_LIMITS_H
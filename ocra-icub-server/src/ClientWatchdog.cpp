@@ -0,0 +1,245 @@
+/*! \file       ClientWatchdog.cpp
+ *  \brief      Detects stalled clients from their heartbeats and takes over their tasks.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/ClientWatchdog.h"
+
+#include <algorithm>
+
+#include <yarp/os/Time.h>
+#include <ocra/util/ErrorsHelper.h>
+#include <ocra-icub/ClientHeartbeat.h>
+
+
+ClientWatchdog::ClientWatchdog(std::shared_ptr<IcubControllerServer> server, int threadPeriod, int timeoutTicks, WATCHDOG_ACTION action, double blendTime, const Eigen::VectorXd& homePosture)
+: ctrlServer(server)
+, period(threadPeriod)
+, timeout(timeoutTicks)
+, watchdogAction(action)
+, blendTicks(std::max(1, int(blendTime * 1000.0 / threadPeriod)))
+, home(homePosture)
+, portsAreOpen(false)
+{
+}
+
+ClientWatchdog::~ClientWatchdog()
+{
+    close();
+}
+
+bool ClientWatchdog::open()
+{
+    // Several clients write on the same port so every heartbeat must be queued, not just the latest.
+    heartbeatPort.setStrict(true);
+    if (!heartbeatPort.open(ocra_icub::ClientHeartbeat::WATCHDOG_PORT_NAME)) {
+        OCRA_ERROR("Could not open " << ocra_icub::ClientHeartbeat::WATCHDOG_PORT_NAME)
+        return false;
+    }
+    if (!eventPort.open("/ocra-icub-server/watchdog/events:o")) {
+        OCRA_ERROR("Could not open /ocra-icub-server/watchdog/events:o")
+        heartbeatPort.close();
+        return false;
+    }
+    portsAreOpen = true;
+    return true;
+}
+
+void ClientWatchdog::close()
+{
+    if (portsAreOpen) {
+        heartbeatPort.interrupt();
+        heartbeatPort.close();
+        eventPort.interrupt();
+        eventPort.close();
+        portsAreOpen = false;
+    }
+}
+
+void ClientWatchdog::update()
+{
+    if (!portsAreOpen) {
+        return;
+    }
+
+    for (auto& client : clients) {
+        ++client.second.ticksSinceBeat;
+    }
+
+    readHeartbeats();
+
+    for (auto& client : clients) {
+        ClientRecord& record = client.second;
+        if (!record.hasTimedOut && record.ticksSinceBeat > timeout) {
+            takeOverClient(client.first, record);
+        }
+        if (record.hasTimedOut) {
+            updateHeldTasks(record);
+        }
+    }
+}
+
+int ClientWatchdog::getNumberOfStalledClients() const
+{
+    int nStalled = 0;
+    for (auto& client : clients) {
+        if (client.second.hasTimedOut) {
+            ++nStalled;
+        }
+    }
+    return nStalled;
+}
+
+std::vector<std::string> ClientWatchdog::getStalledClients() const
+{
+    std::vector<std::string> stalledClients;
+    for (auto& client : clients) {
+        if (client.second.hasTimedOut) {
+            stalledClients.push_back(client.first);
+        }
+    }
+    return stalledClients;
+}
+
+void ClientWatchdog::readHeartbeats()
+{
+    // Heartbeat format: (clientName sequence timestamp (taskNames...))
+    while (yarp::os::Bottle* beat = heartbeatPort.read(false)) {
+        if (beat->size() < 4 || !beat->get(0).isString()) {
+            continue;
+        }
+        std::string clientName = beat->get(0).asString();
+        ClientRecord& record = clients[clientName];
+
+        record.lastSequence = beat->get(1).asInt();
+        record.ticksSinceBeat = 0;
+        record.taskNames.clear();
+        yarp::os::Bottle* taskList = beat->get(3).asList();
+        if (taskList != NULL) {
+            for (int i=0; i<taskList->size(); ++i) {
+                record.taskNames.push_back(taskList->get(i).asString());
+            }
+        }
+
+        if (record.hasTimedOut) {
+            // The client drives its tasks again from its next references.
+            record.hasTimedOut = false;
+            releaseHeldTasks(record);
+            emitEvent("recovered", clientName, record);
+            OCRA_INFO("Client " << clientName << " is alive again.")
+        }
+    }
+}
+
+void ClientWatchdog::takeOverClient(const std::string& clientName, ClientRecord& client)
+{
+    client.hasTimedOut = true;
+    client.ticksSinceTimeout = 0;
+    client.heldTasks.clear();
+
+    for (auto taskName : client.taskNames) {
+        HeldTask held;
+        held.task = ctrlServer->getTask(taskName);
+        if (!held.task) {
+            OCRA_WARNING("Client " << clientName << " declared the task " << taskName << " which does not exist.")
+            continue;
+        }
+
+        ocra::TaskState measured = held.task->getTaskState();
+        held.blendPosture = (watchdogAction == WATCHDOG_BLEND_TO_HOME) && measured.hasQ() && (measured.getQ().size() == home.size());
+
+        ocra::TaskState frozen;
+        if (measured.hasQ()) {
+            held.startPosture = measured.getQ();
+            frozen.setQ(measured.getQ());
+            frozen.setQd(Eigen::VectorXd::Zero(measured.getQ().size()));
+            frozen.setQdd(Eigen::VectorXd::Zero(measured.getQ().size()));
+        }
+        if (measured.hasPosition()) {
+            frozen.setPosition(measured.getPosition());
+            frozen.setVelocity(Eigen::Twistd(0,0,0,0,0,0));
+            frozen.setAcceleration(Eigen::Twistd(0,0,0,0,0,0));
+        }
+        held.target = frozen;
+        if (held.blendPosture) {
+            held.target.setQ(home);
+        }
+        held.task->setDesiredTaskState(frozen);
+
+        // The trajectories and queued messages of the client would otherwise keep writing on the task.
+        held.portsClosed = held.task->closeControlPorts();
+        client.heldTasks.push_back(held);
+    }
+
+    emitEvent("timeout", clientName, client);
+    OCRA_WARNING("Client " << clientName << " missed its heartbeat for " << client.ticksSinceBeat << " ticks. Holding its " << client.heldTasks.size() << " tasks.")
+}
+
+void ClientWatchdog::updateHeldTasks(ClientRecord& client)
+{
+    ++client.ticksSinceTimeout;
+    bool isBlending = client.ticksSinceTimeout <= blendTicks;
+
+    // Minimum jerk blend from the posture at the timeout to the home posture.
+    double T = blendTicks * period / 1000.0;
+    double a = std::min(1.0, double(client.ticksSinceTimeout) / blendTicks);
+    double s = a*a*a*(10.0 - 15.0*a + 6.0*a*a);
+    double ds = 30.0*a*a*(1.0 - 2.0*a + a*a) / T;
+    double dds = 60.0*a*(1.0 - 3.0*a + 2.0*a*a) / (T*T);
+
+    // The held states are written at every tick until the client beats again, so nothing else can move the tasks meanwhile.
+    for (auto& held : client.heldTasks) {
+        if (held.blendPosture && isBlending) {
+            Eigen::VectorXd delta = home - held.startPosture;
+            ocra::TaskState desired;
+            desired.setQ(held.startPosture + s * delta);
+            desired.setQd(ds * delta);
+            desired.setQdd(dds * delta);
+            held.task->setDesiredTaskState(desired);
+        } else {
+            held.task->setDesiredTaskState(held.target);
+        }
+    }
+}
+
+void ClientWatchdog::releaseHeldTasks(ClientRecord& client)
+{
+    for (auto& held : client.heldTasks) {
+        if (held.portsClosed) {
+            held.task->openControlPorts();
+        }
+    }
+    client.heldTasks.clear();
+}
+
+void ClientWatchdog::emitEvent(const std::string& eventType, const std::string& clientName, const ClientRecord& client)
+{
+    yarp::os::Bottle& event = eventPort.prepare();
+    event.clear();
+    event.addString(eventType);
+    event.addString(clientName);
+    event.addDouble(yarp::os::Time::now());
+    event.addInt(client.ticksSinceBeat);
+    event.addInt(client.lastSequence);
+    eventPort.write();
+}
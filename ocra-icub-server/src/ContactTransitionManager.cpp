@@ -0,0 +1,314 @@
+/*! \file       ContactTransitionManager.cpp
+ *  \brief      Releases and acquires contact tasks when their load crosses the thresholds set by the clients.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/ContactTransitionManager.h"
+
+#include <algorithm>
+
+#include <yarp/os/Network.h>
+#include <yarp/os/Time.h>
+#include <ocra/util/ErrorsHelper.h>
+
+
+ContactTransitionManager::WrenchPort::WrenchPort()
+: latestForce(Eigen::Vector3d::Zero())
+, hasSample(false)
+{
+}
+
+void ContactTransitionManager::WrenchPort::onRead(yarp::sig::Vector& wrench)
+{
+    if (wrench.size() < 3) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(forceMutex);
+    latestForce = Eigen::Vector3d::Map(wrench.data());
+    hasSample = true;
+}
+
+bool ContactTransitionManager::WrenchPort::getForce(Eigen::Vector3d& force)
+{
+    std::lock_guard<std::mutex> lock(forceMutex);
+    force = latestForce;
+    return hasSample;
+}
+
+ContactTransitionManager::RulePort::RulePort(ContactTransitionManager& transitionManager)
+: manager(transitionManager)
+{
+}
+
+void ContactTransitionManager::RulePort::onRead(yarp::os::Bottle& bottle)
+{
+    manager.receiveRule(bottle);
+}
+
+ContactTransitionManager::ContactTransitionManager(std::shared_ptr<IcubControllerServer> server)
+: ctrlServer(server)
+, wrenchPortCount(0)
+, rulePort(*this)
+, portsAreOpen(false)
+{
+}
+
+ContactTransitionManager::~ContactTransitionManager()
+{
+    close();
+}
+
+bool ContactTransitionManager::open()
+{
+    // Every client writes on the same port and each rule is sent only once.
+    rulePort.setStrict(true);
+    if (!rulePort.open(ocra_icub::ContactTransitionSender::SERVER_PORT_NAME)) {
+        OCRA_ERROR("Could not open " << ocra_icub::ContactTransitionSender::SERVER_PORT_NAME)
+        return false;
+    }
+    if (!eventPort.open("/ocra-icub-server/contacts/events:o")) {
+        OCRA_ERROR("Could not open /ocra-icub-server/contacts/events:o")
+        rulePort.close();
+        return false;
+    }
+    rulePort.useCallback();
+    portsAreOpen = true;
+    return true;
+}
+
+void ContactTransitionManager::close()
+{
+    if (!portsAreOpen) {
+        return;
+    }
+    rulePort.disableCallback();
+    rulePort.interrupt();
+    rulePort.close();
+    eventPort.interrupt();
+    eventPort.close();
+    portsAreOpen = false;
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    for (auto& armed : rules) {
+        retiredWrenchPorts.push_back(armed.second.wrenchPort);
+    }
+    for (auto& armed : pendingRules) {
+        retiredWrenchPorts.push_back(armed.wrenchPort);
+    }
+    for (auto wrenchPort : retiredWrenchPorts) {
+        if (wrenchPort) {
+            wrenchPort->disableCallback();
+            wrenchPort->close();
+        }
+    }
+    rules.clear();
+    pendingRules.clear();
+    retiredWrenchPorts.clear();
+}
+
+void ContactTransitionManager::update()
+{
+    if (!portsAreOpen) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (auto& armed : pendingRules) {
+            auto previous = rules.find(armed.rule.taskName);
+            if (previous != rules.end()) {
+                retiredWrenchPorts.push_back(previous->second.wrenchPort);
+                rules.erase(previous);
+            }
+            if (armed.rule.mode != ocra_icub::CONTACT_DISARM) {
+                // The hysteresis starts from the current state of the task.
+                armed.loaded = armed.task->isActivated();
+                armed.wasConstraint = armed.task->isActiveAsConstraint();
+                rules[armed.rule.taskName] = armed;
+            }
+        }
+        pendingRules.clear();
+    }
+
+    for (auto it = rules.begin(); it != rules.end(); ) {
+        ArmedRule& armed = it->second;
+        double load;
+        bool fired = false;
+        if (measureLoad(armed, load)) {
+            bool loaded = armed.loaded ? (load > armed.rule.releaseLoad) : (load > armed.rule.acquireLoad);
+            if (loaded == armed.loaded) {
+                armed.pendingTicks = 0;
+            } else if (++armed.pendingTicks >= armed.rule.holdTicks) {
+                armed.pendingTicks = 0;
+                armed.loaded = loaded;
+                bool canRelease = armed.rule.mode == ocra_icub::CONTACT_RELEASE || armed.rule.mode == ocra_icub::CONTACT_RELEASE_AND_ACQUIRE;
+                bool canAcquire = armed.rule.mode == ocra_icub::CONTACT_ACQUIRE || armed.rule.mode == ocra_icub::CONTACT_RELEASE_AND_ACQUIRE;
+                if (!loaded && canRelease && armed.task->isActivated()) {
+                    armed.wasConstraint = armed.task->isActiveAsConstraint();
+                    armed.task->deactivate();
+                    emitEvent("released", it->first, load, "");
+                    fired = true;
+                } else if (loaded && canAcquire && !armed.task->isActivated()) {
+                    if (armed.wasConstraint) {
+                        armed.task->activateAsConstraint();
+                    } else {
+                        armed.task->activateAsObjective();
+                    }
+                    emitEvent("acquired", it->first, load, "");
+                    fired = true;
+                }
+            }
+        }
+        if (fired && armed.rule.oneShot) {
+            retireWrenchPort(armed.wrenchPort);
+            it = rules.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int ContactTransitionManager::getNumberOfArmedRules() const
+{
+    return rules.size();
+}
+
+void ContactTransitionManager::receiveRule(const yarp::os::Bottle& bottle)
+{
+    // Ports of replaced rules are closed here since closing a port may block for a while.
+    std::vector<std::shared_ptr<WrenchPort> > closing;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        closing.swap(retiredWrenchPorts);
+    }
+    for (auto wrenchPort : closing) {
+        if (wrenchPort) {
+            wrenchPort->disableCallback();
+            wrenchPort->close();
+        }
+    }
+
+    ocra_icub::ContactTransitionRule rule;
+    ArmedRule armed;
+    std::string reason;
+    if (!rule.fromBottle(bottle)) {
+        emitEvent("rejected", rule.taskName, 0.0, "malformed rule");
+        OCRA_WARNING("Rejected a malformed contact transition rule: " << bottle.toString())
+        return;
+    }
+    if (!armRule(rule, armed, reason)) {
+        emitEvent("rejected", rule.taskName, 0.0, reason);
+        OCRA_WARNING("Rejected the contact transition rule of " << rule.taskName << ": " << reason)
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pendingRules.push_back(armed);
+    emitEvent(rule.mode == ocra_icub::CONTACT_DISARM ? "disarmed" : "armed", rule.taskName, 0.0, rule.wrenchSource);
+}
+
+bool ContactTransitionManager::armRule(const ocra_icub::ContactTransitionRule& rule, ArmedRule& armed, std::string& reason)
+{
+    armed.rule = rule;
+    armed.task = ctrlServer->getTask(rule.taskName);
+    if (!armed.task) {
+        reason = "unknown task";
+        return false;
+    }
+    if (rule.mode == ocra_icub::CONTACT_DISARM) {
+        return true;
+    }
+    if (!(rule.releaseLoad < rule.acquireLoad)) {
+        reason = "the release load must be smaller than the acquisition load";
+        return false;
+    }
+    if (rule.loadAxis.norm() < 1e-6 || !rule.loadAxis.allFinite()) {
+        reason = "invalid load axis";
+        return false;
+    }
+    armed.rule.loadAxis.normalize();
+    armed.rule.holdTicks = std::max(1, rule.holdTicks);
+
+    if (rule.wrenchSource == ocra_icub::ContactTransitionRule::MODEL_WRENCH_SOURCE) {
+        if (rule.mode != ocra_icub::CONTACT_RELEASE) {
+            reason = "acquiring a contact needs a measured wrench";
+            return false;
+        }
+        return true;
+    }
+
+    armed.wrenchPort = std::make_shared<WrenchPort>();
+    std::string portName = "/ocra-icub-server/contacts/" + rule.taskName + "/wrench" + std::to_string(wrenchPortCount++) + ":i";
+    if (!armed.wrenchPort->open(portName)) {
+        reason = "could not open " + portName;
+        return false;
+    }
+    armed.wrenchPort->useCallback();
+    if (!yarp::os::Network::connect(rule.wrenchSource, portName)) {
+        armed.wrenchPort->disableCallback();
+        armed.wrenchPort->close();
+        reason = "could not connect " + rule.wrenchSource + " to " + portName;
+        return false;
+    }
+    return true;
+}
+
+bool ContactTransitionManager::measureLoad(ArmedRule& armed, double& load)
+{
+    Eigen::Vector3d force;
+    if (armed.wrenchPort) {
+        if (!armed.wrenchPort->getForce(force)) {
+            return false;
+        }
+    } else {
+        // Contact force computed by the solver on the previous tick.
+        const Eigen::VectorXd& computedForce = armed.task->getComputedForce();
+        if (computedForce.size() < 3) {
+            return false;
+        }
+        force = computedForce.head<3>();
+    }
+    load = armed.rule.loadAxis.dot(force);
+    return true;
+}
+
+void ContactTransitionManager::retireWrenchPort(std::shared_ptr<WrenchPort> wrenchPort)
+{
+    if (wrenchPort) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        retiredWrenchPorts.push_back(wrenchPort);
+    }
+}
+
+void ContactTransitionManager::emitEvent(const std::string& eventType, const std::string& taskName, double load, const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(eventMutex);
+    yarp::os::Bottle& event = eventPort.prepare();
+    event.clear();
+    event.addString(eventType);
+    event.addString(taskName);
+    event.addDouble(yarp::os::Time::now());
+    event.addDouble(load);
+    event.addString(message);
+    eventPort.write();
+}
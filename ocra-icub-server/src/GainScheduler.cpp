@@ -0,0 +1,175 @@
+/*! \file       GainScheduler.cpp
+ *  \brief      Interpolates the gain profiles sent by the clients inside the control loop.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/GainScheduler.h"
+
+#include <yarp/os/Time.h>
+#include <ocra/util/ErrorsHelper.h>
+
+
+GainScheduler::GainScheduler(std::shared_ptr<IcubControllerServer> server, int threadPeriod)
+: ctrlServer(server)
+, period(threadPeriod / 1000.0)
+, portsAreOpen(false)
+{
+}
+
+GainScheduler::~GainScheduler()
+{
+    close();
+}
+
+bool GainScheduler::open()
+{
+    // Every client writes on the same port and each profile is sent only once.
+    profilePort.setStrict(true);
+    if (!profilePort.open(ocra_icub::GainProfileSender::SERVER_PORT_NAME)) {
+        OCRA_ERROR("Could not open " << ocra_icub::GainProfileSender::SERVER_PORT_NAME)
+        return false;
+    }
+    if (!eventPort.open("/ocra-icub-server/gains/events:o")) {
+        OCRA_ERROR("Could not open /ocra-icub-server/gains/events:o")
+        profilePort.close();
+        return false;
+    }
+    portsAreOpen = true;
+    return true;
+}
+
+void GainScheduler::close()
+{
+    if (portsAreOpen) {
+        profilePort.interrupt();
+        profilePort.close();
+        eventPort.interrupt();
+        eventPort.close();
+        portsAreOpen = false;
+    }
+}
+
+void GainScheduler::update()
+{
+    if (!portsAreOpen) {
+        return;
+    }
+
+    readProfiles();
+
+    for (auto it = profiles.begin(); it != profiles.end(); ) {
+        RunningProfile& running = it->second;
+        ++running.ticks;
+        double s = running.profile.progress(running.ticks * period);
+        if (running.startStiffness.size() > 0) {
+            running.task->setStiffness(running.startStiffness + s * (running.profile.stiffness - running.startStiffness));
+        }
+        if (running.startDamping.size() > 0) {
+            running.task->setDamping(running.startDamping + s * (running.profile.damping - running.startDamping));
+        }
+        if (s >= 1.0) {
+            emitEvent("finished", it->first, "");
+            it = profiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int GainScheduler::getNumberOfRunningProfiles() const
+{
+    return profiles.size();
+}
+
+void GainScheduler::readProfiles()
+{
+    while (yarp::os::Bottle* bottle = profilePort.read(false)) {
+        ocra_icub::GainProfile profile;
+        std::string reason;
+        if (!profile.fromBottle(*bottle)) {
+            emitEvent("rejected", profile.taskName, "malformed profile");
+            OCRA_WARNING("Rejected a malformed gain profile: " << bottle->toString())
+        } else if (!startProfile(profile, reason)) {
+            emitEvent("rejected", profile.taskName, reason);
+            OCRA_WARNING("Rejected the gain profile of " << profile.taskName << ": " << reason)
+        }
+    }
+}
+
+bool GainScheduler::startProfile(const ocra_icub::GainProfile& profile, std::string& reason)
+{
+    RunningProfile running;
+    running.task = ctrlServer->getTask(profile.taskName);
+    if (!running.task) {
+        reason = "unknown task";
+        return false;
+    }
+
+    // A new profile for the same task starts from the gains reached by the previous one.
+    running.profile = profile;
+    if (profile.stiffness.size() > 0) {
+        running.startStiffness = running.task->getStiffness();
+        if (!expandTarget(profile.stiffness, running.startStiffness, running.profile.stiffness)) {
+            reason = "the stiffness must be 1x1 or " + std::to_string(running.startStiffness.rows()) + "x" + std::to_string(running.startStiffness.cols());
+            return false;
+        }
+    }
+    if (profile.damping.size() > 0) {
+        running.startDamping = running.task->getDamping();
+        if (!expandTarget(profile.damping, running.startDamping, running.profile.damping)) {
+            reason = "the damping must be 1x1 or " + std::to_string(running.startDamping.rows()) + "x" + std::to_string(running.startDamping.cols());
+            return false;
+        }
+    }
+    if (!running.profile.stiffness.allFinite() || !running.profile.damping.allFinite()) {
+        reason = "the gains are not finite";
+        return false;
+    }
+
+    profiles[profile.taskName] = running;
+    return true;
+}
+
+bool GainScheduler::expandTarget(const Eigen::MatrixXd& target, const Eigen::MatrixXd& current, Eigen::MatrixXd& expanded) const
+{
+    if (target.rows() == 1 && target.cols() == 1) {
+        expanded = target(0,0) * Eigen::MatrixXd::Identity(current.rows(), current.cols());
+        return true;
+    }
+    if (target.rows() == current.rows() && target.cols() == current.cols()) {
+        expanded = target;
+        return true;
+    }
+    return false;
+}
+
+void GainScheduler::emitEvent(const std::string& eventType, const std::string& taskName, const std::string& message)
+{
+    yarp::os::Bottle& event = eventPort.prepare();
+    event.clear();
+    event.addString(eventType);
+    event.addString(taskName);
+    event.addDouble(yarp::os::Time::now());
+    event.addString(message);
+    eventPort.write();
+}
@@ -19,6 +19,8 @@ IcubControllerServer::IcubControllerServer( std::shared_ptr<wbi::wholeBodyInterf
 , isFloatingBase(usingFloatingBase)
 , useOdometry(useOdometry)
 , nDoF(wbi->getDoFs())
+, hasLastRobotState(false)
+, odometryModelIsLoaded(false)
 {
     wbi_H_root = wbi::Frame();
 
@@ -36,8 +38,53 @@ ocra::Model::Ptr IcubControllerServer::loadRobotModel()
     return std::make_shared<ocra_icub::OcraWbiModel>(robotName, wbi->getDoFs(), wbi, isFloatingBase);
 }
 
+std::shared_ptr<ocra::Task> IcubControllerServer::getTask(const std::string& taskName)
+{
+    try {
+        return controller->getTask(taskName);
+    } catch (const std::exception& e) {
+        return std::shared_ptr<ocra::Task>();
+    }
+}
+
+std::vector<std::string> IcubControllerServer::getTaskNames()
+{
+    return controller->getTaskNames();
+}
+
+void IcubControllerServer::addConstraint(ocra::LinearConstraint& constraint)
+{
+    controller->addConstraint(constraint);
+}
+
+void IcubControllerServer::removeConstraint(ocra::LinearConstraint& constraint)
+{
+    controller->removeConstraint(constraint);
+}
+
+void IcubControllerServer::followRobotState(std::shared_ptr<IcubControllerServer> source)
+{
+    robotStateSource = source;
+}
+
+bool IcubControllerServer::getLastRobotState(Eigen::VectorXd& q, Eigen::VectorXd& qd, Eigen::Displacementd& H_root, Eigen::Twistd& T_root)
+{
+    if (!hasLastRobotState) {
+        return false;
+    }
+    q = lastQ;
+    qd = lastQd;
+    H_root = lastHRoot;
+    T_root = lastTRoot;
+    return true;
+}
+
 void IcubControllerServer::getRobotState(Eigen::VectorXd& q, Eigen::VectorXd& qd, Eigen::Displacementd& H_root, Eigen::Twistd& T_root)
 {
+    if (robotStateSource && robotStateSource->getLastRobotState(q, qd, H_root, T_root)) {
+        return;
+    }
+
     // OCRA_INFO("Getting robot state");
     q.resize(nDoF);
     qd.resize(nDoF);
@@ -109,9 +156,15 @@ void IcubControllerServer::getRobotState(Eigen::VectorXd& q, Eigen::VectorXd& qd
                                 wbi_T_root_Vector[1],
                                 wbi_T_root_Vector[2]);
     }
+
+    lastQ = q;
+    lastQd = qd;
+    lastHRoot = H_root;
+    lastTRoot = T_root;
+    hasLastRobotState = true;
 }
 
-bool IcubControllerServer::initializeOdometry(std::string model_file, std::string initialFixedFrame)
+bool IcubControllerServer::loadOdometryModel(const std::string& model_file)
 {
     // The URDF file has mode joints than those used by the yarpWholeBodyInterface, and these two should match. Therefore, the following method creates a list of joints as those that constitute ROBOT_MAIN_JOINTS in yarpWholeBodyInterface.ini
     std::vector<std::string> consideredJoints = getCanonical_iCubJoints();
@@ -119,6 +172,15 @@ bool IcubControllerServer::initializeOdometry(std::string model_file, std::strin
         std::cout << "[ERROR] icubcontrollerServer::initializeOdometry  Could not load URDF model of the robot from the specified path: " << model_file << std::endl;
         return false;
     }
+    odometryModelIsLoaded = true;
+    return true;
+}
+
+bool IcubControllerServer::initializeOdometry(std::string model_file, std::string initialFixedFrame)
+{
+    if (!odometryModelIsLoaded && !loadOdometryModel(model_file)) {
+        return false;
+    }
 
     // Build a JointPosDoubleArray
     iDynTree::JointPosDoubleArray qj(wbi->getDoFs());
@@ -153,6 +215,41 @@ bool IcubControllerServer::initializeOdometry(std::string model_file, std::strin
     return true;
 }
 
+bool IcubControllerServer::getOdometryState(std::string& fixedFrame, iDynTree::Transform& world_H_fixedFrame)
+{
+    if (!useOdometry) {
+        return false;
+    }
+    this->controller->getFixedLinkForOdometry(fixedFrame);
+    iDynTree::FrameIndex frameIndex = odometry.model().getFrameIndex(fixedFrame);
+    if (frameIndex == iDynTree::FRAME_INVALID_INDEX) {
+        return false;
+    }
+    world_H_fixedFrame = odometry.getWorldFrameTransform(frameIndex);
+    return true;
+}
+
+bool IcubControllerServer::setOdometryState(const std::string& fixedFrame, const iDynTree::Transform& world_H_fixedFrame)
+{
+    if (!useOdometry) {
+        return false;
+    }
+    this->controller->setFixedLinkForOdometry(fixedFrame);
+    return odometry.init(fixedFrame, world_H_fixedFrame);
+}
+
+std::string IcubControllerServer::getFixedLinkForOdometry()
+{
+    std::string fixedLink;
+    this->controller->getFixedLinkForOdometry(fixedLink);
+    return fixedLink;
+}
+
+void IcubControllerServer::setFixedLinkForOdometry(const std::string& fixedLink)
+{
+    this->controller->setFixedLinkForOdometry(fixedLink);
+}
+
 std::vector<std::string> IcubControllerServer::getCanonical_iCubJoints()
 {
     std::vector<std::string> consideredJoints;
@@ -74,6 +74,76 @@ bool Module::configure(yarp::os::ResourceFinder &rf)
         controller_options.wFc = rf.find("wFc").asDouble();
     }
 
+    if ( rf.check("modelUpdatePeriod") ) {
+        controller_options.modelUpdatePeriod = rf.find("modelUpdatePeriod").asInt();
+    }
+    if ( rf.check("modelUpdateThreshold") ) {
+        controller_options.modelUpdateThreshold = rf.find("modelUpdateThreshold").asDouble();
+    }
+
+    if ( rf.check("watchdogTimeout") ) {
+        controller_options.watchdogTimeout = rf.find("watchdogTimeout").asInt();
+    }
+    if ( rf.check("watchdogAction") ) {
+        std::string actionString = rf.find("watchdogAction").asString().c_str();
+        std::transform(actionString.begin(), actionString.end(), actionString.begin(), toupper);
+        if (actionString == "HOME") {
+            controller_options.watchdogAction = WATCHDOG_BLEND_TO_HOME;
+        } else {
+            controller_options.watchdogAction = WATCHDOG_FREEZE;
+        }
+    }
+    if ( rf.check("watchdogBlendTime") ) {
+        controller_options.watchdogBlendTime = rf.find("watchdogBlendTime").asDouble();
+    }
+
+    if ( rf.check("arbitrationPolicy") ) {
+        std::string policyString = rf.find("arbitrationPolicy").asString().c_str();
+        std::transform(policyString.begin(), policyString.end(), policyString.begin(), toupper);
+        if (policyString == "REJECT") {
+            controller_options.arbitrationPolicy = ARBITRATION_REJECT;
+        } else {
+            controller_options.arbitrationPolicy = ARBITRATION_QUEUE;
+        }
+    }
+    if ( rf.check("ownershipTimeout") ) {
+        controller_options.ownershipTimeout = rf.find("ownershipTimeout").asInt();
+    }
+
+    if ( rf.check("convergencePositionThreshold") ) {
+        controller_options.convergencePositionThreshold = rf.find("convergencePositionThreshold").asDouble();
+    }
+    if ( rf.check("convergenceOrientationThreshold") ) {
+        controller_options.convergenceOrientationThreshold = rf.find("convergenceOrientationThreshold").asDouble();
+    }
+    if ( rf.check("convergenceJointThreshold") ) {
+        controller_options.convergenceJointThreshold = rf.find("convergenceJointThreshold").asDouble();
+    }
+    if ( rf.check("convergenceVelocityThreshold") ) {
+        controller_options.convergenceVelocityThreshold = rf.find("convergenceVelocityThreshold").asDouble();
+    }
+
+    if ( rf.check("coupledJoints") ) {
+        yarp::os::Bottle* groupList = rf.find("coupledJoints").asList();
+        if (groupList) {
+            controller_options.coupledJointGroups.clear();
+            for (int i=0; i<groupList->size(); ++i) {
+                yarp::os::Bottle* group = groupList->get(i).asList();
+                if (group) {
+                    std::vector<int> indexes;
+                    for (int j=0; j<group->size(); ++j) {
+                        indexes.push_back(group->get(j).asInt());
+                    }
+                    controller_options.coupledJointGroups.push_back(indexes);
+                }
+            }
+        }
+    }
+
+    if ( rf.check("controllerSwapTolerance") ) {
+        controller_options.controllerSwapTolerance = rf.find("controllerSwapTolerance").asDouble();
+    }
+
     if( rf.check("solver") )
     {
         std::string solverString = rf.find("solver").asString().c_str();
@@ -137,6 +207,24 @@ bool Module::configure(yarp::os::ResourceFinder &rf)
         }
     }
 
+    if ( rf.check("selfCollision") ) {
+        controller_options.selfCollisionConfigPath = rf.findFileByName(rf.find("selfCollision").asString()).c_str();
+        if (controller_options.selfCollisionConfigPath.empty()) {
+            OCRA_WARNING("Could not find the self collision configuration file " << rf.find("selfCollision").asString() << ". Self collision avoidance is disabled.")
+        }
+    }
+
+    controller_options.useViableJointLimits = rf.check("viableJointLimits");
+    if ( rf.check("jointVelocityLimit") ) {
+        controller_options.jointVelocityLimit = rf.find("jointVelocityLimit").asDouble();
+    }
+    if ( rf.check("jointAccelerationLimit") ) {
+        controller_options.jointAccelerationLimit = rf.find("jointAccelerationLimit").asDouble();
+    }
+    if ( rf.check("jointLimitMargin") ) {
+        controller_options.jointLimitMargin = rf.find("jointLimitMargin").asDouble();
+    }
+
     if( rf.check("sequence") )
     {
         controller_options.startupSequence = rf.find("sequence").asString().c_str();
@@ -267,4 +355,22 @@ void Module::printHelp()
     std::cout << "\t--useOdometry :This will enable odometry leavint the world reference frame attached a non-moving point." << std::endl;
     std::cout << "\t--idleAnkles :Tells the controller to idle the ankles for a short period and then pass on to normal operation. This is to get the feet flush with the ground." << std::endl;
     std::cout << "\t--maintainFinalPosture :Tells the controller to stay in its final posture when the controller is switched to position mode at the end of usage." << std::endl;
+    std::cout << "\t--watchdogTimeout :Number of ticks a client publishing heartbeats may miss before the server takes over its tasks. 0 disables the watchdog. Defaults to 20." << std::endl;
+    std::cout << "\t--watchdogAction :What to do with the tasks of a stalled client. FREEZE holds them at their measured state, HOME also brings the full posture tasks back to the balanced double support posture of the posture cache, or to the initial posture if none is found. Defaults to FREEZE." << std::endl;
+    std::cout << "\t--watchdogBlendTime :Duration in seconds of the blend to the home posture with --watchdogAction HOME. Defaults to 2.0." << std::endl;
+    std::cout << "\t--arbitrationPolicy :What to do with the arbitrated references of a client which does not own the task and has no higher priority than its owner. QUEUE keeps them until the owner releases the task, REJECT drops them. Defaults to QUEUE." << std::endl;
+    std::cout << "\t--ownershipTimeout :Number of ticks without arbitrated reference after which a client loses the tasks it owns. 0 disables it. Defaults to 100." << std::endl;
+    std::cout << "\t--convergencePositionThreshold :Translation error (m) below which a Cartesian task is reported as converged on /ocra-icub-server/convergence:o. Defaults to 0.01." << std::endl;
+    std::cout << "\t--convergenceOrientationThreshold :Rotation angle (rad) below which an orientation task is reported as converged on /ocra-icub-server/convergence:o. Defaults to 0.05." << std::endl;
+    std::cout << "\t--convergenceJointThreshold :Joint error norm (rad) below which a joint space task is reported as converged on /ocra-icub-server/convergence:o. Defaults to 0.05." << std::endl;
+    std::cout << "\t--convergenceVelocityThreshold :Velocity error below which a task is reported as converged on /ocra-icub-server/convergence:o. Defaults to 0.01." << std::endl;
+    std::cout << "\t--coupledJoints :Groups of joint indexes which can only be put into torque mode together in debug mode, e.g. \"((0 1 2))\". Defaults to the torso, ((0 1 2))." << std::endl;
+    std::cout << "\t--controllerSwapTolerance :Largest relative torque difference between the running and the new controller on the shadow tick of a SWAP_CONTROLLER rpc request. Defaults to 0.5." << std::endl;
+    std::cout << "\t--modelUpdatePeriod :Number of control ticks between two refreshes of the mass matrix and its inverse. The Jacobians, segment velocities, bias forces and the CoM are always computed from the current state. Defaults to 1 (every tick)." << std::endl;
+    std::cout << "\t--modelUpdateThreshold :Configuration drift (rad) since the last refresh which forces a new one before modelUpdatePeriod is over. Defaults to 0 (disabled)." << std::endl;
+    std::cout << "\t--selfCollision :Name of a file listing capsules attached to the segments and the pairs of capsules the controller keeps apart, e.g. selfCollision.ini. Disabled by default." << std::endl;
+    std::cout << "\t--viableJointLimits :Bounds the joint accelerations on every tick so that the joints can always stop before their position limits, given the velocity and acceleration limits below." << std::endl;
+    std::cout << "\t--jointVelocityLimit :Velocity limit of the joints (rad/s) used with --viableJointLimits. Defaults to 3.0." << std::endl;
+    std::cout << "\t--jointAccelerationLimit :Acceleration limit of the joints (rad/s^2) used with --viableJointLimits. Defaults to 30.0." << std::endl;
+    std::cout << "\t--jointLimitMargin :Distance to the position limits (rad) the joints keep free with --viableJointLimits. Defaults to 0.02." << std::endl;
 }
@@ -0,0 +1,292 @@
+/*! \file       ReferenceArbiter.cpp
+ *  \brief      Decides which client drives each task when several clients send references to the same tasks.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/ReferenceArbiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <yarp/os/Time.h>
+#include <ocra/util/ErrorsHelper.h>
+
+
+ReferenceArbiter::ReferenceArbiter(std::shared_ptr<IcubControllerServer> server, int threadPeriod, ARBITRATION_POLICY policy, int ownershipTimeout)
+: ctrlServer(server)
+, period(threadPeriod / 1000.0)
+, arbitrationPolicy(policy)
+, timeout(ownershipTimeout)
+, tick(0)
+, portsAreOpen(false)
+{
+}
+
+ReferenceArbiter::~ReferenceArbiter()
+{
+    close();
+}
+
+bool ReferenceArbiter::open()
+{
+    // Releases are sent once, so none of the references may be dropped.
+    referencePort.setStrict(true);
+    if (!referencePort.open(ocra_icub::ArbitratedReferenceSender::SERVER_PORT_NAME)) {
+        OCRA_ERROR("Could not open " << ocra_icub::ArbitratedReferenceSender::SERVER_PORT_NAME)
+        return false;
+    }
+    if (!eventPort.open("/ocra-icub-server/arbitration/events:o")) {
+        OCRA_ERROR("Could not open /ocra-icub-server/arbitration/events:o")
+        referencePort.close();
+        return false;
+    }
+    portsAreOpen = true;
+    return true;
+}
+
+void ReferenceArbiter::close()
+{
+    if (portsAreOpen) {
+        referencePort.interrupt();
+        referencePort.close();
+        eventPort.interrupt();
+        eventPort.close();
+        portsAreOpen = false;
+    }
+}
+
+void ReferenceArbiter::update()
+{
+    if (!portsAreOpen) {
+        return;
+    }
+
+    ++tick;
+    readReferences();
+
+    for (auto& entry : tasks) {
+        updateTask(entry.first, entry.second);
+    }
+}
+
+std::string ReferenceArbiter::getOwner(const std::string& taskName) const
+{
+    auto it = tasks.find(taskName);
+    if (it == tasks.end() || !it->second.hasOwner) {
+        return "";
+    }
+    return it->second.owner.clientName;
+}
+
+void ReferenceArbiter::releaseClient(const std::string& clientName)
+{
+    for (auto& entry : tasks) {
+        TaskArbitration& arbitration = entry.second;
+        arbitration.queued.erase(clientName);
+        arbitration.rejected.erase(clientName);
+        if (arbitration.hasOwner && arbitration.owner.clientName == clientName) {
+            arbitration.hasOwner = false;
+            emitEvent("released", entry.first, clientName, "client stalled");
+            promoteQueued(entry.first, arbitration);
+        }
+    }
+}
+
+void ReferenceArbiter::readReferences()
+{
+    while (yarp::os::Bottle* bottle = referencePort.read(false)) {
+        ocra_icub::ArbitratedReference reference;
+        if (!reference.fromBottle(*bottle)) {
+            emitEvent("rejected", reference.taskName, reference.clientName, "malformed reference");
+            OCRA_WARNING("Rejected a malformed reference: " << bottle->toString())
+            continue;
+        }
+        handleReference(reference);
+    }
+}
+
+void ReferenceArbiter::handleReference(const ocra_icub::ArbitratedReference& reference)
+{
+    auto it = tasks.find(reference.taskName);
+    if (it == tasks.end()) {
+        std::shared_ptr<ocra::Task> task = ctrlServer->getTask(reference.taskName);
+        if (!task) {
+            emitEvent("rejected", reference.taskName, reference.clientName, "unknown task");
+            return;
+        }
+        it = tasks.insert(std::make_pair(reference.taskName, TaskArbitration())).first;
+        it->second.task = task;
+    }
+    TaskArbitration& arbitration = it->second;
+
+    if (reference.release) {
+        handleRelease(arbitration, reference);
+        return;
+    }
+
+    Claim claim;
+    claim.clientName = reference.clientName;
+    claim.priority = reference.priority;
+    claim.blendTime = reference.blendTime;
+    claim.state = reference.state;
+    claim.lastTick = tick;
+
+    if (!arbitration.hasOwner) {
+        takeOver(arbitration, claim);
+        emitEvent("acquired", reference.taskName, claim.clientName, "");
+    } else if (arbitration.owner.clientName == claim.clientName) {
+        arbitration.owner.priority = claim.priority;
+        arbitration.owner.blendTime = claim.blendTime;
+        arbitration.owner.state = claim.state;
+        arbitration.owner.lastTick = tick;
+    } else if (claim.priority > arbitration.owner.priority) {
+        std::string previousOwner = arbitration.owner.clientName;
+        if (arbitrationPolicy == ARBITRATION_QUEUE) {
+            arbitration.queued[previousOwner] = arbitration.owner;
+        }
+        takeOver(arbitration, claim);
+        emitEvent("preempted", reference.taskName, claim.clientName, previousOwner);
+    } else if (arbitrationPolicy == ARBITRATION_QUEUE) {
+        bool isNew = arbitration.queued.find(claim.clientName) == arbitration.queued.end();
+        arbitration.queued[claim.clientName] = claim;
+        if (isNew) {
+            emitEvent("queued", reference.taskName, claim.clientName, arbitration.owner.clientName);
+        }
+    } else if (arbitration.rejected.insert(claim.clientName).second) {
+        // Streaming clients would flood the event port, so a client is only reported once per owner.
+        emitEvent("rejected", reference.taskName, claim.clientName, "owned by " + arbitration.owner.clientName);
+    }
+}
+
+void ReferenceArbiter::handleRelease(TaskArbitration& arbitration, const ocra_icub::ArbitratedReference& reference)
+{
+    arbitration.queued.erase(reference.clientName);
+    arbitration.rejected.erase(reference.clientName);
+    if (arbitration.hasOwner && arbitration.owner.clientName == reference.clientName) {
+        arbitration.hasOwner = false;
+        emitEvent("released", reference.taskName, reference.clientName, "");
+        promoteQueued(reference.taskName, arbitration);
+    }
+}
+
+void ReferenceArbiter::takeOver(TaskArbitration& arbitration, const Claim& claim)
+{
+    arbitration.blendStart = arbitration.task->getDesiredTaskState();
+    arbitration.blendTicks = std::max(0, int(std::round(claim.blendTime / period)));
+    arbitration.blendTick = 0;
+    arbitration.owner = claim;
+    arbitration.hasOwner = true;
+    arbitration.queued.erase(claim.clientName);
+    arbitration.rejected.clear();
+}
+
+void ReferenceArbiter::promoteQueued(const std::string& taskName, TaskArbitration& arbitration)
+{
+    auto best = arbitration.queued.end();
+    for (auto it = arbitration.queued.begin(); it != arbitration.queued.end(); ++it) {
+        if (best == arbitration.queued.end() || it->second.priority > best->second.priority) {
+            best = it;
+        }
+    }
+    if (best != arbitration.queued.end()) {
+        Claim claim = best->second;
+        takeOver(arbitration, claim);
+        emitEvent("acquired", taskName, claim.clientName, "");
+    }
+}
+
+void ReferenceArbiter::updateTask(const std::string& taskName, TaskArbitration& arbitration)
+{
+    if (timeout > 0) {
+        for (auto it = arbitration.queued.begin(); it != arbitration.queued.end(); ) {
+            if (tick - it->second.lastTick > timeout) {
+                it = arbitration.queued.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (arbitration.hasOwner && tick - arbitration.owner.lastTick > timeout) {
+            arbitration.hasOwner = false;
+            emitEvent("expired", taskName, arbitration.owner.clientName, "");
+            promoteQueued(taskName, arbitration);
+        }
+    }
+
+    if (!arbitration.hasOwner) {
+        return;
+    }
+
+    if (arbitration.blendTick < arbitration.blendTicks) {
+        ++arbitration.blendTick;
+        double a = double(arbitration.blendTick) / arbitration.blendTicks;
+        double s = a*a*a*(10.0 - 15.0*a + 6.0*a*a);
+        arbitration.task->setDesiredTaskState(blendStates(arbitration.blendStart, arbitration.owner.state, s));
+    } else {
+        // Written at every tick so that the direct writes of the other clients do not override the owner.
+        arbitration.task->setDesiredTaskState(arbitration.owner.state);
+    }
+}
+
+ocra::TaskState ReferenceArbiter::blendStates(const ocra::TaskState& start, const ocra::TaskState& target, double s)
+{
+    ocra::TaskState blended = target;
+    if (target.hasQ() && start.hasQ() && start.getQ().size() == target.getQ().size()) {
+        blended.setQ(start.getQ() + s * (target.getQ() - start.getQ()));
+    }
+    if (target.hasQd() && start.hasQd() && start.getQd().size() == target.getQd().size()) {
+        blended.setQd(start.getQd() + s * (target.getQd() - start.getQd()));
+    }
+    if (target.hasQdd() && start.hasQdd() && start.getQdd().size() == target.getQdd().size()) {
+        blended.setQdd(start.getQdd() + s * (target.getQdd() - start.getQdd()));
+    }
+    if (target.hasPosition() && start.hasPosition()) {
+        const Eigen::Displacementd& H0 = start.getPosition();
+        const Eigen::Displacementd& H1 = target.getPosition();
+        Eigen::Vector3d p = H0.getTranslation() + s * (H1.getTranslation() - H0.getTranslation());
+        Eigen::Quaterniond r = Eigen::Quaterniond(H0.qw(), H0.qx(), H0.qy(), H0.qz()).slerp(s, Eigen::Quaterniond(H1.qw(), H1.qx(), H1.qy(), H1.qz()));
+        blended.setPosition(Eigen::Displacementd(p.x(), p.y(), p.z(), r.w(), r.x(), r.y(), r.z()));
+    }
+    if (target.hasVelocity() && start.hasVelocity()) {
+        Eigen::Vector3d w = start.getVelocity().getAngularVelocity() + s * (target.getVelocity().getAngularVelocity() - start.getVelocity().getAngularVelocity());
+        Eigen::Vector3d v = start.getVelocity().getLinearVelocity() + s * (target.getVelocity().getLinearVelocity() - start.getVelocity().getLinearVelocity());
+        blended.setVelocity(Eigen::Twistd(w.x(), w.y(), w.z(), v.x(), v.y(), v.z()));
+    }
+    if (target.hasAcceleration() && start.hasAcceleration()) {
+        Eigen::Vector3d w = start.getAcceleration().getAngularVelocity() + s * (target.getAcceleration().getAngularVelocity() - start.getAcceleration().getAngularVelocity());
+        Eigen::Vector3d v = start.getAcceleration().getLinearVelocity() + s * (target.getAcceleration().getLinearVelocity() - start.getAcceleration().getLinearVelocity());
+        blended.setAcceleration(Eigen::Twistd(w.x(), w.y(), w.z(), v.x(), v.y(), v.z()));
+    }
+    return blended;
+}
+
+void ReferenceArbiter::emitEvent(const std::string& eventType, const std::string& taskName, const std::string& clientName, const std::string& message)
+{
+    yarp::os::Bottle& event = eventPort.prepare();
+    event.clear();
+    event.addString(eventType);
+    event.addString(taskName);
+    event.addString(clientName);
+    event.addDouble(yarp::os::Time::now());
+    event.addString(message);
+    eventPort.write();
+}
@@ -0,0 +1,338 @@
+/*! \file       SelfCollisionAvoidance.cpp
+ *  \brief      Keeps pairs of segments apart with capsule distance constraints inside the control loop.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/SelfCollisionAvoidance.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <yarp/os/Property.h>
+#include <yarp/os/Bottle.h>
+#include <ocra/util/ErrorsHelper.h>
+
+namespace
+{
+    // Value of the constraint rows of the pairs which are far apart, strictly satisfied for any acceleration.
+    const double DISABLED_ROW_OFFSET = -1.0;
+    // Below this distance between the segment axes the normal is ill defined and the row of the pair is disabled.
+    const double MIN_AXIS_DISTANCE = 1e-6;
+
+    Eigen::Vector3d readPoint(const yarp::os::Bottle& bottle, int first)
+    {
+        return Eigen::Vector3d(bottle.get(first).asDouble(), bottle.get(first+1).asDouble(), bottle.get(first+2).asDouble());
+    }
+}
+
+SelfCollisionAvoidance::SelfCollisionAvoidance(std::shared_ptr<IcubControllerServer> server, int threadPeriod)
+: ctrlServer(server)
+, model(server->getRobotModel())
+, period(threadPeriod / 1000.0)
+, activationDistance(0.05)
+, safetyDistance(0.01)
+, stiffness(200.0)
+, damping(30.0)
+, constraintIsAdded(false)
+, minimumDistance(0.05)
+, nActivePairs(0)
+{
+}
+
+SelfCollisionAvoidance::~SelfCollisionAvoidance()
+{
+    close();
+}
+
+bool SelfCollisionAvoidance::open(const std::string& configFilePath)
+{
+    if (!parseConfigFile(configFilePath)) {
+        return false;
+    }
+
+    for (auto& capsule : capsules) {
+        capsule.segmentIndex = model->getSegmentIndex(capsule.segmentName);
+        if (capsule.segmentIndex < 0) {
+            OCRA_ERROR("Capsule " << capsule.name << " is attached to " << capsule.segmentName << " which is not a segment of the model.")
+            return false;
+        }
+    }
+
+    // Only the capsules which belong to a pair are updated on every tick.
+    usedCapsules.clear();
+    for (const auto& pair : pairs) {
+        usedCapsules.push_back(pair.first);
+        usedCapsules.push_back(pair.second);
+    }
+    std::sort(usedCapsules.begin(), usedCapsules.end());
+    usedCapsules.erase(std::unique(usedCapsules.begin(), usedCapsules.end()), usedCapsules.end());
+
+    minimumDistance = activationDistance;
+    return addConstraint();
+}
+
+void SelfCollisionAvoidance::close()
+{
+    removeConstraint();
+}
+
+bool SelfCollisionAvoidance::attach(std::shared_ptr<IcubControllerServer> server)
+{
+    removeConstraint();
+    ctrlServer = server;
+    model = server->getRobotModel();
+    for (auto& pair : pairs) {
+        pair.wasActive = false;
+    }
+    return addConstraint();
+}
+
+bool SelfCollisionAvoidance::parseConfigFile(const std::string& configFilePath)
+{
+    yarp::os::Property config;
+    if (!config.fromConfigFile(configFilePath)) {
+        OCRA_ERROR("Could not read the self collision configuration file " << configFilePath)
+        return false;
+    }
+
+    activationDistance = config.check("activationDistance", yarp::os::Value(activationDistance)).asDouble();
+    safetyDistance = config.check("safetyDistance", yarp::os::Value(safetyDistance)).asDouble();
+    stiffness = config.check("stiffness", yarp::os::Value(stiffness)).asDouble();
+    damping = config.check("damping", yarp::os::Value(damping)).asDouble();
+    if (safetyDistance >= activationDistance) {
+        OCRA_ERROR("The safety distance (" << safetyDistance << ") must be smaller than the activation distance (" << activationDistance << ").")
+        return false;
+    }
+
+    yarp::os::Bottle* capsuleList = config.find("capsules").asList();
+    yarp::os::Bottle* pairList = config.find("pairs").asList();
+    if (capsuleList == NULL || pairList == NULL) {
+        OCRA_ERROR("The self collision configuration file needs a capsules and a pairs list.")
+        return false;
+    }
+
+    capsules.clear();
+    for (int i=0; i<capsuleList->size(); ++i) {
+        yarp::os::Bottle* c = capsuleList->get(i).asList();
+        if (c == NULL || c->size() != 9) {
+            OCRA_ERROR("Invalid capsule: " << capsuleList->get(i).toString() << ". Expected (name segment p0x p0y p0z p1x p1y p1z radius).")
+            return false;
+        }
+        Capsule capsule;
+        capsule.name = c->get(0).asString();
+        capsule.segmentName = c->get(1).asString();
+        capsule.localStart = readPoint(*c, 2);
+        capsule.localEnd = readPoint(*c, 5);
+        capsule.radius = c->get(8).asDouble();
+        capsules.push_back(capsule);
+    }
+
+    auto findCapsule = [this](const std::string& name) {
+        for (size_t i=0; i<capsules.size(); ++i) {
+            if (capsules[i].name == name) {
+                return int(i);
+            }
+        }
+        return -1;
+    };
+
+    pairs.clear();
+    for (int i=0; i<pairList->size(); ++i) {
+        yarp::os::Bottle* p = pairList->get(i).asList();
+        CapsulePair pair;
+        if (p != NULL && p->size() == 2) {
+            pair.first = findCapsule(p->get(0).asString());
+            pair.second = findCapsule(p->get(1).asString());
+        }
+        if (pair.first < 0 || pair.second < 0 || pair.first == pair.second) {
+            OCRA_ERROR("Invalid pair: " << pairList->get(i).toString() << ". Expected (capsuleA capsuleB) with two different capsules.")
+            return false;
+        }
+        pairs.push_back(pair);
+    }
+
+    if (pairs.empty()) {
+        OCRA_ERROR("The self collision configuration file has no pairs.")
+        return false;
+    }
+    return true;
+}
+
+bool SelfCollisionAvoidance::addConstraint()
+{
+    int nDof = model->nbDofs();
+    A = Eigen::MatrixXd::Zero(pairs.size(), nDof);
+    b = Eigen::VectorXd::Constant(pairs.size(), DISABLED_ROW_OFFSET);
+    jacobianA = Eigen::MatrixXd::Zero(3, nDof);
+    jacobianB = Eigen::MatrixXd::Zero(3, nDof);
+
+    // ocra inequality constraints are f(x) <= 0, so the rows hold -n^T (J_pA - J_pB) and the opposite of the right hand side.
+    distanceFunction = std::make_shared<ocra::LinearFunction>(model->getAccelerationVariable(), A, b);
+    distanceConstraint = std::make_shared<ocra::LinearConstraint>(distanceFunction.get(), false);
+    ctrlServer->addConstraint(*distanceConstraint);
+    constraintIsAdded = true;
+    return true;
+}
+
+void SelfCollisionAvoidance::removeConstraint()
+{
+    if (constraintIsAdded) {
+        ctrlServer->removeConstraint(*distanceConstraint);
+        constraintIsAdded = false;
+    }
+    distanceConstraint.reset();
+    distanceFunction.reset();
+}
+
+void SelfCollisionAvoidance::update()
+{
+    if (!constraintIsAdded) {
+        return;
+    }
+
+    for (int index : usedCapsules) {
+        updateCapsule(capsules[index]);
+    }
+
+    minimumDistance = activationDistance;
+    nActivePairs = 0;
+    Eigen::Vector3d closestA, closestB, normal;
+
+    for (size_t i=0; i<pairs.size(); ++i) {
+        CapsulePair& pair = pairs[i];
+        const Capsule& capsuleA = capsules[pair.first];
+        const Capsule& capsuleB = capsules[pair.second];
+
+        // Broad phase: the bounding spheres are further apart than the activation distance.
+        double sphereGap = (capsuleA.center - capsuleB.center).norm() - capsuleA.boundingRadius - capsuleB.boundingRadius;
+        if (sphereGap > activationDistance) {
+            A.row(i).setZero();
+            b(i) = DISABLED_ROW_OFFSET;
+            pair.wasActive = false;
+            continue;
+        }
+
+        closestPoints(capsuleA.start, capsuleA.end, capsuleB.start, capsuleB.end, closestA, closestB);
+        normal = closestA - closestB;
+        double axisDistance = normal.norm();
+        double distance = axisDistance - capsuleA.radius - capsuleB.radius;
+        if (distance > activationDistance || axisDistance < MIN_AXIS_DISTANCE) {
+            A.row(i).setZero();
+            b(i) = DISABLED_ROW_OFFSET;
+            pair.wasActive = false;
+            continue;
+        }
+        normal /= axisDistance;
+
+        double distanceRate = pair.wasActive ? (distance - pair.previousDistance) / period : 0.0;
+        pair.wasActive = true;
+        pair.previousDistance = distance;
+
+        pointJacobian(capsuleA, closestA, jacobianA);
+        pointJacobian(capsuleB, closestB, jacobianB);
+        A.row(i).noalias() = -normal.transpose() * (jacobianA - jacobianB);
+        b(i) = -stiffness * (distance - safetyDistance) - damping * distanceRate;
+
+        minimumDistance = std::min(minimumDistance, distance);
+        ++nActivePairs;
+    }
+
+    distanceFunction->changeA(A);
+    distanceFunction->changeb(b);
+}
+
+void SelfCollisionAvoidance::updateCapsule(Capsule& capsule)
+{
+    const Eigen::Displacementd& H = model->getSegmentPosition(capsule.segmentIndex);
+    Eigen::Matrix3d R = H.getRotation().adjoint();
+    capsule.start = H.getTranslation() + R * capsule.localStart;
+    capsule.end = H.getTranslation() + R * capsule.localEnd;
+    capsule.center = 0.5 * (capsule.start + capsule.end);
+    capsule.boundingRadius = 0.5 * (capsule.end - capsule.start).norm() + capsule.radius;
+}
+
+void SelfCollisionAvoidance::pointJacobian(const Capsule& capsule, const Eigen::Vector3d& point, Eigen::MatrixXd& jacobian) const
+{
+    // The segment Jacobian maps to the angular velocity and the velocity of the segment origin, both in the world frame.
+    const Eigen::Matrix<double,6,Eigen::Dynamic>& J = model->getSegmentJacobian(capsule.segmentIndex);
+    Eigen::Vector3d r = point - model->getSegmentPosition(capsule.segmentIndex).getTranslation();
+    // v_point = v_origin + w x r = v_origin - r x w
+    jacobian = J.bottomRows<3>();
+    jacobian.row(0) += r.z() * J.row(1) - r.y() * J.row(2);
+    jacobian.row(1) += r.x() * J.row(2) - r.z() * J.row(0);
+    jacobian.row(2) += r.y() * J.row(0) - r.x() * J.row(1);
+}
+
+void SelfCollisionAvoidance::closestPoints(const Eigen::Vector3d& p0, const Eigen::Vector3d& p1, const Eigen::Vector3d& q0, const Eigen::Vector3d& q1, Eigen::Vector3d& closestP, Eigen::Vector3d& closestQ)
+{
+    // Ericson, Real-Time Collision Detection, 5.1.9.
+    const double eps = std::numeric_limits<double>::epsilon();
+    Eigen::Vector3d d1 = p1 - p0;
+    Eigen::Vector3d d2 = q1 - q0;
+    Eigen::Vector3d r = p0 - q0;
+    double a = d1.squaredNorm();
+    double e = d2.squaredNorm();
+    double f = d2.dot(r);
+    double s = 0.0;
+    double t = 0.0;
+
+    if (a <= eps && e <= eps) {
+        closestP = p0;
+        closestQ = q0;
+        return;
+    }
+    if (a <= eps) {
+        t = std::min(std::max(f / e, 0.0), 1.0);
+    } else {
+        double c = d1.dot(r);
+        if (e <= eps) {
+            s = std::min(std::max(-c / a, 0.0), 1.0);
+        } else {
+            double bb = d1.dot(d2);
+            double denom = a * e - bb * bb;
+            if (denom > eps) {
+                s = std::min(std::max((bb * f - c * e) / denom, 0.0), 1.0);
+            }
+            t = (bb * s + f) / e;
+            if (t < 0.0) {
+                t = 0.0;
+                s = std::min(std::max(-c / a, 0.0), 1.0);
+            } else if (t > 1.0) {
+                t = 1.0;
+                s = std::min(std::max((bb - c) / a, 0.0), 1.0);
+            }
+        }
+    }
+    closestP = p0 + s * d1;
+    closestQ = q0 + t * d2;
+}
+
+double SelfCollisionAvoidance::getMinimumDistance() const
+{
+    return minimumDistance;
+}
+
+int SelfCollisionAvoidance::getNumberOfActivePairs() const
+{
+    return nActivePairs;
+}
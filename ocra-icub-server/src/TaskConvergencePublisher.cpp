@@ -0,0 +1,149 @@
+/*! \file       TaskConvergencePublisher.cpp
+ *  \brief      Publishes the errors and convergence flags of the active tasks on every control tick.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/TaskConvergencePublisher.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <yarp/os/Time.h>
+#include <ocra/util/ErrorsHelper.h>
+
+
+TaskConvergencePublisher::TaskConvergencePublisher(std::shared_ptr<IcubControllerServer> server, int threadPeriod, double positionThreshold, double orientationThreshold, double jointThreshold, double velocityThreshold)
+: ctrlServer(server)
+, positionTolerance(positionThreshold)
+, orientationTolerance(orientationThreshold)
+, jointTolerance(jointThreshold)
+, velocityTolerance(velocityThreshold)
+, refreshTicks(std::max(1, int(1000 / std::max(threadPeriod, 1))))
+, tick(0)
+, portIsOpen(false)
+{
+}
+
+TaskConvergencePublisher::~TaskConvergencePublisher()
+{
+    close();
+}
+
+bool TaskConvergencePublisher::open()
+{
+    if (!convergencePort.open(ocra_icub::TaskConvergenceListener::SERVER_PORT_NAME)) {
+        OCRA_ERROR("Could not open " << ocra_icub::TaskConvergenceListener::SERVER_PORT_NAME)
+        return false;
+    }
+    portIsOpen = true;
+    refreshTasks();
+    return true;
+}
+
+void TaskConvergencePublisher::close()
+{
+    if (portIsOpen) {
+        convergencePort.interrupt();
+        convergencePort.close();
+        portIsOpen = false;
+    }
+}
+
+void TaskConvergencePublisher::update()
+{
+    if (!portIsOpen) {
+        return;
+    }
+
+    ++tick;
+    if (tick % refreshTicks == 0) {
+        refreshTasks();
+    }
+    if (convergencePort.getOutputCount() == 0) {
+        return;
+    }
+
+    yarp::os::Bottle& message = convergencePort.prepare();
+    message.clear();
+    message.addInt(tick);
+    message.addDouble(yarp::os::Time::now());
+    for (auto& entry : tasks) {
+        if (!entry.second->isActivated()) {
+            continue;
+        }
+        convergence.taskName = entry.first;
+        computeConvergence(*entry.second, convergence);
+        convergence.toBottle(message.addList());
+    }
+    convergencePort.write();
+}
+
+void TaskConvergencePublisher::computeConvergence(ocra::Task& task, ocra_icub::TaskConvergence& convergence) const
+{
+    ocra::TaskState current = task.getTaskState();
+    ocra::TaskState desired = task.getDesiredTaskState();
+
+    convergence.positionError = 0.0;
+    convergence.orientationError = 0.0;
+    convergence.velocityError = 0.0;
+
+    if (current.hasQ() && desired.hasQ() && current.getQ().size() == desired.getQ().size()) {
+        convergence.positionError = (desired.getQ() - current.getQ()).norm();
+        if (current.hasQd() && desired.hasQd() && current.getQd().size() == desired.getQd().size()) {
+            convergence.velocityError = (desired.getQd() - current.getQd()).norm();
+        }
+        convergence.converged = convergence.positionError < jointTolerance
+                             && convergence.velocityError < velocityTolerance;
+        return;
+    }
+
+    if (current.hasPosition() && desired.hasPosition()) {
+        const Eigen::Displacementd& H = current.getPosition();
+        const Eigen::Displacementd& Hd = desired.getPosition();
+        convergence.positionError = (Hd.getTranslation() - H.getTranslation()).norm();
+        // Angle of the rotation between the two orientations.
+        double dot = std::abs(H.qw()*Hd.qw() + H.qx()*Hd.qx() + H.qy()*Hd.qy() + H.qz()*Hd.qz());
+        convergence.orientationError = 2.0 * std::acos(std::min(dot, 1.0));
+        if (current.hasVelocity() && desired.hasVelocity()) {
+            Eigen::Vector3d angular = desired.getVelocity().getAngularVelocity() - current.getVelocity().getAngularVelocity();
+            Eigen::Vector3d linear = desired.getVelocity().getLinearVelocity() - current.getVelocity().getLinearVelocity();
+            convergence.velocityError = std::sqrt(angular.squaredNorm() + linear.squaredNorm());
+        }
+    }
+
+    convergence.converged = convergence.positionError < positionTolerance
+                         && convergence.orientationError < orientationTolerance
+                         && convergence.velocityError < velocityTolerance;
+}
+
+void TaskConvergencePublisher::refreshTasks()
+{
+    std::vector<std::string> taskNames = ctrlServer->getTaskNames();
+    tasks.clear();
+    for (const auto& taskName : taskNames) {
+        std::shared_ptr<ocra::Task> task = ctrlServer->getTask(taskName);
+        if (task) {
+            tasks.push_back(std::make_pair(taskName, task));
+        }
+    }
+}
@@ -0,0 +1,195 @@
+/*! \file       TaskSetValidator.cpp
+ *  \brief      Checks a task set xml file against the robot before the controller server creates the tasks.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/TaskSetValidator.h"
+
+#include <set>
+#include <sstream>
+
+#include <tinyxml.h>
+
+
+namespace
+{
+    // Task types understood by the ocra-recipes task builders, and the legacy task manager types.
+    const std::set<std::string> KNOWN_TASK_TYPES = {
+        "FullPosture", "PartialPosture", "CoM", "CoMMomentum", "Cartesian", "Orientation", "Pose", "PointContact", "ContactSet",
+        "FullPostureTaskManager", "PartialPostureTaskManager", "CoMTaskManager", "SegCartesianTaskManager",
+        "SegOrientationTaskManager", "SegPoseTaskManager", "ContactTaskManager", "ContactSetTaskManager"
+    };
+
+    const std::vector<std::string> NUMERIC_PARAMS = {"kp", "kd", "weight", "mu", "margin"};
+}
+
+TaskSetValidator::TaskSetValidator(std::shared_ptr<wbi::wholeBodyInterface> wbi)
+: robot(wbi)
+{
+}
+
+TaskSetValidator::~TaskSetValidator()
+{
+}
+
+bool TaskSetValidator::validate(const std::string& taskSetPath)
+{
+    errors.clear();
+    warnings.clear();
+    tasks.clear();
+
+    TiXmlDocument doc(taskSetPath.c_str());
+    if (!doc.LoadFile()) {
+        std::stringstream ss;
+        ss << taskSetPath << ":" << doc.ErrorRow() << ":" << doc.ErrorCol() << ": " << doc.ErrorDesc();
+        errors.push_back(ss.str());
+        return false;
+    }
+
+    // Tasks are either at the top level of the file or grouped under a single element.
+    int taskNumber = 0;
+    for (TiXmlElement* element = doc.FirstChildElement(); element != NULL; element = element->NextSiblingElement())
+    {
+        std::string tag = element->ValueStr();
+        if (tag == "task") {
+            checkTask(element, taskNumber++);
+        } else {
+            for (TiXmlElement* child = element->FirstChildElement("task"); child != NULL; child = child->NextSiblingElement("task")) {
+                checkTask(child, taskNumber++);
+            }
+        }
+    }
+
+    if (tasks.empty() && errors.empty()) {
+        warnings.push_back("The task set " + taskSetPath + " does not contain any task.");
+    }
+
+    std::set<std::string> names;
+    for (auto task : tasks) {
+        if (!names.insert(task.name).second) {
+            errors.push_back("The task name [" + task.name + "] is used more than once.");
+        }
+    }
+
+    return errors.empty();
+}
+
+void TaskSetValidator::checkTask(TiXmlElement* taskElement, int taskNumber)
+{
+    TaskSummary summary;
+    const char* name = taskElement->Attribute("name");
+    const char* type = taskElement->Attribute("type");
+
+    summary.name = (name != NULL) ? name : "";
+    summary.type = (type != NULL) ? type : "";
+
+    std::string taskLabel = summary.name.empty() ? ("#" + std::to_string(taskNumber)) : summary.name;
+
+    if (summary.name.empty()) {
+        errors.push_back("Task " + taskLabel + " (line " + std::to_string(taskElement->Row()) + ") has no name attribute.");
+    }
+    if (summary.type.empty()) {
+        errors.push_back("Task " + taskLabel + " has no type attribute.");
+    } else if (KNOWN_TASK_TYPES.find(summary.type) == KNOWN_TASK_TYPES.end()) {
+        warnings.push_back("Task " + taskLabel + " has an unknown type [" + summary.type + "].");
+    }
+
+    TiXmlElement* segmentElement = taskElement->FirstChildElement("segment");
+    if (segmentElement != NULL) {
+        if (segmentElement->GetText() == NULL) {
+            errors.push_back("Task " + taskLabel + " has an empty segment.");
+        } else {
+            summary.segment = segmentElement->GetText();
+            int segmentIndex;
+            if (robot && !robot->getFrameList().idToIndex(summary.segment.c_str(), segmentIndex)) {
+                errors.push_back("Task " + taskLabel + " uses the segment [" + summary.segment + "] which does not exist on this robot.");
+            }
+        }
+    } else if (summary.type.find("Cartesian") != std::string::npos || summary.type.find("Orientation") != std::string::npos
+            || summary.type.find("Pose") != std::string::npos || summary.type.find("Contact") != std::string::npos) {
+        errors.push_back("Task " + taskLabel + " of type " + summary.type + " needs a segment.");
+    }
+
+    for (TiXmlElement* params = taskElement->FirstChildElement("params"); params != NULL; params = params->NextSiblingElement("params")) {
+        checkNumericAttributes(params, taskLabel);
+        const char* axes = params->Attribute("axes");
+        if (axes != NULL) {
+            std::string axesString(axes);
+            // R is used by the pose tasks to also control the orientation.
+            if (axesString.empty() || axesString.find_first_not_of("XYZRxyzr") != std::string::npos) {
+                errors.push_back("Task " + taskLabel + " has invalid axes [" + axesString + "]. Use a combination of X, Y, Z and R.");
+            }
+        }
+    }
+
+    for (TiXmlElement* joints = taskElement->FirstChildElement("joints"); joints != NULL; joints = joints->NextSiblingElement("joints")) {
+        for (TiXmlElement* joint = joints->FirstChildElement("joint"); joint != NULL; joint = joint->NextSiblingElement("joint")) {
+            const char* jointName = joint->Attribute("name");
+            int jointIndex;
+            if (jointName != NULL) {
+                if (robot && !robot->getJointList().idToIndex(jointName, jointIndex)) {
+                    errors.push_back("Task " + taskLabel + " uses the joint [" + std::string(jointName) + "] which does not exist on this robot.");
+                }
+            } else if (joint->QueryIntAttribute("index", &jointIndex) == TIXML_SUCCESS) {
+                if (jointIndex < 0) {
+                    errors.push_back("Task " + taskLabel + " uses the negative joint index " + std::to_string(jointIndex) + ".");
+                } else if (robot && jointIndex >= int(robot->getDoFs())) {
+                    errors.push_back("Task " + taskLabel + " uses the joint index " + std::to_string(jointIndex) + " which is outside of [0-" + std::to_string(robot->getDoFs()-1) + "].");
+                }
+            } else {
+                errors.push_back("Task " + taskLabel + " has a joint without a name or an index.");
+            }
+            checkNumericAttributes(joint, taskLabel);
+        }
+    }
+
+    tasks.push_back(summary);
+}
+
+void TaskSetValidator::checkNumericAttributes(TiXmlElement* element, const std::string& taskName)
+{
+    for (auto attributeName : NUMERIC_PARAMS) {
+        double value;
+        int result = element->QueryDoubleAttribute(attributeName.c_str(), &value);
+        if (result == TIXML_WRONG_TYPE) {
+            errors.push_back("Task " + taskName + " has a non numeric " + attributeName + " [" + std::string(element->Attribute(attributeName.c_str())) + "].");
+        } else if (result == TIXML_SUCCESS && value < 0.0) {
+            errors.push_back("Task " + taskName + " has a negative " + attributeName + ".");
+        }
+    }
+}
+
+const std::vector<std::string>& TaskSetValidator::getErrors() const
+{
+    return errors;
+}
+
+const std::vector<std::string>& TaskSetValidator::getWarnings() const
+{
+    return warnings;
+}
+
+const std::vector<TaskSetValidator::TaskSummary>& TaskSetValidator::getTasks() const
+{
+    return tasks;
+}
@@ -49,6 +49,24 @@ OcraControllerOptions::OcraControllerOptions()
 , yarpWbiOptions(yarp::os::Property())
 , controllerType(ocra_recipes::WOCRA_CONTROLLER)
 , solver(ocra_recipes::QUADPROG)
+, modelUpdatePeriod(1)
+, modelUpdateThreshold(0.0)
+, watchdogTimeout(20)
+, watchdogAction(WATCHDOG_FREEZE)
+, watchdogBlendTime(2.0)
+, arbitrationPolicy(ARBITRATION_QUEUE)
+, ownershipTimeout(100)
+, convergencePositionThreshold(0.01)
+, convergenceOrientationThreshold(0.05)
+, convergenceJointThreshold(0.05)
+, convergenceVelocityThreshold(0.01)
+, coupledJointGroups({{0, 1, 2}})
+, controllerSwapTolerance(0.5)
+, selfCollisionConfigPath("")
+, useViableJointLimits(false)
+, jointVelocityLimit(3.0)
+, jointAccelerationLimit(30.0)
+, jointLimitMargin(0.02)
 {
 }
 
@@ -78,6 +96,32 @@ std::ostream& operator<<(std::ostream &out, const OcraControllerOptions& opts)
     // out << "yarpWbiOptions: " << opts.yarpWbiOptions << "\n\n";
     out << "controllerType: " << opts.controllerType << "\n\n";
     out << "solver: " << opts.solver << "\n\n";
+    out << "modelUpdatePeriod: " << opts.modelUpdatePeriod << "\n\n";
+    out << "modelUpdateThreshold: " << opts.modelUpdateThreshold << "\n\n";
+    out << "watchdogTimeout: " << opts.watchdogTimeout << "\n\n";
+    out << "watchdogAction: " << opts.watchdogAction << "\n\n";
+    out << "watchdogBlendTime: " << opts.watchdogBlendTime << "\n\n";
+    out << "arbitrationPolicy: " << (opts.arbitrationPolicy == ARBITRATION_QUEUE ? "QUEUE" : "REJECT") << "\n\n";
+    out << "ownershipTimeout: " << opts.ownershipTimeout << "\n\n";
+    out << "convergencePositionThreshold: " << opts.convergencePositionThreshold << "\n\n";
+    out << "convergenceOrientationThreshold: " << opts.convergenceOrientationThreshold << "\n\n";
+    out << "convergenceJointThreshold: " << opts.convergenceJointThreshold << "\n\n";
+    out << "convergenceVelocityThreshold: " << opts.convergenceVelocityThreshold << "\n\n";
+    out << "coupledJointGroups:";
+    for (auto group : opts.coupledJointGroups) {
+        out << " (";
+        for (auto idx : group) {
+            out << " " << idx;
+        }
+        out << " )";
+    }
+    out << "\n\n";
+    out << "controllerSwapTolerance: " << opts.controllerSwapTolerance << "\n\n";
+    out << "selfCollisionConfigPath: " << opts.selfCollisionConfigPath << "\n\n";
+    out << "useViableJointLimits: " << opts.useViableJointLimits << "\n\n";
+    out << "jointVelocityLimit: " << opts.jointVelocityLimit << "\n\n";
+    out << "jointAccelerationLimit: " << opts.jointAccelerationLimit << "\n\n";
+    out << "jointLimitMargin: " << opts.jointLimitMargin << "\n\n";
 
     return out;
 }
@@ -91,26 +135,21 @@ Thread::Thread(OcraControllerOptions& controller_options, std::shared_ptr<wbi::w
 : RateThread(controller_options.threadPeriod)
 , ctrlOptions(controller_options)
 , controllerStatus(ocra_icub::CONTROLLER_SERVER_STOPPED)
+, swapStatus(SWAP_IDLE)
 {
     std::cout << ctrlOptions << std::endl;
 
     yarpWbi = wbi;
     bool usingInterprocessCommunication = true;
-    ctrlServer = std::make_shared<IcubControllerServer>( yarpWbi,
-                                                         ctrlOptions.robotName,
-                                                         ctrlOptions.isFloatingBase,
-                                                         ctrlOptions.controllerType,
-                                                         ctrlOptions.solver,
-                                                         usingInterprocessCommunication,
-                                                         ctrlOptions.useOdometry
-                                                       );
-
-
-
+    ctrlServer = createControllerServer(ctrlOptions.controllerType, ctrlOptions.solver, usingInterprocessCommunication);
+    activeServer = ctrlServer;
 }
 
 Thread::~Thread()
 {
+    if (swapBuilder.joinable()) {
+        swapBuilder.join();
+    }
     rpcServerPort.close();
     if(ctrlOptions.runInDebugMode) {
         debugRpcPort.close();
@@ -126,36 +165,30 @@ Thread::~Thread()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool Thread::threadInit()
 {
-    /* ======== This block was originally in the constructor of this thread ======= */
-    // The server will initialize but without calling updateModel() at the end, if useOdometry is true.
-    ctrlServer->initialize();
-
-    // ctrlServer->setRegularizationTermWeights(ctrlOptions.wDdq, ctrlOptions.wTau, ctrlOptions.wFc);
-
-    // FOR THE EXPERIMENTS ON ICUBGENOVA02
-    // For reaching
-    // ctrlServer->setRegularizationTermWeights(1e-7, 0.00001, 1e-9);
-    // For sitting
-    // ctrlServer->setRegularizationTermWeights(1e-7, 0.0001, 1e-9);
-
-    // Odometry initialization. Odometry assumes one foot to be fixed to the ground.
-    if (ctrlOptions.useOdometry && ctrlOptions.isFloatingBase) {
-        yarp::os::Bottle wbiStateOptionsGroup = ctrlOptions.yarpWbiOptions.findGroup("WBI_STATE_OPTIONS");
-        std::string initialFixedFrame = wbiStateOptionsGroup.find("localWorldReferenceFrame").asString();
-        std::cout << "\033[1;31m[DEBUG-ODOMETRY Thread::threadInit]\033[0m ocra-icub-server calls initiliazeOdometry" << std::endl;
-        if (!ctrlServer->initializeOdometry(ctrlOptions.urdfModelPath, initialFixedFrame)) {
-            std::cout << "\033[1;31m[ERROR-ODOMETRY Thread::threadInit]\033[0m Odometry could not be initialized" << std::endl;
+    // Check the task set before anything is sent to the robot so that every error is reported at once.
+    if (!ctrlOptions.startupTaskSetPath.empty()) {
+        TaskSetValidator validator(yarpWbi);
+        bool taskSetIsValid = validator.validate(ctrlOptions.startupTaskSetPath);
+        for (auto warning : validator.getWarnings()) {
+            OCRA_WARNING(warning)
+        }
+        if (!taskSetIsValid) {
+            for (auto error : validator.getErrors()) {
+                OCRA_ERROR(error)
+            }
+            OCRA_ERROR("The task set " << ctrlOptions.startupTaskSetPath << " is not valid. The controller server will not start.")
             return false;
         }
-    } else {
-        if (ctrlOptions.useOdometry && !ctrlOptions.isFloatingBase)
-            std::cout << "\033[1;31m[WARNING-ODOMETRY Thread::threadInit]\033[0m You're trying to activate ODOMETRY but isFloatingBase is false. Launch ocra-icub-server again with --floatingBase" << std::endl;
+        OCRA_INFO("Task set validated: " << validator.getTasks().size() << " tasks.")
     }
 
-    if (ctrlOptions.useOdometry)
-        ctrlServer->updateModel();
+    /* ======== This block was originally in the constructor of this thread ======= */
+    if (!initializeControllerServer(ctrlServer)) {
+        return false;
+    }
 
     model = ctrlServer->getRobotModel();
+
     // Construct rpc server callback and bind to the control thread.
     rpcServerCallback = std::make_shared<ControllerRpcServerCallback>(*this);
     // Open the rpc server port.
@@ -181,9 +214,69 @@ bool Thread::threadInit()
 
     l_foot_disp_inverse = model->getSegmentPosition("l_foot").inverse();
 
+    if (ctrlOptions.watchdogTimeout > 0) {
+        // The home of the watchdog is the balanced double support posture of the cache, or the initial posture if it is not cached. It is never computed here, the optimisation would hold up the startup.
+        Eigen::VectorXd homePosture = initialPosture;
+        if (ctrlOptions.watchdogAction == WATCHDOG_BLEND_TO_HOME) {
+            ocra_icub::PostureGenerator postureGenerator(model);
+            Eigen::VectorXd balancedPosture;
+            if (postureGenerator.getCachedPosture(ocra_icub::PostureRequest(), balancedPosture)) {
+                homePosture = balancedPosture;
+            } else {
+                OCRA_WARNING("No balanced posture is cached for this robot, run posture-cache-generator to add it. The watchdog brings the posture tasks back to the initial posture.")
+            }
+        }
+        watchdog = std::make_shared<ClientWatchdog>(ctrlServer, ctrlOptions.threadPeriod, ctrlOptions.watchdogTimeout, ctrlOptions.watchdogAction, ctrlOptions.watchdogBlendTime, homePosture);
+        if (!watchdog->open()) {
+            OCRA_WARNING("The client watchdog could not be started. Stalled clients will not be detected.")
+            watchdog.reset();
+        }
+    }
+
+    referenceArbiter = std::make_shared<ReferenceArbiter>(ctrlServer, ctrlOptions.threadPeriod, ctrlOptions.arbitrationPolicy, ctrlOptions.ownershipTimeout);
+    if (!referenceArbiter->open()) {
+        OCRA_WARNING("The reference arbiter could not be started. Arbitrated references sent by the clients will be ignored.")
+        referenceArbiter.reset();
+    }
+
+    gainScheduler = std::make_shared<GainScheduler>(ctrlServer, ctrlOptions.threadPeriod);
+    if (!gainScheduler->open()) {
+        OCRA_WARNING("The gain scheduler could not be started. Gain profiles sent by the clients will be ignored.")
+        gainScheduler.reset();
+    }
+
+    contactTransitions = std::make_shared<ContactTransitionManager>(ctrlServer);
+    if (!contactTransitions->open()) {
+        OCRA_WARNING("The contact transition manager could not be started. Contact transition rules sent by the clients will be ignored.")
+        contactTransitions.reset();
+    }
+
+    convergencePublisher = std::make_shared<TaskConvergencePublisher>(ctrlServer, ctrlOptions.threadPeriod, ctrlOptions.convergencePositionThreshold, ctrlOptions.convergenceOrientationThreshold, ctrlOptions.convergenceJointThreshold, ctrlOptions.convergenceVelocityThreshold);
+    if (!convergencePublisher->open()) {
+        OCRA_WARNING("The task convergence publisher could not be started. Clients will have to compare the task states themselves.")
+        convergencePublisher.reset();
+    }
+
+    if (!ctrlOptions.selfCollisionConfigPath.empty()) {
+        selfCollision = std::make_shared<SelfCollisionAvoidance>(ctrlServer, ctrlOptions.threadPeriod);
+        if (!selfCollision->open(ctrlOptions.selfCollisionConfigPath)) {
+            OCRA_WARNING("The self collision avoidance could not be started. Segments will not be kept apart.")
+            selfCollision.reset();
+        }
+    }
+
+    if (ctrlOptions.useViableJointLimits) {
+        jointLimits = std::make_shared<ViableJointLimits>(ctrlServer, ctrlOptions.threadPeriod, ctrlOptions.jointVelocityLimit, ctrlOptions.jointAccelerationLimit, ctrlOptions.jointLimitMargin);
+        if (!jointLimits->open()) {
+            OCRA_WARNING("The joint limit constraint could not be started. Joint accelerations will not be bounded.")
+            jointLimits.reset();
+        }
+    }
+
     controllerStatus = ocra_icub::CONTROLLER_SERVER_RUNNING;
     if(ctrlOptions.runInDebugMode || ctrlOptions.noOutputMode) {
-        debugJointIndex = 0;
+        debugJoints.clear();
+        debugReference = initialPosture;
         debuggingAllJoints = false;
         userHasSetDebugIndex = false;
         std::string debugRpcPortName("/ocra-icub-server/debug/rpc:i");
@@ -214,9 +307,9 @@ bool Thread::threadInit()
 
 
         if (ctrlOptions.runInDebugMode) {
-            std::string jointName = model->getJointName(debugJointIndex);
-            std::cout << "Debugging joint index: " << debugJointIndex << " ("<< jointName <<")" << std::endl;
-            return setDebugJointToTorqueMode(debugJointIndex);
+            debugJoints = expandCoupledJoints(std::vector<int>(1, 0));
+            std::cout << "Debugging joints: " << debugJointsToString(debugJoints) << std::endl;
+            return setDebugJointsToTorqueMode(debugJoints);
         } else {
             return true;
         }
@@ -255,7 +348,51 @@ void Thread::run()
     // yarpWbi->getEstimates(wbi::ESTIMATE_JOINT_POS, externalWrench.data());
     // std::cout << "externalWrench:\n" << externalWrench.transpose() << std::endl;
 
-    ctrlServer->computeTorques(torques);
+    if (watchdog) {
+        watchdog->update();
+    }
+
+    if (referenceArbiter) {
+        if (watchdog) {
+            // The arbitration would otherwise keep writing the references of a stalled client over the hold of the watchdog.
+            for (auto clientName : watchdog->getStalledClients()) {
+                referenceArbiter->releaseClient(clientName);
+            }
+        }
+        referenceArbiter->update();
+    }
+
+    if (gainScheduler) {
+        gainScheduler->update();
+    }
+
+    if (contactTransitions) {
+        contactTransitions->update();
+    }
+
+    if (selfCollision) {
+        selfCollision->update();
+    }
+
+    if (jointLimits) {
+        jointLimits->update();
+    }
+
+    if (activeServer != ctrlServer) {
+        // After a controller swap ctrlServer still receives the client references, including the changes of the odometry fixed link.
+        refreshActiveTaskPairs();
+        mirrorTaskStates(activeTaskPairs);
+        if (ctrlOptions.useOdometry) {
+            activeServer->setFixedLinkForOdometry(ctrlServer->getFixedLinkForOdometry());
+        }
+    }
+
+    activeServer->computeTorques(torques);
+
+    if (activeServer != ctrlServer) {
+        // ctrlServer publishes the state activeServer has just read, so the robot is read and the odometry run once per tick.
+        ctrlServer->updateModel();
+    }
     torques = ((torques.array().max(minTorques)).min(maxTorques)).matrix().eval();
     if (ctrlOptions.runInDebugMode || ctrlOptions.noOutputMode) {
         measuredTorques = model->getJointTorques();
@@ -264,7 +401,7 @@ void Thread::run()
             if (debuggingAllJoints) {
                 yarpWbi->setControlReference(torques.data());
             } else {
-                sendTorqueReferenceToDebugJoint(debugJointIndex);
+                sendTorqueReferenceToDebugJoints();
             }
         }
     } else {
@@ -274,11 +411,50 @@ void Thread::run()
             yarpWbi->setControlMode(wbi::CTRL_MODE_TORQUE, 0, ALL_JOINTS);
         }
     }
+
+    if (convergencePublisher) {
+        convergencePublisher->update();
+    }
+
+    // The new controller is checked once the torques of this tick are sent so that it never delays them.
+    if (swapStatus == SWAP_REQUESTED) {
+        startShadowBuild();
+    } else if (swapStatus == SWAP_INITIALIZING) {
+        initializeShadowController();
+    } else if (swapStatus == SWAP_VERIFYING) {
+        runShadowTick();
+    }
 }
 
 void Thread::threadRelease()
 {
     controllerStatus = ocra_icub::CONTROLLER_SERVER_STOPPED;
+    if (watchdog) {
+        watchdog->close();
+    }
+    if (referenceArbiter) {
+        referenceArbiter->close();
+    }
+    if (gainScheduler) {
+        gainScheduler->close();
+    }
+    if (contactTransitions) {
+        contactTransitions->close();
+    }
+    if (convergencePublisher) {
+        convergencePublisher->close();
+    }
+    if (selfCollision) {
+        selfCollision->close();
+    }
+    if (jointLimits) {
+        jointLimits->close();
+    }
+    if (swapBuilder.joinable()) {
+        swapBuilder.join();
+    }
+    shadowServer.reset();
+    retiredServer.reset();
     if (ctrlOptions.maintainFinalPosture) {
         OCRA_INFO("Staying in my current posture.")
         Eigen::VectorXd finalPosture = Eigen::VectorXd::Zero(yarpWbi->getDoFs());
@@ -293,32 +469,332 @@ void Thread::threadRelease()
 
 }
 
-bool Thread::setDebugJointToTorqueMode(int idx)
+std::shared_ptr<IcubControllerServer> Thread::createControllerServer(ocra_recipes::CONTROLLER_TYPE ctrlType, ocra_recipes::SOLVER_TYPE solver, bool usingInterprocessCommunication)
 {
-    bool isTorqueModeSet = true;
-    if ( (idx==0) || (idx==1) || (idx==2) ) {
-        isTorqueModeSet &= yarpWbi->setControlMode(wbi::CTRL_MODE_TORQUE, 0, 0);
-        isTorqueModeSet &= yarpWbi->setControlMode(wbi::CTRL_MODE_TORQUE, 0, 1);
-        isTorqueModeSet &= yarpWbi->setControlMode(wbi::CTRL_MODE_TORQUE, 0, 2);
+    return std::make_shared<IcubControllerServer>( yarpWbi,
+                                                   ctrlOptions.robotName,
+                                                   ctrlOptions.isFloatingBase,
+                                                   ctrlType,
+                                                   solver,
+                                                   usingInterprocessCommunication,
+                                                   ctrlOptions.useOdometry
+                                                 );
+}
+
+bool Thread::initializeControllerServer(std::shared_ptr<IcubControllerServer> server)
+{
+    // The server will initialize but without calling updateModel() at the end, if useOdometry is true.
+    server->initialize();
+
+    // server->setRegularizationTermWeights(ctrlOptions.wDdq, ctrlOptions.wTau, ctrlOptions.wFc);
+
+    // FOR THE EXPERIMENTS ON ICUBGENOVA02
+    // For reaching
+    // server->setRegularizationTermWeights(1e-7, 0.00001, 1e-9);
+    // For sitting
+    // server->setRegularizationTermWeights(1e-7, 0.0001, 1e-9);
+
+    // Odometry initialization. Odometry assumes one foot to be fixed to the ground.
+    if (ctrlOptions.useOdometry && ctrlOptions.isFloatingBase) {
+        yarp::os::Bottle wbiStateOptionsGroup = ctrlOptions.yarpWbiOptions.findGroup("WBI_STATE_OPTIONS");
+        std::string initialFixedFrame = wbiStateOptionsGroup.find("localWorldReferenceFrame").asString();
+        std::cout << "\033[1;31m[DEBUG-ODOMETRY Thread::threadInit]\033[0m ocra-icub-server calls initiliazeOdometry" << std::endl;
+        if (!server->initializeOdometry(ctrlOptions.urdfModelPath, initialFixedFrame)) {
+            std::cout << "\033[1;31m[ERROR-ODOMETRY Thread::threadInit]\033[0m Odometry could not be initialized" << std::endl;
+            return false;
+        }
     } else {
-        isTorqueModeSet &= yarpWbi->setControlMode(wbi::CTRL_MODE_TORQUE, 0, idx);
+        if (ctrlOptions.useOdometry && !ctrlOptions.isFloatingBase)
+            std::cout << "\033[1;31m[WARNING-ODOMETRY Thread::threadInit]\033[0m You're trying to activate ODOMETRY but isFloatingBase is false. Launch ocra-icub-server again with --floatingBase" << std::endl;
     }
 
-    return isTorqueModeSet;
+    if (ctrlOptions.useOdometry)
+        server->updateModel();
+
+    // Multi-rate update of the expensive model quantities.
+    std::shared_ptr<ocra_icub::OcraWbiModel> wbiModel = std::dynamic_pointer_cast<ocra_icub::OcraWbiModel>(server->getRobotModel());
+    if (wbiModel) {
+        wbiModel->setModelUpdateThreshold(ctrlOptions.modelUpdateThreshold);
+        wbiModel->setModelUpdatePeriod(ctrlOptions.modelUpdatePeriod);
+    }
+    return true;
+}
+
+bool Thread::startControllerSwap(const std::string& ctrlTypeString, const std::string& solverString, std::string& message)
+{
+    int status = swapStatus;
+    if (status == SWAP_REQUESTED || status == SWAP_BUILDING || status == SWAP_INITIALIZING || status == SWAP_VERIFYING) {
+        message = "A controller swap is already in progress.";
+        return false;
+    }
+    if (controllerStatus != ocra_icub::CONTROLLER_SERVER_RUNNING) {
+        message = "The controller server is not running.";
+        return false;
+    }
+
+    std::string c = ocra::util::convertToUpperCase(ctrlTypeString);
+    std::string s = ocra::util::convertToUpperCase(solverString);
+    ocra_recipes::CONTROLLER_TYPE newControllerType;
+    ocra_recipes::SOLVER_TYPE newSolver;
+    if (c == "WOCRA") {
+        newControllerType = ocra_recipes::WOCRA_CONTROLLER;
+    } else if (c == "HOCRA") {
+        newControllerType = ocra_recipes::HOCRA_CONTROLLER;
+    } else {
+        message = "Unknown controller type [" + ctrlTypeString + "]. Options are: WOCRA, HOCRA.";
+        return false;
+    }
+    if (s == "QUADPROG") {
+        newSolver = ocra_recipes::QUADPROG;
+    } else if (s == "QPOASES") {
+        newSolver = ocra_recipes::QPOASES;
+    } else {
+        message = "Unknown solver [" + solverString + "]. Options are: QUADPROG, QPOASES.";
+        return false;
+    }
+
+    swapControllerType = newControllerType;
+    swapSolver = newSolver;
+    message = "Building a " + c + " controller with " + s + ". Ask for GET_CONTROLLER_SWAP_STATUS to follow it.";
+    setControllerSwapStatus(SWAP_REQUESTED, message);
+    return true;
 }
 
+void Thread::startShadowBuild()
+{
+    // The controller replaced or rejected by the last swap is destroyed here, on the control thread.
+    retiredServer.reset();
 
-void Thread::sendTorqueReferenceToDebugJoint(int idx)
+    if (swapBuilder.joinable()) {
+        swapBuilder.join();
+    }
+    setControllerSwapStatus(SWAP_BUILDING, "Building the new controller.");
+    swapBuilder = std::thread(&Thread::buildShadowController, this);
+}
+
+void Thread::buildShadowController()
 {
-    if ( (idx==0) || (idx==1) || (idx==2) ) {
-        yarpWbi->setControlReference(&torques(0), 0);
-        yarpWbi->setControlReference(&torques(1), 1);
-        yarpWbi->setControlReference(&torques(2), 2);
+    // The control thread reads the robot and runs the WBI model while this runs, so nothing here may use yarpWbi beyond its number of DoFs. The rest is done by initializeShadowController().
+    // The new controller works on its own model and tasks. Its ports stay closed since ctrlServer keeps talking to the clients.
+    bool usingInterprocessCommunication = false;
+    std::shared_ptr<IcubControllerServer> server = createControllerServer(swapControllerType, swapSolver, usingInterprocessCommunication);
+    if (ctrlOptions.useOdometry && ctrlOptions.isFloatingBase && !server->loadOdometryModel(ctrlOptions.urdfModelPath)) {
+        retiredServer = server;
+        setControllerSwapStatus(SWAP_FAILED, "The odometry model of the new controller could not be loaded.");
+        return;
+    }
+
+    shadowServer = server;
+    setControllerSwapStatus(SWAP_INITIALIZING, "The new controller is built. Initializing it on the control thread.");
+}
+
+void Thread::initializeShadowController()
+{
+    // The new controller reads the state the running one has read on this tick rather than the robot.
+    shadowServer->followRobotState(activeServer);
+    if (!initializeControllerServer(shadowServer)) {
+        retiredServer = shadowServer;
+        shadowServer.reset();
+        setControllerSwapStatus(SWAP_FAILED, "The new controller could not be initialized.");
+        return;
+    }
+    if (!ctrlOptions.startupTaskSetPath.empty()) {
+        shadowServer->addTasksFromXmlFile(ctrlOptions.startupTaskSetPath);
+    }
+
+    shadowTorques = Eigen::VectorXd::Zero(yarpWbi->getDoFs());
+    setControllerSwapStatus(SWAP_VERIFYING, "The new controller is initialized. Verifying it on a shadow tick.");
+}
+
+void Thread::runShadowTick()
+{
+    // The tasks are paired on the tick they are compared, so the tasks the clients have just added are checked too.
+    std::vector<std::string> missingTasks;
+    shadowTaskNames = ctrlServer->getTaskNames();
+    pairTasks(shadowServer, shadowTaskNames, shadowTaskPairs, missingTasks);
+    if (!missingTasks.empty()) {
+        std::stringstream ss;
+        std::copy(missingTasks.begin(), missingTasks.end(), std::ostream_iterator<std::string>(ss, " "));
+        retiredServer = shadowServer;
+        shadowServer.reset();
+        setControllerSwapStatus(SWAP_FAILED, "The new controller was rejected, it cannot create the tasks which are not in the startup task set: " + ss.str());
+        return;
+    }
+
+    // The odometry of the new controller goes on from the pose estimated by the running one rather than from the initial fixed frame.
+    std::string fixedFrame;
+    iDynTree::Transform world_H_fixedFrame;
+    if (activeServer->getOdometryState(fixedFrame, world_H_fixedFrame)) {
+        shadowServer->setOdometryState(fixedFrame, world_H_fixedFrame);
+    }
+
+    mirrorTaskStates(shadowTaskPairs);
+    shadowServer->computeTorques(shadowTorques);
+    shadowTorques = ((shadowTorques.array().max(minTorques)).min(maxTorques)).matrix().eval();
+
+    double difference = (shadowTorques - torques).norm() / std::max(torques.norm(), 1.0);
+    std::stringstream ss;
+    ss << "relative torque difference on the shadow tick: " << difference << " (tolerance: " << ctrlOptions.controllerSwapTolerance << ").";
+
+    if (shadowTorques.allFinite() && difference <= ctrlOptions.controllerSwapTolerance) {
+        if (activeServer != ctrlServer) {
+            retiredServer = activeServer;
+        }
+        // From now on the new controller reads the robot and ctrlServer follows it.
+        shadowServer->followRobotState(std::shared_ptr<IcubControllerServer>());
+        activeServer = shadowServer;
+        activeTaskPairs = shadowTaskPairs;
+        activeTaskNames = shadowTaskNames;
+        ctrlServer->followRobotState(activeServer);
+        if (selfCollision) {
+            selfCollision->attach(activeServer);
+        }
+        if (jointLimits) {
+            jointLimits->attach(activeServer);
+        }
+        shadowServer.reset();
+        {
+            std::lock_guard<std::mutex> lock(swapMutex);
+            ctrlOptions.controllerType = swapControllerType;
+            ctrlOptions.solver = swapSolver;
+        }
+        setControllerSwapStatus(SWAP_SUCCEEDED, "Controller swapped, " + ss.str());
     } else {
-        yarpWbi->setControlReference(&torques(idx), idx);
+        retiredServer = shadowServer;
+        shadowServer.reset();
+        setControllerSwapStatus(SWAP_FAILED, "The new controller was rejected, " + ss.str());
     }
 }
 
+void Thread::pairTasks(std::shared_ptr<IcubControllerServer> server, const std::vector<std::string>& taskNames, std::vector<std::pair<std::shared_ptr<ocra::Task>, std::shared_ptr<ocra::Task> > >& taskPairs, std::vector<std::string>& missingTasks)
+{
+    taskPairs.clear();
+    for (auto taskName : taskNames) {
+        std::shared_ptr<ocra::Task> task = ctrlServer->getTask(taskName);
+        if (!task) {
+            continue;
+        }
+        std::shared_ptr<ocra::Task> copy = server->getTask(taskName);
+        if (copy) {
+            taskPairs.push_back(std::make_pair(task, copy));
+        } else {
+            missingTasks.push_back(taskName);
+        }
+    }
+}
+
+void Thread::refreshActiveTaskPairs()
+{
+    std::vector<std::string> taskNames = ctrlServer->getTaskNames();
+    if (taskNames == activeTaskNames) {
+        return;
+    }
+
+    // The copies of the tasks the clients have removed stop acting on the robot.
+    for (auto taskName : activeTaskNames) {
+        if (std::find(taskNames.begin(), taskNames.end(), taskName) == taskNames.end()) {
+            std::shared_ptr<ocra::Task> copy = activeServer->getTask(taskName);
+            if (copy && copy->isActivated()) {
+                copy->deactivate();
+            }
+        }
+    }
+
+    std::vector<std::string> missingTasks;
+    pairTasks(activeServer, taskNames, activeTaskPairs, missingTasks);
+    for (auto taskName : missingTasks) {
+        // The running controller only has the tasks of the startup task set. A task it does not have is deactivated so that the client does not take it for a running task.
+        OCRA_ERROR("The task " << taskName << " was added after the controller swap but the running controller cannot create it. It is deactivated.")
+        std::shared_ptr<ocra::Task> task = ctrlServer->getTask(taskName);
+        if (task && task->isActivated()) {
+            task->deactivate();
+        }
+    }
+    activeTaskNames = taskNames;
+}
+
+void Thread::mirrorTaskStates(const std::vector<std::pair<std::shared_ptr<ocra::Task>, std::shared_ptr<ocra::Task> > >& taskPairs)
+{
+    for (auto& taskPair : taskPairs) {
+        std::shared_ptr<ocra::Task> source = taskPair.first;
+        std::shared_ptr<ocra::Task> destination = taskPair.second;
+
+        if (source->isActiveAsObjective() && !destination->isActiveAsObjective()) {
+            destination->activateAsObjective();
+        } else if (source->isActiveAsConstraint() && !destination->isActiveAsConstraint()) {
+            destination->activateAsConstraint();
+        } else if (!source->isActivated() && destination->isActivated()) {
+            destination->deactivate();
+        }
+        destination->setStiffness(source->getStiffness());
+        destination->setDamping(source->getDamping());
+        destination->setWeight(source->getWeight());
+        destination->setDesiredTaskState(source->getDesiredTaskState());
+    }
+}
+
+void Thread::setControllerSwapStatus(CONTROLLER_SWAP_STATUS status, const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(swapMutex);
+    swapMessage = message;
+    swapStatus = status;
+    OCRA_INFO(message)
+}
+
+std::vector<int> Thread::expandCoupledJoints(const std::vector<int>& joints)
+{
+    // A joint which belongs to a coupled group drags the whole group into torque mode with it.
+    std::vector<int> expanded;
+    for (auto idx : joints) {
+        expanded.push_back(idx);
+        for (auto& group : ctrlOptions.coupledJointGroups) {
+            if (std::find(group.begin(), group.end(), idx) != group.end()) {
+                expanded.insert(expanded.end(), group.begin(), group.end());
+            }
+        }
+    }
+    std::sort(expanded.begin(), expanded.end());
+    expanded.erase(std::unique(expanded.begin(), expanded.end()), expanded.end());
+    return expanded;
+}
+
+bool Thread::setDebugJointsToTorqueMode(const std::vector<int>& joints)
+{
+    bool isTorqueModeSet = true;
+    for (auto idx : joints) {
+        isTorqueModeSet &= yarpWbi->setControlMode(wbi::CTRL_MODE_TORQUE, 0, idx);
+    }
+    return isTorqueModeSet;
+}
+
+void Thread::setDebugJointsToPositionMode(const std::vector<int>& joints)
+{
+    for (auto idx : joints) {
+        yarpWbi->setControlMode(wbi::CTRL_MODE_POS, &initialPosture(idx), idx);
+        yarpWbi->setControlReference(&initialPosture(idx), idx);
+        // The batched write of sendTorqueReferenceToDebugJoints() must keep sending the position this joint now holds, not its last torque.
+        debugReference(idx) = initialPosture(idx);
+    }
+}
+
+void Thread::sendTorqueReferenceToDebugJoints()
+{
+    // One write for the whole robot. The WBI interprets each entry in the current control mode of its joint, so the joints which are not debugged are sent the position they hold.
+    for (auto idx : debugJoints) {
+        debugReference(idx) = torques(idx);
+    }
+    yarpWbi->setControlReference(debugReference.data());
+}
+
+std::string Thread::debugJointsToString(const std::vector<int>& joints)
+{
+    std::string jointString;
+    for (auto idx : joints) {
+        jointString += std::to_string(idx) + " (" + model->getJointName(idx) + ") ";
+    }
+    return jointString;
+}
+
 void Thread::writeDebugData()
 {
     yarp::os::Bottle refBottle, realBottle;
@@ -356,6 +832,12 @@ ocra_icub::OCRA_ICUB_MESSAGE Thread::convertStringToOcraIcubMessage(const std::s
         return ocra_icub::OCRA_ICUB_MESSAGE::GET_CONTROLLER_SERVER_STATUS;
     } else if (_s=="GET_L_FOOT_POSE") {
         return ocra_icub::OCRA_ICUB_MESSAGE::GET_L_FOOT_POSE;
+    } else if (_s=="GET_MODEL_UPDATE_INFO") {
+        return ocra_icub::OCRA_ICUB_MESSAGE::GET_MODEL_UPDATE_INFO;
+    } else if (_s=="SWAP_CONTROLLER") {
+        return ocra_icub::OCRA_ICUB_MESSAGE::SWAP_CONTROLLER;
+    } else if (_s=="GET_CONTROLLER_SWAP_STATUS") {
+        return ocra_icub::OCRA_ICUB_MESSAGE::GET_CONTROLLER_SWAP_STATUS;
     } else {
         return ocra_icub::OCRA_ICUB_MESSAGE::FAILURE;
     }
@@ -397,6 +879,46 @@ void Thread::parseIncomingMessage(yarp::os::Bottle& input, yarp::os::Bottle& rep
                     ocra::util::pourDisplacementdIntoBottle(l_foot_disp_inverse, reply);
                 }break;
 
+            case ocra_icub::GET_MODEL_UPDATE_INFO:
+                {
+                    std::cout << "Got message: GET_MODEL_UPDATE_INFO." << std::endl;
+                    std::shared_ptr<ocra_icub::OcraWbiModel> wbiModel = std::dynamic_pointer_cast<ocra_icub::OcraWbiModel>(model);
+                    if (wbiModel) {
+                        reply.addInt(wbiModel->getModelUpdatePeriod());
+                        reply.addDouble(wbiModel->getModelUpdateThreshold());
+                        reply.addInt(wbiModel->getTicksSinceModelRefresh());
+                        reply.addDouble(wbiModel->getConfigurationDrift());
+                        reply.addDouble(wbiModel->getInertiaApproximationError());
+                        reply.addDouble(wbiModel->getInertiaRefreshError());
+                    } else {
+                        reply.addInt(ocra_icub::FAILURE);
+                    }
+                }break;
+
+            case ocra_icub::SWAP_CONTROLLER:
+                {
+                    std::cout << "Got message: SWAP_CONTROLLER." << std::endl;
+                    std::string ctrlTypeString = input.get(++i).asString();
+                    std::string solverString = input.get(++i).asString();
+                    std::string message;
+                    if (startControllerSwap(ctrlTypeString, solverString, message)) {
+                        reply.addInt(ocra_icub::SUCCESS);
+                    } else {
+                        reply.addInt(ocra_icub::FAILURE);
+                    }
+                    reply.addString(message);
+                }break;
+
+            case ocra_icub::GET_CONTROLLER_SWAP_STATUS:
+                {
+                    std::cout << "Got message: GET_CONTROLLER_SWAP_STATUS." << std::endl;
+                    std::lock_guard<std::mutex> lock(swapMutex);
+                    reply.addInt(swapStatus);
+                    reply.addString(swapMessage);
+                    reply.addInt(ctrlOptions.controllerType);
+                    reply.addInt(ctrlOptions.solver);
+                }break;
+
             case ocra_icub::STRING_MESSAGE:
                 {
                     std::cout << "Got message: STRING_MESSAGE." << std::endl;
@@ -425,40 +947,66 @@ void Thread::parseDebugMessage(yarp::os::Bottle& input, yarp::os::Bottle& reply)
     {
         std::string key = input.get(i).asString();
         if (key == "setJoint") {
-            std::string jointName;
-            std::string jointString;
             std::string replyString;
-            int newIndex = input.get(++i).asInt();
-            if (newIndex == -1) {
+            yarp::os::Value jointValue = input.get(++i);
+            std::vector<int> requestedJoints;
+            std::string invalidJoints;
+            // Either a single index, or a list of indexes and joint names, e.g. (l_shoulder_pitch l_shoulder_roll 5).
+            yarp::os::Bottle* jointList = jointValue.asList();
+            if (jointList != NULL) {
+                for (int j=0; j<jointList->size(); ++j) {
+                    int idx = -1;
+                    if (jointList->get(j).isString()) {
+                        yarpWbi->getJointList().idToIndex(jointList->get(j).asString().c_str(), idx);
+                    } else {
+                        idx = jointList->get(j).asInt();
+                    }
+                    if (idx >= 0 && idx < initialPosture.rows()) {
+                        requestedJoints.push_back(idx);
+                    } else {
+                        invalidJoints += jointList->get(j).toString() + " ";
+                    }
+                }
+            } else {
+                int idx = jointValue.asInt();
+                if (idx >= 0 && idx < initialPosture.rows()) {
+                    requestedJoints.push_back(idx);
+                } else if (idx != -1) {
+                    invalidJoints = std::to_string(idx);
+                }
+            }
+
+            if (jointList == NULL && jointValue.asInt() == -1) {
                 if(yarpWbi->setControlMode(wbi::CTRL_MODE_TORQUE, torques.data(), ALL_JOINTS) ) {
                     debuggingAllJoints = true;
                     replyString = "Success! Setting all joints to TORQUE control mode.";
                 } else {
                     replyString = "FAILED! Could not set the control mode of the joints to TORQUE mode.";
                 }
-            } else {
-                jointName = model->getJointName(newIndex);
-                jointString = std::to_string(newIndex);
-                if (newIndex >= 0 && newIndex < initialPosture.rows()) {
-                    if (debuggingAllJoints) {
-                        yarpWbi->setControlMode(wbi::CTRL_MODE_POS, initialPosture.data(), ALL_JOINTS);
-                        yarpWbi->setControlReference(initialPosture.data(), ALL_JOINTS);
-                        debuggingAllJoints = false;
-                    } else {
-                        yarpWbi->setControlMode(wbi::CTRL_MODE_POS, &initialPosture(debugJointIndex), debugJointIndex);
-                        yarpWbi->setControlReference(&initialPosture(debugJointIndex), debugJointIndex);
-                    }
+            } else if (invalidJoints.empty() && !requestedJoints.empty()) {
+                std::vector<int> newDebugJoints = expandCoupledJoints(requestedJoints);
+                if (debuggingAllJoints) {
+                    yarpWbi->setControlMode(wbi::CTRL_MODE_POS, initialPosture.data(), ALL_JOINTS);
+                    yarpWbi->setControlReference(initialPosture.data(), ALL_JOINTS);
+                    debugReference = initialPosture;
+                    debuggingAllJoints = false;
+                } else {
+                    // Only the joints which leave the selection go back to position control.
+                    std::vector<int> releasedJoints;
+                    std::set_difference(debugJoints.begin(), debugJoints.end(), newDebugJoints.begin(), newDebugJoints.end(), std::back_inserter(releasedJoints));
+                    setDebugJointsToPositionMode(releasedJoints);
+                }
 
-                    if( setDebugJointToTorqueMode(newIndex) ) {
-                        replyString = "Success! Debugging joint index: " + jointString + " (" + jointName +")";
-                    } else {
-                        replyString = "FAILED! Could not set the control mode of joint " + jointString + " ("+jointName+") to TORQUE mode.";
-                    }
-                    debugJointIndex = newIndex;
-                    userHasSetDebugIndex = true;
+                std::string jointString = debugJointsToString(newDebugJoints);
+                if( setDebugJointsToTorqueMode(newDebugJoints) ) {
+                    replyString = "Success! Debugging joints: " + jointString;
                 } else {
-                    replyString = "FAILED! The index " + jointString + " is outside of the valid range, [0-" + std::to_string(initialPosture.rows() - 1)+ "] Use index = -1 for all joints. Type [listJoints] or [help] for details.";
+                    replyString = "FAILED! Could not set the control mode of joints " + jointString + "to TORQUE mode.";
                 }
+                debugJoints = newDebugJoints;
+                userHasSetDebugIndex = true;
+            } else {
+                replyString = "FAILED! The joints " + invalidJoints + " are not valid. Use indexes in [0-" + std::to_string(initialPosture.rows() - 1)+ "] or joint names, and index = -1 for all joints. Type [listJoints] or [help] for details.";
             }
             reply.addVocab(yarp::os::Vocab::encode("many"));
             reply.addString(replyString);
@@ -508,7 +1056,7 @@ void Thread::parseDebugMessage(yarp::os::Bottle& input, yarp::os::Bottle& reply)
         } else if (key == "help") {
             std::string helpString("");
             helpString += "Valid commands: \n";
-            helpString += "-- setJoint [index]\n";
+            helpString += "-- setJoint [index] or setJoint ([index or name] ...) (coupled joints are added automatically)\n";
             helpString += "-- listJoints\n";
             helpString += "-- noOutputMode [ON/OFF]\n";
             helpString += "-- help\n";
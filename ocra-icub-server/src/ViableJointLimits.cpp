@@ -0,0 +1,155 @@
+/*! \file       ViableJointLimits.cpp
+ *  \brief      Joint acceleration bounds which respect the position and velocity limits of the joints.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ocra-icub-server/ViableJointLimits.h"
+
+#include <algorithm>
+
+#include <ocra/util/ErrorsHelper.h>
+
+
+ViableJointLimits::ViableJointLimits(std::shared_ptr<IcubControllerServer> server, int threadPeriod, double maxVelocity, double maxAcceleration, double margin)
+: ctrlServer(server)
+, model(server->getRobotModel())
+, period(threadPeriod / 1000.0)
+, vMax(maxVelocity)
+, aMax(maxAcceleration)
+, positionMargin(margin)
+, constraintIsAdded(false)
+{
+}
+
+ViableJointLimits::~ViableJointLimits()
+{
+    close();
+}
+
+bool ViableJointLimits::open()
+{
+    if (vMax <= 0.0 || aMax <= 0.0) {
+        OCRA_ERROR("The joint velocity and acceleration limits must be > 0.")
+        return false;
+    }
+
+    qMin = model->getJointLowerLimits().array() + positionMargin;
+    qMax = model->getJointUpperLimits().array() - positionMargin;
+    Eigen::Array<bool, Eigen::Dynamic, 1> tooNarrow = qMin > qMax;
+    if (tooNarrow.any()) {
+        OCRA_WARNING("The joint limit margin is larger than the range of some joints. Their margin is removed.")
+        qMin = tooNarrow.select(model->getJointLowerLimits().array(), qMin);
+        qMax = tooNarrow.select(model->getJointUpperLimits().array(), qMax);
+    }
+
+    lower = Eigen::ArrayXd::Constant(model->nbInternalDofs(), -aMax);
+    upper = Eigen::ArrayXd::Constant(model->nbInternalDofs(), aMax);
+    return addConstraint();
+}
+
+void ViableJointLimits::close()
+{
+    removeConstraint();
+}
+
+bool ViableJointLimits::attach(std::shared_ptr<IcubControllerServer> server)
+{
+    removeConstraint();
+    ctrlServer = server;
+    model = server->getRobotModel();
+    return addConstraint();
+}
+
+bool ViableJointLimits::addConstraint()
+{
+    int nJoints = model->nbInternalDofs();
+    int nDof = model->nbDofs();
+
+    // ocra inequality constraints are f(x) <= 0: ddq - upper <= 0 and lower - ddq <= 0 on the joint part of the acceleration variable.
+    Eigen::MatrixXd C = Eigen::MatrixXd::Zero(2*nJoints, nDof);
+    C.topRightCorner(nJoints, nJoints).setIdentity();
+    C.bottomRightCorner(nJoints, nJoints) = -Eigen::MatrixXd::Identity(nJoints, nJoints);
+    b.resize(2*nJoints);
+    b << -upper.matrix(), lower.matrix();
+
+    boundFunction = std::make_shared<ocra::LinearFunction>(model->getAccelerationVariable(), C, b);
+    boundConstraint = std::make_shared<ocra::LinearConstraint>(boundFunction.get(), false);
+    ctrlServer->addConstraint(*boundConstraint);
+    constraintIsAdded = true;
+    return true;
+}
+
+void ViableJointLimits::removeConstraint()
+{
+    if (constraintIsAdded) {
+        ctrlServer->removeConstraint(*boundConstraint);
+        constraintIsAdded = false;
+    }
+    boundConstraint.reset();
+    boundFunction.reset();
+}
+
+void ViableJointLimits::update()
+{
+    if (!constraintIsAdded) {
+        return;
+    }
+
+    computeBounds(model->getJointPositions().array(), model->getJointVelocities().array(), qMin, qMax, vMax, aMax, period, lower, upper);
+
+    int nJoints = lower.size();
+    b.head(nJoints) = -upper.matrix();
+    b.tail(nJoints) = lower.matrix();
+    boundFunction->changeb(b);
+}
+
+void ViableJointLimits::computeBounds(const Eigen::ArrayXd& q, const Eigen::ArrayXd& dq, const Eigen::ArrayXd& qMin, const Eigen::ArrayXd& qMax, double vMax, double aMax, double dt, Eigen::ArrayXd& lower, Eigen::ArrayXd& upper)
+{
+    const double dt2 = dt * dt;
+
+    // Largest acceleration after which the joint can still brake at aMax before qMax. It is the positive root of
+    // (dq + dt ddq)^2 = 2 aMax (qMax - q - dt dq - dt^2 ddq / 2). Outside the viable set the discriminant is negative and the bound brakes.
+    upper = ((aMax*aMax*dt2 - 4.0*aMax*dt*dq + 8.0*aMax*(qMax - q)).max(0.0).sqrt() - 2.0*dq - aMax*dt) / (2.0*dt);
+    upper = upper.min(2.0 * (qMax - q - dt*dq) / dt2).min((vMax - dq) / dt).min(aMax);
+
+    // Same bounds mirrored for qMin.
+    lower = (aMax*dt - 2.0*dq - (aMax*aMax*dt2 + 4.0*aMax*dt*dq + 8.0*aMax*(q - qMin)).max(0.0).sqrt()) / (2.0*dt);
+    lower = lower.max(2.0 * (qMin - q - dt*dq) / dt2).max((-vMax - dq) / dt).max(-aMax);
+
+    // The bounds cross when the state is already outside the viable set: brake as hard as allowed.
+    for (int i=0; i<q.size(); ++i) {
+        if (lower(i) > upper(i)) {
+            lower(i) = upper(i) = std::min(std::max(-dq(i) / dt, -aMax), aMax);
+        }
+    }
+}
+
+const Eigen::ArrayXd& ViableJointLimits::getLowerAccelerationBounds() const
+{
+    return lower;
+}
+
+const Eigen::ArrayXd& ViableJointLimits::getUpperAccelerationBounds() const
+{
+    return upper;
+}
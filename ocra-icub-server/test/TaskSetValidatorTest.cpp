@@ -0,0 +1,62 @@
+/*! \file       TaskSetValidatorTest.cpp
+ *  \brief      Checks that task set files pass the schema checks of TaskSetValidator.
+ *  \details    Usage:
+ *              test-task-set-validator taskSet.xml [taskSet.xml ...]
+ *
+ *              No robot is needed: the validator is built without a WBI, so the joints and segments are not looked up. Returns a non zero code if any file has an error.
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string>
+
+#include <ocra-icub-server/TaskSetValidator.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " taskSet.xml [taskSet.xml ...]" << std::endl;
+        return 1;
+    }
+
+    TaskSetValidator validator(nullptr);
+    int nFailed = 0;
+    for (int i=1; i<argc; ++i) {
+        std::string taskSetPath(argv[i]);
+        bool isValid = validator.validate(taskSetPath);
+        for (auto warning : validator.getWarnings()) {
+            std::cout << taskSetPath << ": warning: " << warning << std::endl;
+        }
+        for (auto error : validator.getErrors()) {
+            std::cout << taskSetPath << ": error: " << error << std::endl;
+        }
+        if (isValid && validator.getTasks().empty()) {
+            std::cout << taskSetPath << ": error: no task was found." << std::endl;
+            isValid = false;
+        }
+        if (!isValid) {
+            ++nFailed;
+        }
+        std::cout << taskSetPath << ": " << (isValid ? "OK" : "FAILED") << " (" << validator.getTasks().size() << " tasks)" << std::endl;
+    }
+    return (nFailed == 0) ? 0 : 1;
+}
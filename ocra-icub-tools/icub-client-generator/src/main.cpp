@@ -11,6 +11,7 @@ std::string getUninstallString();
 std::string getMainString(const std::string& clientName, const std::string& className);
 std::string getIncludeString(const std::string& clientName, const std::string& className);
 std::string getSourceString(const std::string& clientName, const std::string& className);
+std::string getTestString(const std::string& clientName, const std::string& className);
 
 
 
@@ -69,6 +70,9 @@ int main(int argc, char const *argv[])
     std::string sourceFolderPath = rootFolderPath + "/src";
     boost::filesystem::create_directory(sourceFolderPath);
 
+    std::string testFolderPath = rootFolderPath + "/test";
+    boost::filesystem::create_directory(testFolderPath);
+
     std::string buildFolderPath = rootFolderPath + "/build";
     boost::filesystem::create_directory(buildFolderPath);
 
@@ -123,6 +127,16 @@ int main(int argc, char const *argv[])
     }
     includeFile.close();
 
+    std::string testFilePath = testFolderPath + "/"+clientName+"-offline-test.cpp";
+    std::ofstream testFile;
+    testFile.open(testFilePath.c_str());
+    if (testFile.is_open()) {
+        testFile << getTestString(clientName, className);
+    } else {
+        std::cout << "[ERROR] Could not write file:\n\n-- " << boost::filesystem::canonical(testFilePath).string() << std::endl;
+    }
+    testFile.close();
+
 
 
 
@@ -189,19 +203,25 @@ std::string getIncludeString(const std::string& clientName, const std::string& c
 {
     std::string defString = className;
     std::transform(defString.begin(), defString.end(), defString.begin(), ::toupper);
-    std::string includeString = "\43ifndef "+defString+"_H\n\43define "+defString+"_H\n\n\43include <ocra-icub/IcubClient.h>\n\43include <ocra-recipes/TrajectoryThread.h>\n\43include <ocra-recipes/ControllerClient.h>\n\n\nclass "+className+" : public ocra_recipes::ControllerClient\n{\nDEFINE_CLASS_POINTER_TYPEDEFS("+className+")\n\npublic:\n    "+className+" (std::shared_ptr<ocra::Model> modelPtr, const int loopPeriod);\n    virtual ~"+className+" ();\n\nprotected:\n    virtual bool initialize();\n    virtual void release();\n    virtual void loop();\n\nprivate:\n\n};\n\n\n\43endif // "+defString+"_H\n";
+    std::string includeString = "\x23ifndef "+defString+"_H\n\43define "+defString+"_H\n\n\x23include <atomic>\n\n\x23include <ocra-icub/IcubClient.h>\n\x23include <ocra-icub/ClientLoopStatistics.h>\n\x23include <ocra-recipes/TrajectoryThread.h>\n\x23include <ocra-recipes/ControllerClient.h>\n\n\nclass "+className+" : public ocra_recipes::ControllerClient\n{\nDEFINE_CLASS_POINTER_TYPEDEFS("+className+")\n\npublic:\n    "+className+" (std::shared_ptr<ocra::Model> modelPtr, const int loopPeriod);\n    virtual ~"+className+" ();\n\n    /*! True once loop() has reached PHASE_DONE. */\n    bool isDone() const;\n    ocra_icub::ClientLoopStatistics& getLoopStatistics();\n\nprotected:\n    virtual bool initialize();\n    virtual void release();\n    virtual void loop();\n\nprivate:\n    /*! The phases of loop(). Add your own between PHASE_START and PHASE_DONE. */\n    enum LOOP_PHASE\n    {\n        PHASE_START,\n        PHASE_RUN,\n        PHASE_DONE\n    };\n\n    void setPhase(LOOP_PHASE newPhase);\n    double getTimeInPhase() const;\n\nprivate:\n    ocra_icub::ClientLoopStatistics loopStatistics;\n    LOOP_PHASE phase;\n    double phaseStartTime;\n    std::atomic<bool> done;\n};\n\n\n\43endif // "+defString+"_H\n";
     return includeString;
 }
 
 std::string getSourceString(const std::string& clientName, const std::string& className)
 {
-    std::string sourceString = "\x23include \""+clientName+"/"+className+".h\"\n"+className+"::"+className+"(std::shared_ptr<ocra::Model> modelPtr, const int loopPeriod)\n: ocra_recipes::ControllerClient(modelPtr, loopPeriod)\n{\n    // add your code here...\n}\n\n"+className+"::~"+className+"()\n{\n    // add your code here...\n}\n\nbool "+className+"::initialize()\n{\n    // add your code here...\n    return true;\n}\n\nvoid "+className+"::release()\n{\n    // add your code here...\n}\n\nvoid "+className+"::loop()\n{\n    // add your code here...\n}\n";
+    std::string sourceString = "\x23include \""+clientName+"/"+className+".h\"\n\n\x23include <yarp/os/Time.h>\n\n"+className+"::"+className+"(std::shared_ptr<ocra::Model> modelPtr, const int loopPeriod)\n: ocra_recipes::ControllerClient(modelPtr, loopPeriod)\n, loopStatistics(\""+clientName+"\", loopPeriod/1000.0)\n, phase(PHASE_START)\n, phaseStartTime(0.0)\n, done(false)\n{\n    // add your code here...\n}\n\n"+className+"::~"+className+"()\n{\n    // add your code here...\n}\n\nbool "+className+"::isDone() const\n{\n    return done;\n}\n\nocra_icub::ClientLoopStatistics& "+className+"::getLoopStatistics()\n{\n    return loopStatistics;\n}\n\nbool "+className+"::initialize()\n{\n    // The loop timing is served on /"+clientName+"/timing/rpc:i, e.g.: echo get | yarp rpc /"+clientName+"/timing/rpc:i\n    loopStatistics.open();\n    setPhase(PHASE_START);\n    // add your code here...\n    return true;\n}\n\nvoid "+className+"::release()\n{\n    // add your code here...\n    loopStatistics.close();\n}\n\nvoid "+className+"::loop()\n{\n    // loop() is called once per loopPeriod by the client thread. Never block inside it: no yarp::os::Time::delay(), no std::cin and no while loop waiting for a reply or a task error. To wait, stay in the current phase and check getTimeInPhase() or your condition again on the next call. Calls which last longer than loopPeriod are counted as overruns in the timing statistics.\n    ocra_icub::ClientLoopStatistics::Scope timing(loopStatistics);\n\n    switch (phase) {\n        case PHASE_START:\n        {\n            // add your code here, e.g. connect to the tasks and send the first references...\n            setPhase(PHASE_RUN);\n        }break;\n\n        case PHASE_RUN:\n        {\n            // add your code here, e.g. send the next reference and check the task errors...\n            if (getTimeInPhase() > 5.0) {\n                setPhase(PHASE_DONE);\n            }\n        }break;\n\n        case PHASE_DONE:\n        default:\n            break;\n    }\n}\n\nvoid "+className+"::setPhase(LOOP_PHASE newPhase)\n{\n    phase = newPhase;\n    phaseStartTime = yarp::os::Time::now();\n    done = (phase == PHASE_DONE);\n}\n\ndouble "+className+"::getTimeInPhase() const\n{\n    return yarp::os::Time::now() - phaseStartTime;\n}\n";
     return sourceString;
 }
 
+std::string getTestString(const std::string& clientName, const std::string& className)
+{
+    std::string testString = "/*! \\file       "+clientName+"-offline-test.cpp\n *  \\brief      Runs the client against the in-process stand-in server.\n *  \\details    No yarpserver, simulator or robot is needed. Options: --wbiConfigFile, --robot, --floatingBase, --taskSet, --speedUp, --duration (s) and --maxOverrunRatio.\n *              Returns 1 if the client could not run, did not reach PHASE_DONE or overran its loop period in more than maxOverrunRatio of the loops.\n *              The warm-up loops are not counted, see ocra_icub::ClientLoopStatistics.\n *  \\author     [Your Name](url of your github site)\n *  \\date       [date]\n *  \\copyright  GNU General Public License.\n */\n/*\n *  This file is part of "+clientName+".\n *  Copyright (C) [year] [institution]\n *\n *  This program is free software: you can redistribute it and/or modify\n *  it under the terms of the GNU General Public License as published by\n *  the Free Software Foundation, either version 3 of the License, or\n *  (at your option) any later version.\n *\n *  This program is distributed in the hope that it will be useful,\n *  but WITHOUT ANY WARRANTY; without even the implied warranty of\n *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n *  GNU General Public License for more details.\n *\n *  You should have received a copy of the GNU General Public License\n *  along with this program.  If not, see <http://www.gnu.org/licenses/>.\n*/\n\n\x23include <iostream>\n\n\x23include <yarp/os/ResourceFinder.h>\n\x23include <yarp/os/Network.h>\n\x23include <yarp/os/Time.h>\n\n\x23include <ocra-icub/ModelInitializer.h>\n\x23include <ocra-icub/StandInServer.h>\n\n\x23include \""+clientName+"/"+className+".h\"\n\nint main (int argc, char * argv[])\n{\n    // All the ports stay inside this process.\n    yarp::os::Network::setLocalMode(true);\n    yarp::os::Network yarp;\n\n    yarp::os::ResourceFinder rf;\n    rf.configure(argc,argv);\n\n    ocra_icub::StandInServerOptions options;\n    options.wbiConfigFilePath = rf.findFileByName(rf.check(\"wbiConfigFile\", yarp::os::Value(\"yarpWholeBodyInterface.ini\")).asString());\n    options.robotName = rf.check(\"robot\", yarp::os::Value(\"icubGazeboSim\")).asString();\n    options.isFloatingBase = rf.check(\"floatingBase\");\n    if (rf.check(\"taskSet\")) {\n        options.startupTaskSetPath = rf.findFileByName(rf.find(\"taskSet\").asString());\n    }\n    options.speedUp = rf.check(\"speedUp\", yarp::os::Value(1.0)).asDouble();\n    double duration = rf.check(\"duration\", yarp::os::Value(30.0)).asDouble();\n    double maxOverrunRatio = rf.check(\"maxOverrunRatio\", yarp::os::Value(0.01)).asDouble();\n\n    ocra_icub::StandInServer server(options);\n    if (!server.start()) {\n        std::cout << \"[ERROR] The stand-in server did not start.\" << std::endl;\n        return 1;\n    }\n\n    // Gets the model configuration from the stand-in server, as it would from ocra-icub-server.\n    ocra_icub::ModelInitializer modelIni = ocra_icub::ModelInitializer();\n    if (!modelIni.getModel()) {\n        std::cout << \"[ERROR] Could not build the model.\" << std::endl;\n        server.stop();\n        return 1;\n    }\n\n    int loopPeriod = 10;\n    std::shared_ptr<"+className+"> client = std::make_shared<"+className+">(modelIni.getModel(), loopPeriod);\n    if (!client->start()) {\n        std::cout << \"[ERROR] The client did not start.\" << std::endl;\n        server.stop();\n        return 1;\n    }\n\n    double startTime = yarp::os::Time::now();\n    while (!client->isDone() && (yarp::os::Time::now() - startTime) < duration) {\n        yarp::os::Time::delay(0.1);\n    }\n    bool clientIsDone = client->isDone();\n\n    ocra_icub::ClientLoopStatistics& stats = client->getLoopStatistics();\n    std::cout << \"loops: \" << stats.getNumberOfLoops() << std::endl;\n    std::cout << \"mean period: \" << stats.getMeanPeriod() << \" s, max period: \" << stats.getMaxPeriod() << \" s\" << std::endl;\n    std::cout << \"mean duration: \" << stats.getMeanDuration() << \" s, max duration: \" << stats.getMaxDuration() << \" s\" << std::endl;\n    std::cout << \"overruns: \" << stats.getNumberOfOverruns() << \" (\" << 100.0*stats.getOverrunRatio() << \" %)\" << std::endl;\n    bool failed = !clientIsDone || stats.getOverrunRatio() > maxOverrunRatio;\n\n    client->stop();\n    server.stop();\n\n    if (!clientIsDone) {\n        std::cout << \"[ERROR] The client did not reach PHASE_DONE within \" << duration << \" s.\" << std::endl;\n    }\n    if (stats.getOverrunRatio() > maxOverrunRatio) {\n        std::cout << \"[ERROR] The client overran its loop period in more than \" << 100.0*maxOverrunRatio << \" % of the loops.\" << std::endl;\n    }\n    return failed ? 1 : 0;\n}\n";
+    return testString;
+}
+
 std::string getCmakeString(const std::string& clientName)
 {
-    std::string cmakeString = "\x23 This file is part of "+clientName+".\n\x23 Copyright (C) [your institution here]\n\x23 author(s): [your name here]\n\x23\n\x23 This program is free software: you can redistribute it and/or modify\n\x23 it under the terms of the GNU General Public License as published by\n\x23 the Free Software Foundation, either version 3 of the License, or\n\x23 (at your option) any later version.\n\x23\n\x23 This program is distributed in the hope that it will be useful,\n\x23 but WITHOUT ANY WARRANTY; without even the implied warranty of\n\x23 MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n\x23 GNU General Public License for more details.\n\x23\n\x23 You should have received a copy of the GNU General Public License\n\x23 along with this program.  If not, see <http://www.gnu.org/licenses/>.\n\n\x23 Make sure we are working with at least CMake 2.8.12\ncmake_minimum_required(VERSION 2.8.12)\n\n\x23 Initiate the project\nPROJECT("+clientName+" CXX)\n\n\x23 Make sure you have a C++11 compatible compiler\ninclude(CheckCXXCompilerFlag)\nCHECK_CXX_COMPILER_FLAG(\"-std=c++11\" COMPILER_SUPPORTS_CXX11)\nif(COMPILER_SUPPORTS_CXX11)\n    set(CMAKE_CXX_FLAGS \"\x24{CMAKE_CXX_FLAGS} -std=c++11\")\nelse()\n    message(FATAL_ERROR \"The compiler \x24{CMAKE_CXX_COMPILER} has no C++11 support. Please use a different C++ compiler.\")\n endif() \n \n \x23 Build as Release (Change Release to Debug for better debugging symbols)\nset(CMAKE_BUILD_TYPE Release)\n\n\x23 Set the project version.\nset(\x24{PROJECT_NAME}_MAJOR_VERSION 1)\nset(\x24{PROJECT_NAME}_MINOR_VERSION 0)\nset(\x24{PROJECT_NAME}_PATCH_VERSION 0)\nset(\x24{PROJECT_NAME}_VERSION \x24{\x24{PROJECT_NAME}_MAJOR_VERSION}.\x24{\x24{PROJECT_NAME}_MINOR_VERSION}.\x24{\x24{PROJECT_NAME}_PATCH_VERSION})\n\n\x23 Add some helpful CMake functions\nlist(APPEND CMAKE_MODULE_PATH \x24{CMAKE_CURRENT_SOURCE_DIR}/cmake/Modules)\n\n\x23 Find OcraIcub\nfind_package(OcraIcub REQUIRED)\nIF(\x24{OcraIcub_FOUND})\n    message(\"-- Found OcraIcub version \x24{OcraIcub_VERSION}\")\nENDIF()\nset(CMAKE_EXPORT_COMPILE_COMMANDS ON)\n\x23 Get all of the source and header files.\nfile(GLOB folder_source src/*.cpp)\nfile(GLOB folder_header include/\x24{PROJECT_NAME}/*.h)\nsource_group(\"Source Files\" FILES \x24{folder_source})\nsource_group(\"Header Files\" FILES \x24{folder_header})\n\n\x23 Tell the compiler where to look for all other headers\ninclude_directories(\n\x24{PROJECT_SOURCE_DIR}/include\n\x24{OcraIcub_INCLUDE_DIRS}\n)\n\n\x23 Add the client executable (binary)\nadd_executable(\x24{PROJECT_NAME} \x24{folder_source} \x24{folder_header})\n\n\x23 Link to the appropriate libs\ntarget_link_libraries(\n\x24{PROJECT_NAME}\n\x24{OcraIcub_LIBRARIES}\n)\n\n\x23 Install to the bin/ directory if installed.\ninstall(TARGETS \x24{PROJECT_NAME} DESTINATION bin)\n\n\x23 Add an uninstallation target so you can just run - make uninstall - to remove the binary.\ninclude(AddUninstallTarget)\n";
+    std::string cmakeString = "\x23 This file is part of "+clientName+".\n\x23 Copyright (C) [your institution here]\n\x23 author(s): [your name here]\n\x23\n\x23 This program is free software: you can redistribute it and/or modify\n\x23 it under the terms of the GNU General Public License as published by\n\x23 the Free Software Foundation, either version 3 of the License, or\n\x23 (at your option) any later version.\n\x23\n\x23 This program is distributed in the hope that it will be useful,\n\x23 but WITHOUT ANY WARRANTY; without even the implied warranty of\n\x23 MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n\x23 GNU General Public License for more details.\n\x23\n\x23 You should have received a copy of the GNU General Public License\n\x23 along with this program.  If not, see <http://www.gnu.org/licenses/>.\n\n\x23 Make sure we are working with at least CMake 2.8.12\ncmake_minimum_required(VERSION 2.8.12)\n\n\x23 Initiate the project\nPROJECT("+clientName+" CXX)\n\n\x23 Make sure you have a C++11 compatible compiler\ninclude(CheckCXXCompilerFlag)\nCHECK_CXX_COMPILER_FLAG(\"-std=c++11\" COMPILER_SUPPORTS_CXX11)\nif(COMPILER_SUPPORTS_CXX11)\n    set(CMAKE_CXX_FLAGS \"\x24{CMAKE_CXX_FLAGS} -std=c++11\")\nelse()\n    message(FATAL_ERROR \"The compiler \x24{CMAKE_CXX_COMPILER} has no C++11 support. Please use a different C++ compiler.\")\n endif() \n \n \x23 Build as Release (Change Release to Debug for better debugging symbols)\nset(CMAKE_BUILD_TYPE Release)\n\n\x23 Set the project version.\nset(\x24{PROJECT_NAME}_MAJOR_VERSION 1)\nset(\x24{PROJECT_NAME}_MINOR_VERSION 0)\nset(\x24{PROJECT_NAME}_PATCH_VERSION 0)\nset(\x24{PROJECT_NAME}_VERSION \x24{\x24{PROJECT_NAME}_MAJOR_VERSION}.\x24{\x24{PROJECT_NAME}_MINOR_VERSION}.\x24{\x24{PROJECT_NAME}_PATCH_VERSION})\n\n\x23 Add some helpful CMake functions\nlist(APPEND CMAKE_MODULE_PATH \x24{CMAKE_CURRENT_SOURCE_DIR}/cmake/Modules)\n\n\x23 Find OcraIcub\nfind_package(OcraIcub REQUIRED)\nIF(\x24{OcraIcub_FOUND})\n    message(\"-- Found OcraIcub version \x24{OcraIcub_VERSION}\")\nENDIF()\nset(CMAKE_EXPORT_COMPILE_COMMANDS ON)\n\x23 Get all of the source and header files.\nfile(GLOB folder_source src/*.cpp)\nfile(GLOB folder_header include/\x24{PROJECT_NAME}/*.h)\nsource_group(\"Source Files\" FILES \x24{folder_source})\nsource_group(\"Header Files\" FILES \x24{folder_header})\n\n\x23 Tell the compiler where to look for all other headers\ninclude_directories(\n\x24{PROJECT_SOURCE_DIR}/include\n\x24{OcraIcub_INCLUDE_DIRS}\n)\n\n\x23 Add the client executable (binary)\nadd_executable(\x24{PROJECT_NAME} \x24{folder_source} \x24{folder_header})\n\n\x23 Link to the appropriate libs\ntarget_link_libraries(\n\x24{PROJECT_NAME}\n\x24{OcraIcub_LIBRARIES}\n)\n\n\x23 Install to the bin/ directory if installed.\ninstall(TARGETS \x24{PROJECT_NAME} DESTINATION bin)\n\n\x23 Optionally build a test which runs the client against the in-process stand-in server. No robot or simulator is needed.\noption(BUILD_OFFLINE_TEST \"Build \x24{PROJECT_NAME}-offline-test.\" OFF)\nif(BUILD_OFFLINE_TEST)\n    set(client_source \x24{folder_source})\n    list(REMOVE_ITEM client_source \x24{CMAKE_CURRENT_SOURCE_DIR}/src/main.cpp)\n    add_executable(\x24{PROJECT_NAME}-offline-test test/\x24{PROJECT_NAME}-offline-test.cpp \x24{client_source} \x24{folder_header})\n    target_link_libraries(\x24{PROJECT_NAME}-offline-test \x24{OcraIcub_LIBRARIES})\n    enable_testing()\n    add_test(NAME \x24{PROJECT_NAME}-offline-test COMMAND \x24{PROJECT_NAME}-offline-test)\nendif()\n\n\x23 Add an uninstallation target so you can just run - make uninstall - to remove the binary.\ninclude(AddUninstallTarget)\n";
     return cmakeString;
 }
 
@@ -0,0 +1,119 @@
+/*! \file       main.cpp
+ *  \brief      Fills the posture cache of several robot variants in parallel.
+ *  \details    Usage:
+ *              posture-cache-generator --variants "(name wbiConfigFile robot floatingBase) ..." [--requests "(double) (left 0.0 0.0 0.0 0.0 0.05) ..."] [--cacheDir dir]
+ *
+ *              The models are built one after the other, since the whole body interfaces are not thread safe while they are created, then the postures of every variant are computed in their own thread. Without --requests, the double, left and right support postures with default parameters are computed.
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Bottle.h>
+
+#include <ocra-icub/ModelInitializer.h>
+#include <ocra-icub/PostureGenerator.h>
+
+int main(int argc, char * argv[])
+{
+    yarp::os::Network yarp;
+
+    yarp::os::ResourceFinder rf;
+    rf.configure(argc, argv);
+
+    if (rf.check("help") || !rf.check("variants")) {
+        std::cout << "Usage: posture-cache-generator --variants \"(name wbiConfigFile robot floatingBase) ...\" [--requests \"(double) (left 0.0 0.0 0.0 0.0 0.05) ...\"] [--cacheDir dir]" << std::endl;
+        std::cout << "A request is (support comOffsetX comOffsetY comHeight feetSeparation swingFootHeight), support being double, left or right." << std::endl;
+        return rf.check("help") ? 0 : 1;
+    }
+
+    std::string cacheDir = rf.check("cacheDir", yarp::os::Value(ocra_icub::PostureGenerator::getDefaultCacheDirectory())).asString();
+
+    std::vector<ocra_icub::PostureRequest> requests;
+    if (rf.check("requests")) {
+        yarp::os::Bottle requestList;
+        requestList.fromString(rf.find("requests").toString());
+        for (int i=0; i<requestList.size(); ++i) {
+            ocra_icub::PostureRequest request;
+            if (!requestList.get(i).isList() || !request.fromBottle(*requestList.get(i).asList())) {
+                std::cout << "Invalid request: " << requestList.get(i).toString() << std::endl;
+                return 1;
+            }
+            requests.push_back(request);
+        }
+    } else {
+        for (int support=ocra_icub::POSTURE_DOUBLE_SUPPORT; support<=ocra_icub::POSTURE_RIGHT_SUPPORT; ++support) {
+            ocra_icub::PostureRequest request;
+            request.support = ocra_icub::POSTURE_SUPPORT(support);
+            requests.push_back(request);
+        }
+    }
+
+    yarp::os::Bottle variantList;
+    variantList.fromString(rf.find("variants").toString());
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<ocra_icub::ModelInitializer> > initializers;
+    for (int i=0; i<variantList.size(); ++i) {
+        yarp::os::Bottle* variant = variantList.get(i).asList();
+        if (variant == NULL || variant->size() != 4) {
+            std::cout << "Invalid variant: " << variantList.get(i).toString() << std::endl;
+            return 1;
+        }
+        std::cout << "Building the model of " << variant->get(0).asString() << std::endl;
+        auto initializer = std::make_shared<ocra_icub::ModelInitializer>(variant->get(1).asString(), variant->get(2).asString(), variant->get(3).asInt() != 0);
+        if (!initializer->getModel()) {
+            std::cout << "Could not build the model of " << variant->get(0).asString() << std::endl;
+            return 1;
+        }
+        names.push_back(variant->get(0).asString());
+        initializers.push_back(initializer);
+    }
+
+    std::atomic<int> failures(0);
+    std::vector<std::thread> workers;
+    for (size_t v=0; v<initializers.size(); ++v) {
+        workers.push_back(std::thread([&, v]() {
+            ocra_icub::PostureGenerator generator(initializers[v]->getModel(), cacheDir);
+            for (const auto& request : requests) {
+                Eigen::VectorXd q;
+                if (generator.getPosture(request, q)) {
+                    std::cout << names[v] << " (" << request.toString() << "): done." << std::endl;
+                } else {
+                    std::cout << names[v] << " (" << request.toString() << "): FAILED, residual " << generator.getLastResidual() << std::endl;
+                    ++failures;
+                }
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+/*! \file       ArbitratedReference.h
+ *  \brief      Task references which the controller server arbitrates between several clients.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_ARBITRATED_REFERENCE_H
+#define OCRA_ICUB_ARBITRATED_REFERENCE_H
+
+#include <string>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include <ocra/control/TaskState.h>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+/*! \struct ArbitratedReference
+ *  \brief A desired state sent by a client for one task, with the priority of the client and the blend to use when it takes the task over.
+ *
+ *  A reference with `release` set gives the task back, its state is ignored.
+ *
+ *  Bottle format: (clientName taskName priority blendTime release (field values...)...), the fields being any of (q ...), (qd ...), (qdd ...), (position x y z qw qx qy qz), (velocity rx ry rz vx vy vz) and (acceleration rx ry rz vx vy vz).
+ */
+struct ArbitratedReference
+{
+    std::string clientName;
+    std::string taskName;
+    int priority; /*!< Higher priorities preempt lower ones. */
+    double blendTime; /*!< Duration in seconds of the blend from the previous reference when this client takes the task over. */
+    bool release;
+    ocra::TaskState state;
+
+    ArbitratedReference();
+
+    void toBottle(yarp::os::Bottle& bottle) const;
+    bool fromBottle(const yarp::os::Bottle& bottle);
+};
+
+/*! \class ArbitratedReferenceSender
+ *  \brief Sends task references to the arbitration of the controller server instead of writing them to the tasks directly.
+ *
+ *  Clients which share tasks with other clients should send their references through this class: the server then decides which client drives each task and blends between them when the owner changes. References written directly to the task ports bypass the arbitration.
+ */
+class ArbitratedReferenceSender
+{
+CLASS_POINTER_TYPEDEFS(ArbitratedReferenceSender)
+
+public:
+    /*! Constructor
+     *  \param clientName Unique name of the client. Used to open /<clientName>/references:o.
+     *  \param priority Priority of the references of this client.
+     *  \param blendTime Duration in seconds of the blend when this client takes a task over.
+     */
+    ArbitratedReferenceSender(const std::string& clientName, int priority, double blendTime = 0.5);
+    virtual ~ArbitratedReferenceSender();
+
+    /*! Opens the port and connects it to the server.
+     *  \return True if the port was opened and connected.
+     */
+    bool open();
+    void close();
+
+    /*! Sends a desired state for a task. Never blocks the client loop.
+     */
+    void send(const std::string& taskName, const ocra::TaskState& state);
+
+    /*! Gives a task back so that a lower priority client can drive it.
+     */
+    void release(const std::string& taskName);
+
+    static const std::string SERVER_PORT_NAME; /*!< The reference input port of the controller server. */
+
+private:
+    std::string name;
+    int clientPriority;
+    double clientBlendTime;
+    yarp::os::BufferedPort<yarp::os::Bottle> port;
+    bool portIsOpen;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_ARBITRATED_REFERENCE_H
@@ -0,0 +1,83 @@
+/*! \file       ClientHeartbeat.h
+ *  \brief      Heartbeat published by the clients so the controller server can detect when they stall.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_CLIENT_HEARTBEAT_H
+#define OCRA_ICUB_CLIENT_HEARTBEAT_H
+
+#include <string>
+#include <vector>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+/*! \class ClientHeartbeat
+ *  \brief Publishes a heartbeat to the controller server watchdog.
+ *
+ *  A client calls beat() once per batch of references it sends. Each beat carries the client name, a sequence number, a timestamp and the names of the tasks the client drives. If the beats stop for longer than the server watchdog timeout, the server takes those tasks over and holds them (or brings them back to a safe posture) until the client comes back. The write never blocks the client loop.
+ */
+class ClientHeartbeat
+{
+CLASS_POINTER_TYPEDEFS(ClientHeartbeat)
+
+public:
+    /*! Constructor
+     *  \param clientName Unique name of the client. Used to open /<clientName>/heartbeat:o.
+     *  \param taskNames The tasks which this client drives and which the server should take over if it stalls.
+     */
+    ClientHeartbeat(const std::string& clientName, const std::vector<std::string>& taskNames);
+    virtual ~ClientHeartbeat();
+
+    /*! Opens the heartbeat port and connects it to the server watchdog.
+     *  \return True if the port was opened. A missing server connection is only a warning since the server may start later.
+     */
+    bool open();
+    void close();
+
+    /*! Publishes one heartbeat. Call it right after sending the references of a loop iteration.
+     */
+    void beat();
+
+    /*! Changes the list of tasks which are sent with the next beats.
+     */
+    void setTaskNames(const std::vector<std::string>& taskNames);
+
+    static const std::string WATCHDOG_PORT_NAME; /*!< The heartbeat input port of the controller server. */
+
+private:
+    std::string name;
+    std::vector<std::string> tasks;
+    yarp::os::BufferedPort<yarp::os::Bottle> port;
+    int sequence;
+    bool portIsOpen;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_CLIENT_HEARTBEAT_H
@@ -0,0 +1,130 @@
+/*! \file       ClientLoopStatistics.h
+ *  \brief      Timing statistics of a client loop, exposed on an rpc port.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_CLIENT_LOOP_STATISTICS_H
+#define OCRA_ICUB_CLIENT_LOOP_STATISTICS_H
+
+#include <mutex>
+#include <string>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/RpcServer.h>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+/*! \class ClientLoopStatistics
+ *  \brief Measures the period and the duration of the loop of a client.
+ *
+ *  Call startLoop() at the beginning and endLoop() at the end of ControllerClient::loop(), or declare a ClientLoopStatistics::Scope at its top. A loop whose duration exceeds the expected period is counted as an overrun: it is the sign of a blocking call, e.g. yarp::os::Time::delay() or std::cin, inside the loop.
+ *
+ *  The first warm-up loops after construction or reset() are not measured: they include the port connections and the first allocations. A single overrun can come from the scheduler, so judge a client on getOverrunRatio() rather than on getNumberOfOverruns() > 0.
+ *
+ *  The statistics are served on /<clientName>/timing/rpc:i. `get` replies (loops meanPeriod periodStdDev maxPeriod meanDuration maxDuration overruns), times in seconds, and `reset` restarts them.
+ */
+class ClientLoopStatistics
+{
+CLASS_POINTER_TYPEDEFS(ClientLoopStatistics)
+
+public:
+    /*! Measures the loop from its construction to its destruction.
+     */
+    class Scope
+    {
+    public:
+        Scope(ClientLoopStatistics& statistics);
+        ~Scope();
+    private:
+        ClientLoopStatistics& stats;
+    };
+
+    /*! Constructor
+     *  \param clientName Unique name of the client. Used to open /<clientName>/timing/rpc:i.
+     *  \param expectedPeriod The period of the client loop in seconds.
+     *  \param warmUpLoops The number of loops to ignore after construction or reset().
+     */
+    ClientLoopStatistics(const std::string& clientName, double expectedPeriod, int warmUpLoops = 10);
+    virtual ~ClientLoopStatistics();
+
+    bool open();
+    void close();
+
+    void startLoop();
+    void endLoop();
+    void reset();
+
+    int getNumberOfLoops();
+    int getNumberOfOverruns();
+    /*! Overruns per measured loop, 0.0 when no loop was measured. */
+    double getOverrunRatio();
+    double getMeanPeriod();
+    double getMaxPeriod();
+    double getMeanDuration();
+    double getMaxDuration();
+
+    /*! (loops meanPeriod periodStdDev maxPeriod meanDuration maxDuration overruns)
+     */
+    void toBottle(yarp::os::Bottle& bottle);
+
+private:
+    class RpcCallback : public yarp::os::PortReader
+    {
+    public:
+        RpcCallback(ClientLoopStatistics& statistics);
+        virtual bool read(yarp::os::ConnectionReader& connection);
+    private:
+        ClientLoopStatistics& stats;
+    };
+
+private:
+    std::string name;
+    double period;
+    int nWarmUpLoops;
+
+    std::mutex statsMutex;
+    double loopStart;
+    double previousStart;
+    int nSkippedLoops;
+    int nLoops;
+    int nPeriods;
+    int nOverruns;
+    double periodMean;
+    double periodM2; // Welford accumulator of the squared deviations.
+    double periodMax;
+    double durationMean;
+    double durationMax;
+
+    RpcCallback rpcCallback;
+    yarp::os::RpcServer rpcPort;
+    bool portIsOpen;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_CLIENT_LOOP_STATISTICS_H
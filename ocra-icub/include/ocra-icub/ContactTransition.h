@@ -0,0 +1,116 @@
+/*! \file       ContactTransition.h
+ *  \brief      Load-triggered release and acquisition of contact tasks, evaluated by the controller server.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_CONTACT_TRANSITION_H
+#define OCRA_ICUB_CONTACT_TRANSITION_H
+
+#include <string>
+
+#include <Eigen/Dense>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+enum CONTACT_TRANSITION_MODE
+{
+    CONTACT_DISARM = 0,             /*!< Removes the rule of the task. */
+    CONTACT_RELEASE,                /*!< Deactivates the task when its load falls below releaseLoad. */
+    CONTACT_ACQUIRE,                /*!< Activates the task when its load rises above acquireLoad. */
+    CONTACT_RELEASE_AND_ACQUIRE     /*!< Both. */
+};
+
+/*! \struct ContactTransitionRule
+ *  \brief Releases and/or acquires one contact task when the load it carries crosses a threshold.
+ *
+ *  The load is the projection of the contact force on loadAxis. It comes either from the model, i.e. the contact force computed by the solver for the task (`wrenchSource` equal to MODEL_WRENCH_SOURCE), or from a port streaming an estimated wrench (F/T sensors, skin or wholeBodyDynamics), whose name is given in `wrenchSource`. The solver force of an inactive task is zero, so acquisition needs a measured wrench.
+ *
+ *  The two thresholds form a hysteresis: the contact is considered unloaded below releaseLoad and loaded again above acquireLoad, and the change must hold for holdTicks control ticks. With holdTicks = 1 the task is switched on the tick where the threshold is crossed.
+ *
+ *  Bottle format: (taskName mode releaseLoad acquireLoad holdTicks oneShot wrenchSource (ax ay az)).
+ */
+struct ContactTransitionRule
+{
+    std::string taskName;
+    CONTACT_TRANSITION_MODE mode;
+    double releaseLoad; /*!< Load below which the contact is released (N). */
+    double acquireLoad; /*!< Load above which the contact is acquired (N). Must be larger than releaseLoad. */
+    int holdTicks; /*!< Number of ticks a crossing must hold before the task is switched. */
+    bool oneShot; /*!< If true the rule is removed after its first transition. */
+    std::string wrenchSource; /*!< MODEL_WRENCH_SOURCE or the name of a port streaming a wrench (fx fy fz ...). */
+    Eigen::Vector3d loadAxis; /*!< Direction of the force measured as load, in the frame of the wrench. */
+
+    ContactTransitionRule();
+
+    void toBottle(yarp::os::Bottle& bottle) const;
+    bool fromBottle(const yarp::os::Bottle& bottle);
+
+    static const std::string MODEL_WRENCH_SOURCE;
+};
+
+/*! \class ContactTransitionSender
+ *  \brief Sends contact transition rules to the controller server.
+ *
+ *  The server evaluates the rules on every control tick, so a contact is released or acquired on the tick where its load crosses the threshold rather than after the client has noticed it. Events are published by the server on /ocra-icub-server/contacts/events:o.
+ */
+class ContactTransitionSender
+{
+CLASS_POINTER_TYPEDEFS(ContactTransitionSender)
+
+public:
+    /*! Constructor
+     *  \param clientName Unique name of the client. Used to open /<clientName>/contacts:o.
+     */
+    ContactTransitionSender(const std::string& clientName);
+    virtual ~ContactTransitionSender();
+
+    /*! Opens the port and connects it to the server.
+     *  \return True if the port was opened and connected.
+     */
+    bool open();
+    void close();
+
+    /*! Arms a rule. It replaces the previous rule of the same task.
+     */
+    void send(const ContactTransitionRule& rule);
+
+    /*! Removes the rule of a task.
+     */
+    void disarm(const std::string& taskName);
+
+    static const std::string SERVER_PORT_NAME; /*!< The rule input port of the controller server. */
+
+private:
+    std::string name;
+    yarp::os::BufferedPort<yarp::os::Bottle> port;
+    bool portIsOpen;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_CONTACT_TRANSITION_H
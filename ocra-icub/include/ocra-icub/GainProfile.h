@@ -0,0 +1,108 @@
+/*! \file       GainProfile.h
+ *  \brief      Time-parameterised stiffness and damping changes interpolated by the controller server.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_GAIN_PROFILE_H
+#define OCRA_ICUB_GAIN_PROFILE_H
+
+#include <string>
+
+#include <Eigen/Dense>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+enum GAIN_INTERPOLATION
+{
+    GAIN_STEP = 0,      /*!< The target gains are applied at once, at the end of the duration. */
+    GAIN_LINEAR,        /*!< Constant rate of change. */
+    GAIN_MIN_JERK       /*!< Minimum jerk profile, with zero rate of change at both ends. */
+};
+
+/*! \struct GainProfile
+ *  \brief A change of the stiffness and/or damping of one task, interpolated by the server on every control tick.
+ *
+ *  The interpolation starts from the gains of the task when the server receives the profile. A profile received for a task which is still being interpolated replaces the previous one from the gains reached so far. Since the gains are a convex combination of the initial and target matrices, symmetric positive (semi-)definite targets keep the gains positive (semi-)definite all along the profile.
+ *
+ *  Bottle format: (taskName interpolation duration (rows cols stiffness...) (rows cols damping...)). An empty matrix leaves the corresponding gain unchanged and a 1x1 matrix stands for a scalar times the identity.
+ */
+struct GainProfile
+{
+    std::string taskName;
+    Eigen::MatrixXd stiffness; /*!< Target stiffness. Empty to keep the current one. */
+    Eigen::MatrixXd damping; /*!< Target damping. Empty to keep the current one. */
+    double duration; /*!< Duration of the transition in seconds. */
+    GAIN_INTERPOLATION interpolation;
+
+    GainProfile();
+
+    /*! \return The interpolation parameter, from 0 at the start to 1 at the end of the profile, after t seconds.
+     */
+    double progress(double t) const;
+
+    void toBottle(yarp::os::Bottle& bottle) const;
+    bool fromBottle(const yarp::os::Bottle& bottle);
+};
+
+/*! \class GainProfileSender
+ *  \brief Sends gain profiles to the controller server.
+ *
+ *  A client sends a profile once and the server interpolates the gains inside its control loop, so smooth gain changes do not need a message on every tick.
+ */
+class GainProfileSender
+{
+CLASS_POINTER_TYPEDEFS(GainProfileSender)
+
+public:
+    /*! Constructor
+     *  \param clientName Unique name of the client. Used to open /<clientName>/gains:o.
+     */
+    GainProfileSender(const std::string& clientName);
+    virtual ~GainProfileSender();
+
+    /*! Opens the port and connects it to the server.
+     *  \return True if the port was opened and connected.
+     */
+    bool open();
+    void close();
+
+    /*! Sends a profile. Never blocks the client loop.
+     */
+    void send(const GainProfile& profile);
+
+    static const std::string SERVER_PORT_NAME; /*!< The gain profile input port of the controller server. */
+
+private:
+    std::string name;
+    yarp::os::BufferedPort<yarp::os::Bottle> port;
+    bool portIsOpen;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_GAIN_PROFILE_H
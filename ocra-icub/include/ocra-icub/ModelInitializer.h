@@ -34,6 +34,8 @@ private:
 
 public:
     ModelInitializer ();
+    /*! Builds the model without asking the controller server for its configuration, e.g. for offline tools. */
+    ModelInitializer (const std::string& wbiConfigFile, const std::string& robot, bool floatingBase);
     virtual ~ModelInitializer ();
 
     std::shared_ptr<ocra::Model> getModel(){return model;}
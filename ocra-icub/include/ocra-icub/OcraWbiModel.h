@@ -101,6 +101,26 @@ public:
     virtual const Eigen::Matrix<double,6,Eigen::Dynamic>&  getJointJacobian            (int index) const;
     virtual const Eigen::Twistd&                           getSegmentJdotQdot          (int index) const;
 
+//==========================Multi-rate update functions=======================//
+    /*! The mass matrix and its inverse are refreshed every nTicks calls to setState. 1 (default) refreshes on every tick, <= 0 only refreshes when the drift threshold is exceeded.
+     *
+     *  Only M and Minv may be stale, by at most nTicks - 1 ticks or the drift threshold. The segment and CoM Jacobians, the segment velocities, the nonlinear and gravity terms and the CoM quantities are computed from the current state on every tick.
+     */
+    void                                                   setModelUpdatePeriod        (int nTicks);
+    /*! Forces a refresh when the configuration drift (norm of the joint displacement plus root rotation angle since the last refresh) exceeds maxDrift. <= 0 disables it.
+     */
+    void                                                   setModelUpdateThreshold     (double maxDrift);
+    int                                                    getModelUpdatePeriod        () const;
+    double                                                 getModelUpdateThreshold     () const;
+    int                                                    getTicksSinceModelRefresh   () const;
+    double                                                 getConfigurationDrift       () const;
+    /*! First order estimate of the relative error (Frobenius norm) of the mass matrix currently in use: the sensitivity measured between the last two refreshes times the current drift.
+     */
+    double                                                 getInertiaApproximationError() const;
+    /*! Relative change of the mass matrix measured at the last refresh.
+     */
+    double                                                 getInertiaRefreshError      () const;
+
     void printAllData();
 
     // void getJointTorques(Eigen::VectorXd& wbiTorques);
@@ -129,6 +149,11 @@ protected:
     virtual const std::string   doSegmentName           (const std::string& name) const;
     virtual const std::string   doDofName               (const std::string& name) const;
 
+//===========================Multi-rate update helpers========================//
+    void                        updateMultiRateState    ();
+    void                        invalidateConfigurationDependentQuantities(bool includeSlowQuantities);
+    double                      computeConfigurationDrift() const;
+
 private:
     std::shared_ptr<wbi::wholeBodyInterface> robot; // Access to wholeBodyInterface
     struct OcraWbiModel_pimpl;
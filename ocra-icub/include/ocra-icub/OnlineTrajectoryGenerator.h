@@ -0,0 +1,97 @@
+/*! \file       OnlineTrajectoryGenerator.h
+ *  \brief      Velocity and acceleration limited trajectory towards a goal which can change at any time.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_ONLINE_TRAJECTORY_GENERATOR_H
+#define OCRA_ICUB_ONLINE_TRAJECTORY_GENERATOR_H
+
+#include <Eigen/Dense>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+/*! \class OnlineTrajectoryGenerator
+ *  \brief Generates, one sample at a time, the time-optimal motion to a goal under velocity and acceleration limits.
+ *
+ *  Unlike a trajectory built from a waypoint list, nothing is precomputed: every call to step() decides the acceleration of the next sample from the current position and velocity, so setGoal() can be called at any time and the motion continues from the current state without stopping. The velocity is steered towards the direction of the goal with the largest speed from which the discrete braking at the acceleration limit still stops exactly on the goal, so there is no overshoot or chattering at the end of a motion. The cost of step() is a few operations per axis and it never allocates.
+ *
+ *  The limits apply to the norm of the velocity and acceleration. A motion which starts at rest is a straight line. The acceleration is bounded but, as with a time optimal trajectory, it is not continuous.
+ */
+class OnlineTrajectoryGenerator
+{
+CLASS_POINTER_TYPEDEFS(OnlineTrajectoryGenerator)
+
+public:
+    /*! Constructor
+     *  \param dimension Number of axes.
+     *  \param period Sampling period in seconds.
+     *  \param maxVelocity Limit of the norm of the velocity.
+     *  \param maxAcceleration Limit of the norm of the acceleration.
+     */
+    OnlineTrajectoryGenerator(int dimension, double period, double maxVelocity, double maxAcceleration);
+    virtual ~OnlineTrajectoryGenerator();
+
+    /*! Sets the state from which the next sample is generated, e.g. the measured or desired state of the task. The goal is set to the position.
+     */
+    void reset(const Eigen::VectorXd& position, const Eigen::VectorXd& velocity);
+
+    /*! Sets a new goal. The motion continues from the current state.
+     */
+    void setGoal(const Eigen::VectorXd& goal);
+
+    void setMaxVelocity(double maxVelocity);
+    void setMaxAcceleration(double maxAcceleration);
+
+    /*! Advances the trajectory by one period.
+     */
+    void step();
+
+    const Eigen::VectorXd& getPosition() const;
+    const Eigen::VectorXd& getVelocity() const;
+    const Eigen::VectorXd& getAcceleration() const;
+    const Eigen::VectorXd& getGoal() const;
+
+    /*! \return True once the goal has been reached with zero velocity.
+     */
+    bool isGoalReached() const;
+
+private:
+    double dt;
+    double vMax;
+    double aMax;
+    bool goalReached;
+
+    Eigen::VectorXd x;
+    Eigen::VectorXd v;
+    Eigen::VectorXd a;
+    Eigen::VectorXd target;
+    Eigen::VectorXd error;
+    Eigen::VectorXd deltaVelocity;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_ONLINE_TRAJECTORY_GENERATOR_H
@@ -0,0 +1,104 @@
+/*! \file       OnlineTrajectoryThread.h
+ *  \brief      Drives the desired position of a task with an OnlineTrajectoryGenerator.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_ONLINE_TRAJECTORY_THREAD_H
+#define OCRA_ICUB_ONLINE_TRAJECTORY_THREAD_H
+
+#include <mutex>
+#include <string>
+
+#include <Eigen/Dense>
+#include <yarp/os/RateThread.h>
+
+#include <ocra/control/TaskState.h>
+#include <ocra-recipes/TaskConnection.h>
+
+#include "ocra-icub/Utilities.h"
+#include "ocra-icub/OnlineTrajectoryGenerator.h"
+
+namespace ocra_icub
+{
+
+/*! \class OnlineTrajectoryThread
+ *  \brief Sends the position, velocity and acceleration of an OnlineTrajectoryGenerator to a position task (e.g. the CoM task) on every period.
+ *
+ *  A drop-in for a TrajectoryThread whose goal changes often: setGoal() can be called from any thread at any time, and the trajectory bends towards the new goal from its current position and velocity instead of restarting from rest. The trajectory starts from the desired state of the task when the thread starts.
+ */
+class OnlineTrajectoryThread : public yarp::os::RateThread
+{
+CLASS_POINTER_TYPEDEFS(OnlineTrajectoryThread)
+
+public:
+    /*! Constructor
+     *  \param period Period of the thread in ms.
+     *  \param taskName Name of the position task to drive.
+     *  \param maxVelocity Limit of the norm of the velocity (m/s).
+     *  \param maxAcceleration Limit of the norm of the acceleration (m/s^2).
+     */
+    OnlineTrajectoryThread(int period, const std::string& taskName, double maxVelocity, double maxAcceleration);
+    virtual ~OnlineTrajectoryThread();
+
+    virtual bool threadInit();
+    virtual void run();
+    virtual void threadRelease();
+
+    /*! Sets a new goal, used from the next period on.
+     */
+    void setGoal(const Eigen::Vector3d& goal);
+
+    /*! \return The last goal set, or the starting position if there is none.
+     */
+    Eigen::Vector3d getGoal();
+
+    void setMaxVelocity(double maxVelocity);
+    void setMaxAcceleration(double maxAcceleration);
+
+    /*! \return True once the last goal set has been reached.
+     */
+    bool isGoalReached();
+
+    /*! \return The distance from the last position sent to the task to the last goal set. Lets a caller pass the next goal before the trajectory stops on the current one.
+     */
+    double getDistanceToGoal();
+
+private:
+    std::string name;
+    ocra_recipes::TaskConnection::Ptr task;
+    OnlineTrajectoryGenerator generator;
+    ocra::TaskState desiredState;
+
+    std::mutex goalMutex;
+    Eigen::Vector3d goal;
+    Eigen::Vector3d position;
+    bool newGoal;
+    bool goalReached;
+    double maxVel;
+    double maxAcc;
+    bool newLimits;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_ONLINE_TRAJECTORY_THREAD_H
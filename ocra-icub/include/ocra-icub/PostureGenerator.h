@@ -0,0 +1,135 @@
+/*! \file       PostureGenerator.h
+ *  \brief      Statically balanced postures computed on the model and cached on disk.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_POSTURE_GENERATOR_H
+#define OCRA_ICUB_POSTURE_GENERATOR_H
+
+#include <memory>
+#include <string>
+
+#include <Eigen/Dense>
+#include <yarp/os/Bottle.h>
+
+#include <ocra/control/Model.h>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+enum POSTURE_SUPPORT
+{
+    POSTURE_DOUBLE_SUPPORT = 0,  /*!< Both soles flat on the ground, side by side. */
+    POSTURE_LEFT_SUPPORT,        /*!< Standing on the left sole, the right one lifted. */
+    POSTURE_RIGHT_SUPPORT        /*!< Standing on the right sole, the left one lifted. */
+};
+
+/*! \struct PostureRequest
+ *  \brief What a posture must satisfy. Positions are expressed in the frame of the stance sole (the right one in double support).
+ *
+ *  Bottle format: (support comOffsetX comOffsetY comHeight feetSeparation swingFootHeight), with support one of `double`, `left` or `right`.
+ */
+struct PostureRequest
+{
+    POSTURE_SUPPORT support;
+    Eigen::Vector2d comOffset; /*!< Offset of the CoM from the centre of the support polygon (m). */
+    double comHeight; /*!< Height of the CoM above the stance sole (m). <= 0 leaves it free. */
+    double feetSeparation; /*!< Lateral distance between the soles (m). <= 0 keeps the one of the reference posture. */
+    double swingFootHeight; /*!< Height of the lifted sole in single support (m). */
+
+    PostureRequest();
+
+    /*! \return A canonical description of the request, used as part of the cache key.
+     */
+    std::string toString() const;
+    bool fromBottle(const yarp::os::Bottle& bottle);
+};
+
+/*! \class PostureGenerator
+ *  \brief Computes statically balanced postures of the model by inverse kinematics, and caches them on disk.
+ *
+ *  A posture puts the CoM over the centre of the support polygon (plus the requested offset), keeps the soles flat and parallel, and stays within the joint limits. It is found with a damped least squares iteration started from, and regularised towards, a reference posture (by default the hand-tuned getNominalPosture()), so the joints which do not matter for balance, e.g. the arms, keep their reference values.
+ *
+ *  Results are stored in the cache directory in one text file per posture, keyed by the model (its name, joint names and joint limits) and the request, so the optimisation only runs once per robot variant and request. Files are written to a temporary file first and then renamed, so several processes can fill the same cache.
+ *
+ *  The state of the model is changed during the optimisation and restored afterwards, so do not use it from another thread while computing.
+ */
+class PostureGenerator
+{
+CLASS_POINTER_TYPEDEFS(PostureGenerator)
+
+public:
+    /*! Constructor
+     *  \param model The model of the robot.
+     *  \param cacheDirectory Directory of the cache. Empty uses getDefaultCacheDirectory().
+     */
+    PostureGenerator(std::shared_ptr<ocra::Model> model, const std::string& cacheDirectory = "");
+    virtual ~PostureGenerator();
+
+    /*! Sets the posture the optimisation starts from and is regularised towards. It is part of the cache key.
+     */
+    void setReferencePosture(const Eigen::VectorXd& reference);
+
+    /*! Loads the posture from the cache or computes and caches it.
+     *  \param request The requested support and CoM location.
+     *  \param[out] q The joint positions.
+     *  \return False if the optimisation did not converge. q is then the best posture found, and is not cached.
+     */
+    bool getPosture(const PostureRequest& request, Eigen::VectorXd& q);
+
+    /*! Only loads the posture from the cache, e.g. during a startup which must not wait for the optimisation. Fill the cache offline with posture-cache-generator.
+     *  \return False if the posture is not in the cache. q is then left untouched.
+     */
+    bool getCachedPosture(const PostureRequest& request, Eigen::VectorXd& q) const;
+
+    /*! Computes the posture without using the cache.
+     */
+    bool computePosture(const PostureRequest& request, Eigen::VectorXd& q);
+
+    /*! \return The residual of the task errors of the last computed posture.
+     */
+    double getLastResidual() const;
+
+    /*! \return $OCRA_ICUB_POSTURE_CACHE if it is set, $HOME/.ocra-icub/postures otherwise.
+     */
+    static std::string getDefaultCacheDirectory();
+
+private:
+    std::string getCacheKey(const PostureRequest& request) const;
+    std::string getCacheFilePath(const std::string& key) const;
+    bool loadFromCache(const std::string& key, Eigen::VectorXd& q) const;
+    void saveToCache(const std::string& key, const Eigen::VectorXd& q) const;
+    void setJointPositions(const Eigen::VectorXd& q);
+
+private:
+    std::shared_ptr<ocra::Model> model;
+    std::string cacheDir;
+    Eigen::VectorXd referencePosture;
+    double lastResidual;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_POSTURE_GENERATOR_H
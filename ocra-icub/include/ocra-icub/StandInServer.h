@@ -0,0 +1,181 @@
+/*! \file       StandInServer.h
+ *  \brief      A controller server which runs inside the process of a client, on a kinematic model of the robot.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_STAND_IN_SERVER_H
+#define OCRA_ICUB_STAND_IN_SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <Eigen/Dense>
+#include <Eigen/Lgsm>
+
+#include <yarp/os/RateThread.h>
+#include <yarp/os/RpcServer.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/Bottle.h>
+
+#include <ocra/control/Model.h>
+#include <ocra-recipes/ControllerServer.h>
+
+#include "ocra-icub/Utilities.h"
+#include "ocra-icub/ModelInitializer.h"
+
+namespace ocra_icub
+{
+
+/*! \struct StandInServerOptions
+ *  \brief The options of a StandInServer. The model ones are those of ocra-icub-server.
+ */
+struct StandInServerOptions
+{
+    std::string wbiConfigFilePath;
+    std::string robotName;
+    bool isFloatingBase;
+    std::string startupTaskSetPath; /*!< Tasks added at start up. Empty starts without tasks. */
+    ocra_recipes::CONTROLLER_TYPE controllerType;
+    ocra_recipes::SOLVER_TYPE solver;
+    int threadPeriod; /*!< The simulated control period in ms. */
+    double speedUp; /*!< Ratio of simulated time to wall time. The thread runs every threadPeriod/speedUp ms. */
+
+    StandInServerOptions();
+};
+
+/*! \class StandInControllerServer
+ *  \brief An ocra_recipes::ControllerServer whose robot is a double integrator of the joint accelerations found by the controller.
+ *
+ *  No robot, simulator or whole body interface state is needed. The joint positions are kept within the joint limits of the model. With a free base, the root twist is integrated in the world frame, like the base estimates of the real server.
+ */
+class StandInControllerServer : public ocra_recipes::ControllerServer
+{
+CLASS_POINTER_TYPEDEFS(StandInControllerServer)
+
+public:
+    /*! Constructor
+     *  \param robotModel The model of the robot. It becomes the model of the controller.
+     */
+    StandInControllerServer(std::shared_ptr<ocra::Model> robotModel,
+                            const ocra_recipes::CONTROLLER_TYPE ctrlType=ocra_recipes::WOCRA_CONTROLLER,
+                            const ocra_recipes::SOLVER_TYPE solver=ocra_recipes::QUADPROG);
+    virtual ~StandInControllerServer();
+
+    virtual ocra::Model::Ptr loadRobotModel();
+    virtual void getRobotState(Eigen::VectorXd& q, Eigen::VectorXd& qd, Eigen::Displacementd& H_root, Eigen::Twistd& T_root);
+
+    /*! Sets the state of the robot, e.g. the initial posture, and zeroes its velocity.
+     */
+    void setJointPositions(const Eigen::VectorXd& q);
+
+    /*! Integrates the accelerations of the last call to computeTorques() over dt.
+     *  \param dt The simulated time step in seconds.
+     */
+    void integrate(double dt);
+
+private:
+    std::shared_ptr<ocra::Model> robot;
+    int nDoF;
+
+    Eigen::VectorXd jointPositions;
+    Eigen::VectorXd jointVelocities;
+    Eigen::Displacementd rootPosition;
+    Eigen::VectorXd rootVelocity; /*!< (angular, linear) in the world frame. */
+};
+
+/*! \class StandInServer
+ *  \brief A stand-in for ocra-icub-server which clients can run in their own process, e.g. with yarp::os::Network::setLocalMode(true), to test their logic and measure their loop cost without a robot or a simulator.
+ *
+ *  The tasks and their ports are those of the real server since they come from ocra_recipes::ControllerServer, and /ocra-icub-server/info/rpc:i answers the same messages (GET_MODEL_CONFIG_INFO, GET_CONTROLLER_SERVER_STATUS, GET_L_FOOT_POSE, GET_MODEL_UPDATE_INFO, as tags or strings), so clients and ModelInitializer need no change. Controller swaps are refused. The watchdog, arbitration, gain scheduling and convergence ports of the real server are not provided.
+ *
+ *  Each tick solves the controller and integrates the joint accelerations, not the torques, so the robot follows the task references as a kinematic chain: there is no gravity, no contact force and no torque limit. The simulated time advances threadPeriod per tick, speedUp times faster than the wall clock when the host keeps up. getRealTimeFactor() tells whether it does.
+ */
+class StandInServer : public yarp::os::RateThread
+{
+CLASS_POINTER_TYPEDEFS(StandInServer)
+
+public:
+    StandInServer(const StandInServerOptions& options);
+    virtual ~StandInServer();
+
+    virtual bool threadInit();
+    virtual void run();
+    virtual void threadRelease();
+
+    /*! \return The model the controller works on. Use it from the server thread only, clients should build their own with ModelInitializer.
+     */
+    std::shared_ptr<ocra::Model> getModel();
+    std::shared_ptr<StandInControllerServer> getControllerServer();
+
+    /*! \return Simulated time since the start in seconds.
+     */
+    double getSimulatedTime() const;
+    int getNumberOfTicks() const;
+    double getMeanTickDuration() const;
+    /*! \return Simulated time over wall time since the start. Lower than the speed up if the ticks take too long.
+     */
+    double getRealTimeFactor() const;
+    int getNumberOfRpcRequests() const;
+
+private:
+    /*! \class RpcCallback
+     *  \brief Binds /ocra-icub-server/info/rpc:i to parseIncomingMessage().
+     */
+    class RpcCallback : public yarp::os::PortReader
+    {
+    public:
+        RpcCallback(StandInServer& serverRef);
+        virtual bool read(yarp::os::ConnectionReader& connection);
+    private:
+        StandInServer& server;
+    };
+
+    void parseIncomingMessage(yarp::os::Bottle& input, yarp::os::Bottle& reply);
+    OCRA_ICUB_MESSAGE convertStringToOcraIcubMessage(const std::string& s);
+
+private:
+    StandInServerOptions options;
+    std::shared_ptr<ModelInitializer> modelInitializer;
+    std::shared_ptr<StandInControllerServer> ctrlServer;
+    std::shared_ptr<ocra::Model> model;
+    Eigen::VectorXd torques;
+    Eigen::Displacementd l_foot_disp_inverse;
+
+    RpcCallback rpcCallback;
+    yarp::os::RpcServer rpcPort;
+
+    std::atomic<int> controllerStatus;
+    std::atomic<int> nRpcRequests;
+
+    mutable std::mutex statsMutex;
+    int nTicks;
+    double tickDurationSum;
+    double startTime;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_STAND_IN_SERVER_H
@@ -0,0 +1,125 @@
+/*! \file       TaskConvergence.h
+ *  \brief      Per tick errors and convergence flags of the active tasks, published by the controller server.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCRA_ICUB_TASK_CONVERGENCE_H
+#define OCRA_ICUB_TASK_CONVERGENCE_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include "ocra-icub/Utilities.h"
+
+namespace ocra_icub
+{
+
+/*! \struct TaskConvergence
+ *  \brief Distance of a task to its desired state on one control tick.
+ *
+ *  The errors are norms: joint space tasks report the position error in rad and no orientation error, Cartesian tasks the translation error in m and the rotation angle in rad. The velocity error is the norm of the joint velocity or twist error.
+ *
+ *  Bottle format of the server message: (tick time (taskName positionError orientationError velocityError converged) ...), with one entry per active task.
+ */
+struct TaskConvergence
+{
+    std::string taskName;
+    double positionError;
+    double orientationError;
+    double velocityError;
+    bool converged; /*!< True when all the errors are below the thresholds of the server. */
+
+    TaskConvergence();
+
+    void toBottle(yarp::os::Bottle& bottle) const;
+    bool fromBottle(const yarp::os::Bottle& bottle);
+};
+
+/*! \class TaskConvergenceListener
+ *  \brief Keeps the latest convergence message of the controller server, so clients check convergence locally instead of fetching the task states.
+ */
+class TaskConvergenceListener
+{
+CLASS_POINTER_TYPEDEFS(TaskConvergenceListener)
+
+public:
+    /*! Constructor
+     *  \param clientName Unique name of the client. Used to open /<clientName>/convergence:i.
+     */
+    TaskConvergenceListener(const std::string& clientName);
+    virtual ~TaskConvergenceListener();
+
+    /*! Opens the port and connects the server to it.
+     *  \return True if the port was opened and connected.
+     */
+    bool open();
+    void close();
+
+    /*! \param taskName The task.
+     *  \param[out] convergence The latest errors of the task.
+     *  \return False if the task was not active on the last received tick.
+     */
+    bool getConvergence(const std::string& taskName, TaskConvergence& convergence);
+
+    /*! \return True if the task was active and converged on the last received tick.
+     */
+    bool isConverged(const std::string& taskName);
+
+    /*! \return True if the task was active on the last received tick and its position error is below the threshold. Lets a client use its own tolerance.
+     */
+    bool isConverged(const std::string& taskName, double positionThreshold);
+
+    /*! \return The tick of the server of the last received message, -1 before the first one.
+     */
+    int getLastTick();
+
+    static const std::string SERVER_PORT_NAME; /*!< The convergence output port of the controller server. */
+
+private:
+    class StatusPort : public yarp::os::BufferedPort<yarp::os::Bottle>
+    {
+    public:
+        StatusPort(TaskConvergenceListener& listener);
+        using yarp::os::BufferedPort<yarp::os::Bottle>::onRead;
+        virtual void onRead(yarp::os::Bottle& bottle);
+    private:
+        TaskConvergenceListener& owner;
+    };
+
+private:
+    std::string name;
+    StatusPort port;
+    bool portIsOpen;
+
+    std::mutex statusMutex;
+    std::map<std::string, TaskConvergence> tasks;
+    int lastTick;
+};
+
+} /* ocra_icub */
+
+#endif // OCRA_ICUB_TASK_CONVERGENCE_H
@@ -31,6 +31,7 @@
  */
 
 // STL includes
+#include <cstdint>
 #include <memory>
 #include <cmath>
 #include <iostream>
@@ -104,12 +105,21 @@ enum OCRA_ICUB_MESSAGE
 
     GET_L_FOOT_POSE,
 
+    GET_MODEL_UPDATE_INFO,
+
+    SWAP_CONTROLLER,
+    GET_CONTROLLER_SWAP_STATUS,
+
     HELP
 };
 
+/*! Hand-tuned postures, set joint by joint. They are not checked against balance or the joint limits of the model; PostureGenerator uses the nominal one as the seed of its optimisation. */
 void getNominalPosture(const ocra::Model &model, Eigen::VectorXd &q);
 void getHomePosture(const ocra::Model &model, Eigen::VectorXd &q);
 
+/*! 64 bit FNV-1a hash. Unlike std::hash it is the same with every compiler, so it can name cache files. Pass a previous hash to chain several strings. */
+uint64_t fnv1aHash(const std::string &data, uint64_t hash = 14695981039346656037ULL);
+
 
 } /* ocra_icub */
 #endif //OCRA_ICUB_UTILITIES_H
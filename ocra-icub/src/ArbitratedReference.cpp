@@ -0,0 +1,210 @@
+/*! \file       ArbitratedReference.cpp
+ *  \brief      Task references which the controller server arbitrates between several clients.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/ArbitratedReference.h>
+
+#include <yarp/os/Network.h>
+#include <ocra/util/ErrorsHelper.h>
+
+using namespace ocra_icub;
+
+namespace
+{
+    void addField(const std::string& tag, const Eigen::VectorXd& values, yarp::os::Bottle& bottle)
+    {
+        yarp::os::Bottle& field = bottle.addList();
+        field.addString(tag);
+        for (int i=0; i<values.size(); ++i) {
+            field.addDouble(values(i));
+        }
+    }
+
+    void addTwist(const std::string& tag, const Eigen::Twistd& twist, yarp::os::Bottle& bottle)
+    {
+        Eigen::VectorXd values(6);
+        values << twist.getAngularVelocity(), twist.getLinearVelocity();
+        addField(tag, values, bottle);
+    }
+
+    Eigen::VectorXd fieldValues(const yarp::os::Bottle& field)
+    {
+        Eigen::VectorXd values(field.size() - 1);
+        for (int i=1; i<field.size(); ++i) {
+            values(i-1) = field.get(i).asDouble();
+        }
+        return values;
+    }
+}
+
+const std::string ArbitratedReferenceSender::SERVER_PORT_NAME = "/ocra-icub-server/references:i";
+
+ArbitratedReference::ArbitratedReference()
+: clientName("")
+, taskName("")
+, priority(0)
+, blendTime(0.5)
+, release(false)
+{
+}
+
+void ArbitratedReference::toBottle(yarp::os::Bottle& bottle) const
+{
+    bottle.clear();
+    bottle.addString(clientName);
+    bottle.addString(taskName);
+    bottle.addInt(priority);
+    bottle.addDouble(blendTime);
+    bottle.addInt(release ? 1 : 0);
+    if (release) {
+        return;
+    }
+    if (state.hasQ()) {
+        addField("q", state.getQ(), bottle);
+    }
+    if (state.hasQd()) {
+        addField("qd", state.getQd(), bottle);
+    }
+    if (state.hasQdd()) {
+        addField("qdd", state.getQdd(), bottle);
+    }
+    if (state.hasPosition()) {
+        const Eigen::Displacementd& H = state.getPosition();
+        Eigen::VectorXd values(7);
+        values << H.x(), H.y(), H.z(), H.qw(), H.qx(), H.qy(), H.qz();
+        addField("position", values, bottle);
+    }
+    if (state.hasVelocity()) {
+        addTwist("velocity", state.getVelocity(), bottle);
+    }
+    if (state.hasAcceleration()) {
+        addTwist("acceleration", state.getAcceleration(), bottle);
+    }
+}
+
+bool ArbitratedReference::fromBottle(const yarp::os::Bottle& bottle)
+{
+    if (bottle.size() < 5 || !bottle.get(0).isString() || !bottle.get(1).isString()) {
+        return false;
+    }
+    clientName = bottle.get(0).asString();
+    taskName = bottle.get(1).asString();
+    priority = bottle.get(2).asInt();
+    blendTime = bottle.get(3).asDouble();
+    release = bottle.get(4).asInt() != 0;
+    state = ocra::TaskState();
+
+    for (int i=5; i<bottle.size(); ++i) {
+        yarp::os::Bottle* field = bottle.get(i).asList();
+        if (field == NULL || field->size() < 1) {
+            return false;
+        }
+        std::string tag = field->get(0).asString();
+        Eigen::VectorXd values = fieldValues(*field);
+        if (tag == "q") {
+            state.setQ(values);
+        } else if (tag == "qd") {
+            state.setQd(values);
+        } else if (tag == "qdd") {
+            state.setQdd(values);
+        } else if (tag == "position" && values.size() == 7) {
+            state.setPosition(Eigen::Displacementd(values(0), values(1), values(2), values(3), values(4), values(5), values(6)));
+        } else if (tag == "velocity" && values.size() == 6) {
+            state.setVelocity(Eigen::Twistd(values(0), values(1), values(2), values(3), values(4), values(5)));
+        } else if (tag == "acceleration" && values.size() == 6) {
+            state.setAcceleration(Eigen::Twistd(values(0), values(1), values(2), values(3), values(4), values(5)));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+ArbitratedReferenceSender::ArbitratedReferenceSender(const std::string& clientName, int priority, double blendTime)
+: name(clientName)
+, clientPriority(priority)
+, clientBlendTime(blendTime)
+, portIsOpen(false)
+{
+}
+
+ArbitratedReferenceSender::~ArbitratedReferenceSender()
+{
+    close();
+}
+
+bool ArbitratedReferenceSender::open()
+{
+    std::string portName = "/" + name + "/references:o";
+    if (!port.open(portName)) {
+        OCRA_ERROR("Could not open " << portName)
+        return false;
+    }
+    portIsOpen = true;
+    if (!yarp::os::Network::connect(portName, SERVER_PORT_NAME)) {
+        OCRA_ERROR("Could not connect " << portName << " to " << SERVER_PORT_NAME << ".")
+        return false;
+    }
+    return true;
+}
+
+void ArbitratedReferenceSender::close()
+{
+    if (portIsOpen) {
+        port.interrupt();
+        port.close();
+        portIsOpen = false;
+    }
+}
+
+void ArbitratedReferenceSender::send(const std::string& taskName, const ocra::TaskState& state)
+{
+    if (!portIsOpen) {
+        return;
+    }
+    ArbitratedReference reference;
+    reference.clientName = name;
+    reference.taskName = taskName;
+    reference.priority = clientPriority;
+    reference.blendTime = clientBlendTime;
+    reference.state = state;
+    yarp::os::Bottle& bottle = port.prepare();
+    reference.toBottle(bottle);
+    port.write();
+}
+
+void ArbitratedReferenceSender::release(const std::string& taskName)
+{
+    if (!portIsOpen) {
+        return;
+    }
+    ArbitratedReference reference;
+    reference.clientName = name;
+    reference.taskName = taskName;
+    reference.priority = clientPriority;
+    reference.release = true;
+    yarp::os::Bottle& bottle = port.prepare();
+    reference.toBottle(bottle);
+    port.write();
+}
@@ -0,0 +1,93 @@
+/*! \file       ClientHeartbeat.cpp
+ *  \brief      Heartbeat published by the clients so the controller server can detect when they stall.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/ClientHeartbeat.h>
+
+#include <yarp/os/Network.h>
+#include <yarp/os/Time.h>
+#include <ocra/util/ErrorsHelper.h>
+
+using namespace ocra_icub;
+
+const std::string ClientHeartbeat::WATCHDOG_PORT_NAME = "/ocra-icub-server/watchdog/heartbeat:i";
+
+ClientHeartbeat::ClientHeartbeat(const std::string& clientName, const std::vector<std::string>& taskNames)
+: name(clientName)
+, tasks(taskNames)
+, sequence(0)
+, portIsOpen(false)
+{
+}
+
+ClientHeartbeat::~ClientHeartbeat()
+{
+    close();
+}
+
+bool ClientHeartbeat::open()
+{
+    std::string portName = "/" + name + "/heartbeat:o";
+    if (!port.open(portName)) {
+        OCRA_ERROR("Could not open " << portName)
+        return false;
+    }
+    portIsOpen = true;
+    if (!yarp::os::Network::connect(portName, WATCHDOG_PORT_NAME)) {
+        OCRA_WARNING("Could not connect " << portName << " to " << WATCHDOG_PORT_NAME << ". The server watchdog will not monitor " << name << ".")
+    }
+    return true;
+}
+
+void ClientHeartbeat::close()
+{
+    if (portIsOpen) {
+        port.interrupt();
+        port.close();
+        portIsOpen = false;
+    }
+}
+
+void ClientHeartbeat::beat()
+{
+    if (!portIsOpen) {
+        return;
+    }
+    // prepare() hands back a buffer which is not being sent, so this never waits on the network.
+    yarp::os::Bottle& bottle = port.prepare();
+    bottle.clear();
+    bottle.addString(name);
+    bottle.addInt(sequence++);
+    bottle.addDouble(yarp::os::Time::now());
+    yarp::os::Bottle& taskList = bottle.addList();
+    for (auto task : tasks) {
+        taskList.addString(task);
+    }
+    port.write();
+}
+
+void ClientHeartbeat::setTaskNames(const std::vector<std::string>& taskNames)
+{
+    tasks = taskNames;
+}
@@ -0,0 +1,218 @@
+/*! \file       ClientLoopStatistics.cpp
+ *  \brief      Timing statistics of a client loop, exposed on an rpc port.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/ClientLoopStatistics.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <yarp/os/Time.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <ocra/util/ErrorsHelper.h>
+
+using namespace ocra_icub;
+
+ClientLoopStatistics::Scope::Scope(ClientLoopStatistics& statistics)
+: stats(statistics)
+{
+    stats.startLoop();
+}
+
+ClientLoopStatistics::Scope::~Scope()
+{
+    stats.endLoop();
+}
+
+ClientLoopStatistics::RpcCallback::RpcCallback(ClientLoopStatistics& statistics)
+: stats(statistics)
+{
+}
+
+bool ClientLoopStatistics::RpcCallback::read(yarp::os::ConnectionReader& connection)
+{
+    yarp::os::Bottle input, reply;
+    if (!input.read(connection)) {
+        return false;
+    }
+    std::string command = input.get(0).asString();
+    if (command == "get") {
+        stats.toBottle(reply);
+    } else if (command == "reset") {
+        stats.reset();
+        reply.addString("ok");
+    } else {
+        reply.addString("Unknown command. Use get or reset.");
+    }
+    yarp::os::ConnectionWriter* returnToSender = connection.getWriter();
+    if (returnToSender != NULL) {
+        return reply.write(*returnToSender);
+    }
+    return true;
+}
+
+ClientLoopStatistics::ClientLoopStatistics(const std::string& clientName, double expectedPeriod, int warmUpLoops)
+: name(clientName)
+, period(expectedPeriod)
+, nWarmUpLoops(warmUpLoops)
+, rpcCallback(*this)
+, portIsOpen(false)
+{
+    reset();
+}
+
+ClientLoopStatistics::~ClientLoopStatistics()
+{
+    close();
+}
+
+bool ClientLoopStatistics::open()
+{
+    std::string portName = "/" + name + "/timing/rpc:i";
+    if (!rpcPort.open(portName)) {
+        OCRA_ERROR("Could not open " << portName)
+        return false;
+    }
+    rpcPort.setReader(rpcCallback);
+    portIsOpen = true;
+    return true;
+}
+
+void ClientLoopStatistics::close()
+{
+    if (portIsOpen) {
+        rpcPort.interrupt();
+        rpcPort.close();
+        portIsOpen = false;
+    }
+}
+
+void ClientLoopStatistics::startLoop()
+{
+    double now = yarp::os::Time::now();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    loopStart = now;
+    if (previousStart >= 0.0 && nSkippedLoops >= nWarmUpLoops) {
+        double p = now - previousStart;
+        ++nPeriods;
+        double delta = p - periodMean;
+        periodMean += delta / nPeriods;
+        periodM2 += delta * (p - periodMean);
+        periodMax = std::max(periodMax, p);
+    }
+    previousStart = now;
+}
+
+void ClientLoopStatistics::endLoop()
+{
+    double now = yarp::os::Time::now();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (loopStart < 0.0) {
+        return;
+    }
+    if (nSkippedLoops < nWarmUpLoops) {
+        ++nSkippedLoops;
+        loopStart = -1.0;
+        return;
+    }
+    double d = now - loopStart;
+    ++nLoops;
+    durationMean += (d - durationMean) / nLoops;
+    durationMax = std::max(durationMax, d);
+    if (d > period) {
+        ++nOverruns;
+    }
+    loopStart = -1.0;
+}
+
+void ClientLoopStatistics::reset()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    loopStart = -1.0;
+    previousStart = -1.0;
+    nSkippedLoops = 0;
+    nLoops = 0;
+    nPeriods = 0;
+    nOverruns = 0;
+    periodMean = 0.0;
+    periodM2 = 0.0;
+    periodMax = 0.0;
+    durationMean = 0.0;
+    durationMax = 0.0;
+}
+
+int ClientLoopStatistics::getNumberOfLoops()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return nLoops;
+}
+
+int ClientLoopStatistics::getNumberOfOverruns()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return nOverruns;
+}
+
+double ClientLoopStatistics::getOverrunRatio()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return nLoops > 0 ? double(nOverruns) / nLoops : 0.0;
+}
+
+double ClientLoopStatistics::getMeanPeriod()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return periodMean;
+}
+
+double ClientLoopStatistics::getMaxPeriod()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return periodMax;
+}
+
+double ClientLoopStatistics::getMeanDuration()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return durationMean;
+}
+
+double ClientLoopStatistics::getMaxDuration()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return durationMax;
+}
+
+void ClientLoopStatistics::toBottle(yarp::os::Bottle& bottle)
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    bottle.clear();
+    bottle.addInt(nLoops);
+    bottle.addDouble(periodMean);
+    bottle.addDouble(nPeriods > 1 ? std::sqrt(periodM2 / (nPeriods - 1)) : 0.0);
+    bottle.addDouble(periodMax);
+    bottle.addDouble(durationMean);
+    bottle.addDouble(durationMax);
+    bottle.addInt(nOverruns);
+}
@@ -0,0 +1,142 @@
+/*! \file       ContactTransition.cpp
+ *  \brief      Load-triggered release and acquisition of contact tasks, evaluated by the controller server.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/ContactTransition.h>
+
+#include <yarp/os/Network.h>
+#include <ocra/util/ErrorsHelper.h>
+
+using namespace ocra_icub;
+
+const std::string ContactTransitionRule::MODEL_WRENCH_SOURCE = "model";
+const std::string ContactTransitionSender::SERVER_PORT_NAME = "/ocra-icub-server/contacts:i";
+
+ContactTransitionRule::ContactTransitionRule()
+: taskName("")
+, mode(CONTACT_RELEASE)
+, releaseLoad(10.0)
+, acquireLoad(20.0)
+, holdTicks(1)
+, oneShot(true)
+, wrenchSource(MODEL_WRENCH_SOURCE)
+, loadAxis(Eigen::Vector3d::UnitZ())
+{
+}
+
+void ContactTransitionRule::toBottle(yarp::os::Bottle& bottle) const
+{
+    bottle.clear();
+    bottle.addString(taskName);
+    bottle.addInt(mode);
+    bottle.addDouble(releaseLoad);
+    bottle.addDouble(acquireLoad);
+    bottle.addInt(holdTicks);
+    bottle.addInt(oneShot);
+    bottle.addString(wrenchSource);
+    yarp::os::Bottle& axis = bottle.addList();
+    for (int i=0; i<3; ++i) {
+        axis.addDouble(loadAxis(i));
+    }
+}
+
+bool ContactTransitionRule::fromBottle(const yarp::os::Bottle& bottle)
+{
+    if (bottle.size() != 8 || !bottle.get(0).isString() || !bottle.get(6).isString()) {
+        return false;
+    }
+    int m = bottle.get(1).asInt();
+    if (m < CONTACT_DISARM || m > CONTACT_RELEASE_AND_ACQUIRE) {
+        return false;
+    }
+    yarp::os::Bottle* axis = bottle.get(7).asList();
+    if (axis == NULL || axis->size() != 3) {
+        return false;
+    }
+    taskName = bottle.get(0).asString();
+    mode = CONTACT_TRANSITION_MODE(m);
+    releaseLoad = bottle.get(2).asDouble();
+    acquireLoad = bottle.get(3).asDouble();
+    holdTicks = bottle.get(4).asInt();
+    oneShot = bottle.get(5).asInt() != 0;
+    wrenchSource = bottle.get(6).asString();
+    for (int i=0; i<3; ++i) {
+        loadAxis(i) = axis->get(i).asDouble();
+    }
+    return true;
+}
+
+ContactTransitionSender::ContactTransitionSender(const std::string& clientName)
+: name(clientName)
+, portIsOpen(false)
+{
+}
+
+ContactTransitionSender::~ContactTransitionSender()
+{
+    close();
+}
+
+bool ContactTransitionSender::open()
+{
+    std::string portName = "/" + name + "/contacts:o";
+    if (!port.open(portName)) {
+        OCRA_ERROR("Could not open " << portName)
+        return false;
+    }
+    portIsOpen = true;
+    if (!yarp::os::Network::connect(portName, SERVER_PORT_NAME)) {
+        OCRA_ERROR("Could not connect " << portName << " to " << SERVER_PORT_NAME << ".")
+        return false;
+    }
+    return true;
+}
+
+void ContactTransitionSender::close()
+{
+    if (portIsOpen) {
+        port.interrupt();
+        port.close();
+        portIsOpen = false;
+    }
+}
+
+void ContactTransitionSender::send(const ContactTransitionRule& rule)
+{
+    if (!portIsOpen) {
+        return;
+    }
+    yarp::os::Bottle& bottle = port.prepare();
+    rule.toBottle(bottle);
+    // Rules are sent once, so none of them may be dropped.
+    port.writeStrict();
+}
+
+void ContactTransitionSender::disarm(const std::string& taskName)
+{
+    ContactTransitionRule rule;
+    rule.taskName = taskName;
+    rule.mode = CONTACT_DISARM;
+    send(rule);
+}
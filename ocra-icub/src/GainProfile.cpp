@@ -0,0 +1,163 @@
+/*! \file       GainProfile.cpp
+ *  \brief      Time-parameterised stiffness and damping changes interpolated by the controller server.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/GainProfile.h>
+
+#include <algorithm>
+
+#include <yarp/os/Network.h>
+#include <ocra/util/ErrorsHelper.h>
+
+using namespace ocra_icub;
+
+namespace
+{
+    void matrixToBottle(const Eigen::MatrixXd& matrix, yarp::os::Bottle& bottle)
+    {
+        bottle.addInt(matrix.rows());
+        bottle.addInt(matrix.cols());
+        for (int i=0; i<matrix.rows(); ++i) {
+            for (int j=0; j<matrix.cols(); ++j) {
+                bottle.addDouble(matrix(i,j));
+            }
+        }
+    }
+
+    bool matrixFromBottle(const yarp::os::Bottle* bottle, Eigen::MatrixXd& matrix)
+    {
+        if (bottle == NULL || bottle->size() < 2) {
+            return false;
+        }
+        int rows = bottle->get(0).asInt();
+        int cols = bottle->get(1).asInt();
+        if (rows < 0 || cols < 0 || bottle->size() != 2 + rows*cols) {
+            return false;
+        }
+        matrix.resize(rows, cols);
+        for (int i=0; i<rows; ++i) {
+            for (int j=0; j<cols; ++j) {
+                matrix(i,j) = bottle->get(2 + i*cols + j).asDouble();
+            }
+        }
+        return true;
+    }
+}
+
+const std::string GainProfileSender::SERVER_PORT_NAME = "/ocra-icub-server/gains:i";
+
+GainProfile::GainProfile()
+: taskName("")
+, duration(0.0)
+, interpolation(GAIN_MIN_JERK)
+{
+}
+
+double GainProfile::progress(double t) const
+{
+    if (duration <= 0.0 || t >= duration) {
+        return 1.0;
+    }
+    double a = std::max(0.0, t / duration);
+    switch (interpolation) {
+        case GAIN_STEP:
+            return 0.0;
+        case GAIN_LINEAR:
+            return a;
+        case GAIN_MIN_JERK:
+        default:
+            return a*a*a*(10.0 - 15.0*a + 6.0*a*a);
+    }
+}
+
+void GainProfile::toBottle(yarp::os::Bottle& bottle) const
+{
+    bottle.clear();
+    bottle.addString(taskName);
+    bottle.addInt(interpolation);
+    bottle.addDouble(duration);
+    matrixToBottle(stiffness, bottle.addList());
+    matrixToBottle(damping, bottle.addList());
+}
+
+bool GainProfile::fromBottle(const yarp::os::Bottle& bottle)
+{
+    if (bottle.size() != 5 || !bottle.get(0).isString()) {
+        return false;
+    }
+    int law = bottle.get(1).asInt();
+    if (law < GAIN_STEP || law > GAIN_MIN_JERK) {
+        return false;
+    }
+    taskName = bottle.get(0).asString();
+    interpolation = GAIN_INTERPOLATION(law);
+    duration = bottle.get(2).asDouble();
+    return matrixFromBottle(bottle.get(3).asList(), stiffness) && matrixFromBottle(bottle.get(4).asList(), damping);
+}
+
+GainProfileSender::GainProfileSender(const std::string& clientName)
+: name(clientName)
+, portIsOpen(false)
+{
+}
+
+GainProfileSender::~GainProfileSender()
+{
+    close();
+}
+
+bool GainProfileSender::open()
+{
+    std::string portName = "/" + name + "/gains:o";
+    if (!port.open(portName)) {
+        OCRA_ERROR("Could not open " << portName)
+        return false;
+    }
+    portIsOpen = true;
+    if (!yarp::os::Network::connect(portName, SERVER_PORT_NAME)) {
+        OCRA_ERROR("Could not connect " << portName << " to " << SERVER_PORT_NAME << ".")
+        return false;
+    }
+    return true;
+}
+
+void GainProfileSender::close()
+{
+    if (portIsOpen) {
+        port.interrupt();
+        port.close();
+        portIsOpen = false;
+    }
+}
+
+void GainProfileSender::send(const GainProfile& profile)
+{
+    if (!portIsOpen) {
+        return;
+    }
+    yarp::os::Bottle& bottle = port.prepare();
+    profile.toBottle(bottle);
+    // Profiles are sent once, so none of them may be dropped.
+    port.writeStrict();
+}
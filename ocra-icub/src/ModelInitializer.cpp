@@ -15,6 +15,17 @@ ModelInitializer::ModelInitializer()
     }
 }
 
+ModelInitializer::ModelInitializer(const std::string& wbiConfigFile, const std::string& robot, bool floatingBase)
+: wbiConfigFilePath(wbiConfigFile)
+, robotName(robot)
+, isFloatingBase(floatingBase)
+{
+    modInitNumber = ++MODEL_INITIALIZER_COUNT;
+    if ( configureWbi() ){
+         constructModel();
+    }
+}
+
 ModelInitializer::~ModelInitializer()
 {
     /* Stop the WBI threads. */
@@ -26,6 +26,9 @@
 
 #include <ocra-icub/OcraWbiModel.h>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace ocra_icub;
 
 #define ALL_JOINTS -1
@@ -114,6 +117,22 @@ public:
     Eigen::Matrix<double,TRANS_ROT_DIM,Eigen::Dynamic>      Jroot;
     Eigen::Matrix<double,TRANS_ROT_DIM,Eigen::Dynamic>      dJroot;
 
+    // Multi-rate update of the expensive configuration dependent quantities (M and Minv). The segment Jacobians are only reused within a tick.
+    int                                                     slowUpdatePeriod; // refresh every n ticks, 1 = every tick, <=0 = only on drift
+    double                                                  slowUpdateThreshold; // refresh when the configuration drift exceeds this, <=0 = disabled
+    int                                                     ticksSinceRefresh;
+    Eigen::VectorXd                                         q_slow; // joint positions at the last refresh
+    Eigen::Displacementd                                    Hroot_slow; // root pose at the last refresh
+    double                                                  drift; // configuration drift since the last refresh
+    bool                                                    massMatrixIsValid;
+    bool                                                    massMatrixInverseIsValid;
+    Eigen::LLT<Eigen::MatrixXd>                             M_llt; // factorization of M, reused for Minv
+    Eigen::MatrixXd                                         M_previous; // M at the previous refresh, for the error model
+    double                                                  driftSinceMassMatrix; // accumulated drift since M_previous was computed
+    double                                                  massMatrixSensitivity; // relative error of M per unit drift (first order error model)
+    double                                                  massMatrixRefreshError; // relative change of M measured at the last refresh
+    std::vector< bool >                                     segJacobianIsValid; // reset by every new state
+
     OcraWbiModel_pimpl(int nbSeg, int ndof, int nDofFree)
         :nbSegments(nbSeg)
         ,q(Eigen::VectorXd::Zero(nDofFree-TRANS_ROT_DIM))
@@ -157,6 +176,18 @@ public:
         ,segJdot(nbSeg, Eigen::Matrix<double,TRANS_ROT_DIM,Eigen::Dynamic>::Zero(TRANS_ROT_DIM,ndof))
         ,segJointJacobian(nbSeg, Eigen::Matrix<double,TRANS_ROT_DIM,Eigen::Dynamic>::Zero(TRANS_ROT_DIM,ndof))
         ,segJdotQdot(nbSeg, Eigen::Twistd(0,0,0,0,0,0))
+        ,slowUpdatePeriod(1)
+        ,slowUpdateThreshold(0.0)
+        ,ticksSinceRefresh(0)
+        ,q_slow(Eigen::VectorXd::Zero(nDofFree-TRANS_ROT_DIM))
+        ,Hroot_slow(Eigen::Displacementd(0,0,1))
+        ,drift(0.0)
+        ,massMatrixIsValid(false)
+        ,massMatrixInverseIsValid(false)
+        ,driftSinceMassMatrix(0.0)
+        ,massMatrixSensitivity(0.0)
+        ,massMatrixRefreshError(0.0)
+        ,segJacobianIsValid(nbSeg, false)
     {
         vel_com_old = Eigen::Vector3d::Zero();
 
@@ -281,6 +312,10 @@ const Eigen::Twistd& OcraWbiModel::getFreeFlyerVelocity() const
 
 const Eigen::MatrixXd& OcraWbiModel::getInertiaMatrix() const
 {
+    // M is only recomputed when the multi-rate scheme asks for it, see updateMultiRateState().
+    if (owm_pimpl->massMatrixIsValid)
+        return owm_pimpl->M;
+
     bool res = robot->computeMassMatrix(owm_pimpl->q.data(), owm_pimpl->Hroot_wbi, owm_pimpl->M_full_rm.data());
     OcraWbiConversions::eigenRowMajorToColMajor(owm_pimpl->M_full_rm, owm_pimpl->M_full);
 
@@ -298,6 +333,16 @@ const Eigen::MatrixXd& OcraWbiModel::getInertiaMatrix() const
     std::cout << owm_pimpl->M.lpNorm<Eigen::Infinity>() << std::endl;
 */
 
+    // First order error model: the relative change of M between two refreshes divided by the configuration drift which caused it.
+    if (owm_pimpl->M_previous.size() == owm_pimpl->M.size() && owm_pimpl->driftSinceMassMatrix > 1e-9)
+    {
+        owm_pimpl->massMatrixRefreshError = (owm_pimpl->M - owm_pimpl->M_previous).norm() / owm_pimpl->M.norm();
+        owm_pimpl->massMatrixSensitivity = owm_pimpl->massMatrixRefreshError / owm_pimpl->driftSinceMassMatrix;
+    }
+    owm_pimpl->M_previous = owm_pimpl->M;
+    owm_pimpl->driftSinceMassMatrix = 0.0;
+
+    owm_pimpl->massMatrixIsValid = true;
     return owm_pimpl->M;
 }
 
@@ -306,8 +351,13 @@ const Eigen::MatrixXd& OcraWbiModel::getInertiaMatrixInverse() const
 /*
     printf("Get Inertia Matrix Inverse\n");
 */
-    getInertiaMatrix();
-    owm_pimpl->Minv = owm_pimpl->M.inverse();
+    if (owm_pimpl->massMatrixInverseIsValid && owm_pimpl->massMatrixIsValid)
+        return owm_pimpl->Minv;
+
+    // M is symmetric positive definite so a Cholesky factorization is cheaper and more stable than a general inverse.
+    owm_pimpl->M_llt.compute(getInertiaMatrix());
+    owm_pimpl->Minv = owm_pimpl->M_llt.solve(Eigen::MatrixXd::Identity(owm_pimpl->M.rows(), owm_pimpl->M.cols()));
+    owm_pimpl->massMatrixInverseIsValid = true;
     return owm_pimpl->Minv;
 }
 
@@ -605,6 +655,10 @@ const Eigen::Rotation3d& OcraWbiModel::getSegmentInertiaAxes(int index) const
 //compute jacobian in segment frame
 const Eigen::Matrix<double,6,Eigen::Dynamic>& OcraWbiModel::getSegmentJacobian(int index) const
 {
+    if (owm_pimpl->segJacobianIsValid[index])
+        return owm_pimpl->segJacobian[index];
+    owm_pimpl->segJacobianIsValid[index] = true;
+
     robot->computeJacobian(owm_pimpl->q.data(), owm_pimpl->Hroot_wbi, index, owm_pimpl->segJacobian_rm[index].data());
 
     OcraWbiConversions::eigenRowMajorToColMajor(owm_pimpl->segJacobian_rm[index], owm_pimpl->segJacobian_full[index]);
@@ -649,6 +703,8 @@ const Eigen::Matrix<double,6,Eigen::Dynamic>& OcraWbiModel::getSegmentJacobian(i
 
 const Eigen::Matrix<double,6,Eigen::Dynamic>& OcraWbiModel::getSegmentJacobian(int index, wbi::Frame H_world_root) const
 {
+    // This overload shares its storage with the cached Jacobian but not its root pose.
+    owm_pimpl->segJacobianIsValid[index] = false;
             robot->computeJacobian(owm_pimpl->q.data(), H_world_root, index, owm_pimpl->segJacobian_rm[index].data());
 
     OcraWbiConversions::eigenRowMajorToColMajor(owm_pimpl->segJacobian_rm[index], owm_pimpl->segJacobian_full[index]);
@@ -706,6 +762,10 @@ void OcraWbiModel::doSetJointPositions(const Eigen::VectorXd& q)
     std::cout << q.transpose() << std::endl;
 */
     owm_pimpl->q = q;
+    if (owm_pimpl->slowUpdatePeriod == 1)
+        invalidateConfigurationDependentQuantities(true);
+    else
+        invalidateConfigurationDependentQuantities(false);
 }
 
 void OcraWbiModel::doSetJointVelocities(const Eigen::VectorXd& dq)
@@ -730,6 +790,10 @@ void OcraWbiModel::doSetFreeFlyerPosition(const Eigen::Displacementd& Hroot)
 {
     owm_pimpl->Hroot = Hroot;
     OcraWbiConversions::eigenDispdToWbiFrame(owm_pimpl->Hroot, owm_pimpl->Hroot_wbi);
+    if (owm_pimpl->slowUpdatePeriod == 1)
+        invalidateConfigurationDependentQuantities(true);
+    else
+        invalidateConfigurationDependentQuantities(false);
 }
 
 void OcraWbiModel::doSetFreeFlyerVelocity(const Eigen::Twistd& Troot)
@@ -786,16 +850,102 @@ const std::string OcraWbiModel::doDofName(const std::string& name) const
 
 void OcraWbiModel::doSetState(const Eigen::VectorXd& q, const Eigen::VectorXd& q_dot)
 {
+    updateMultiRateState();
     updateCoMPosition();
     updateCoMVelocity();
 }
 
 void OcraWbiModel::doSetState(const Eigen::Displacementd& H_root, const Eigen::VectorXd& q, const Eigen::Twistd& T_root, const Eigen::VectorXd& q_dot)
 {
+    updateMultiRateState();
     updateCoMPosition();
     updateCoMVelocity();
 }
 
+void OcraWbiModel::setModelUpdatePeriod(int nTicks)
+{
+    owm_pimpl->slowUpdatePeriod = nTicks;
+    invalidateConfigurationDependentQuantities(true);
+}
+
+void OcraWbiModel::setModelUpdateThreshold(double maxDrift)
+{
+    owm_pimpl->slowUpdateThreshold = maxDrift;
+}
+
+int OcraWbiModel::getModelUpdatePeriod() const
+{
+    return owm_pimpl->slowUpdatePeriod;
+}
+
+double OcraWbiModel::getModelUpdateThreshold() const
+{
+    return owm_pimpl->slowUpdateThreshold;
+}
+
+int OcraWbiModel::getTicksSinceModelRefresh() const
+{
+    return owm_pimpl->ticksSinceRefresh;
+}
+
+double OcraWbiModel::getConfigurationDrift() const
+{
+    return owm_pimpl->drift;
+}
+
+double OcraWbiModel::getInertiaApproximationError() const
+{
+    return owm_pimpl->massMatrixSensitivity * owm_pimpl->drift;
+}
+
+double OcraWbiModel::getInertiaRefreshError() const
+{
+    return owm_pimpl->massMatrixRefreshError;
+}
+
+double OcraWbiModel::computeConfigurationDrift() const
+{
+    double dq2 = (owm_pimpl->q - owm_pimpl->q_slow).squaredNorm();
+    if (owm_pimpl->freeRoot)
+    {
+        // The base block of M and of the Jacobians depends on the root orientation, so add its angular drift.
+        const Eigen::Rotation3d& R = owm_pimpl->Hroot.getRotation();
+        const Eigen::Rotation3d& R_slow = owm_pimpl->Hroot_slow.getRotation();
+        double cosHalfAngle = std::abs(R.w()*R_slow.w() + R.x()*R_slow.x() + R.y()*R_slow.y() + R.z()*R_slow.z());
+        double angle = 2.0 * std::acos(std::min(cosHalfAngle, 1.0));
+        dq2 += angle * angle;
+    }
+    return std::sqrt(dq2);
+}
+
+void OcraWbiModel::updateMultiRateState()
+{
+    ++owm_pimpl->ticksSinceRefresh;
+    owm_pimpl->drift = computeConfigurationDrift();
+
+    bool periodElapsed = (owm_pimpl->slowUpdatePeriod > 0) && (owm_pimpl->ticksSinceRefresh >= owm_pimpl->slowUpdatePeriod);
+    bool driftExceeded = (owm_pimpl->slowUpdateThreshold > 0.0) && (owm_pimpl->drift > owm_pimpl->slowUpdateThreshold);
+
+    invalidateConfigurationDependentQuantities(periodElapsed || driftExceeded);
+}
+
+void OcraWbiModel::invalidateConfigurationDependentQuantities(bool includeSlowQuantities)
+{
+    // The segment Jacobians give the segment velocities and the task Jacobians, so they are never held over a tick.
+    std::fill(owm_pimpl->segJacobianIsValid.begin(), owm_pimpl->segJacobianIsValid.end(), false);
+
+    if (includeSlowQuantities)
+    {
+        owm_pimpl->massMatrixIsValid = false;
+        owm_pimpl->massMatrixInverseIsValid = false;
+        owm_pimpl->driftSinceMassMatrix += computeConfigurationDrift();
+        owm_pimpl->q_slow = owm_pimpl->q;
+        owm_pimpl->Hroot_slow = owm_pimpl->Hroot;
+        owm_pimpl->ticksSinceRefresh = 0;
+        owm_pimpl->drift = 0.0;
+    }
+}
+
 void OcraWbiModel::printAllData()
 {
     std::cout<<"nbSegments:\n";
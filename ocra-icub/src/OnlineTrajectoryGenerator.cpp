@@ -0,0 +1,142 @@
+/*! \file       OnlineTrajectoryGenerator.cpp
+ *  \brief      Velocity and acceleration limited trajectory towards a goal which can change at any time.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/OnlineTrajectoryGenerator.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ocra_icub;
+
+namespace
+{
+    // Distance below which the goal counts as reached.
+    const double GOAL_TOLERANCE = 1e-9;
+}
+
+OnlineTrajectoryGenerator::OnlineTrajectoryGenerator(int dimension, double period, double maxVelocity, double maxAcceleration)
+: dt(period)
+, vMax(maxVelocity)
+, aMax(maxAcceleration)
+, goalReached(true)
+, x(Eigen::VectorXd::Zero(dimension))
+, v(Eigen::VectorXd::Zero(dimension))
+, a(Eigen::VectorXd::Zero(dimension))
+, target(Eigen::VectorXd::Zero(dimension))
+, error(Eigen::VectorXd::Zero(dimension))
+, deltaVelocity(Eigen::VectorXd::Zero(dimension))
+{
+}
+
+OnlineTrajectoryGenerator::~OnlineTrajectoryGenerator()
+{
+}
+
+void OnlineTrajectoryGenerator::reset(const Eigen::VectorXd& position, const Eigen::VectorXd& velocity)
+{
+    x = position;
+    v = velocity;
+    a.setZero();
+    target = position;
+    goalReached = v.isZero();
+}
+
+void OnlineTrajectoryGenerator::setGoal(const Eigen::VectorXd& goal)
+{
+    target = goal;
+    goalReached = false;
+}
+
+void OnlineTrajectoryGenerator::setMaxVelocity(double maxVelocity)
+{
+    vMax = maxVelocity;
+}
+
+void OnlineTrajectoryGenerator::setMaxAcceleration(double maxAcceleration)
+{
+    aMax = maxAcceleration;
+}
+
+void OnlineTrajectoryGenerator::step()
+{
+    if (goalReached) {
+        a.setZero();
+        return;
+    }
+
+    error = target - x;
+    double distance = error.norm();
+    double aStep = aMax * dt;
+
+    // Largest speed after this step from which the goal can still be reached at rest, braking at the limit on every following step.
+    double vStop = aStep * (std::sqrt(0.25 + 2.0 * distance / (aStep * dt)) - 0.5);
+    // The last step lands exactly on the goal.
+    double speed = std::min(std::min(vMax, vStop), distance / dt);
+
+    if (distance > GOAL_TOLERANCE) {
+        deltaVelocity = (speed / distance) * error - v;
+    } else {
+        deltaVelocity = -v;
+    }
+    double deltaSpeed = deltaVelocity.norm();
+    if (deltaSpeed > aStep) {
+        deltaVelocity *= aStep / deltaSpeed;
+    }
+
+    a = deltaVelocity / dt;
+    v += deltaVelocity;
+    x += v * dt;
+
+    if ((target - x).norm() <= GOAL_TOLERANCE && v.norm() <= aStep) {
+        x = target;
+        v.setZero();
+        goalReached = true;
+    }
+}
+
+const Eigen::VectorXd& OnlineTrajectoryGenerator::getPosition() const
+{
+    return x;
+}
+
+const Eigen::VectorXd& OnlineTrajectoryGenerator::getVelocity() const
+{
+    return v;
+}
+
+const Eigen::VectorXd& OnlineTrajectoryGenerator::getAcceleration() const
+{
+    return a;
+}
+
+const Eigen::VectorXd& OnlineTrajectoryGenerator::getGoal() const
+{
+    return target;
+}
+
+bool OnlineTrajectoryGenerator::isGoalReached() const
+{
+    return goalReached;
+}
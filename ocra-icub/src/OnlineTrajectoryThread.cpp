@@ -0,0 +1,142 @@
+/*! \file       OnlineTrajectoryThread.cpp
+ *  \brief      Drives the desired position of a task with an OnlineTrajectoryGenerator.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/OnlineTrajectoryThread.h>
+
+#include <ocra/util/EigenUtilities.h>
+
+using namespace ocra_icub;
+
+OnlineTrajectoryThread::OnlineTrajectoryThread(int period, const std::string& taskName, double maxVelocity, double maxAcceleration)
+: yarp::os::RateThread(period)
+, name(taskName)
+, generator(3, period / 1000.0, maxVelocity, maxAcceleration)
+, goal(Eigen::Vector3d::Zero())
+, position(Eigen::Vector3d::Zero())
+, newGoal(false)
+, goalReached(true)
+, maxVel(maxVelocity)
+, maxAcc(maxAcceleration)
+, newLimits(false)
+{
+}
+
+OnlineTrajectoryThread::~OnlineTrajectoryThread()
+{
+}
+
+bool OnlineTrajectoryThread::threadInit()
+{
+    task = std::make_shared<ocra_recipes::TaskConnection>(name);
+    ocra::TaskState startState = task->getDesiredTaskState();
+    Eigen::Vector3d startPosition = startState.getPosition().getTranslation();
+    Eigen::Vector3d startVelocity = Eigen::Vector3d::Zero();
+    if (startState.hasVelocity()) {
+        startVelocity = startState.getVelocity().getLinearVelocity();
+    }
+    generator.reset(startPosition, startVelocity);
+
+    std::lock_guard<std::mutex> lock(goalMutex);
+    position = startPosition;
+    if (!newGoal) {
+        goal = startPosition;
+    }
+    return true;
+}
+
+void OnlineTrajectoryThread::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(goalMutex);
+        if (newLimits) {
+            generator.setMaxVelocity(maxVel);
+            generator.setMaxAcceleration(maxAcc);
+            newLimits = false;
+        }
+        if (newGoal) {
+            generator.setGoal(goal);
+            newGoal = false;
+        }
+    }
+
+    bool wasReached = generator.isGoalReached();
+    generator.step();
+
+    // Once the goal is reached the task holds it by itself.
+    if (!wasReached) {
+        desiredState.setPosition(ocra::util::eigenVectorToDisplacementd(generator.getPosition()));
+        desiredState.setVelocity(ocra::util::eigenVectorToTwistd(generator.getVelocity()));
+        desiredState.setAcceleration(ocra::util::eigenVectorToTwistd(generator.getAcceleration()));
+        task->setDesiredTaskStateDirect(desiredState);
+    }
+
+    std::lock_guard<std::mutex> lock(goalMutex);
+    position = generator.getPosition();
+    goalReached = generator.isGoalReached() && !newGoal;
+}
+
+void OnlineTrajectoryThread::threadRelease()
+{
+}
+
+void OnlineTrajectoryThread::setGoal(const Eigen::Vector3d& newGoalPosition)
+{
+    std::lock_guard<std::mutex> lock(goalMutex);
+    goal = newGoalPosition;
+    newGoal = true;
+    goalReached = false;
+}
+
+Eigen::Vector3d OnlineTrajectoryThread::getGoal()
+{
+    std::lock_guard<std::mutex> lock(goalMutex);
+    return goal;
+}
+
+void OnlineTrajectoryThread::setMaxVelocity(double maxVelocity)
+{
+    std::lock_guard<std::mutex> lock(goalMutex);
+    maxVel = maxVelocity;
+    newLimits = true;
+}
+
+void OnlineTrajectoryThread::setMaxAcceleration(double maxAcceleration)
+{
+    std::lock_guard<std::mutex> lock(goalMutex);
+    maxAcc = maxAcceleration;
+    newLimits = true;
+}
+
+bool OnlineTrajectoryThread::isGoalReached()
+{
+    std::lock_guard<std::mutex> lock(goalMutex);
+    return goalReached;
+}
+
+double OnlineTrajectoryThread::getDistanceToGoal()
+{
+    std::lock_guard<std::mutex> lock(goalMutex);
+    return (goal - position).norm();
+}
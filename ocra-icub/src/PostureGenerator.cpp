@@ -0,0 +1,347 @@
+/*! \file       PostureGenerator.cpp
+ *  \brief      Statically balanced postures computed on the model and cached on disk.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/PostureGenerator.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+#include <yarp/os/Os.h>
+#include <ocra/util/ErrorsHelper.h>
+
+using namespace ocra_icub;
+
+namespace
+{
+    const int MAX_ITERATIONS = 300;
+    const double RESIDUAL_TOLERANCE = 1e-5;
+    const double DAMPING = 1e-3;            // Damping of the least squares, squared.
+    const double MAX_JOINT_STEP = 0.1;      // Largest joint displacement per iteration (rad).
+    const double POSTURE_GAIN = 0.1;        // Gain of the regularisation towards the reference, in the null space of the tasks.
+    const double JOINT_LIMIT_MARGIN = 2.0 * DEG_TO_RAD;
+
+    Eigen::Matrix3d skew(const Eigen::Vector3d& v)
+    {
+        Eigen::Matrix3d S;
+        S <<     0.0, -v(2),  v(1),
+                v(2),   0.0, -v(0),
+               -v(1),  v(0),   0.0;
+        return S;
+    }
+
+    std::string hashKey(const std::string& key)
+    {
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(fnv1aHash(key)));
+        return std::string(buffer);
+    }
+}
+
+PostureRequest::PostureRequest()
+: support(POSTURE_DOUBLE_SUPPORT)
+, comOffset(Eigen::Vector2d::Zero())
+, comHeight(0.0)
+, feetSeparation(0.0)
+, swingFootHeight(0.05)
+{
+}
+
+std::string PostureRequest::toString() const
+{
+    std::stringstream ss;
+    ss.precision(6);
+    ss << (support == POSTURE_DOUBLE_SUPPORT ? "double" : (support == POSTURE_LEFT_SUPPORT ? "left" : "right"));
+    ss << " " << comOffset(0) << " " << comOffset(1) << " " << comHeight << " " << feetSeparation << " " << swingFootHeight;
+    return ss.str();
+}
+
+bool PostureRequest::fromBottle(const yarp::os::Bottle& bottle)
+{
+    if (bottle.size() < 1 || !bottle.get(0).isString()) {
+        return false;
+    }
+    std::string s = bottle.get(0).asString();
+    if (s == "double") {
+        support = POSTURE_DOUBLE_SUPPORT;
+    } else if (s == "left") {
+        support = POSTURE_LEFT_SUPPORT;
+    } else if (s == "right") {
+        support = POSTURE_RIGHT_SUPPORT;
+    } else {
+        return false;
+    }
+    if (bottle.size() > 1) comOffset(0) = bottle.get(1).asDouble();
+    if (bottle.size() > 2) comOffset(1) = bottle.get(2).asDouble();
+    if (bottle.size() > 3) comHeight = bottle.get(3).asDouble();
+    if (bottle.size() > 4) feetSeparation = bottle.get(4).asDouble();
+    if (bottle.size() > 5) swingFootHeight = bottle.get(5).asDouble();
+    return true;
+}
+
+PostureGenerator::PostureGenerator(std::shared_ptr<ocra::Model> modelPtr, const std::string& cacheDirectory)
+: model(modelPtr)
+, cacheDir(cacheDirectory.empty() ? getDefaultCacheDirectory() : cacheDirectory)
+, lastResidual(0.0)
+{
+    referencePosture = Eigen::VectorXd::Zero(model->nbInternalDofs());
+    getNominalPosture(*model, referencePosture);
+}
+
+PostureGenerator::~PostureGenerator()
+{
+}
+
+void PostureGenerator::setReferencePosture(const Eigen::VectorXd& reference)
+{
+    referencePosture = reference;
+}
+
+bool PostureGenerator::getPosture(const PostureRequest& request, Eigen::VectorXd& q)
+{
+    std::string key = getCacheKey(request);
+    if (loadFromCache(key, q)) {
+        return true;
+    }
+    if (!computePosture(request, q)) {
+        return false;
+    }
+    saveToCache(key, q);
+    return true;
+}
+
+bool PostureGenerator::getCachedPosture(const PostureRequest& request, Eigen::VectorXd& q) const
+{
+    return loadFromCache(getCacheKey(request), q);
+}
+
+bool PostureGenerator::computePosture(const PostureRequest& request, Eigen::VectorXd& q)
+{
+    const int n = model->nbInternalDofs();
+    const bool freeRoot = !model->hasFixedRoot();
+
+    // Saved to be restored at the end.
+    Eigen::VectorXd savedQ = model->getJointPositions();
+    Eigen::VectorXd savedDq = model->getJointVelocities();
+    Eigen::Displacementd savedRoot = freeRoot ? model->getFreeFlyerPosition() : Eigen::Displacementd::Identity();
+    Eigen::Twistd savedRootVelocity = freeRoot ? model->getFreeFlyerVelocity() : Eigen::Twistd::Zero();
+
+    int leftSole = model->getSegmentIndex("l_sole");
+    int rightSole = model->getSegmentIndex("r_sole");
+    int stance = (request.support == POSTURE_LEFT_SUPPORT) ? leftSole : rightSole;
+    int other = (stance == leftSole) ? rightSole : leftSole;
+
+    Eigen::VectorXd lower = model->getJointLowerLimits();
+    Eigen::VectorXd upper = model->getJointUpperLimits();
+    for (int i=0; i<n; ++i) {
+        double margin = std::min(JOINT_LIMIT_MARGIN, 0.5 * (upper(i) - lower(i)));
+        lower(i) += margin;
+        upper(i) -= margin;
+    }
+
+    q = referencePosture.cwiseMax(lower).cwiseMin(upper);
+    setJointPositions(q);
+
+    // Lateral position of the other sole in the stance sole frame.
+    Eigen::Displacementd H_stance = model->getSegmentPosition(stance);
+    Eigen::Vector3d otherInStance = H_stance.getRotation().adjoint().transpose() * (model->getSegmentPosition(other).getTranslation() - H_stance.getTranslation());
+    double side = (otherInStance(1) != 0.0) ? std::copysign(1.0, otherInStance(1)) : (stance == rightSole ? 1.0 : -1.0);
+    double separation = (request.feetSeparation > 0.0) ? side * request.feetSeparation : otherInStance(1);
+
+    Eigen::Vector3d footTarget(0.0, separation, (request.support == POSTURE_DOUBLE_SUPPORT) ? 0.0 : request.swingFootHeight);
+    Eigen::Vector2d comTarget = request.comOffset;
+    if (request.support == POSTURE_DOUBLE_SUPPORT) {
+        comTarget += 0.5 * footTarget.head<2>();
+    }
+
+    const int comRows = (request.comHeight > 0.0) ? 3 : 2;
+    const int m = comRows + 6;
+    Eigen::MatrixXd J(m, n);
+    Eigen::VectorXd e(m);
+    Eigen::MatrixXd JJt(m, m);
+    Eigen::VectorXd dq(n);
+
+    bool converged = false;
+    for (int iter=0; iter<MAX_ITERATIONS; ++iter) {
+        H_stance = model->getSegmentPosition(stance);
+        const Eigen::Displacementd& H_other = model->getSegmentPosition(other);
+        Eigen::Matrix3d Rs = H_stance.getRotation().adjoint();
+        Eigen::Vector3d os = H_stance.getTranslation();
+        Eigen::Matrix3d Rf = H_other.getRotation().adjoint();
+        Eigen::Vector3d of = H_other.getTranslation();
+
+        // The segment Jacobians are [angular; linear] in the world frame.
+        Eigen::MatrixXd Js = model->getSegmentJacobian(stance).rightCols(n);
+        Eigen::MatrixXd Jf = model->getSegmentJacobian(other).rightCols(n);
+        Eigen::MatrixXd Jc = model->getCoMJacobian().rightCols(n);
+        Eigen::Vector3d com = model->getCoMPosition();
+
+        // Velocity of a point in the stance sole frame: Rs^T (v - vs + (p - os) x ws)
+        Eigen::Vector3d comInStance = Rs.transpose() * (com - os);
+        Eigen::MatrixXd Jcom = Rs.transpose() * (Jc - Js.bottomRows(3) + skew(com - os) * Js.topRows(3));
+        Eigen::Vector3d footInStance = Rs.transpose() * (of - os);
+        Eigen::MatrixXd Jfoot = Rs.transpose() * (Jf.bottomRows(3) - Js.bottomRows(3) + skew(of - os) * Js.topRows(3));
+        Eigen::AngleAxisd relativeRotation(Eigen::Matrix3d(Rs.transpose() * Rf));
+        Eigen::MatrixXd Jrot = Rs.transpose() * (Jf.topRows(3) - Js.topRows(3));
+
+        e.head(2) = comTarget - comInStance.head<2>();
+        J.topRows(2) = Jcom.topRows(2);
+        if (comRows == 3) {
+            e(2) = request.comHeight - comInStance(2);
+            J.row(2) = Jcom.row(2);
+        }
+        e.segment<3>(comRows) = footTarget - footInStance;
+        J.middleRows(comRows, 3) = Jfoot;
+        e.tail<3>() = -relativeRotation.angle() * relativeRotation.axis();
+        J.bottomRows(3) = Jrot;
+
+        lastResidual = e.norm();
+        if (lastResidual < RESIDUAL_TOLERANCE) {
+            converged = true;
+            break;
+        }
+
+        // Damped least squares on the tasks, and a pull towards the reference in their null space.
+        JJt.noalias() = J * J.transpose();
+        JJt.diagonal().array() += DAMPING;
+        Eigen::MatrixXd Jpinv = J.transpose() * JJt.ldlt().solve(Eigen::MatrixXd::Identity(m, m));
+        dq = Jpinv * e;
+        Eigen::VectorXd pull = POSTURE_GAIN * (referencePosture - q);
+        dq += pull - Jpinv * (J * pull);
+
+        double stepNorm = dq.cwiseAbs().maxCoeff();
+        if (stepNorm > MAX_JOINT_STEP) {
+            dq *= MAX_JOINT_STEP / stepNorm;
+        }
+        q = (q + dq).cwiseMax(lower).cwiseMin(upper);
+        setJointPositions(q);
+    }
+
+    if (freeRoot) {
+        model->setState(savedRoot, savedQ, savedRootVelocity, savedDq);
+    } else {
+        model->setState(savedQ, savedDq);
+    }
+
+    if (!converged) {
+        OCRA_WARNING("No balanced posture found for (" << request.toString() << "), the residual is " << lastResidual << ". The request may be out of reach or against the joint limits.")
+    }
+    return converged;
+}
+
+double PostureGenerator::getLastResidual() const
+{
+    return lastResidual;
+}
+
+std::string PostureGenerator::getDefaultCacheDirectory()
+{
+    const char* dir = std::getenv("OCRA_ICUB_POSTURE_CACHE");
+    if (dir != NULL) {
+        return std::string(dir);
+    }
+    const char* home = std::getenv("HOME");
+    return std::string(home != NULL ? home : ".") + "/.ocra-icub/postures";
+}
+
+std::string PostureGenerator::getCacheKey(const PostureRequest& request) const
+{
+    std::stringstream ss;
+    ss.precision(6);
+    ss << model->getName() << " " << model->nbInternalDofs() << " " << !model->hasFixedRoot();
+    const Eigen::VectorXd& lower = model->getJointLowerLimits();
+    const Eigen::VectorXd& upper = model->getJointUpperLimits();
+    for (int i=0; i<model->nbInternalDofs(); ++i) {
+        ss << " " << model->getJointName(i) << " " << lower(i) << " " << upper(i) << " " << referencePosture(i);
+    }
+    ss << " | " << request.toString();
+    return ss.str();
+}
+
+std::string PostureGenerator::getCacheFilePath(const std::string& key) const
+{
+    return cacheDir + "/" + model->getName() + "_" + hashKey(key) + ".txt";
+}
+
+bool PostureGenerator::loadFromCache(const std::string& key, Eigen::VectorXd& q) const
+{
+    std::ifstream file(getCacheFilePath(key).c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string storedKey;
+    std::getline(file, storedKey);
+    if (storedKey != key) {
+        return false;
+    }
+    int n = model->nbInternalDofs();
+    Eigen::VectorXd cached(n);
+    for (int i=0; i<n; ++i) {
+        std::string jointName;
+        if (!(file >> jointName >> cached(i)) || jointName != model->getJointName(i)) {
+            return false;
+        }
+    }
+    q = cached;
+    return true;
+}
+
+void PostureGenerator::saveToCache(const std::string& key, const Eigen::VectorXd& q) const
+{
+    yarp::os::mkdir_p(cacheDir.c_str());
+    std::string path = getCacheFilePath(key);
+    std::string tmpPath = path + ".tmp" + std::to_string(getpid()) + "_" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmpPath.c_str());
+        if (!file.is_open()) {
+            OCRA_WARNING("Could not write the posture cache file " << tmpPath)
+            return;
+        }
+        file.precision(17);
+        file << key << "\n";
+        for (int i=0; i<q.size(); ++i) {
+            file << model->getJointName(i) << " " << q(i) << "\n";
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        OCRA_WARNING("Could not move " << tmpPath << " to " << path)
+        std::remove(tmpPath.c_str());
+    }
+}
+
+void PostureGenerator::setJointPositions(const Eigen::VectorXd& q)
+{
+    Eigen::VectorXd zero = Eigen::VectorXd::Zero(q.size());
+    if (model->hasFixedRoot()) {
+        model->setState(q, zero);
+    } else {
+        // The root stays at the origin, every quantity is measured relative to the stance sole.
+        model->setState(Eigen::Displacementd::Identity(), q, Eigen::Twistd::Zero(), zero);
+    }
+}
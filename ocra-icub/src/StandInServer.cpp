@@ -0,0 +1,375 @@
+/*! \file       StandInServer.cpp
+ *  \brief      A controller server which runs inside the process of a client, on a kinematic model of the robot.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/StandInServer.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <yarp/os/Time.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <ocra/util/ErrorsHelper.h>
+
+#include <ocra-icub/OcraWbiModel.h>
+#include <ocra-icub/PostureGenerator.h>
+
+using namespace ocra_icub;
+
+StandInServerOptions::StandInServerOptions()
+: wbiConfigFilePath("")
+, robotName("icubGazeboSim")
+, isFloatingBase(false)
+, startupTaskSetPath("")
+, controllerType(ocra_recipes::WOCRA_CONTROLLER)
+, solver(ocra_recipes::QUADPROG)
+, threadPeriod(10)
+, speedUp(1.0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//                                               StandInControllerServer
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+StandInControllerServer::StandInControllerServer(std::shared_ptr<ocra::Model> robotModel,
+                                                 const ocra_recipes::CONTROLLER_TYPE ctrlType,
+                                                 const ocra_recipes::SOLVER_TYPE solver)
+: ocra_recipes::ControllerServer(ctrlType, solver, true, false)
+, robot(robotModel)
+, nDoF(robotModel->nbInternalDofs())
+, rootPosition(Eigen::Displacementd::Identity())
+{
+    jointPositions = Eigen::VectorXd::Zero(nDoF);
+    jointVelocities = Eigen::VectorXd::Zero(nDoF);
+    rootVelocity = Eigen::VectorXd::Zero(6);
+}
+
+StandInControllerServer::~StandInControllerServer()
+{
+}
+
+ocra::Model::Ptr StandInControllerServer::loadRobotModel()
+{
+    return robot;
+}
+
+void StandInControllerServer::getRobotState(Eigen::VectorXd& q, Eigen::VectorXd& qd, Eigen::Displacementd& H_root, Eigen::Twistd& T_root)
+{
+    q = jointPositions;
+    qd = jointVelocities;
+    if (!robot->hasFixedRoot()) {
+        H_root = rootPosition;
+        T_root = Eigen::Twistd(rootVelocity[0], rootVelocity[1], rootVelocity[2], rootVelocity[3], rootVelocity[4], rootVelocity[5]);
+    }
+}
+
+void StandInControllerServer::setJointPositions(const Eigen::VectorXd& q)
+{
+    jointPositions = q.cwiseMax(robot->getJointLowerLimits()).cwiseMin(robot->getJointUpperLimits());
+    jointVelocities.setZero();
+    rootVelocity.setZero();
+}
+
+void StandInControllerServer::integrate(double dt)
+{
+    const Eigen::VectorXd& ddq = robot->getAccelerationVariable().getValue();
+    int rootDoF = robot->hasFixedRoot() ? 0 : 6;
+    if (ddq.size() != rootDoF + nDoF) {
+        // The controller has not solved yet.
+        return;
+    }
+
+    // Semi-implicit Euler: the new velocity moves the position, which keeps a stiff task from diverging.
+    jointVelocities += dt * ddq.tail(nDoF);
+    jointPositions += dt * jointVelocities;
+    const Eigen::VectorXd& lower = robot->getJointLowerLimits();
+    const Eigen::VectorXd& upper = robot->getJointUpperLimits();
+    for (int i=0; i<nDoF; ++i) {
+        if (jointPositions[i] < lower[i] || jointPositions[i] > upper[i]) {
+            jointPositions[i] = std::min(std::max(jointPositions[i], lower[i]), upper[i]);
+            jointVelocities[i] = 0.0;
+        }
+    }
+
+    if (rootDoF > 0) {
+        rootVelocity += dt * ddq.head(6);
+        Eigen::Vector3d angularVelocity = rootVelocity.head(3);
+        Eigen::Vector3d translation = rootPosition.getTranslation();
+        translation += dt * rootVelocity.tail(3);
+        Eigen::Quaterniond orientation(rootPosition.qw(), rootPosition.qx(), rootPosition.qy(), rootPosition.qz());
+        double angle = dt * angularVelocity.norm();
+        if (angle > 1e-12) {
+            orientation = Eigen::Quaterniond(Eigen::AngleAxisd(angle, angularVelocity.normalized())) * orientation;
+            orientation.normalize();
+        }
+        rootPosition = Eigen::Displacementd(translation.x(), translation.y(), translation.z(), orientation.w(), orientation.x(), orientation.y(), orientation.z());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//                                               StandInServer
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+StandInServer::RpcCallback::RpcCallback(StandInServer& serverRef)
+: server(serverRef)
+{
+}
+
+bool StandInServer::RpcCallback::read(yarp::os::ConnectionReader& connection)
+{
+    yarp::os::Bottle input, reply;
+    if (!input.read(connection)) {
+        return false;
+    }
+    server.parseIncomingMessage(input, reply);
+    yarp::os::ConnectionWriter* returnToSender = connection.getWriter();
+    if (returnToSender != NULL) {
+        reply.write(*returnToSender);
+    }
+    return true;
+}
+
+StandInServer::StandInServer(const StandInServerOptions& serverOptions)
+: RateThread(std::max(1, int(std::round(serverOptions.threadPeriod / (serverOptions.speedUp > 0.0 ? serverOptions.speedUp : 1.0)))))
+, options(serverOptions)
+, rpcCallback(*this)
+, controllerStatus(CONTROLLER_SERVER_STOPPED)
+, nRpcRequests(0)
+, nTicks(0)
+, tickDurationSum(0.0)
+, startTime(0.0)
+{
+    if (options.speedUp <= 0.0) {
+        OCRA_WARNING("The speed up must be positive. Using 1.0.")
+        options.speedUp = 1.0;
+    }
+}
+
+StandInServer::~StandInServer()
+{
+}
+
+bool StandInServer::threadInit()
+{
+    modelInitializer = std::make_shared<ModelInitializer>(options.wbiConfigFilePath, options.robotName, options.isFloatingBase);
+    model = modelInitializer->getModel();
+    if (!model) {
+        OCRA_ERROR("Could not build the model from " << options.wbiConfigFilePath)
+        return false;
+    }
+
+    ctrlServer = std::make_shared<StandInControllerServer>(model, options.controllerType, options.solver);
+    // Start from the balanced double support posture of the cache. It is not computed here so the startup is not held up by the optimisation.
+    Eigen::VectorXd initialPosture = Eigen::VectorXd::Zero(model->nbInternalDofs());
+    PostureGenerator postureGenerator(model);
+    if (!postureGenerator.getCachedPosture(PostureRequest(), initialPosture)) {
+        OCRA_WARNING("No balanced posture is cached for this robot, run posture-cache-generator to add it. Starting from the nominal posture.")
+        getNominalPosture(*model, initialPosture);
+    }
+    ctrlServer->setJointPositions(initialPosture);
+    ctrlServer->initialize();
+
+    if (!options.startupTaskSetPath.empty()) {
+        ctrlServer->addTasksFromXmlFile(options.startupTaskSetPath);
+    }
+
+    l_foot_disp_inverse = model->getSegmentPosition("l_foot").inverse();
+    torques = Eigen::VectorXd::Zero(model->nbInternalDofs());
+
+    if (!rpcPort.open("/ocra-icub-server/info/rpc:i")) {
+        OCRA_ERROR("Could not open /ocra-icub-server/info/rpc:i. Is another controller server running?")
+        return false;
+    }
+    rpcPort.setReader(rpcCallback);
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        nTicks = 0;
+        tickDurationSum = 0.0;
+        startTime = yarp::os::Time::now();
+    }
+    controllerStatus = CONTROLLER_SERVER_RUNNING;
+    return true;
+}
+
+void StandInServer::run()
+{
+    double tickStart = yarp::os::Time::now();
+
+    ctrlServer->computeTorques(torques);
+    ctrlServer->integrate(options.threadPeriod / 1000.0);
+
+    double tickDuration = yarp::os::Time::now() - tickStart;
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++nTicks;
+    tickDurationSum += tickDuration;
+}
+
+void StandInServer::threadRelease()
+{
+    controllerStatus = CONTROLLER_SERVER_STOPPED;
+    rpcPort.interrupt();
+    rpcPort.close();
+}
+
+std::shared_ptr<ocra::Model> StandInServer::getModel()
+{
+    return model;
+}
+
+std::shared_ptr<StandInControllerServer> StandInServer::getControllerServer()
+{
+    return ctrlServer;
+}
+
+double StandInServer::getSimulatedTime() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return nTicks * options.threadPeriod / 1000.0;
+}
+
+int StandInServer::getNumberOfTicks() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return nTicks;
+}
+
+double StandInServer::getMeanTickDuration() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return nTicks > 0 ? tickDurationSum / nTicks : 0.0;
+}
+
+double StandInServer::getRealTimeFactor() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    double wallTime = yarp::os::Time::now() - startTime;
+    return (nTicks > 0 && wallTime > 0.0) ? (nTicks * options.threadPeriod / 1000.0) / wallTime : 0.0;
+}
+
+int StandInServer::getNumberOfRpcRequests() const
+{
+    return nRpcRequests;
+}
+
+OCRA_ICUB_MESSAGE StandInServer::convertStringToOcraIcubMessage(const std::string& s)
+{
+    std::string _s = ocra::util::convertToUpperCase(s);
+    if (_s=="HELP") {
+        return HELP;
+    } else if (_s=="GET_MODEL_CONFIG_INFO") {
+        return GET_MODEL_CONFIG_INFO;
+    } else if (_s=="GET_CONTROLLER_SERVER_STATUS") {
+        return GET_CONTROLLER_SERVER_STATUS;
+    } else if (_s=="GET_L_FOOT_POSE") {
+        return GET_L_FOOT_POSE;
+    } else if (_s=="GET_MODEL_UPDATE_INFO") {
+        return GET_MODEL_UPDATE_INFO;
+    } else if (_s=="SWAP_CONTROLLER") {
+        return SWAP_CONTROLLER;
+    } else if (_s=="GET_CONTROLLER_SWAP_STATUS") {
+        return GET_CONTROLLER_SWAP_STATUS;
+    } else {
+        return FAILURE;
+    }
+}
+
+void StandInServer::parseIncomingMessage(yarp::os::Bottle& input, yarp::os::Bottle& reply)
+{
+    ++nRpcRequests;
+    bool convertStringToTag = false;
+    int btlSize = input.size();
+    for (int i=0; i<btlSize; ++i)
+    {
+        OCRA_ICUB_MESSAGE tag;
+        if (convertStringToTag) {
+            tag = convertStringToOcraIcubMessage(input.get(i).asString());
+            convertStringToTag = false;
+        } else {
+            tag = OCRA_ICUB_MESSAGE(input.get(i).asInt());
+        }
+        switch (tag) {
+            case GET_CONTROLLER_SERVER_STATUS:
+                {
+                    reply.addInt(controllerStatus);
+                }break;
+
+            case GET_MODEL_CONFIG_INFO:
+                {
+                    reply.addString(options.wbiConfigFilePath);
+                    reply.addString(options.robotName);
+                    reply.addInt(options.isFloatingBase);
+                }break;
+
+            case GET_L_FOOT_POSE:
+                {
+                    ocra::util::pourDisplacementdIntoBottle(l_foot_disp_inverse, reply);
+                }break;
+
+            case GET_MODEL_UPDATE_INFO:
+                {
+                    std::shared_ptr<OcraWbiModel> wbiModel = std::dynamic_pointer_cast<OcraWbiModel>(model);
+                    if (wbiModel) {
+                        reply.addInt(wbiModel->getModelUpdatePeriod());
+                        reply.addDouble(wbiModel->getModelUpdateThreshold());
+                        reply.addInt(wbiModel->getTicksSinceModelRefresh());
+                        reply.addDouble(wbiModel->getConfigurationDrift());
+                        reply.addDouble(wbiModel->getInertiaApproximationError());
+                        reply.addDouble(wbiModel->getInertiaRefreshError());
+                    } else {
+                        reply.addInt(FAILURE);
+                    }
+                }break;
+
+            case SWAP_CONTROLLER:
+                {
+                    // Skip the controller type and the solver.
+                    i += 2;
+                    reply.addInt(FAILURE);
+                    reply.addString("The stand-in server does not swap controllers.");
+                }break;
+
+            case GET_CONTROLLER_SWAP_STATUS:
+                {
+                    // Same reply as a real server which never swapped.
+                    reply.addInt(0);
+                    reply.addString("");
+                    reply.addInt(options.controllerType);
+                    reply.addInt(options.solver);
+                }break;
+
+            case STRING_MESSAGE:
+                {
+                    convertStringToTag = true;
+                }break;
+
+            case HELP:
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,154 @@
+/*! \file       TaskConvergence.cpp
+ *  \brief      Per tick errors and convergence flags of the active tasks, published by the controller server.
+ *  \details
+ *  \author     [Ryan Lober](http://www.ryanlober.com)
+ *  \date       Feb 2016
+ *  \copyright  GNU General Public License.
+ */
+/*
+ *  This file is part of ocra-icub.
+ *  Copyright (C) 2016 Institut des Systèmes Intelligents et de Robotique (ISIR)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ocra-icub/TaskConvergence.h>
+
+#include <yarp/os/Network.h>
+#include <ocra/util/ErrorsHelper.h>
+
+using namespace ocra_icub;
+
+const std::string TaskConvergenceListener::SERVER_PORT_NAME = "/ocra-icub-server/convergence:o";
+
+TaskConvergence::TaskConvergence()
+: taskName("")
+, positionError(0.0)
+, orientationError(0.0)
+, velocityError(0.0)
+, converged(false)
+{
+}
+
+void TaskConvergence::toBottle(yarp::os::Bottle& bottle) const
+{
+    bottle.clear();
+    bottle.addString(taskName);
+    bottle.addDouble(positionError);
+    bottle.addDouble(orientationError);
+    bottle.addDouble(velocityError);
+    bottle.addInt(converged ? 1 : 0);
+}
+
+bool TaskConvergence::fromBottle(const yarp::os::Bottle& bottle)
+{
+    if (bottle.size() != 5 || !bottle.get(0).isString()) {
+        return false;
+    }
+    taskName = bottle.get(0).asString();
+    positionError = bottle.get(1).asDouble();
+    orientationError = bottle.get(2).asDouble();
+    velocityError = bottle.get(3).asDouble();
+    converged = bottle.get(4).asInt() != 0;
+    return true;
+}
+
+TaskConvergenceListener::StatusPort::StatusPort(TaskConvergenceListener& listener)
+: owner(listener)
+{
+}
+
+void TaskConvergenceListener::StatusPort::onRead(yarp::os::Bottle& bottle)
+{
+    if (bottle.size() < 2) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(owner.statusMutex);
+    owner.lastTick = bottle.get(0).asInt();
+    owner.tasks.clear();
+    for (int i=2; i<bottle.size(); ++i) {
+        TaskConvergence convergence;
+        yarp::os::Bottle* entry = bottle.get(i).asList();
+        if (entry != NULL && convergence.fromBottle(*entry)) {
+            owner.tasks[convergence.taskName] = convergence;
+        }
+    }
+}
+
+TaskConvergenceListener::TaskConvergenceListener(const std::string& clientName)
+: name(clientName)
+, port(*this)
+, portIsOpen(false)
+, lastTick(-1)
+{
+}
+
+TaskConvergenceListener::~TaskConvergenceListener()
+{
+    close();
+}
+
+bool TaskConvergenceListener::open()
+{
+    std::string portName = "/" + name + "/convergence:i";
+    if (!port.open(portName)) {
+        OCRA_ERROR("Could not open " << portName)
+        return false;
+    }
+    port.useCallback();
+    portIsOpen = true;
+    if (!yarp::os::Network::connect(SERVER_PORT_NAME, portName)) {
+        OCRA_ERROR("Could not connect " << SERVER_PORT_NAME << " to " << portName << ".")
+        return false;
+    }
+    return true;
+}
+
+void TaskConvergenceListener::close()
+{
+    if (portIsOpen) {
+        port.interrupt();
+        port.close();
+        portIsOpen = false;
+    }
+}
+
+bool TaskConvergenceListener::getConvergence(const std::string& taskName, TaskConvergence& convergence)
+{
+    std::lock_guard<std::mutex> lock(statusMutex);
+    auto it = tasks.find(taskName);
+    if (it == tasks.end()) {
+        return false;
+    }
+    convergence = it->second;
+    return true;
+}
+
+bool TaskConvergenceListener::isConverged(const std::string& taskName)
+{
+    TaskConvergence convergence;
+    return getConvergence(taskName, convergence) && convergence.converged;
+}
+
+bool TaskConvergenceListener::isConverged(const std::string& taskName, double positionThreshold)
+{
+    TaskConvergence convergence;
+    return getConvergence(taskName, convergence) && convergence.positionError < positionThreshold;
+}
+
+int TaskConvergenceListener::getLastTick()
+{
+    std::lock_guard<std::mutex> lock(statusMutex);
+    return lastTick;
+}
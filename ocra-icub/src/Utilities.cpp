@@ -53,3 +53,12 @@ void getHomePosture(const ocra::Model& model, Eigen::VectorXd &q)
     q[model.getDofIndex("l_elbow")]        =   50.0*DEG_TO_RAD;//PI/4.0;
     q[model.getDofIndex("r_elbow")]        =   50.0*DEG_TO_RAD;//PI/4.0;
 }
+
+uint64_t ocra_icub::fnv1aHash(const std::string& data, uint64_t hash)
+{
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}